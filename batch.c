@@ -0,0 +1,893 @@
+/* batch mode: reads transitions (one per line) and writes one line of results per transition
+the input is split into chunks which are parsed, calculated and formatted in parallel by a pool
+of worker threads, then written out in input order
+input and output can also be in the binary columnar format (see bcol.c), in which case a chunk
+is a range of rows, and its output is one row group */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "bcalc.h"
+
+#define BATCH_CHUNK_SIZE        262144 /* target size of a chunk of input (bytes) */
+#define BATCH_CHUNKS_PER_THREAD 8 /* chunks read in at once, per thread */
+#define BATCH_MAX_TOK           64 /* maximum length of a multipole column */
+#define BATCH_MAX_ARGS          64 /* maximum number of words in a command line (BATCH_CMD input) */
+
+/* a chunk of whole input lines (or rows of binary input), and the formatted output for them */
+typedef struct
+{
+  const char *data; /* input text */
+  size_t len; /* length of input text */
+  const bcolGroup *grp; /* binary input (NULL for text input) */
+  size_t firstRow, numRows; /* rows of grp */
+  unsigned long firstLine; /* line (or row) number of the first line */
+  unsigned long numErr; /* number of lines that could not be processed */
+  strBuf out; /* formatted output (only error messages with binary output) */
+  bcolBuf col; /* binary output */
+  statCounts st; /* timings and error counts (with --stats) */
+  rcacheCtx cc; /* result cache lookups (with --cache) */
+  int done; /* 1 once the chunk is processed */
+}batchChunk;
+
+/* chunks owned by a worker thread, taken from the front by the owner and stolen from the back by others */
+typedef struct
+{
+  pthread_mutex_t lock;
+  size_t lo, hi;
+}batchQueue;
+
+typedef struct
+{
+  const bcalcTrans *tdef; /* default parameters */
+  int inMode; /* input columns with lifetimes or B values, or command lines (BATCH_LT, BATCH_B or BATCH_CMD) */
+  int fmt; /* output format (OUT_BIN for binary output) */
+  int stats; /* 1=collect statistics */
+  const rcache *rc; /* result cache (NULL=none) */
+  int numThreads;
+  batchChunk *chunks;
+  batchQueue *queues;
+  pthread_mutex_t lock; /* protects gen, quit and the done flags of chunks */
+  pthread_cond_t workCond; /* signalled when new chunks are queued */
+  pthread_cond_t doneCond; /* signalled when a chunk is done */
+  unsigned long gen; /* incremented each time new chunks are queued */
+  int quit;
+}batchPool;
+
+typedef struct
+{
+  batchPool *pool;
+  int id;
+}batchWorkerArg;
+
+/* formats the results for a single transition on one line */
+void formatRow(strBuf *sb, const bcalcTrans *t, const bcalcRes *r){
+  char ustr[32], mstr1[16];
+  if(t->calcMode == 0){
+    getBUnit(ustr,sizeof(ustr),t->EM,t->L,t->barn);
+    sbPuts(sb,"B(");
+    sbPuts(sb,t->mstr);
+    sbPuts(sb,") = ");
+    sbPutExp(sb,r->b,4);
+    sbPutc(sb,' ');
+    sbPuts(sb,ustr);
+    if(t->useDelta){
+      getMixedMstr(mstr1,sizeof(mstr1),t);
+      getBUnit(ustr,sizeof(ustr),!t->EM,t->L+1,t->barn);
+      sbPuts(sb,"\tB(");
+      sbPuts(sb,mstr1);
+      sbPuts(sb,") = ");
+      sbPutExp(sb,r->b1,4);
+      sbPutc(sb,' ');
+      sbPuts(sb,ustr);
+    }
+  }else{
+    sbPuts(sb,"lifetime = ");
+    sbPutExp(sb,r->lt,4);
+    sbPuts(sb," ps");
+    if(r->branching != 1.){
+      sbPuts(sb," (partial lifetime)");
+    }
+  }
+  if(t->calcB2){
+    sbPuts(sb,"\tbeta_2 = ");
+    sbPutExp(sb,r->beta2,4);
+  }
+  sbPutc(sb,'\n');
+}
+
+/* reports a line (or row) which could not be processed, as an error message appended to sb
+or as a record with the error (for structured output formats)
+colNum is the column where parsing failed (0 if not applicable), r is NULL for parse errors */
+static void batchErr(strBuf *sb, const int fmt, bcolBuf *col, const char *what, const unsigned long lineNum, const unsigned long colNum, const bcalcTrans *t, const bcalcRes *r, const int err, const char *msg){
+  char estr[320];
+  if(col != NULL){
+    bcolAppend(col,lineNum,t,r,err);
+  }else if(fmt != OUT_TEXT){
+    if(colNum > 0){
+      snprintf(estr,sizeof(estr),"column %lu: %s",colNum,msg);
+      msg = estr;
+    }
+    formatRecord(sb,fmt,lineNum,t,r,err,msg);
+    return;
+  }
+  if(colNum > 0)
+    sbPrintf(sb,"ERROR: %s %lu, column %lu: %s\n",what,lineNum,colNum,msg);
+  else
+    sbPrintf(sb,"ERROR: %s %lu: %s\n",what,lineNum,msg);
+}
+
+/* writes out the results of a calculation, to col if given or else to sb in the output format fmt */
+static void batchRes(strBuf *sb, const int fmt, bcolBuf *col, const unsigned long lineNum, const bcalcTrans *t, const bcalcRes *r){
+  if(col != NULL)
+    bcolAppend(col,lineNum,t,r,BCALC_OK);
+  else if(fmt == OUT_TEXT)
+    formatRow(sb,t,r);
+  else
+    formatRecord(sb,fmt,lineNum,t,r,BCALC_OK,NULL);
+}
+
+/* parses one line of batch input (not NUL terminated) into t, as columns or (for BATCH_CMD input)
+as a command line of transition parameters
+returns 1 for a transition, 0 for a blank or comment line, or -1 if the line could not be parsed
+err is set to BCOL_ERR_PARSE (with the message in estr and the column in colNum, 0 if not
+applicable) or the error code for an invalid parameter value */
+static int parseLine(const char *line, const size_t len, const bcalcTrans *tdef, const int inMode, bcalcTrans *t, int *err, char *estr, const size_t estrLen, unsigned long *colNum){
+
+  const char *tok[BATCH_MAX_ARGS];
+  size_t tokLen[BATCH_MAX_ARGS];
+  char mstr[BATCH_MAX_TOK];
+  const char *end = line + len;
+  const char *p = line;
+  const int maxTok = (inMode == BATCH_CMD) ? BATCH_MAX_ARGS : BATCH_MAX_COLS;
+  double val;
+  int i, merr;
+  int numTok = 0;
+
+  *err = BCOL_ERR_PARSE;
+  *colNum = 0;
+
+  /* split the line into whitespace separated columns */
+  while(p < end){
+    while((p < end)&&isColSep(*p))
+      p++;
+    if((p == end)||(*p == '#'))
+      break;
+    if(numTok >= maxTok){
+      snprintf(estr,estrLen,"too many fields.");
+      *colNum = (unsigned long)(p - line) + 1;
+      return -1;
+    }
+    tok[numTok] = p;
+    while((p < end)&&!isColSep(*p))
+      p++;
+    tokLen[numTok] = (size_t)(p - tok[numTok]);
+    numTok++;
+  }
+  if(numTok == 0){
+    return 0; /* blank or comment line */
+  }
+  if(inMode == BATCH_CMD){
+    *t = *tdef;
+    *err = parseTransArgs(tok,tokLen,numTok,t,&i,estr,estrLen);
+    if(*err == OPT_ERR_PARSE)
+      *colNum = (unsigned long)(tok[i] - line) + 1;
+    return (*err == BCALC_OK) ? 1 : -1;
+  }
+  if(numTok < 3){
+    snprintf(estr,estrLen,"at least 3 columns (energy, multipole, %s) are needed.",(inMode == BATCH_B) ? "B" : "lifetime");
+    return -1;
+  }
+
+  *t = *tdef;
+  t->calcMode = (inMode == BATCH_B);
+  for(i=0;i<numTok;i++){
+    if((tokLen[i] == 1)&&(tok[i][0] == '-')){
+      continue; /* use the default value */
+    }
+    if(i==1){
+      if(tokLen[i] >= BATCH_MAX_TOK){
+        break;
+      }
+      memcpy(mstr,tok[i],tokLen[i]);
+      mstr[tokLen[i]] = '\0';
+      if((merr=bcalcParseMultipole(mstr,t))!=BCALC_OK){
+        *err = merr;
+        return -1;
+      }
+      continue;
+    }
+    if(!parseDouble(tok[i],tokLen[i],&val)){
+      if((i==8)&&(bcalcParseNuclide(tok[i],tokLen[i],&t->nucA,&t->nucZ) == BCALC_OK)){
+        continue; /* nuclide name in place of A, sets A and Z */
+      }
+      break;
+    }
+    switch(i){
+      case 0:
+        t->Et = val;
+        break;
+      case 2:
+        if(inMode == BATCH_B)
+          t->b = val;
+        else
+          t->lt = val;
+        break;
+      case 3:
+        t->branching = val;
+        break;
+      case 4:
+        t->delta = val;
+        t->useDelta = 1;
+        break;
+      case 5:
+        t->icc = val;
+        t->iccAuto = 0;
+        break;
+      case 6:
+        t->ji = val;
+        break;
+      case 7:
+        t->jf = val;
+        break;
+      case 8:
+        t->nucA = (int)val;
+        break;
+      case 9:
+      default:
+        t->nucZ = (int)val;
+        break;
+    }
+  }
+  if(i<numTok){
+    snprintf(estr,estrLen,"invalid value '%.*s' in field %i.",(int)tokLen[i],tok[i],i+1);
+    *colNum = (unsigned long)(tok[i] - line) + 1;
+    return -1;
+  }
+  *err = BCALC_OK;
+  return 1;
+}
+
+/* processes one line of batch input (not NUL terminated), appending the result or an error message to sb
+in the output format fmt (or the result to col, if given, with error messages still going to sb)
+st collects timings and error counts (NULL if not needed)
+results are taken from (and stored in) the result cache rc if given, cc holds the state of the lookups in the chunk
+returns 1 if the line could not be processed */
+int processLine(const char *line, const size_t len, const unsigned long lineNum, const bcalcTrans *tdef, const int inMode, const int fmt, strBuf *sb, bcolBuf *col, statCounts *st, const rcache *rc, rcacheCtx *cc){
+
+  bcalcTrans t;
+  bcalcRes r;
+  char estr[256];
+  unsigned long colNum;
+  uint64_t key[2];
+  uint64_t tm = 0;
+  int ret, err;
+  int keyed = 0;
+  int cached = 0;
+  int haveRes; /* 1 if r is set */
+
+  if(st != NULL)
+    tm = statsNow();
+  if(rc != NULL){
+    keyed = rcacheKey(rc,line,len,key);
+    if(keyed){
+      cached = rcacheGet(rc,key,cc,&t,&r,&err);
+      if(cached)
+        cc->hits++;
+      else
+        cc->misses++;
+    }
+    if(st != NULL){
+      st->numCached += (unsigned long)cached;
+      statsLap(st,STAT_CACHE,&tm);
+    }
+    if(!keyed){
+      return 0; /* blank or comment line */
+    }
+  }
+
+  haveRes = cached;
+  if(!cached){
+    ret = parseLine(line,len,tdef,inMode,&t,&err,estr,sizeof(estr),&colNum);
+    if(st != NULL)
+      statsLap(st,STAT_PARSE,&tm);
+    if(ret == 0){
+      return 0;
+    }
+    if(err == BCOL_ERR_PARSE){
+      batchErr(sb,fmt,col,"line",lineNum,colNum,tdef,NULL,BCOL_ERR_PARSE,estr);
+      if(st != NULL){
+        statsErr(st,err);
+        statsLap(st,STAT_FORMAT,&tm);
+      }
+      return 1;
+    }
+    if(err == BCALC_OK){
+      err = (st != NULL) ? statsCompute(&t,&r,st,&tm) : bcalcCompute(&t,&r);
+      haveRes = 1;
+      if(keyed){
+        rcachePut(rc,key,cc,&t,&r,err);
+        if(st != NULL)
+          statsLap(st,STAT_CACHE,&tm);
+      }
+    }
+  }
+
+  if(haveRes && r.warn){
+    fprintf(stderr,"WARNING: line %lu: initial and final spin unknown for B(%s) up, assuming a 2 -> 0 transition.\n",lineNum,t.mstr);
+  }
+  if(err != BCALC_OK){
+    if(!haveRes)
+      memset(&r,0,sizeof(bcalcRes)); /* invalid value found while parsing */
+    getErrStr(estr,sizeof(estr),err,&t);
+    batchErr(sb,fmt,col,"line",lineNum,0,&t,&r,err,estr);
+  }else{
+    batchRes(sb,fmt,col,lineNum,&t,&r);
+  }
+  if(st != NULL){
+    if(err != BCALC_OK)
+      statsErr(st,err);
+    statsLap(st,STAT_FORMAT,&tm);
+  }
+  return (err != BCALC_OK);
+}
+
+/* processes one row of binary input, like processLine
+returns 1 if the row could not be processed */
+static int processRow(const bcolGroup *g, const size_t row, const unsigned long rowNum, const bcalcTrans *tdef, const int fmt, strBuf *sb, bcolBuf *col, statCounts *st){
+
+  bcalcTrans t = *tdef;
+  bcalcRes r;
+  char estr[256];
+  uint64_t tm = 0;
+  int err;
+
+  if(st != NULL)
+    tm = statsNow();
+  memset(&r,0,sizeof(bcalcRes));
+  err = bcolRowTrans(g,row,&t);
+  if(st != NULL)
+    statsLap(st,STAT_PARSE,&tm);
+  if(err == BCALC_OK){
+    err = (st != NULL) ? statsCompute(&t,&r,st,&tm) : bcalcCompute(&t,&r);
+    if(r.warn){
+      fprintf(stderr,"WARNING: row %lu: initial and final spin unknown for B(%s) up, assuming a 2 -> 0 transition.\n",rowNum,t.mstr);
+    }
+  }
+  if(err != BCALC_OK){
+    getErrStr(estr,sizeof(estr),err,&t);
+    batchErr(sb,fmt,col,"row",rowNum,0,&t,&r,err,estr);
+  }else{
+    batchRes(sb,fmt,col,rowNum,&t,&r);
+  }
+  if(st != NULL){
+    if(err != BCALC_OK)
+      statsErr(st,err);
+    statsLap(st,STAT_FORMAT,&tm);
+  }
+  return (err != BCALC_OK);
+}
+
+/* processes all lines (or rows) in a chunk, stats=1 collects statistics in the chunk
+lines are looked up in the result cache rc, if given (rows of binary input are not cached) */
+static void processChunk(batchChunk *c, const bcalcTrans *tdef, const int inMode, const int fmt, const int stats, const rcache *rc){
+  const char *p = c->data;
+  const char *end = c->data + c->len;
+  const char *nl;
+  bcolBuf *col = (fmt == OUT_BIN) ? &c->col : NULL;
+  statCounts *st = NULL;
+  unsigned long lineNum = c->firstLine;
+  size_t i;
+  c->numErr = 0;
+  c->out.len = 0;
+  c->col.n = 0;
+  memset(&c->cc,0,sizeof(rcacheCtx));
+  if(stats){
+    st = &c->st;
+    memset(st,0,sizeof(statCounts));
+  }
+  if(c->grp != NULL){
+    for(i=0;i<c->numRows;i++){
+      c->numErr += (unsigned long)processRow(c->grp,c->firstRow + i,lineNum + i,tdef,fmt,&c->out,col,st);
+    }
+    return;
+  }
+  while(p < end){
+    nl = memchr(p,'\n',(size_t)(end - p));
+    if(nl == NULL)
+      nl = end;
+    c->numErr += (unsigned long)processLine(p,(size_t)(nl - p),lineNum,tdef,inMode,fmt,&c->out,col,st,rc,&c->cc);
+    lineNum++;
+    p = nl + 1;
+  }
+}
+
+/* takes a chunk index from the worker's own queue, or steals one from the back of the fullest other queue
+returns 0 if there are no chunks left */
+static int takeChunk(batchPool *p, const int w, size_t *idx){
+  int i, v;
+  size_t n, maxN;
+  pthread_mutex_lock(&p->queues[w].lock);
+  if(p->queues[w].lo < p->queues[w].hi){
+    *idx = p->queues[w].lo++;
+    pthread_mutex_unlock(&p->queues[w].lock);
+    return 1;
+  }
+  pthread_mutex_unlock(&p->queues[w].lock);
+  for(;;){
+    v = -1;
+    maxN = 0;
+    for(i=0;i<p->numThreads;i++){
+      pthread_mutex_lock(&p->queues[i].lock);
+      n = p->queues[i].hi - p->queues[i].lo;
+      pthread_mutex_unlock(&p->queues[i].lock);
+      if(n > maxN){
+        maxN = n;
+        v = i;
+      }
+    }
+    if(v < 0){
+      return 0;
+    }
+    pthread_mutex_lock(&p->queues[v].lock);
+    if(p->queues[v].lo < p->queues[v].hi){
+      *idx = --p->queues[v].hi;
+      pthread_mutex_unlock(&p->queues[v].lock);
+      return 1;
+    }
+    pthread_mutex_unlock(&p->queues[v].lock);
+  }
+}
+
+static void *batchWorker(void *arg){
+  batchWorkerArg *a = (batchWorkerArg *)arg;
+  batchPool *p = a->pool;
+  unsigned long gen = 0;
+  size_t idx;
+  for(;;){
+    pthread_mutex_lock(&p->lock);
+    while((p->gen == gen)&&(!p->quit))
+      pthread_cond_wait(&p->workCond,&p->lock);
+    if(p->quit){
+      pthread_mutex_unlock(&p->lock);
+      break;
+    }
+    gen = p->gen;
+    pthread_mutex_unlock(&p->lock);
+    while(takeChunk(p,a->id,&idx)){
+      processChunk(&p->chunks[idx],p->tdef,p->inMode,p->fmt,p->stats,p->rc);
+      pthread_mutex_lock(&p->lock);
+      p->chunks[idx].done = 1;
+      pthread_cond_broadcast(&p->doneCond);
+      pthread_mutex_unlock(&p->lock);
+    }
+  }
+  return NULL;
+}
+
+/* splits whole lines of input into chunks, returns the number of chunks
+numLines is advanced by the number of lines */
+static size_t splitChunks(const char *data, const size_t len, batchChunk *chunks, const size_t maxChunks, const size_t chunkSize, unsigned long *numLines){
+  size_t pos = 0;
+  size_t n = 0;
+  size_t end;
+  const char *nl, *p;
+  while((pos < len)&&(n < maxChunks)){
+    end = pos + chunkSize;
+    if((end >= len)||(n == maxChunks-1)){
+      end = len;
+    }else{
+      nl = memchr(data + end,'\n',len - end);
+      end = (nl == NULL) ? len : (size_t)(nl - data) + 1;
+    }
+    chunks[n].data = data + pos;
+    chunks[n].len = end - pos;
+    chunks[n].grp = NULL;
+    chunks[n].firstLine = *numLines + 1;
+    chunks[n].done = 0;
+    /* count lines (a final line without a newline counts too) */
+    for(p=data+pos;(p<data+end)&&((nl=memchr(p,'\n',(size_t)(data+end-p)))!=NULL);p=nl+1)
+      (*numLines)++;
+    if(p < data+end)
+      (*numLines)++;
+    pos = end;
+    n++;
+  }
+  return n;
+}
+
+/* writes out the results of a processed chunk (to outFd in the binary format, if outFd >= 0) */
+static void flushChunk(batchChunk *c, const int outFd){
+  if(outFd < 0){
+    sbFlush(&c->out,stdout);
+    return;
+  }
+  sbFlush(&c->out,stderr);
+  if(bcolWriteGroup(outFd,&c->col) != 0){
+    printf("ERROR: Cannot write binary output.\n");
+    exit(-1);
+  }
+}
+
+/* processes chunks, in parallel if a pool is given, and writes out the results in order
+st collects timings and error counts (NULL if not needed), rc is the result cache (NULL if none)
+returns the number of lines which could not be processed */
+static unsigned long runChunks(batchPool *p, batchChunk *chunks, const size_t numChunks, const bcalcTrans *tdef, const int inMode, const int fmt, const int outFd, statCounts *st, rcache *rc){
+  unsigned long numErr = 0;
+  uint64_t tm = 0;
+  size_t i, per;
+  int w;
+
+  if(p == NULL){
+    for(i=0;i<numChunks;i++){
+      processChunk(&chunks[i],tdef,inMode,fmt,(st != NULL),rc);
+      if(st != NULL)
+        tm = statsNow();
+      flushChunk(&chunks[i],outFd);
+      numErr += chunks[i].numErr;
+      if(rc != NULL)
+        rcacheAdd(rc,&chunks[i].cc);
+      if(st != NULL){
+        statsLap(st,STAT_OUTPUT,&tm);
+        statsAdd(st,&chunks[i].st);
+      }
+    }
+    return numErr;
+  }
+
+  /* give each worker a contiguous range of chunks */
+  per = (numChunks + (size_t)p->numThreads - 1)/(size_t)p->numThreads;
+  for(w=0;w<p->numThreads;w++){
+    pthread_mutex_lock(&p->queues[w].lock);
+    p->queues[w].lo = (size_t)w*per < numChunks ? (size_t)w*per : numChunks;
+    p->queues[w].hi = (size_t)(w+1)*per < numChunks ? (size_t)(w+1)*per : numChunks;
+    pthread_mutex_unlock(&p->queues[w].lock);
+  }
+  pthread_mutex_lock(&p->lock);
+  p->gen++;
+  pthread_cond_broadcast(&p->workCond);
+  pthread_mutex_unlock(&p->lock);
+
+  /* write out results in input order as they become available */
+  for(i=0;i<numChunks;i++){
+    if(st != NULL)
+      tm = statsNow();
+    pthread_mutex_lock(&p->lock);
+    while(!chunks[i].done)
+      pthread_cond_wait(&p->doneCond,&p->lock);
+    pthread_mutex_unlock(&p->lock);
+    if(st != NULL)
+      statsLap(st,STAT_WAIT,&tm);
+    flushChunk(&chunks[i],outFd);
+    numErr += chunks[i].numErr;
+    if(rc != NULL)
+      rcacheAdd(rc,&chunks[i].cc);
+    if(st != NULL){
+      statsLap(st,STAT_OUTPUT,&tm);
+      statsAdd(st,&chunks[i].st);
+    }
+  }
+  return numErr;
+}
+
+/* processes a block of whole lines, in parallel if a pool is given, and writes out the results in order
+returns the number of lines which could not be processed */
+static unsigned long processBlock(const char *data, const size_t len, batchPool *p, batchChunk *chunks, const size_t maxChunks, const bcalcTrans *tdef, const int inMode, const int fmt, const int outFd, unsigned long *numLines, statCounts *st, rcache *rc){
+  uint64_t tm = 0;
+  size_t numChunks;
+  if(st != NULL)
+    tm = statsNow();
+  numChunks = splitChunks(data,len,chunks,maxChunks,BATCH_CHUNK_SIZE,numLines);
+  if(st != NULL)
+    statsLap(st,STAT_INPUT,&tm);
+  return runChunks(p,chunks,numChunks,tdef,inMode,fmt,outFd,st,rc);
+}
+
+/* processes a mapped binary columnar input file, in chunks of rows
+returns the number of rows which could not be processed, numRows is set to the number of rows */
+static unsigned long processCol(const char *data, const size_t size, batchPool *p, batchChunk *chunks, const size_t maxChunks, const bcalcTrans *tdef, const int fmt, const int outFd, unsigned long *numRows, statCounts *st){
+  bcolIn in;
+  bcolGroup g;
+  unsigned long numErr = 0;
+  size_t row, n;
+  int ret;
+
+  if(bcolOpen(data,size,&in) != 0){
+    exit(-1);
+  }
+  while((ret = bcolNextGroup(&in,&g)) == 1){
+    row = 0;
+    while(row < g.numRows){
+      for(n=0;(n<maxChunks)&&(row<g.numRows);n++){
+        chunks[n].data = NULL;
+        chunks[n].len = 0;
+        chunks[n].grp = &g;
+        chunks[n].firstRow = row;
+        chunks[n].numRows = (g.numRows - row < BCOL_CHUNK_ROWS) ? g.numRows - row : BCOL_CHUNK_ROWS;
+        chunks[n].firstLine = *numRows + 1;
+        chunks[n].done = 0;
+        row += chunks[n].numRows;
+        *numRows += chunks[n].numRows;
+      }
+      numErr += runChunks(p,chunks,n,tdef,BATCH_LT,fmt,outFd,st,NULL);
+      fflush(stdout);
+    }
+  }
+  if(ret < 0){
+    printf("ERROR: Binary columnar input is truncated or invalid (after row %lu).\n",*numRows);
+    exit(-1);
+  }
+  return numErr;
+}
+
+/* processes a whole input file mapped into memory, in blocks of whole lines (without copying)
+returns the number of lines which could not be processed */
+static unsigned long processMapped(const char *data, const size_t size, const size_t blockSize, batchPool *p, batchChunk *chunks, const size_t maxChunks, const bcalcTrans *tdef, const int inMode, const int fmt, const int outFd, unsigned long *numLines, statCounts *st, rcache *rc){
+  unsigned long numErr = 0;
+  size_t pos = 0;
+  size_t end;
+  const char *nl;
+  while(pos < size){
+    end = pos + blockSize;
+    if(end >= size){
+      end = size;
+    }else{
+      nl = memchr(data + end,'\n',size - end);
+      end = (nl == NULL) ? size : (size_t)(nl - data) + 1;
+    }
+    numErr += processBlock(data + pos,end - pos,p,chunks,maxChunks,tdef,inMode,fmt,outFd,numLines,st,rc);
+    fflush(stdout);
+    pos = end;
+  }
+  return numErr;
+}
+
+/* reads input into buf, blocking until some input is available and then continuing
+for as long as more is immediately available (so that interactive input is processed
+line by line, while files and fast pipes are read in large blocks)
+returns the number of bytes read, eof is set at the end of the input */
+static size_t readAvail(const int fd, char *buf, const size_t space, int *eof){
+  size_t got = 0;
+  ssize_t n;
+  struct pollfd pfd;
+  while(got < space){
+    n = read(fd,buf+got,space-got);
+    if(n < 0){
+      if(errno == EINTR)
+        continue;
+      printf("ERROR: Cannot read batch input.\n");
+      exit(-1);
+    }
+    if(n == 0){
+      *eof = 1;
+      break;
+    }
+    got += (size_t)n;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    if(poll(&pfd,1,0) <= 0)
+      break;
+  }
+  return got;
+}
+
+/* returns the number of online processors */
+int getNumCPUs(void){
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return (n > 0) ? (int)n : 1;
+}
+
+/* reads transitions from a file or stdin (one per line), and prints one line of results per transition
+columns: energy, multipole, lifetime (or B, for BATCH_B input), br, delta, icc, ji, jf, A, Z
+or for BATCH_CMD input, transition parameters as on the command line (eg. -e 1332 -m E2 -lt 0.9)
+regular files are mapped into memory, other input (pipes, terminals) is read in blocks
+files in the binary columnar format are used in place, and if binOutFile is given (- for stdout),
+the results are written to it in the binary columnar format instead of being printed
+fmt is the format of printed results (OUT_TEXT, or a structured record format)
+numThreads <= 0 uses all online processors
+if rs is given, statistics are collected and printed to stderr at the end
+if rc is given, results of lines are taken from (and stored in) this result cache, with the lookups counted in it */
+int runBatch(const char *fileName, const bcalcTrans *tdef, const int inMode, int numThreads, const char *binOutFile, int fmt, runStats *rs, rcache *rc){
+
+  int fd = STDIN_FILENO;
+  int outFd = -1;
+  int binIn = 0;
+  batchPool pool;
+  batchPool *p = NULL;
+  pthread_t *threads = NULL;
+  batchWorkerArg *args = NULL;
+  batchChunk *chunks;
+  char *buf = NULL;
+  char *nbuf;
+  const char *nl;
+  void *map = NULL;
+  struct stat st;
+  size_t mapSize = 0;
+  size_t maxChunks, cap, have, blockLen, i;
+  unsigned long numLines = 0;
+  unsigned long numErr = 0;
+  strBuf hdr;
+  statCounts *sc = (rs != NULL) ? &rs->c : NULL;
+  uint64_t tm = 0;
+  int w, eof = 0;
+
+  if(fileName != NULL){
+    if((fd=open(fileName,O_RDONLY))<0){
+      printf("ERROR: Cannot open the batch input file %s!\n",fileName);
+      exit(-1);
+    }
+    if((fstat(fd,&st) == 0)&&S_ISREG(st.st_mode)&&(st.st_size > 0)){
+      mapSize = (size_t)st.st_size;
+      map = mmap(NULL,mapSize,PROT_READ,MAP_PRIVATE,fd,0);
+      if(map == MAP_FAILED){
+        map = NULL; /* read it instead */
+      }else{
+        posix_madvise(map,mapSize,POSIX_MADV_SEQUENTIAL);
+      }
+    }
+  }
+  if((map != NULL)&&(mapSize >= strlen(BCOL_MAGIC))&&(memcmp(map,BCOL_MAGIC,strlen(BCOL_MAGIC)) == 0)){
+    binIn = 1;
+  }
+  if(binOutFile != NULL){
+    if(strcmp(binOutFile,"-") == 0){
+      outFd = STDOUT_FILENO;
+    }else if((outFd=open(binOutFile,O_WRONLY|O_CREAT|O_TRUNC,0644))<0){
+      printf("ERROR: Cannot open the binary output file %s!\n",binOutFile);
+      exit(-1);
+    }
+    if(bcolWriteHeader(outFd) != 0){
+      printf("ERROR: Cannot write binary output.\n");
+      exit(-1);
+    }
+    fmt = OUT_BIN;
+  }else{
+    sbInit(&hdr);
+    formatRecordHeader(&hdr,fmt);
+    sbFlush(&hdr,stdout);
+    sbFree(&hdr);
+  }
+  if(numThreads <= 0){
+    numThreads = getNumCPUs();
+  }
+
+  maxChunks = (size_t)numThreads*BATCH_CHUNKS_PER_THREAD;
+  cap = maxChunks*BATCH_CHUNK_SIZE;
+  if(map == NULL)
+    buf = malloc(cap);
+  chunks = calloc(maxChunks,sizeof(batchChunk));
+  if(((map == NULL)&&(buf == NULL))||(chunks == NULL)){
+    printf("ERROR: Cannot allocate memory for batch input.\n");
+    exit(-1);
+  }
+  for(i=0;i<maxChunks;i++){
+    sbInit(&chunks[i].out);
+    bcolInit(&chunks[i].col);
+  }
+
+  /* start the worker threads */
+  if(numThreads > 1){
+    p = &pool;
+    p->tdef = tdef;
+    p->inMode = inMode;
+    p->fmt = fmt;
+    p->stats = (rs != NULL);
+    p->rc = rc;
+    p->numThreads = numThreads;
+    p->chunks = chunks;
+    p->gen = 0;
+    p->quit = 0;
+    p->queues = calloc((size_t)numThreads,sizeof(batchQueue));
+    threads = calloc((size_t)numThreads,sizeof(pthread_t));
+    args = calloc((size_t)numThreads,sizeof(batchWorkerArg));
+    if((p->queues == NULL)||(threads == NULL)||(args == NULL)){
+      printf("ERROR: Cannot allocate memory for batch threads.\n");
+      exit(-1);
+    }
+    pthread_mutex_init(&p->lock,NULL);
+    pthread_cond_init(&p->workCond,NULL);
+    pthread_cond_init(&p->doneCond,NULL);
+    for(w=0;w<numThreads;w++){
+      pthread_mutex_init(&p->queues[w].lock,NULL);
+      args[w].pool = p;
+      args[w].id = w;
+      if(pthread_create(&threads[w],NULL,batchWorker,&args[w])!=0){
+        printf("ERROR: Cannot create batch thread.\n");
+        exit(-1);
+      }
+    }
+  }
+
+  if(binIn){
+    numErr = processCol((const char *)map,mapSize,p,chunks,maxChunks,tdef,fmt,outFd,&numLines,sc);
+    eof = 1;
+  }else if(map != NULL){
+    numErr = processMapped((const char *)map,mapSize,cap,p,chunks,maxChunks,tdef,inMode,fmt,outFd,&numLines,sc,rc);
+    eof = 1;
+  }
+
+  /* read blocks of whole lines, any partial line at the end of a block is carried over to the next */
+  have = 0;
+  while(!eof){
+    if(sc != NULL)
+      tm = statsNow();
+    have += readAvail(fd,buf+have,cap-have,&eof);
+    if(sc != NULL)
+      statsLap(sc,STAT_INPUT,&tm);
+    if((numLines == 0)&&(have >= strlen(BCOL_MAGIC))&&(memcmp(buf,BCOL_MAGIC,strlen(BCOL_MAGIC)) == 0)){
+      printf("ERROR: Binary columnar input must be a file (not a pipe).\n");
+      exit(-1);
+    }
+    if(eof){
+      blockLen = have;
+    }else{
+      /* find the end of the last whole line */
+      nl = buf + have;
+      while((nl > buf)&&(*(nl-1) != '\n'))
+        nl--;
+      blockLen = (size_t)(nl - buf);
+      if(blockLen == 0){
+        if(have == cap){
+          /* a single line longer than the buffer, grow it */
+          if((nbuf = realloc(buf,cap*2)) == NULL){
+            printf("ERROR: Cannot allocate memory for batch input.\n");
+            exit(-1);
+          }
+          buf = nbuf;
+          cap *= 2;
+        }
+        continue;
+      }
+    }
+    numErr += processBlock(buf,blockLen,p,chunks,maxChunks,tdef,inMode,fmt,outFd,&numLines,sc,rc);
+    fflush(stdout);
+    memmove(buf,buf+blockLen,have-blockLen);
+    have -= blockLen;
+  }
+  if(p != NULL){
+    pthread_mutex_lock(&p->lock);
+    p->quit = 1;
+    pthread_cond_broadcast(&p->workCond);
+    pthread_mutex_unlock(&p->lock);
+    for(w=0;w<numThreads;w++){
+      pthread_join(threads[w],NULL);
+      pthread_mutex_destroy(&p->queues[w].lock);
+    }
+    pthread_mutex_destroy(&p->lock);
+    pthread_cond_destroy(&p->workCond);
+    pthread_cond_destroy(&p->doneCond);
+    free(p->queues);
+    free(threads);
+    free(args);
+  }
+  for(i=0;i<maxChunks;i++){
+    sbFree(&chunks[i].out);
+    bcolFree(&chunks[i].col);
+  }
+  free(chunks);
+  free(buf);
+  if(map != NULL){
+    munmap(map,mapSize);
+  }
+  if(fd != STDIN_FILENO){
+    close(fd);
+  }
+  if((outFd >= 0)&&(outFd != STDOUT_FILENO)&&(close(outFd) != 0)){
+    printf("ERROR: Cannot write binary output.\n");
+    exit(-1);
+  }
+  if(numErr > 0){
+    fprintf(stderr,"%lu of %lu %s could not be processed.\n",numErr,numLines,binIn ? "rows" : "lines");
+  }
+  if(rs != NULL){
+    statsPrint(rs,numLines,binIn ? "row" : "line",stderr);
+  }
+
+  return 0;
+}
@@ -33,7 +33,28 @@ void printHelp(){
   printf("    -ji        --  inital spin (integer or half-integer)\n");
   printf("    -jf        --  final spin (integer or half-integer)\n");
   printf("    -A         --  mass number of the nucleus\n");
-  printf("    -Z         --  proton number of the nucleus\n");
+  printf("    -Z         --  proton number of the nucleus (if a conversion\n");
+  printf("                   coefficient table is used and -icc is not\n");
+  printf("                   given, the coefficient is taken from the table)\n");
+  printf("    -nuc       --  nuclide (eg. 152Sm or Sm152), sets -A and -Z\n");
+  printf("    --icctab   --  internal conversion coefficient table made by\n");
+  printf("                   mkicc (default: $BCALC_ICC_TABLE)\n");
+  printf("\n");
+  printf("  The -e, -lt, -hl, -b and -d parameters can also be given as\n");
+  printf("  a range START:STOP:STEP (or -d atan:START:STOP:STEP, with\n");
+  printf("  arctan(delta) in degrees), to calculate on a grid of values.\n");
+  printf("\n");
+  printf("  Uncertainties (given as X, or as +X,-Y for asymmetric\n");
+  printf("  uncertainties, and propagated by Monte Carlo sampling):\n");
+  printf("    -eerr      --  transition energy uncertainty in keV\n");
+  printf("    -lterr     --  lifetime or half-life uncertainty (in the same\n");
+  printf("                   units as the lifetime or half-life)\n");
+  printf("    -berr      --  reduced transition probability uncertainty\n");
+  printf("    -brerr     --  branching fraction uncertainty\n");
+  printf("    -derr      --  mixing ratio uncertainty\n");
+  printf("    -iccerr    --  internal conversion coefficient uncertainty\n");
+  printf("    --samples  --  number of Monte Carlo samples (default 1000000)\n");
+  printf("    --seed     --  random number seed (default 1)\n");
   printf("\n");
   printf(" --- Press any key for more ---");
   getc(stdin);
@@ -54,586 +75,569 @@ void printHelp(){
   printf("                   relative to another transition.\n");
   printf("    --beta2    --  Calculate the quadrupole deformation parameter,\n");
   printf("                   assuming a 2->0 (g.s.) E2 transition.  Requires\n");
-  printf("                   '-m E2 -ji 2 -jf 0', and the -A and -Z parameters.\n");
-  printf("                   Assumes mean charge radius R = r_0*A^(1/3), with\n");
-  printf("                   r_0 = 1.2 fm.\n");
+  printf("                   '-m E2 -ji 2 -jf 0', and the -A and -Z parameters\n");
+  printf("                   (or -nuc).  Uses the measured RMS charge radius\n");
+  printf("                   where tabulated (R^2 = 5/3 <r^2>), otherwise\n");
+  printf("                   R = r_0*A^(1/3) with r_0 = 1.2 fm.\n");
+  printf("    --precision -- Precision of the calculation: 'fast' (relative\n");
+  printf("                   error below %.1E), 'default' or 'exact'\n",BCALC_PREC_FAST_MAXREL);
+  printf("                   (extended precision reference).\n");
   printf("    --quiet    --  Only show the result of the calculation.\n");
+  printf("    --jacobian --  Also show the partial derivatives of each result\n");
+  printf("                   with respect to each input (E, lifetime or B,\n");
+  printf("                   br, d, icc, ji and jf with --up, and A).\n");
+  printf("    --batch    --  Read transitions from a file (or stdin if no file\n");
+  printf("                   is given), one per line, with the columns:\n");
+  printf("                   energy multipole lifetime br d icc ji jf A Z\n");
+  printf("                   Only the first 3 columns are required, use '-'\n");
+  printf("                   to skip a column.  Parameters and flags on the\n");
+  printf("                   command line are used as defaults for all lines.\n");
+  printf("    --bval     --  In batch mode, the third column is a reduced\n");
+  printf("                   transition probability rather than a lifetime\n");
+  printf("                   in ps.\n");
+  printf("    --commands --  Like --batch, but each line is a command line of\n");
+  printf("                   transition parameters and flags, eg.\n");
+  printf("                   -e 1332 -m E2 -lt 0.9 --wu -A 60\n");
+  printf("    --follow   --  Follow a batch input file which is being written\n");
+  printf("                   to (eg. --follow fits.txt), calculating each new\n");
+  printf("                   line as soon as it is complete.\n");
+  printf("    --binout   --  In batch mode, write the results to the given\n");
+  printf("                   file (- for stdout) in the binary columnar\n");
+  printf("                   format.  Batch input files in this format are\n");
+  printf("                   recognized automatically.\n");
+  printf("    --cache    --  In batch mode, keep the results of each line in\n");
+  printf("                   the given file (eg. --cache results.cache), and\n");
+  printf("                   take them from there when the same line is read\n");
+  printf("                   again, so that only new or changed lines are\n");
+  printf("                   calculated.\n");
+  printf("    --cache-size --  Maximum number of results kept with --cache\n");
+  printf("                   (default %i), the oldest are replaced.\n",RCACHE_DEF_SIZE);
+  printf("    --stats    --  In batch mode, print statistics to stderr at the\n");
+  printf("                   end: the time spent in each stage (parsing,\n");
+  printf("                   validation, calculation, formatting, I/O),\n");
+  printf("                   lines/s, errors by type and peak memory use.\n");
+  printf("                   '--stats hw' also reads hardware counters\n");
+  printf("                   (cycles, instructions, cache misses) if the\n");
+  printf("                   system allows it.\n");
+  printf("    --format   --  Output format: text (the default), or csv, tsv\n");
+  printf("                   or json for one record per calculation with\n");
+  printf("                   the inputs and results in every unit.\n");
+  printf("    --threads  --  Number of threads used in batch mode and for\n");
+  printf("                   uncertainty propagation (default:\n");
+  printf("                   the number of processors).\n");
+  printf("    --ensdf    --  Calculate reduced transition probabilities for\n");
+  printf("                   all gammas with known level lifetimes in the\n");
+  printf("                   adopted datasets of an ENSDF file.\n");
+  printf("    --levels   --  Calculate partial lifetimes and reduced transition\n");
+  printf("                   probabilities for all gammas in a level scheme\n");
+  printf("                   file (levels with lifetimes, and their gammas\n");
+  printf("                   with relative intensities).\n");
+  printf("    --serve    --  Answer requests (one per line, with the same\n");
+  printf("                   parameters as the command line) from clients\n");
+  printf("                   connecting to the given Unix domain socket\n");
+  printf("                   (eg. --serve /tmp/bcalc.sock).\n");
+  printf("    --shm      --  Answer binary transition records from a request\n");
+  printf("                   ring in a POSIX shared memory region (created by\n");
+  printf("                   the producer, see shmring.h), eg. --shm /daq.\n");
+  printf("    --repl     --  Interactive session: change parameters with\n");
+  printf("                   commands such as 'set d 0.35' or 'set lt 2.1ns',\n");
+  printf("                   recalculating only what depends on them.\n");
+  printf("    --selftest --  Check the vectorized calculations against the\n");
+  printf("                   scalar calculations, measure the error of each\n");
+  printf("                   precision tier, check the parsing of batch\n");
+  printf("                   input lines, and exit.\n");
 }
 
-double dblfac(unsigned int n){ 
-  double val = 1.0;
-  int i;
-  for (i=(int)n; i>=0; i=i-2){
-    if (i==0 || i==1)
-      return val;
-    else
-      val *= i;
-  }
-  return val;
+/* writes the name of the L+1 multipole mixing with the given transition */
+void getMixedMstr(char *mstr1, const size_t len, const bcalcTrans *t){
+  if(t->mstr[0] == 'E')
+    snprintf(mstr1,len,"M%i",t->L+1);
+  else
+    snprintf(mstr1,len,"E%i",t->L+1);
 }
 
-/* calculates single particle lifetimes */
-double ltsp(const int EM, const int L, const int nucA, const double Et_keV){
-
-  double hl_sp = 0.;
-  double hbar = 6.58212E-19; /* keV s */
-  double hbarc = 197.327E-10; /* keV cm */
-  double esq = 1.440E-10; /* kev cm */
-  double muNsq = 1.5922E-38; /* keV cm^3 */
-  double RFac = 1.2E-13; /* cm */
-  if(EM == 0){
-    /* electric */
-    hl_sp = log(2.0)*L*pow(dblfac((unsigned int)(2*L + 1)),2.0)*hbar*pow(((3.0+L)/3.0),2.0)*pow(hbarc,2*L + 1)/(2.0*(L + 1.0)*esq*pow(RFac,2.0*L));
-    hl_sp /= (pow(Et_keV,2.0*L + 1)*pow(nucA,2.0*L/3.0));
+/* writes the unit string for a calculated reduced transition probability */
+void getBUnit(char *ustr, const size_t len, const int EM, const int L, const int barn){
+  if(barn == 2){
+    snprintf(ustr,len,"W.u.");
+  }else if(EM==0){
+    if(L>0){
+      if(barn == 1)
+        snprintf(ustr,len,"e^2 b^%i",L);
+      else
+        snprintf(ustr,len,"e^2 fm^%i",2*L);
+    }else{
+      snprintf(ustr,len,"e^2");
+    }
   }else{
-    /* magnetic */
-    hl_sp = log(2.0)*L*pow(dblfac((unsigned int)(2*L + 1)),2.0)*hbar*pow(((3.0+L)/3.0),2.0)*pow(hbarc,2*L + 1)/(80.0*(L + 1.0)*muNsq*pow(RFac,2.0*L - 2.0));
-    hl_sp /= (pow(Et_keV,2.0*L + 1)*pow(nucA,(2.0*L - 2.0)/3.0));
+    if(L>1){
+      if(barn == 1)
+        snprintf(ustr,len,"uN^2 b^%i",L-1);
+      else
+        snprintf(ustr,len,"uN^2 fm^%i",(2*L) - 2);
+    }else{
+      snprintf(ustr,len,"uN^2");
+    }
   }
-
-  //convert from half-life to lifetime (in s)
-  return hl_sp/LN2;
 }
 
-/* calculates the value of the quadrupole deformation parameter, assuming an input reduced transtion probability and a 2->0 transition */
-void calcBeta2(const double Et, const double b_in, const int nucA, const int nucZ, const int barn, const int verbose){
-  
-  double b=0.;
+/* writes the (single line) description of an error code */
+void getErrStr(char *estr, const size_t len, const int err, const bcalcTrans *t){
+  switch(err){
+    case BCALC_ERR_ENERGY:
+      snprintf(estr,len,"Invalid transition energy (%f).  Value must be a positive number.",t->Et);
+      break;
+    case BCALC_ERR_JI:
+      snprintf(estr,len,"Invalid initial spin value provided (%0.1f).  The value must be a positive integer or half-integer.",t->ji);
+      break;
+    case BCALC_ERR_JF:
+      snprintf(estr,len,"Invalid final spin value provided (%0.1f).  The value must be a positive integer or half-integer.",t->jf);
+      break;
+    default:
+      snprintf(estr,len,"%s",bcalcErrStr(err));
+      break;
+  }
+}
 
-  if(barn == 2){
-    /* input using Weisskopf units, first calculate lifetime */
-    double lt = ltsp(0,2,nucA,Et*1000.)/b_in;
-    /* calculate b from lifetime */
-    double fac = 8.0*PI*(2+1)/(2*HBAR_MEVS*pow(dblfac((2.0*2)+1.0),2.0)*LN2);
-    fac = fac * (pow((Et/HBARC_MEVFM),2.0*2 + 1.0));
-    b=1/(fac*lt); /* lifetime to reduced transition probability (E2: e^2 fm^4) */
+/* prints an error message (with hints for missing parameters) */
+void printErr(const int err, const bcalcTrans *t){
+  char estr[256];
+  getErrStr(estr,sizeof(estr),err,t);
+  if(err == BCALC_ERR_M0){
+    printf("%s\n",estr);
   }else{
-    b=b_in;
+    printf("ERROR: %s\n",estr);
   }
+  if(err == BCALC_ERR_NOENERGY){
+    printf("    -e  --  transition energy in keV\n");
+  }else if(err == BCALC_ERR_NOMULTIPOLE){
+    printf("    -m  --  multipole (eg. E1, M1, E2, etc.)\n");
+  }else if(err == BCALC_ERR_NOVALUE){
+    printf("   -lt  --  Mean transition lifetime (in ps)\n");
+    printf("   -hl  --  Transition half-life (in ps)\n");
+    printf("   -b   --  Reduced transition probability\n");
+  }
+}
 
-  double beta = sqrt(5*b)*4.0*PI/(2*nucZ*ESQ_MEVFM*1.20*1.20*pow(1.0*nucA,2.0/3.0));
-
-  if(verbose){
-    printf("\nbeta_2 CALCULATION\n-----------------\n");
-    printf("%0.4E\n",beta);
+/* parses an uncertainty given as X (symmetric) or +X,-Y (asymmetric) into unc = {upper, lower}
+returns 0 on success */
+int parseUnc(const char *str, double *unc){
+  char *end;
+  unc[0] = fabs(strtod(str,&end));
+  if(end == str)
+    return -1;
+  if(*end == ','){
+    str = end + 1;
+    unc[1] = fabs(strtod(str,&end));
+    if(end == str)
+      return -1;
   }else{
-    printf("beta_2 = %0.4E\n",beta);
+    unc[1] = unc[0];
   }
-  
+  if(*end != '\0')
+    return -1;
+  return 0;
 }
 
-/* calculates the value of the quadrupole deformation parameter, assuming an input lifetime and a 2->0 transition */
-void calcBeta2Lt(const double Et, const double lt, const int nucA, const int nucZ, const int verbose){
-
-  double fac = 8.0*PI*(2+1)/(2*HBAR_MEVS*pow(dblfac((unsigned int)((2.0*2)+1.0)),2.0)*LN2);
-  fac = fac * (pow((Et/HBARC_MEVFM),2.0*2 + 1.0));
-  
-  double b=1/(fac*lt); /* lifetime to reduced transition probability (E2: e^2 fm^4) */
-  calcBeta2(Et,b,nucA,nucZ,0,verbose);
-  
+/* formats the median and intervals of a Monte Carlo result distribution */
+void printDist(strBuf *sb, const int verbose, const char *name, const char *ustr, const bcalcDist *d){
+  if(verbose){
+    sbPrintf(sb,"%s: %0.4E +%0.4E -%0.4E %s (median, 68.3%% interval)\n",name,d->median,d->hi68-d->median,d->median-d->lo68,ustr);
+    sbPrintf(sb,"    95.4%% interval: %0.4E to %0.4E %s\n",d->lo95,d->hi95,ustr);
+  }else{
+    sbPrintf(sb,"%s = %0.4E +%0.4E -%0.4E %s (95.4%%: %0.4E to %0.4E)\n",name,d->median,d->hi68-d->median,d->median-d->lo68,ustr,d->lo95,d->hi95);
+  }
 }
 
-/* calculates the value of the reduced transtion probability */
-void calcB(const int bup, const int EM, const int L, const double Et, const double lt, const double ji, const double jf, const int verbose, const int barn, const char *mstr, const int nucA){
+/* formats a calculated reduced transition probability */
+void printB(strBuf *sb, const int verbose, const char *mstr, const int EM, const int L, const int barn, const double b){
+  char ustr[32];
   if(verbose){
-    printf("\nB(%s) CALCULATION\n-----------------\n",mstr);
+    sbPrintf(sb,"\nB(%s) CALCULATION\n-----------------\n",mstr);
   }
+  getBUnit(ustr,sizeof(ustr),EM,L,barn);
+  sbPutExp(sb,b,4);
+  sbPutc(sb,' ');
+  sbPuts(sb,ustr);
+  sbPutc(sb,'\n');
+}
 
-  if(barn == 2){
-    /* Weisskopf unit calculation */
-    double lt_sp = ltsp(EM,L,nucA,Et*1000.);
-    printf("%0.4E W.u.\n",lt_sp/lt);
-    return;
+/* formats a labelled lifetime (in ps), in units suited to its size */
+void putLifetime(strBuf *sb, const char *label, const double lt){
+  if(lt < 1E3){
+    sbPrintf(sb,"%s: %0.3f ps\n",label,lt);
+  }else if(lt < 1E12){
+    sbPrintf(sb,"%s: %0.3f ns\n",label,lt/((double)1E3));
+  }else if(lt < 1E16){
+    sbPrintf(sb,"%s: %0.3f s\n",label,lt/((double)1E12));
+  }else{
+    sbPrintf(sb,"%s: %0.3f hr\n",label,lt/(3600.0*(double)1E12));
   }
+}
 
-  double fac = 8.0*PI*(L+1)/(L*HBAR_MEVS*pow(dblfac((unsigned int)((2.0*L)+1.0)),2.0)*LN2);
-  fac = fac * (pow((Et/HBARC_MEVFM),2.0*L + 1.0));
-  /* lifetime to reduced transition probability */
-  if(EM==0){
-    /* electric */
-    /* e^2 fm^(2L) */
-    double b=1/(fac*lt);
-    if(bup){
-      b = b*(2.0*ji + 1.0)/(2.0*jf + 1.0);
-    }
-    if(L>0){
-      switch(barn){
-        case 1:
-          printf("%0.4E e^2 b^%i\n",b/pow(BARN_FM,L),L);
-          break;
-        case 0:
-        default:
-          printf("%0.4E e^2 fm^%i\n",b,2*L);
-          break;
-      }  
-    }else{
-      printf("%0.4E e^2\n",b);
+/* formats a labelled fraction, with enough decimal places to show small values */
+void putFraction(strBuf *sb, const char *label, const double f){
+  int prec;
+  if(f > 0.1)
+    prec = 2;
+  else if(f > 0.001)
+    prec = 4;
+  else if(f > 0.0000001)
+    prec = 8;
+  else if(f > 0.00000000001)
+    prec = 12;
+  else
+    prec = 16;
+  sbPrintf(sb,"%s: %.*f\n",label,prec,f);
+}
+
+/* names of multipoles, by L */
+static const char *multName[] = {"monopole","dipole","quadrupole","octopole","hexadecapole","triacontadipole",
+  "hexacontatetrapole","hecatonicosioctopole","diacosiapentecontahexadecapole"};
+
+/* formats the input parameters (if verbose) and results of a calculation */
+void printResult(strBuf *sb, const bcalcTrans *t, const bcalcRes *r, const int verbose){
+  char mstr1[16], ustr[32], name[48];
+
+  /*print extra info*/
+  if(verbose){
+    sbPuts(sb,"\nINPUT PARAMETERS\n----------------\n");
+    sbPrintf(sb,"Transition energy: %0.3f keV\n",t->Et);
+    sbPuts(sb,"Transition multipole: ");
+    sbPuts(sb,(t->EM==0) ? "electric " : "magnetic ");
+    if((t->L>=0)&&(t->L<=8))
+      sbPuts(sb,multName[t->L]);
+    else
+      sbPrintf(sb,"L = %i",t->L);
+    if(t->useDelta&&(t->calcMode==0)){
+      if(t->delta > 0.01){
+        sbPrintf(sb," (L+1 mixing, delta = %0.3f)", t->delta);
+      }else if(t->delta > 0.00001){
+        sbPrintf(sb," (L+1 mixing, delta = %0.6f)", t->delta);
+      }else{
+        sbPrintf(sb," (L+1 mixing, delta = %0.9f)", t->delta);
+      }
     }
-    
-  }else if(EM==1){
-    /* magnetic */
-    /* uN^2 fm^(2L-2) */
-    fac = fac * UN_MEVFM3/ESQ_MEVFM;
-    //printf("fac: %f\n",fac);
-    double b=1/(fac*lt);
-    if(bup){
-      b = b*(2.0*ji + 1.0)/(2.0*jf + 1.0);
+    sbPutc(sb,'\n');
+    if((t->iccAuto)&&(t->iccTab != NULL)&&(t->nucZ > 0)&&(t->calcMode == 0)){
+      sbPrintf(sb,"Internal conversion coefficient: %0.3f (from table)\n",r->icc);
+    }else if(t->icc > 0.){
+      sbPrintf(sb,"Internal conversion coefficient: %0.3f\n",t->icc);
     }
-    if(L>1){
-      switch(barn){
-        case 1:
-          printf("%0.4E uN^2 b^%i\n",b/pow(BARN_FM,L-1),L-1);
-          break;
-        case 0:
-        default:
-          printf("%0.4E uN^2 fm^%i\n",b,(2*L) - 2);
-          break;
+    if(t->calcMode == 0){
+      putLifetime(sb,"Mean lifetime",t->lt);
+    }else if(t->calcMode == 1){
+      sbPrintf(sb,"B(%s): %f ",t->mstr, t->b);
+      if((t->EM==0)&&(t->L==0)&&(t->barn < 2)){
+        sbPrintf(sb,"e^2 %s^0\n",(t->barn == 1) ? "b" : "fm"); /* monopole strength, as entered */
+      }else{
+        getBUnit(ustr,sizeof(ustr),t->EM,t->L,t->barn);
+        sbPrintf(sb,"%s\n",ustr);
       }
-    }else{
-      printf("%0.4E uN^2\n",b);
     }
-      
-  }
-}
-
-void calcLt(const int bup, const int EM, const int L, const double Et, double b, const double ji, const double jf, const int verbose, const int barn, const char *mstr, const int nucA, const double branching){
-  if(verbose){
-    printf("\nLIFETIME CALCULATION\n--------------------\n");
+    if(t->nucA>0)
+      sbPrintf(sb,"A = %i\n",t->nucA);
+    if(t->nucZ>0)
+      sbPrintf(sb,"Z = %i\n",t->nucZ);
+    if((t->nucA>=t->nucZ)&&(bcalcElementSym(t->nucZ) != NULL))
+      sbPrintf(sb,"Nuclide: %i%s\n",t->nucA,bcalcElementSym(t->nucZ));
+    if(t->brrel == 0){
+      putFraction(sb,"Branching fraction",t->branching);
+    }else if(t->brrel == 1){
+      putFraction(sb,"Relative intensity",t->branching);
+    }
   }
 
-  if(bup){
-    b = b*(2.0*jf + 1.0)/(2.0*ji + 1.0);
+  if(t->useDelta){
+    getMixedMstr(mstr1,sizeof(mstr1),t);
   }
 
-  if(barn == 2){
-    /* Weisskopf unit calculation */
-    double lt_sp = ltsp(EM,L,nucA,Et*1000.);
-    lt_sp = lt_sp / 1.0E-12; //convert from s to ps
-    printf("%0.4E ps\n",lt_sp/b);
-    return;
+  /* report partial lifetimes */
+  if((verbose)&&(t->calcMode==0)){
+    if((r->branching != 1.)&&(!t->useDelta)){
+      putLifetime(sb,"Partial lifetime",r->lt);
+    }else if(t->useDelta){
+      snprintf(name,sizeof(name),"Partial lifetime (%s)",t->mstr);
+      putLifetime(sb,name,r->lt);
+      snprintf(name,sizeof(name),"Partial lifetime (%s)",mstr1);
+      putLifetime(sb,name,r->lt1);
+    }
   }
 
-  //convert barn units to fm units
-  if(barn){
-    if(EM==0){
-      b = b*pow(BARN_FM,L);
-    }else if(EM==1){
-      b = b*pow(BARN_FM,L-1);
+  /* report results */
+  if(t->calcMode == 0){
+    printB(sb,verbose,t->mstr,t->EM,t->L,t->barn,r->b);
+    if(t->useDelta){
+      printB(sb,verbose,mstr1,!t->EM,t->L+1,t->barn,r->b1);
+    }
+  }else if(t->calcMode == 1){
+    if(verbose){
+      sbPuts(sb,"\nLIFETIME CALCULATION\n--------------------\n");
     }
+    sbPutExp(sb,r->lt,4);
+    sbPuts(sb," ps");
+    if(r->branching != 1.){
+      sbPuts(sb," (partial lifetime)");
+    }
+    sbPutc(sb,'\n');
+  }
+  if(t->calcB2){
+    sbPuts(sb,verbose ? "\nbeta_2 CALCULATION\n-----------------\n" : "beta_2 = ");
+    if(verbose){
+      double rms = bcalcNucRadius(t->nucA,t->nucZ);
+      if(rms > 0.){
+        sbPrintf(sb,"Charge radius: R = %.4f fm (measured RMS radius %.4f fm)\n",sqrt(5.0/3.0)*rms,rms);
+      }else{
+        sbPrintf(sb,"Charge radius: R = %.4f fm (1.2*A^(1/3), no measured radius)\n",1.2*cbrt((double)t->nucA));
+      }
+    }
+    sbPutExp(sb,r->beta2,4);
+    sbPutc(sb,'\n');
   }
+}
+
+/* formats the partial derivatives of the results of a calculation with respect to each input,
+one row per result and one column per input that the results depend on */
+void printJacobian(strBuf *sb, const bcalcTrans *t, const bcalcJac *jac, const int verbose){
+  static const char *inName[BCALC_JAC_NUM_IN] = {"E","lt","br","d","icc","ji","jf","A"};
+  char mstr1[16], label[32];
+  int show[BCALC_JAC_NUM_IN];
+  int i, j;
+
+  show[BCALC_JAC_E] = 1;
+  show[BCALC_JAC_VAL] = 1;
+  show[BCALC_JAC_BR] = 1;
+  show[BCALC_JAC_DELTA] = t->useDelta&&(t->calcMode == 0);
+  show[BCALC_JAC_ICC] = (t->calcMode == 0);
+  show[BCALC_JAC_JI] = t->bup;
+  show[BCALC_JAC_JF] = t->bup;
+  show[BCALC_JAC_A] = (t->nucA > 0);
 
-  double fac = 8.0*PI*(L+1)/(L*HBAR_MEVS*pow(dblfac((unsigned int)((2.0*L)+1.0)),2.0)*LN2);
-  fac = fac * (pow((Et/HBARC_MEVFM),2.0*L + 1.0));
-  /* reduced transition probability to lifetime */
-  if(EM==1){
-    fac = fac * UN_MEVFM3/ESQ_MEVFM;
-  }
-  double lt = 1/(fac*b);
-  lt = lt / 1.0E-12; //convert lifetime to ps
-  lt = 1.0/((1.0/lt)*branching); //partial lifetime
-  printf("%0.4E ps",lt);
-  if(branching != 1.){
-    printf(" (partial lifetime)");
+  if(verbose){
+    sbPuts(sb,"\nPARTIAL DERIVATIVES\n-------------------\n");
+    sbPrintf(sb,"d(result)/d(input), with E in keV and %s\n",(t->calcMode == 0) ? "lt in ps" : "the lifetime in ps");
+  }
+  sbPrintf(sb,"%-14s","");
+  for(j=0;j<BCALC_JAC_NUM_IN;j++){
+    if(show[j])
+      sbPrintf(sb,"%12s",((j == BCALC_JAC_VAL)&&(t->calcMode == 1)) ? "B" : inName[j]);
+  }
+  sbPutc(sb,'\n');
+  getMixedMstr(mstr1,sizeof(mstr1),t);
+  for(i=0;i<BCALC_JAC_NUM_OUT;i++){
+    if(isnan(jac->val[i])||((i == BCALC_JAC_BWU)&&(t->barn == 2)))
+      continue; /* not calculated, or the same as B */
+    switch(i){
+      case BCALC_JAC_B:
+        snprintf(label,sizeof(label),"B(%s)",t->mstr);
+        break;
+      case BCALC_JAC_B1:
+        snprintf(label,sizeof(label),"B(%s)",mstr1);
+        break;
+      case BCALC_JAC_BWU:
+        snprintf(label,sizeof(label),"B(%s) W.u.",t->mstr);
+        break;
+      case BCALC_JAC_LT:
+        snprintf(label,sizeof(label),"lifetime");
+        break;
+      default:
+        snprintf(label,sizeof(label),"beta_2");
+        break;
+    }
+    sbPrintf(sb,"%-14s",label);
+    for(j=0;j<BCALC_JAC_NUM_IN;j++){
+      if(show[j])
+        sbPrintf(sb,"%12.4E",jac->d[i][j]);
+    }
+    sbPutc(sb,'\n');
   }
-  printf("\n");
 }
 
 int main(int argc, char *argv[]) {
 
+  uint64_t start = statsNow(); /* for --stats */
+
   if (argc == 1) {
     printHelp();
     exit(-1);
   }
 
-  int i; /*counters*/
-
   /*initialize parameter values*/
-  char mstr[4], mstr1[12];
-  double Et = -1.; /* transition energy */
-  int L = -1; /* multipolarity */
-  int EM = -1; /* 0=electric, 1=magnetic */
-  double lt = 0.; /* lifetime */
-  double lt1 = 0.; /* lifetime for L+1 multipole (mixed transitions) */
-  double b = 0.; /* reduced transition probability */
-  int calcMode = -1; /* 0=calulate B, 1=calculate lifetime */
-  int verbose = 1; /* 0=none, 1=verbose */
-  int barn = 0; /* 0=fm units, 1=barn units, 2=Weisskopf units */
-  int bup = 0; /* 0=down, 1=up */
-  double ji = -1.; /* Initial spin */
-  double jf = -1.; /* Final spin*/
-  double delta = 0; /* mixing ratio */
-  double branching = 1.; /* branching fraction */
-  double icc = 0.; /* internal conversion coefficient */
-  int useDelta = 0; /* 0=no mixing, 1=mixing */
-  int calcB2 = 0; /* 0=no beta_2 calc, 1=calc beta_2 */
-  int brrel = 0; /* 0=use branching fraction, 1=use relative intensity */
-  int nucA = -1; /* mass number of the nucleus of interest */
-  int nucZ = -1; /* proton number of the nucleus of interest */
+  cmdOpts o; /* everything set on the command line */
+  bcalcTrans t; /* transition parameters */
+  bcalcRes r; /* calculated values */
+  char mstr1[16];
+  bcalcIccTab iccTab;
+  int err;
+  bcalcMCRes mcr; /* Monte Carlo results */
+  bcalcJac jac; /* partial derivatives */
+  char ustr[32], name[48], estr[256];
+  strBuf out; /* formatted output */
+  runStats rs;
+  rcache rc; /* result cache */
 
   /*read parameters*/
-  for(i=0;i<argc;i++){
-    if(strcmp(argv[i],"--quiet")==0){
-      verbose = 0;
-    }else if(strcmp(argv[i],"--up")==0){
-      bup = 1;
-    }else if(strcmp(argv[i],"--beta2")==0){
-      calcB2 = 1;
-    }else if(strcmp(argv[i],"--barn")==0){
-      barn += 1;
-    }else if(strcmp(argv[i],"--wu")==0){
-      barn += 2;
-    }else if(strcmp(argv[i],"--brrel")==0){
-      brrel = 1;
-    }else if(strcmp(argv[i],"--help")==0){
-      printHelp();
-      exit(-1);
-    }
-  }
-  for(i=0;i<(argc-1);i++){
-    if((strcmp(argv[i],"-E")==0)||(strcmp(argv[i],"-e")==0)){
-      Et=atof(argv[i+1]);
-      if(Et <= 0.){
-        printf("ERROR: Invalid transition energy (%f).  Value must be a positive number.\n",Et);
-        exit(-1);
-      }
-    }else if((strcmp(argv[i],"-M")==0)||(strcmp(argv[i],"-m")==0)){
-      mstr[2] = '\0';
-      strncpy(mstr,argv[i+1],sizeof(mstr));
-      if(mstr[0] == 'E'){
-        EM=0;
-      }else if(mstr[0] == 'M'){
-        EM=1;
-      }else{
-        printf("ERROR: invalid multipole value.\n");
-        exit(-1);
-      }
-      if((isdigit(mstr[2])!=0)&&(isdigit(mstr[1])!=0)){
-        L=mstr[2] - '0';
-        L+=(mstr[1] - '0')*10;
-      }else if(isdigit(mstr[1])!=0){
-        L=mstr[1] - '0';
-      }else{
-        printf("ERROR: invalid multipole value.\n");
-        exit(-1);
-      }
-      
-    }else if((strcmp(argv[i],"-Lt")==0)||(strcmp(argv[i],"-lt")==0)||(strcmp(argv[i],"-Ltps")==0)||(strcmp(argv[i],"-ltps")==0)){
-      lt=atof(argv[i+1]);
-      calcMode = 0;
-    }else if((strcmp(argv[i],"-Ltns")==0)||(strcmp(argv[i],"-ltns")==0)){
-      lt=atof(argv[i+1])*1000.0;
-      calcMode = 0;
-    }else if((strcmp(argv[i],"-Ltus")==0)||(strcmp(argv[i],"-ltus")==0)){
-      lt=atof(argv[i+1])*1000000.0;
-      calcMode = 0;
-    }else if((strcmp(argv[i],"-Lts")==0)||(strcmp(argv[i],"-lts")==0)){
-      lt=atof(argv[i+1])*1000000000000.0;
-      calcMode = 0;
-    }else if((strcmp(argv[i],"-Lth")==0)||(strcmp(argv[i],"-lth")==0)){
-      lt=atof(argv[i+1])*3600*1000000000000.0;
-      calcMode = 0;
-    }else if((strcmp(argv[i],"-Hl")==0)||(strcmp(argv[i],"-hl")==0)||(strcmp(argv[i],"-Hlps")==0)||(strcmp(argv[i],"-hlps")==0)){
-      lt=atof(argv[i+1])/LN2;
-      calcMode = 0;
-    }else if((strcmp(argv[i],"-Hlns")==0)||(strcmp(argv[i],"-hlns")==0)){
-      lt=atof(argv[i+1])*1000.0/LN2;
-      calcMode = 0;
-    }else if((strcmp(argv[i],"-Hlus")==0)||(strcmp(argv[i],"-hlus")==0)){
-      lt=atof(argv[i+1])*1000000.0/LN2;
-      calcMode = 0;
-    }else if((strcmp(argv[i],"-Hls")==0)||(strcmp(argv[i],"-hls")==0)){
-      lt=atof(argv[i+1])*1000000000000.0/LN2;
-      calcMode = 0;
-    }else if((strcmp(argv[i],"-Hlh")==0)||(strcmp(argv[i],"-hlh")==0)){
-      lt=atof(argv[i+1])*3600*1000000000000.0/LN2;
-      calcMode = 0;
-    }else if((strcmp(argv[i],"-B")==0)||(strcmp(argv[i],"-b")==0)){
-      b=atof(argv[i+1]);
-      calcMode = 1;
-    }else if(strcmp(argv[i],"-d")==0){
-      delta=atof(argv[i+1]);
-      useDelta = 1;
-    }else if(strcmp(argv[i],"-br")==0){
-      branching=atof(argv[i+1]);
-    }else if(strcmp(argv[i],"-icc")==0){
-      icc=atof(argv[i+1]);
-      if(icc < 0.){
-        printf("ERROR: Internal conversion coefficient must be a positive number.\n");
-        exit(-1);
-      }
-    }else if(strcmp(argv[i],"-A")==0){
-      nucA=atoi(argv[i+1]);
-    }else if(strcmp(argv[i],"-Z")==0){
-      nucZ=atoi(argv[i+1]);
-    }else if(strcmp(argv[i],"-ji")==0){
-      ji=atof(argv[i+1]);
-      if(ji<0){
-        printf("ERROR: Invalid initial spin value provided (%0.1f).  The value must be a positive integer or half-integer.\n",ji);
-        exit(-1);
-      }
-    }else if(strcmp(argv[i],"-jf")==0){
-      jf=atof(argv[i+1]);
-      if(jf<0){
-        printf("ERROR: Invalid final spin value provided (%0.1f).  The value must be a positive integer or half-integer.\n",jf);
-        exit(-1);
-      }
-    }
-  }
-
-  /*check argument values for validity*/
-  if(Et < 0.){
-    printf("ERROR: Missing parameter.\n");
-    printf("    -e  --  transition energy in keV\n");
+  initCmdOpts(&o);
+  err = parseCmdArgs(argc-1,(const char *const *)(argv+1),&o,estr,sizeof(estr));
+  if(err == OPT_ERR_PARSE){
+    printf("ERROR: %s\n",estr);
     exit(-1);
-  }
-  if(calcMode < 0){
-    printf("ERROR: One of the following parameters is needed:\n");
-    printf("   -lt  --  Mean transition lifetime (in ps)\n");
-    printf("   -hl  --  Transition half-life (in ps)\n");
-    printf("   -b   --  Reduced transition probability\n");
-    exit(-1);
-  }
-  if((EM==1) && (L ==0)){
-    printf("Magnetic monopole transitions are not allowed.\n");
+  }else if(err != BCALC_OK){
+    printErr(err,&o.t);
     exit(-1);
   }
-  if(L<0){
-    printf("ERROR: Missing parameter.\n");
-    printf("    -m  --  multipole (eg. E1, M1, E2, etc.)\n");
-    exit(-1);
-  }
-  if(L > 12){
-    printf("ERROR: Maximum calculable L-value is 12.\n");
+  if(o.help){
+    printHelp();
     exit(-1);
   }
-  if ((fmod(ji,0.5)!=0.) || (fmod(jf,0.5)!=0.) || (fmod(jf-ji,1)!=0.)){
-     printf("ERROR: Initial and final spins must both be either integer or half-integer.\n");
-     exit(-1);
+  if(o.selfTest){
+    return runSelfTest();
   }
-  if((bup == 1)&&((ji == -1)||(jf == -1))){
-    printf("WARNING: To calculate B(%s) up, the initial and final spin must be known.\nAssuming a 2 -> 0 transition.\n",mstr);
-    ji=2.;
-    jf=0.;
+  if((o.iccFile != NULL)&&(o.iccFile[0] != '\0')){
+    if(bcalcIccOpen(o.iccFile,&iccTab) != BCALC_OK){
+      printf("ERROR: Cannot read the internal conversion coefficient table %s.\n",o.iccFile);
+      exit(-1);
+    }
+    o.t.iccTab = &iccTab;
+    if(!o.iccSet)
+      o.t.iccAuto = 1; /* unless -icc is given */
   }
-  if((branching <= 0.)||(branching > 1.)){
-    printf("ERROR: invalid branching fraction (must be a positive number less than 1).\n");
+  t = o.t;
+
+  if((o.fmt != OUT_TEXT)&&((o.binOutFile != NULL)||(o.ensdfFile != NULL)||(o.serveSock != NULL)||(o.shmName != NULL)||o.repl||o.useMC)){
+    printf("ERROR: --format cannot be used with --binout, --ensdf, --serve, --shm, --repl or uncertainties.\n");
     exit(-1);
   }
-  if(barn>2){
-    printf("ERROR: only one of --barn and --wu can be used at once.\n");
+  if(o.jacobian&&(o.batch||o.sweep||o.repl||(o.fmt != OUT_TEXT)||(o.followFile != NULL)||(o.ensdfFile != NULL)||(o.levelsFile != NULL)||(o.serveSock != NULL)||(o.shmName != NULL))){
+    printf("ERROR: --jacobian can only be used for a single calculation with text output.\n");
     exit(-1);
   }
-  if(barn==2){
-    if(nucA == -1){
-      printf("ERROR: when using --wu, must also specify the -A parameter.\n");
-      exit(-1);
-    }else if(nucA <= 0){
-      printf("ERROR: The mass number A cannot be less than 1.\n");
+  if(o.followFile != NULL){
+    if((o.binOutFile != NULL)||(o.stats)||(o.cacheFile != NULL)||(o.cacheSize > 0)){
+      printf("ERROR: --binout, --stats, --cache and --cache-size cannot be used with --follow.\n");
       exit(-1);
     }
+    return runFollow(o.followFile,&t,o.batchIn,o.fmt);
   }
-  if(calcB2){
-    if((EM!=0)||(L!=2)||(ji!=2)||(jf!=0)){
-      printf("ERROR: Can only calculate beta_2 for 2->0 (g.s.) E2 transitions.  The parameter values '-m E2 -ji 2 -jf 0' are required.\n");
-      exit(-1);
-    }
-    if((nucZ == -1)||(nucA == -1)){
-      printf("ERROR: when calculating beta_2, must specify both the -A and -Z parameters.\n");
-      exit(-1);
-    }else if((nucZ <= 0)||(nucA <= 0)){
-      printf("ERROR: The proton number Z or mass number A cannot be less than 1.\n");
-      exit(-1);
-    }
+  if(o.stats && !o.batch){
+    printf("ERROR: --stats can only be used in batch mode.\n");
+    exit(-1);
   }
-  if(nucA < nucZ){
-    printf("ERROR: The mass number A cannot be less than the proton number Z.\n");
+  if(((o.cacheFile != NULL)||(o.cacheSize > 0))&&!o.batch){
+    printf("ERROR: --cache and --cache-size can only be used in batch mode.\n");
     exit(-1);
   }
-  
-
-  /*print extra info*/
-  if(verbose){
-    printf("\nINPUT PARAMETERS\n----------------\n");
-    printf("Transition energy: %0.3f keV\n",Et);
-    printf("Transition multipole: ");
-    if(EM==0)
-      printf("electric ");
-    else
-      printf("magnetic ");
-    if(L==0)
-      printf("monopole");
-    else if(L==1)
-      printf("dipole");
-    else if(L==2)
-      printf("quadrupole");
-    else if(L==3)
-      printf("octopole");
-    else if(L==4)
-      printf("hexadecapole");
-    else if(L==5)
-      printf("triacontadipole");
-    else if(L==6)
-      printf("hexacontatetrapole");
-    else if(L==7)
-      printf("hecatonicosioctopole");
-    else if(L==8)
-      printf("diacosiapentecontahexadecapole");
-    else
-      printf("L = %i",L);
-    if(useDelta&&(calcMode==0)){
-      if(delta > 0.01){
-        printf(" (L+1 mixing, delta = %0.3f)", delta);
-      }else if(delta > 0.00001){
-        printf(" (L+1 mixing, delta = %0.6f)", delta);
-      }else{
-        printf(" (L+1 mixing, delta = %0.9f)", delta);
-      }
-    }
-    printf("\n");
-    if(icc > 0.){
-      printf("Internal conversion coefficient: %0.3f\n",icc);
+  if(o.batch){
+    if((o.cacheFile != NULL)&&(rcacheOpen(&rc,o.cacheFile,o.cacheSize,&t,o.batchIn) != 0)){
+      exit(-1);
     }
-    if(calcMode == 0){
-      if(lt < 1E3){
-        printf("Mean lifetime: %0.3f ps\n",lt);
-      }else if(lt < 1E12){
-        printf("Mean lifetime: %0.3f ns\n",lt/((double)1E3));
-      }else if(lt < 1E16){
-        printf("Mean lifetime: %0.3f s\n",lt/((double)1E12));
-      }else
-        printf("Mean lifetime: %0.3f hr\n",lt/(3600.0*(double)1E12));
-    }else if(calcMode == 1){
-      printf("B(%s): %f ",mstr, b);
-      if(EM==0){
-        if(barn == 0){
-          printf("e^2 fm^%i\n",2*L);
-        }else if(barn == 1){
-          printf("e^2 b^%i\n",L);
-        }else{
-          printf("W.u.\n");
-        }
-      }else if(EM==1){
-        if(L>1){
-          if(barn == 0){
-            printf("uN^2 fm^%i\n",(2*L) - 2);
-          }else if(barn == 1){
-            printf("uN^2 b^%i\n",L-1);
-          }else{
-            printf("W.u.\n");
-          }
-        }else if(L==1){
-          if(barn < 2){
-            printf("uN^2\n");
-          }else{
-            printf("W.u.\n");
-          }
-        }
-      }
+    if(o.stats){
+      statsStart(&rs,start,(o.stats == 2));
+      statsLap(&rs.c,STAT_ARGS,&start);
     }
-    if(nucA>0)
-      printf("A = %i\n",nucA);
-    if(nucZ>0)
-      printf("Z = %i\n",nucZ);
-    if(brrel == 0){
-      if(branching > 0.1){
-        printf("Branching fraction: %.2f\n",branching);
-      }else if(branching > 0.001){
-        printf("Branching fraction: %.4f\n",branching);
-      }else if(branching > 0.0000001){
-        printf("Branching fraction: %.8f\n",branching);
-      }else if(branching > 0.00000000001){
-        printf("Branching fraction: %.12f\n",branching);
-      }else{
-        printf("Branching fraction: %.16f\n",branching);
-      }
-    }else if(brrel == 1){
-      if(branching > 0.1){
-        printf("Relative intensity: %.2f\n",branching);
-      }else if(branching > 0.001){
-        printf("Relative intensity: %.4f\n",branching);
-      }else if(branching > 0.0000001){
-        printf("Relative intensity: %.8f\n",branching);
-      }else if(branching > 0.00000000001){
-        printf("Relative intensity: %.12f\n",branching);
-      }else{
-        printf("Relative intensity: %.16f\n",branching);
-      }
+    err = runBatch(o.batchFile,&t,o.batchIn,o.numThreads,o.binOutFile,o.fmt,o.stats ? &rs : NULL,(o.cacheFile != NULL) ? &rc : NULL);
+    if(o.cacheFile != NULL){
+      rcacheClose(&rc,stderr);
     }
+    return err;
   }
-
-  /* branching fraction calculation */
-  if(brrel == 1)
-    branching = branching/(branching + 1.0);
-  if(calcMode == 0){
-    lt = 1.0/((1.0/lt)*branching); //partial lifetime
-    lt = lt*(1.0 + icc);
+  if(o.ensdfFile != NULL){
+    return runEnsdf(o.ensdfFile,&t,o.numThreads);
   }
-
-  /* mixing ratio calculation */
-  if(useDelta){
-    lt1 = lt * (1.0 + delta*delta) / (delta*delta);
-    lt = lt * (1.0 + delta*delta);
-    if(mstr[0] == 'E')
-      snprintf(mstr1,12,"M%i",L+1);
-    else
-      snprintf(mstr1,12,"E%i",L+1);
+  if(o.levelsFile != NULL){
+    return runLevels(o.levelsFile,&t,o.fmt);
+  }
+  if(o.serveSock != NULL){
+    return runServer(o.serveSock,&t);
+  }
+  if(o.shmName != NULL){
+    return runShm(o.shmName,&t);
+  }
+  if(o.repl){
+    return runRepl(&o);
+  }
+  if(o.sweep){
+    return runSweep(&t,o.axes,o.verbose,o.fmt);
+  }
+  if(t.calcMode == 0){
+    o.unc.val[0] = o.ltUnc[0]*o.ltFac;
+    o.unc.val[1] = o.ltUnc[1]*o.ltFac;
+  }else{
+    o.unc.val[0] = o.bUnc[0];
+    o.unc.val[1] = o.bUnc[1];
   }
 
-  /* report partial lifetimes */
-  if((verbose)&&(calcMode==0)){
-    if((branching != 1.)&&(!useDelta)){
-      if(lt < 1E3){
-        printf("Partial lifetime: %0.3f ps\n",lt);
-      }else if(lt < 1E12){
-        printf("Partial lifetime: %0.3f ns\n",lt/((double)1E3));
-      }else if(lt < 1E16){
-        printf("Partial lifetime: %0.3f s\n",lt/((double)1E12));
-      }else{
-        printf("Partial lifetime: %0.3f hr\n",lt/(3600.0*(double)1E12));
-      }
-    }else if(useDelta){
-      if(lt < 1E3){
-        printf("Partial lifetime (%s): %0.3f ps\n",mstr,lt);
-      }else if(lt < 1E12){
-        printf("Partial lifetime (%s): %0.3f ns\n",mstr,lt/((double)1E3));
-      }else if(lt < 1E16){
-        printf("Partial lifetime (%s): %0.3f s\n",mstr,lt/((double)1E12));
-      }else{
-        printf("Partial lifetime (%s): %0.3f hr\n",mstr,lt/(3600.0*(double)1E12));
-      }
-      if(lt1 < 1E3){
-        printf("Partial lifetime (%s): %0.3f ps\n",mstr1,lt1);
-      }else if(lt1 < 1E12){
-        printf("Partial lifetime (%s): %0.3f ns\n",mstr1,lt1/((double)1E3));
-      }else if(lt1 < 1E16){
-        printf("Partial lifetime (%s): %0.3f s\n",mstr1,lt1/((double)1E12));
-      }else{
-        printf("Partial lifetime (%s): %0.3f hr\n",mstr1,lt1/(3600.0*(double)1E12));
-      }
+  /*check argument values for validity, and calculate*/
+  err = bcalcCompute(&t,&r);
+  if(o.fmt != OUT_TEXT){
+    /* one structured record */
+    if(r.warn){
+      fprintf(stderr,"WARNING: Initial and final spin unknown for B(%s) up, assuming a 2 -> 0 transition.\n",t.mstr);
     }
+    sbInit(&out);
+    formatRecordHeader(&out,o.fmt);
+    if(err != BCALC_OK)
+      getErrStr(estr,sizeof(estr),err,&t);
+    formatRecord(&out,o.fmt,1,&t,&r,err,(err != BCALC_OK) ? estr : NULL);
+    sbFlush(&out,stdout);
+    sbFree(&out);
+    return (err == BCALC_OK) ? 0 : -1;
+  }
+  if(r.warn){
+    printf("WARNING: To calculate B(%s) up, the initial and final spin must be known.\nAssuming a 2 -> 0 transition.\n",t.mstr);
+  }
+  if(err != BCALC_OK){
+    printErr(err,&t);
+    exit(-1);
   }
+  sbInit(&out);
 
+  printResult(&out,&t,&r,o.verbose);
+  if(o.jacobian){
+    bcalcJacobian(&t,&jac);
+    printJacobian(&out,&t,&jac,o.verbose);
+  }
 
-  lt=lt*1.0E-12; //convert lifetime to s
-  lt1=lt1*1.0E-12; //convert lifetime to s
-  Et=Et/1000.0; //convert energy to MeV
-
+  /* the results are written out before the (slower) uncertainty propagation */
+  sbFlush(&out,stdout);
 
-  if(calcMode == 0){
-    calcB(bup,EM,L,Et,lt,ji,jf,verbose,barn,mstr,nucA);
-    if(useDelta){
-      calcB(bup,!EM,L+1,Et,lt1,ji,jf,verbose,barn,mstr1,nucA);
+  /* propagate uncertainties */
+  if(o.useMC){
+    if(o.numThreads == 0){
+      o.numThreads = getNumCPUs();
+    }
+    err = bcalcMonteCarlo(&t,&o.unc,o.numSamples,o.seed,o.numThreads,&mcr);
+    if(err != BCALC_OK){
+      printErr(err,&t);
+      exit(-1);
     }
-    if(calcB2){
-      calcBeta2Lt(Et,lt,nucA,nucZ,verbose);
+    if(o.verbose){
+      sbPrintf(&out,"\nUNCERTAINTIES (%lu samples, seed %llu)\n--------------------------------------\n",o.numSamples,(unsigned long long)o.seed);
     }
-  }else if(calcMode == 1){
-    calcLt(bup,EM,L,Et,b,ji,jf,verbose,barn,mstr,nucA,branching);
-    if(calcB2){
-      calcBeta2(Et,b,nucA,nucZ,barn,verbose);
+    if(t.useDelta){
+      getMixedMstr(mstr1,sizeof(mstr1),&t);
     }
+    if(t.calcMode == 0){
+      getBUnit(ustr,sizeof(ustr),t.EM,t.L,t.barn);
+      snprintf(name,sizeof(name),"B(%s)",t.mstr);
+      printDist(&out,o.verbose,name,ustr,&mcr.b);
+      if(t.useDelta){
+        getBUnit(ustr,sizeof(ustr),!t.EM,t.L+1,t.barn);
+        snprintf(name,sizeof(name),"B(%s)",mstr1);
+        printDist(&out,o.verbose,name,ustr,&mcr.b1);
+      }
+    }else{
+      printDist(&out,o.verbose,"lifetime","ps",&mcr.lt);
+    }
+    if(t.calcB2){
+      printDist(&out,o.verbose,"beta_2","",&mcr.beta2);
+    }
+    if(mcr.numBad > 0){
+      sbPrintf(&out,"WARNING: %lu of %lu samples gave no finite result and were excluded.\n",mcr.numBad,o.numSamples);
+    }
+    sbFlush(&out,stdout);
   }
-  
+  sbFree(&out);
 
   return 0;
-}
\ No newline at end of file
+}
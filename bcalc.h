@@ -1,23 +1,451 @@
-#include <stdlib.h>
 #include <stdio.h>
-#include <string.h>
-#include <math.h>
-#include <ctype.h>
-
-#define PI         3.14159265359
-#define LN2        0.693147180559945
-#define ESQ_MEVFM      1.44 /* MeV fm */
-#define UN_MEVFM3      0.015922 /* MeV fm^3 */
-#define UNSQ           1.5922E-38 /* keV cm^3 */
-#define BARN_FM        100.0 /* fm^2 */
-#define HBAR_MEVS      6.58212E-22 /* MeV s */
-#define HBARC_MEVFM    197.327 /* MeV fm */
+#include <stdint.h>
+#include "libbcalc.h"
+
+#define BATCH_MAX_COLS 10 /* energy, multipole, lifetime/B, br, delta, icc, ji, jf, A, Z */
+
+/* growable string buffer */
+typedef struct
+{
+  char *data;
+  size_t len;
+  size_t cap;
+}strBuf;
+
+/* output formats */
+#define OUT_TEXT  0
+#define OUT_CSV   1
+#define OUT_TSV   2
+#define OUT_JSON  3
+#define OUT_BIN   4 /* binary columnar (batch mode only) */
+
+/* batch input: columns with lifetimes, columns with B values, or one command line per line */
+#define BATCH_LT  0
+#define BATCH_B   1
+#define BATCH_CMD 2
+
+/* command line options (opts.c, opttab.h) */
+#define OPT_VAL_NONE    0 /* flag */
+#define OPT_VAL_REQ     1 /* followed by a value */
+#define OPT_VAL_OPT     2 /* optionally followed by a value (not starting with '-') */
+#define OPT_SCOPE_TRANS 0 /* transition parameter or flag, also allowed in batch command lines and server requests */
+#define OPT_SCOPE_PROG  1 /* only on the command line of the program */
+#define OPT_ERR_PARSE   BCOL_ERR_PARSE /* unknown option, or missing or invalid value */
+
+#define OPT_E        0
+#define OPT_M        1
+#define OPT_LT       2 /* lifetimes and half-lives, in any unit */
+#define OPT_B        3
+#define OPT_D        4
+#define OPT_BR       5
+#define OPT_ICC      6
+#define OPT_A        7
+#define OPT_Z        8
+#define OPT_NUC      9
+#define OPT_JI       10
+#define OPT_JF       11
+#define OPT_UP       12
+#define OPT_BETA2    13
+#define OPT_BARN     14
+#define OPT_WU       15
+#define OPT_BRREL    16
+#define OPT_EERR     17
+#define OPT_LTERR    18
+#define OPT_BERR     19
+#define OPT_BRERR    20
+#define OPT_DERR     21
+#define OPT_ICCERR   22
+#define OPT_SAMPLES  23
+#define OPT_SEED     24
+#define OPT_QUIET    25
+#define OPT_BATCH    26
+#define OPT_COMMANDS 27
+#define OPT_BVAL     28
+#define OPT_BINOUT   29
+#define OPT_FORMAT   30
+#define OPT_STATS    31
+#define OPT_THREADS  32
+#define OPT_ICCTAB   33
+#define OPT_ENSDF    34
+#define OPT_LEVELS   35
+#define OPT_SERVE    36
+#define OPT_REPL     37
+#define OPT_FOLLOW   38
+#define OPT_JACOBIAN 39
+#define OPT_SHM      40
+#define OPT_CACHE    41
+#define OPT_CACHESIZE 42
+#define OPT_PRECISION 43
+#define OPT_SELFTEST 44
+#define OPT_HELP     45
+
+typedef struct
+{
+  const char *name;
+  int id; /* OPT_E, ... */
+  int val; /* OPT_VAL_NONE, OPT_VAL_REQ or OPT_VAL_OPT */
+  int scope; /* OPT_SCOPE_TRANS or OPT_SCOPE_PROG */
+  int axis; /* parameter grid axis (BCALC_AXIS_ENERGY, ...) if the value may be a range, otherwise -1 */
+  double ltMul, ltDiv; /* lifetime options: the lifetime in ps is value*ltMul/ltDiv */
+}optDef;
+
+/* everything set on the command line of the program */
+typedef struct
+{
+  bcalcTrans t; /* transition parameters */
+  double ltFac; /* lifetime units given on the command line, in ps */
+  int iccSet; /* 1 if -icc was given (overriding a conversion coefficient table) */
+  double ltUnc[2]; /* lifetime uncertainty, in the units given on the command line */
+  double bUnc[2]; /* B value uncertainty */
+  bcalcUnc unc; /* uncertainties to propagate */
+  int useMC; /* 1=propagate uncertainties */
+  unsigned long numSamples;
+  uint64_t seed;
+  bcalcAxis axes[BCALC_NUM_AXES]; /* parameter ranges */
+  int sweep; /* 1=calculate on a grid of parameter values */
+  int verbose; /* 0=none, 1=verbose */
+  int jacobian; /* 1=also print the partial derivatives of the results */
+  int batch; /* 0=single calculation, 1=batch mode */
+  int batchIn; /* BATCH_LT, BATCH_B or BATCH_CMD */
+  const char *batchFile; /* batch input file (NULL=stdin) */
+  const char *binOutFile; /* batch binary output file (NULL=print results) */
+  int fmt; /* output format */
+  int stats; /* 0=no statistics, 1=statistics, 2=statistics and hardware counters */
+  int numThreads; /* batch mode and Monte Carlo threads (0=number of processors) */
+  const char *iccFile; /* conversion coefficient table */
+  const char *ensdfFile; /* ENSDF file to calculate all transitions of */
+  const char *levelsFile; /* level scheme file to calculate all transitions of */
+  const char *serveSock; /* server socket path (NULL=not a server) */
+  int repl; /* 1=interactive session */
+  const char *followFile; /* growing batch input file to follow (NULL=none) */
+  const char *shmName; /* shared memory region to answer requests from (NULL=none) */
+  const char *cacheFile; /* batch mode result cache (NULL=none) */
+  unsigned long cacheSize; /* result cache entries (0=the size of an existing cache, or the default) */
+  int selfTest, help; /* 1=run the self test, or print help, and exit */
+}cmdOpts;
+
+/* results of a calculation in every unit system, NaN for values not calculated */
+typedef struct
+{
+  double lt, lt1; /* partial lifetimes (ps) */
+  double b[3], b1[3]; /* B values (by unit: e^2 fm^2L, e^2 b^L, W.u.) */
+  double beta2;
+}outVals;
+
+/* binary columnar format (bcol): a bcolHeader, numCols bcolColDesc column descriptors, then row
+groups until the end of the file, each a bcolGroupHeader followed by the values of every column
+(numRows float64 or int32 values, zero padded to a multiple of 8 bytes) in descriptor order
+all values are in the native byte order, missing values are NaN (float64) or BCOL_NA (int32) */
+#define BCOL_MAGIC      "BCALCCOL"
+#define BCOL_VERSION    1
+#define BCOL_NAME_LEN   24
+#define BCOL_FLOAT64    1
+#define BCOL_INT32      2
+#define BCOL_NA         INT32_MIN /* missing int32 value */
+#define BCOL_ERR_PARSE  -1 /* err column value for input that could not be parsed */
+#define BCOL_CHUNK_ROWS 8192 /* rows of binary input per chunk of batch processing */
+
+typedef struct
+{
+  char magic[8]; /* BCOL_MAGIC (not NUL terminated) */
+  uint32_t version; /* BCOL_VERSION */
+  uint32_t numCols;
+}bcolHeader;
+
+typedef struct
+{
+  char name[BCOL_NAME_LEN]; /* NUL padded */
+  uint32_t type; /* BCOL_FLOAT64 or BCOL_INT32 */
+  uint32_t reserved; /* 0 */
+}bcolColDesc;
+
+typedef struct
+{
+  uint64_t numRows;
+  uint64_t size; /* bytes of column data following the group header */
+}bcolGroupHeader;
+
+/* input columns (read by name, other columns are ignored) */
+#define BCOL_IN_E         0
+#define BCOL_IN_EM        1
+#define BCOL_IN_L         2
+#define BCOL_IN_LT        3
+#define BCOL_IN_B         4
+#define BCOL_IN_BR        5
+#define BCOL_IN_DELTA     6
+#define BCOL_IN_ICC       7
+#define BCOL_IN_JI        8
+#define BCOL_IN_JF        9
+#define BCOL_IN_A         10
+#define BCOL_IN_Z         11
+#define BCOL_NUM_IN       12
+
+/* output columns */
+#define BCOL_OUT_LINE     0
+#define BCOL_OUT_E        1
+#define BCOL_OUT_EM       2
+#define BCOL_OUT_L        3
+#define BCOL_OUT_LT       4
+#define BCOL_OUT_LT1      5
+#define BCOL_OUT_B_FM     6
+#define BCOL_OUT_B_BARN   7
+#define BCOL_OUT_B_WU     8
+#define BCOL_OUT_B1_FM    9
+#define BCOL_OUT_B1_BARN  10
+#define BCOL_OUT_B1_WU    11
+#define BCOL_OUT_BETA2    12
+#define BCOL_OUT_ERR      13
+#define BCOL_NUM_OUT      14
+
+/* mapped binary input file */
+typedef struct
+{
+  const char *data;
+  size_t size;
+  size_t pos; /* offset of the next row group */
+  uint32_t numCols;
+  const bcolColDesc *desc;
+  int col[BCOL_NUM_IN]; /* index of each input column, -1 if not present */
+}bcolIn;
+
+/* a row group of binary input */
+typedef struct
+{
+  size_t numRows;
+  const void *col[BCOL_NUM_IN]; /* values of each input column, NULL if not present */
+}bcolGroup;
+
+/* binary output columns being filled */
+typedef struct
+{
+  void *col[BCOL_NUM_OUT];
+  size_t n, cap;
+}bcolBuf;
+
+/* ENSDF index: nuclides -> levels -> gammas (from the adopted levels and gammas datasets) */
+typedef struct
+{
+  double E; /* energy (keV), -1 if not numeric */
+  double MR; /* mixing ratio (if hasMR) */
+  double CC; /* total conversion coefficient, 0 if not given */
+  double Itot; /* total (gamma + conversion electron) relative intensity, -1 if not given */
+  int hasMR;
+  int hasCC;
+  char Es[12]; /* energy as written in the file */
+  char mult[12]; /* multipolarity as written in the file */
+}ensdfGamma;
+
+typedef struct
+{
+  double E; /* energy (keV), -1 if not numeric (eg. 1000+X) */
+  double lt; /* mean lifetime (ps), -1 if unknown */
+  size_t firstGamma, numGammas; /* gammas depopulating the level */
+  char Es[12]; /* energy as written in the file */
+  char J[20]; /* spin and parity as written in the file */
+}ensdfLevel;
+
+typedef struct
+{
+  int A, Z;
+  size_t firstLevel, numLevels;
+  char nucid[6]; /* eg. 152SM */
+}ensdfNuclide;
+
+typedef struct
+{
+  ensdfNuclide *nuc;
+  ensdfLevel *lev;
+  ensdfGamma *gam;
+  size_t numNuc, numLev, numGam;
+  size_t nucCap, levCap, gamCap;
+}ensdfIndex;
+
+/* reasons for not calculating a transition from ENSDF data */
+#define ENSDF_SKIP_LT     0 /* level lifetime unknown (or a limit) */
+#define ENSDF_SKIP_MULT   1 /* multipolarity unknown or not specific */
+#define ENSDF_SKIP_DELTA  2 /* mixed multipolarity without a mixing ratio */
+#define ENSDF_SKIP_BR     3 /* intensities not known for all gammas of the level */
+#define ENSDF_SKIP_CALC   4 /* calculation failed */
+#define ENSDF_NUM_SKIP    5
+
+/* runtime statistics (--stats): stages timed */
+#define STAT_ARGS       0  /* parsing the command line and loading tables */
+#define STAT_INPUT      1  /* reading input and splitting it into chunks */
+#define STAT_CACHE      2  /* hashing lines, and looking up and storing results in the result cache */
+#define STAT_PARSE      3  /* parsing lines (or binary rows) into transitions */
+#define STAT_VALIDATE   4  /* bcalcValidate */
+#define STAT_CALCB      5  /* calcB, B values from lifetimes */
+#define STAT_CALCB_WU   6  /* calcB with ltsp, B values in W.u. */
+#define STAT_CALCLT     7  /* calcLt, lifetimes from B values */
+#define STAT_CALCLT_WU  8  /* calcLt with ltsp, from B values in W.u. */
+#define STAT_BETA2      9  /* calcBeta2 and calcBeta2Lt */
+#define STAT_FORMAT     10 /* formatting results and error messages */
+#define STAT_OUTPUT     11 /* writing output */
+#define STAT_WAIT       12 /* waiting for worker threads */
+#define STAT_NUM        13
+#define STAT_NUM_HW     4  /* hardware counters: cycles, instructions, cache references, cache misses */
+
+/* times and counts, accumulated per chunk of batch input and then over the whole run */
+typedef struct
+{
+  uint64_t ns[STAT_NUM]; /* time spent in each stage (ns, summed over threads) */
+  unsigned long calls[STAT_NUM]; /* number of times each stage was timed */
+  unsigned long numParseErr; /* lines which could not be parsed */
+  unsigned long numCached; /* transitions taken from the result cache */
+  unsigned long numErr[BCALC_NUM_ERR]; /* transitions rejected, by error code */
+}statCounts;
+
+typedef struct
+{
+  statCounts c;
+  uint64_t start; /* start of the run (ns) */
+  int perfFd[STAT_NUM_HW]; /* hardware counters, -1 if not available */
+  int perfErr; /* errno from opening the hardware counters */
+}runStats;
+
+/* persistent result cache (--cache): a file mapped into memory holding a header, an open
+addressing hash table of keys, and a log of entries (results) written in input order, where a key
+is a hash of the text of a batch input line and of everything else its results depend on (see
+rcache.c) */
+#define RCACHE_MAGIC    "BCALCRES"
+#define RCACHE_VERSION  1
+#define RCACHE_DEF_SIZE 2097152 /* default number of entries */
+#define RCACHE_PROBE    16 /* slots searched for a key, from the slot given by its hash */
+#define RCACHE_BLOCK    64 /* entries taken from the log at once, by each chunk of input */
+
+typedef struct
+{
+  char magic[8]; /* RCACHE_MAGIC (not NUL terminated) */
+  uint32_t version; /* RCACHE_VERSION */
+  uint32_t entrySize; /* sizeof(rcacheEntry) */
+  uint64_t numEntries; /* size of the log, a power of 2 */
+  uint64_t numSlots; /* size of the hash table, 2*numEntries */
+  char build[24]; /* build date and time of the bcalc which made the cache */
+  uint64_t next; /* log position of the next entry (positions count up from 1, modulo numEntries) */
+  uint64_t hits, misses; /* over all runs */
+}rcacheHeader;
+
+/* a hash table slot: the first half of a key and the log position of its entry (0 = empty) */
+typedef struct
+{
+  uint64_t key;
+  uint64_t pos;
+}rcacheSlot;
+
+/* an entry, written under a sequence lock: seq is odd while it is being written */
+typedef struct
+{
+  uint32_t seq;
+  int32_t err; /* error code of the calculation */
+  uint64_t key[2];
+  bcalcTrans t; /* the parsed line (iccTab is restored when read) */
+  bcalcRes r;
+}rcacheEntry;
+
+/* lookups in a chunk of input (and in a whole run), with the position of the last entry found
+(the next line is looked for first in the entry after it) and the block of the log being filled */
+typedef struct
+{
+  unsigned long hits, misses, evictions;
+  uint64_t last;
+  uint64_t fill, fillEnd;
+}rcacheCtx;
+
+typedef struct
+{
+  rcacheHeader *hdr; /* the mapped file */
+  rcacheSlot *slot;
+  rcacheEntry *ent;
+  size_t mapSize;
+  uint64_t slotMask, entMask; /* numSlots - 1, numEntries - 1 */
+  uint64_t seed[2]; /* hash of the defaults and everything else the results depend on */
+  const bcalcIccTab *iccTab; /* of the defaults, restored in cached transitions */
+  int fd; /* kept open with a shared lock while in use */
+  rcacheCtx c; /* counts of this run */
+}rcache;
+
+/* whitespace separating columns (the locale independent subset of isspace, without newlines) */
+static inline int isColSep(const char c){
+  return (c == ' ')||(c == '\t')||(c == '\r')||(c == '\v')||(c == '\f');
+}
 
 /* function prototypes */
 void printHelp(void);
-double dblfac(unsigned int);
-double ltsp(const int,const int,const int,const double);
-void calcBeta2(const double,const double,const int,const int,const int,const int);
-void calcBeta2Lt(const double,const double,const int,const int,const int);
-void calcB(const int,const int,const int,const double,const double,const double,const double,const int,const int,const char *,const int);
-void calcLt(const int,const int,const int,const double,double,const double,const double,const int,const int,const char *,const int,const double);
+void getMixedMstr(char *,const size_t,const bcalcTrans *);
+void getBUnit(char *,const size_t,const int,const int,const int);
+void getErrStr(char *,const size_t,const int,const bcalcTrans *);
+void printErr(const int,const bcalcTrans *);
+void printB(strBuf *,const int,const char *,const int,const int,const int,const double);
+void putLifetime(strBuf *,const char *,const double);
+void putFraction(strBuf *,const char *,const double);
+void printResult(strBuf *,const bcalcTrans *,const bcalcRes *,const int);
+void printJacobian(strBuf *,const bcalcTrans *,const bcalcJac *,const int);
+const optDef *findOpt(const char *,const size_t);
+int parseTransArgs(const char *const *,const size_t *,const int,bcalcTrans *,int *,char *,const size_t);
+void initCmdOpts(cmdOpts *);
+int parseCmdArgs(const int,const char *const *,cmdOpts *,char *,const size_t);
+int parseUnc(const char *,double *);
+void printDist(strBuf *,const int,const char *,const char *,const bcalcDist *);
+void sbInit(strBuf *);
+void sbFree(strBuf *);
+void sbReserve(strBuf *,const size_t);
+void sbPrintf(strBuf *,const char *,...);
+void sbPutn(strBuf *,const char *,const size_t);
+void sbPuts(strBuf *,const char *);
+void sbPutc(strBuf *,const char);
+void sbFlush(strBuf *,FILE *);
+size_t fmtExp(char *,const double,const int);
+size_t fmtNum(char *,const double);
+void sbPutExp(strBuf *,const double,const int);
+void sbPutNum(strBuf *,const double);
+void sbJsonStr(strBuf *,const char *,const size_t);
+void getOutVals(outVals *,const bcalcTrans *,const bcalcRes *);
+int parseOutFormat(const char *);
+void formatRecordHeader(strBuf *,const int);
+void formatRecord(strBuf *,const int,const unsigned long,const bcalcTrans *,const bcalcRes *,const int,const char *);
+void formatRow(strBuf *,const bcalcTrans *,const bcalcRes *);
+int parseDouble(const char *,const size_t,double *);
+int processLine(const char *,const size_t,const unsigned long,const bcalcTrans *,const int,const int,strBuf *,bcolBuf *,statCounts *,const rcache *,rcacheCtx *);
+int getNumCPUs(void);
+int runBatch(const char *,const bcalcTrans *,const int,int,const char *,int,runStats *,rcache *);
+void bcolInit(bcolBuf *);
+void bcolFree(bcolBuf *);
+void bcolAppend(bcolBuf *,const unsigned long,const bcalcTrans *,const bcalcRes *,const int);
+int bcolWriteHeader(const int);
+int bcolWriteGroup(const int,const bcolBuf *);
+int bcolOpen(const char *,const size_t,bcolIn *);
+int bcolNextGroup(bcolIn *,bcolGroup *);
+int bcolRowTrans(const bcolGroup *,const size_t,bcalcTrans *);
+void serveRequest(const char *,const size_t,const unsigned long,const bcalcTrans *,strBuf *);
+int runServer(const char *,const bcalcTrans *);
+int runShm(const char *,const bcalcTrans *);
+int rcacheOpen(rcache *,const char *,const unsigned long,const bcalcTrans *,const int);
+void rcacheAdd(rcache *,const rcacheCtx *);
+void rcacheClose(rcache *,FILE *);
+int rcacheKey(const rcache *,const char *,const size_t,uint64_t *);
+int rcacheGet(const rcache *,const uint64_t *,rcacheCtx *,bcalcTrans *,bcalcRes *,int *);
+void rcachePut(const rcache *,const uint64_t *,rcacheCtx *,const bcalcTrans *,const bcalcRes *,const int);
+int runRepl(const cmdOpts *);
+int runFollow(const char *,const bcalcTrans *,const int,const int);
+int parseRange(const char *,const double,bcalcAxis *);
+int runSweep(const bcalcTrans *,const bcalcAxis *,const int,const int);
+int ensdfGrowArr(void **,size_t *,const size_t,const size_t);
+int ensdfParseMult(const char *,char *);
+int ensdfTrans(const ensdfIndex *,const ensdfNuclide *,const ensdfLevel *,const ensdfGamma *,const bcalcTrans *,bcalcTrans *);
+const ensdfNuclide *ensdfFind(const ensdfIndex *,const int,const int);
+void ensdfFree(ensdfIndex *);
+int ensdfLoad(const char *,int,const bcalcTrans *,ensdfIndex *,FILE *,unsigned long *,unsigned long *);
+int runEnsdf(const char *,const bcalcTrans *,const int);
+int runLevels(const char *,const bcalcTrans *,const int);
+uint64_t statsNow(void);
+void statsLap(statCounts *,const int,uint64_t *);
+void statsErr(statCounts *,const int);
+void statsAdd(statCounts *,const statCounts *);
+int statsCompute(const bcalcTrans *,bcalcRes *,statCounts *,uint64_t *);
+void statsStart(runStats *,const uint64_t,const int);
+void statsPrint(runStats *,const unsigned long,const char *,FILE *);
+double ulpDist(const double,const double);
+int selfTestArr(void);
+int selfTestPrec(void);
+int selfTestBatch(void);
+int runSelfTest(void);
@@ -0,0 +1,329 @@
+/* binary columnar input and output (bcol format, see bcalc.h and README.md)
+Output columns are filled per chunk of batch input and written out as one row group with a single
+writev call.  Input files are mapped into memory and used in place, the values are read directly
+from the column arrays. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <unistd.h>
+#include <errno.h>
+#include <sys/uio.h>
+#include "bcalc.h"
+
+/* column names and types, in file order */
+static const bcolColDesc outCols[BCOL_NUM_OUT] = {
+  {"line",BCOL_INT32,0},
+  {"E",BCOL_FLOAT64,0},
+  {"EM",BCOL_INT32,0},
+  {"L",BCOL_INT32,0},
+  {"lifetime",BCOL_FLOAT64,0},
+  {"lifetime1",BCOL_FLOAT64,0},
+  {"B_fm",BCOL_FLOAT64,0},
+  {"B_barn",BCOL_FLOAT64,0},
+  {"B_wu",BCOL_FLOAT64,0},
+  {"B1_fm",BCOL_FLOAT64,0},
+  {"B1_barn",BCOL_FLOAT64,0},
+  {"B1_wu",BCOL_FLOAT64,0},
+  {"beta2",BCOL_FLOAT64,0},
+  {"err",BCOL_INT32,0}
+};
+static const bcolColDesc inCols[BCOL_NUM_IN] = {
+  {"E",BCOL_FLOAT64,0},
+  {"EM",BCOL_INT32,0},
+  {"L",BCOL_INT32,0},
+  {"lifetime",BCOL_FLOAT64,0},
+  {"B",BCOL_FLOAT64,0},
+  {"branching",BCOL_FLOAT64,0},
+  {"delta",BCOL_FLOAT64,0},
+  {"icc",BCOL_FLOAT64,0},
+  {"ji",BCOL_FLOAT64,0},
+  {"jf",BCOL_FLOAT64,0},
+  {"A",BCOL_INT32,0},
+  {"Z",BCOL_INT32,0}
+};
+
+static size_t typeSize(const uint32_t type){
+  return (type == BCOL_INT32) ? sizeof(int32_t) : sizeof(double);
+}
+
+/* size of a column of n values, padded to a multiple of 8 bytes */
+static size_t colSize(const uint32_t type, const size_t n){
+  return (n*typeSize(type) + 7) & ~(size_t)7;
+}
+
+void bcolInit(bcolBuf *b){
+  memset(b,0,sizeof(bcolBuf));
+}
+
+void bcolFree(bcolBuf *b){
+  int i;
+  for(i=0;i<BCOL_NUM_OUT;i++){
+    free(b->col[i]);
+  }
+  bcolInit(b);
+}
+
+static void setF(bcolBuf *b, const int c, const double v){
+  ((double *)b->col[c])[b->n] = v;
+}
+static void setI(bcolBuf *b, const int c, const int32_t v){
+  ((int32_t *)b->col[c])[b->n] = v;
+}
+
+/* appends the results for one transition (NaN for values which were not calculated)
+err is a BCALC_ERR code, or BCOL_ERR_PARSE if the input could not be parsed */
+void bcolAppend(bcolBuf *b, const unsigned long lineNum, const bcalcTrans *t, const bcalcRes *r, const int err){
+  size_t cap;
+  void *p;
+  outVals o;
+  int i;
+
+  if(b->n == b->cap){
+    /* padding to 8 bytes may need one extra int32 value */
+    cap = (b->cap > 0) ? 2*b->cap : 1024;
+    for(i=0;i<BCOL_NUM_OUT;i++){
+      if((p = realloc(b->col[i],colSize(outCols[i].type,cap))) == NULL){
+        printf("ERROR: Cannot allocate memory for output.\n");
+        exit(-1);
+      }
+      b->col[i] = p;
+    }
+    b->cap = cap;
+  }
+
+  setI(b,BCOL_OUT_LINE,(lineNum > INT32_MAX) ? BCOL_NA : (int32_t)lineNum);
+  setF(b,BCOL_OUT_E,(err == BCOL_ERR_PARSE) ? NAN : t->Et);
+  setI(b,BCOL_OUT_EM,((err == BCOL_ERR_PARSE)||(t->EM < 0)) ? BCOL_NA : t->EM);
+  setI(b,BCOL_OUT_L,((err == BCOL_ERR_PARSE)||(t->L < 0)) ? BCOL_NA : t->L);
+  setI(b,BCOL_OUT_ERR,err);
+  getOutVals(&o,t,(err == BCALC_OK) ? r : NULL);
+  setF(b,BCOL_OUT_LT,o.lt);
+  setF(b,BCOL_OUT_LT1,o.lt1);
+  for(i=0;i<3;i++){
+    setF(b,BCOL_OUT_B_FM+i,o.b[i]);
+    setF(b,BCOL_OUT_B1_FM+i,o.b1[i]);
+  }
+  setF(b,BCOL_OUT_BETA2,o.beta2);
+  b->n++;
+}
+
+/* writes all of iov, returns 0 on success */
+static int writeAll(const int fd, struct iovec *iov, int n){
+  ssize_t w;
+  size_t len;
+  while(n > 0){
+    w = writev(fd,iov,n);
+    if(w < 0){
+      if(errno == EINTR)
+        continue;
+      return -1;
+    }
+    len = (size_t)w;
+    while((n > 0)&&(len >= iov->iov_len)){
+      len -= iov->iov_len;
+      iov++;
+      n--;
+    }
+    if(n > 0){
+      iov->iov_base = (char *)iov->iov_base + len;
+      iov->iov_len -= len;
+    }
+  }
+  return 0;
+}
+
+/* writes the file header and column descriptors, returns 0 on success */
+int bcolWriteHeader(const int fd){
+  bcolHeader h;
+  struct iovec iov[2];
+  memcpy(h.magic,BCOL_MAGIC,sizeof(h.magic));
+  h.version = BCOL_VERSION;
+  h.numCols = BCOL_NUM_OUT;
+  iov[0].iov_base = &h;
+  iov[0].iov_len = sizeof(h);
+  iov[1].iov_base = (void *)(uintptr_t)outCols;
+  iov[1].iov_len = sizeof(outCols);
+  return writeAll(fd,iov,2);
+}
+
+/* writes the buffered rows as one row group, returns 0 on success */
+int bcolWriteGroup(const int fd, const bcolBuf *b){
+  bcolGroupHeader g;
+  struct iovec iov[BCOL_NUM_OUT+1];
+  static const char zeros[8] = {0};
+  int i;
+  if(b->n == 0){
+    return 0;
+  }
+  g.numRows = b->n;
+  g.size = 0;
+  iov[0].iov_base = &g;
+  iov[0].iov_len = sizeof(g);
+  for(i=0;i<BCOL_NUM_OUT;i++){
+    /* zero the padding of int32 columns */
+    if(colSize(outCols[i].type,b->n) > b->n*typeSize(outCols[i].type)){
+      memcpy((char *)b->col[i] + b->n*typeSize(outCols[i].type),zeros,colSize(outCols[i].type,b->n) - b->n*typeSize(outCols[i].type));
+    }
+    iov[i+1].iov_base = b->col[i];
+    iov[i+1].iov_len = colSize(outCols[i].type,b->n);
+    g.size += iov[i+1].iov_len;
+  }
+  return writeAll(fd,iov,BCOL_NUM_OUT+1);
+}
+
+/* reads the header of a mapped binary input file, returns 0 on success (with an error message
+printed otherwise) */
+int bcolOpen(const char *data, const size_t size, bcolIn *in){
+  const bcolHeader *h = (const bcolHeader *)(const void *)data;
+  uint32_t i, j;
+  memset(in,0,sizeof(bcolIn));
+  for(j=0;j<BCOL_NUM_IN;j++){
+    in->col[j] = -1;
+  }
+  if((size < sizeof(bcolHeader))||(memcmp(h->magic,BCOL_MAGIC,sizeof(h->magic)) != 0)){
+    printf("ERROR: Not a binary columnar file.\n");
+    return -1;
+  }
+  if(h->version != BCOL_VERSION){
+    printf("ERROR: Unsupported binary columnar file version (or byte order).\n");
+    return -1;
+  }
+  if(h->numCols > (size - sizeof(bcolHeader))/sizeof(bcolColDesc)){
+    printf("ERROR: Binary columnar file is truncated.\n");
+    return -1;
+  }
+  in->data = data;
+  in->size = size;
+  in->numCols = h->numCols;
+  in->desc = (const bcolColDesc *)(const void *)(data + sizeof(bcolHeader));
+  in->pos = sizeof(bcolHeader) + h->numCols*sizeof(bcolColDesc);
+  for(i=0;i<h->numCols;i++){
+    for(j=0;j<BCOL_NUM_IN;j++){
+      if(strncmp(in->desc[i].name,inCols[j].name,BCOL_NAME_LEN) == 0){
+        if(in->desc[i].type != inCols[j].type){
+          printf("ERROR: Column '%s' of the binary input has the wrong type (must be %s).\n",inCols[j].name,(inCols[j].type == BCOL_INT32) ? "int32" : "float64");
+          return -1;
+        }
+        in->col[j] = (int)i;
+      }
+    }
+    if((in->desc[i].type != BCOL_FLOAT64)&&(in->desc[i].type != BCOL_INT32)){
+      printf("ERROR: Column %u of the binary input has an unknown type.\n",i+1);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/* gets the next row group of a binary input file
+returns 1 if there is a group, 0 at the end of the file, -1 if the file is invalid */
+int bcolNextGroup(bcolIn *in, bcolGroup *g){
+  const bcolGroupHeader *gh;
+  size_t pos, size;
+  uint32_t i;
+  int j;
+  if(in->pos == in->size){
+    return 0;
+  }
+  if(in->size - in->pos < sizeof(bcolGroupHeader)){
+    return -1;
+  }
+  gh = (const bcolGroupHeader *)(const void *)(in->data + in->pos);
+  pos = in->pos + sizeof(bcolGroupHeader);
+  if((gh->numRows > (in->size - pos)/sizeof(int32_t))||(gh->size > in->size - pos)||(gh->size % 8 != 0)){
+    return -1;
+  }
+  memset(g,0,sizeof(bcolGroup));
+  g->numRows = (size_t)gh->numRows;
+  size = 0;
+  for(i=0;i<in->numCols;i++){
+    for(j=0;j<BCOL_NUM_IN;j++){
+      if(in->col[j] == (int)i)
+        g->col[j] = in->data + pos + size;
+    }
+    size += colSize(in->desc[i].type,g->numRows);
+    if(size > gh->size){
+      return -1;
+    }
+  }
+  in->pos = pos + (size_t)gh->size;
+  return 1;
+}
+
+/* sets the transition parameters given for a row of binary input (others are left unchanged)
+returns BCALC_OK or an error code for an invalid multipole */
+int bcolRowTrans(const bcolGroup *g, const size_t row, bcalcTrans *t){
+  const double *f;
+  int32_t EM, L;
+  double v;
+  int j;
+
+  if((g->col[BCOL_IN_EM] != NULL)&&(g->col[BCOL_IN_L] != NULL)){
+    EM = ((const int32_t *)g->col[BCOL_IN_EM])[row];
+    L = ((const int32_t *)g->col[BCOL_IN_L])[row];
+    if((EM != BCOL_NA)&&(L != BCOL_NA)){
+      if((EM != 0)&&(EM != 1)){
+        return BCALC_ERR_MULTIPOLE;
+      }
+      if(L < 0){
+        return BCALC_ERR_MULTIPOLE;
+      }
+      if(L > BCALC_MAXL){
+        return BCALC_ERR_LMAX;
+      }
+      t->EM = EM;
+      t->L = L;
+      snprintf(t->mstr,sizeof(t->mstr),"%c%i",EM ? 'M' : 'E',L);
+    }
+  }
+  if((g->col[BCOL_IN_A] != NULL)&&(((const int32_t *)g->col[BCOL_IN_A])[row] != BCOL_NA)){
+    t->nucA = ((const int32_t *)g->col[BCOL_IN_A])[row];
+  }
+  if((g->col[BCOL_IN_Z] != NULL)&&(((const int32_t *)g->col[BCOL_IN_Z])[row] != BCOL_NA)){
+    t->nucZ = ((const int32_t *)g->col[BCOL_IN_Z])[row];
+  }
+
+  for(j=0;j<BCOL_NUM_IN;j++){
+    if((g->col[j] == NULL)||(inCols[j].type != BCOL_FLOAT64))
+      continue;
+    f = (const double *)g->col[j];
+    v = f[row];
+    if(isnan(v))
+      continue;
+    switch(j){
+      case BCOL_IN_E:
+        t->Et = v;
+        break;
+      case BCOL_IN_LT:
+        t->lt = v;
+        t->calcMode = 0;
+        break;
+      case BCOL_IN_B:
+        /* a lifetime takes precedence */
+        if((g->col[BCOL_IN_LT] == NULL)||(isnan(((const double *)g->col[BCOL_IN_LT])[row]))){
+          t->b = v;
+          t->calcMode = 1;
+        }
+        break;
+      case BCOL_IN_BR:
+        t->branching = v;
+        break;
+      case BCOL_IN_DELTA:
+        t->delta = v;
+        t->useDelta = 1;
+        break;
+      case BCOL_IN_ICC:
+        t->icc = v;
+        t->iccAuto = 0;
+        break;
+      case BCOL_IN_JI:
+        t->ji = v;
+        break;
+      case BCOL_IN_JF:
+      default:
+        t->jf = v;
+        break;
+    }
+  }
+  return BCALC_OK;
+}
@@ -0,0 +1,357 @@
+/* bcalc-bench: micro- and end-to-end benchmarks (run with 'make bench')
+Results are written to stdout as tab separated columns, one benchmark per line:
+  benchmark  n  ns_per_op  ops_per_s  bytes_per_s
+where n is the number of operations (calls, elements, rows or processes) timed,
+and bytes_per_s is the input throughput (0 where it does not apply). */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <limits.h>
+#include <time.h>
+#include <spawn.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "bcalc.h"
+
+#define BENCH_MIN_TIME  0.2 /* minimum time per microbenchmark (s) */
+#define BENCH_ARR_LEN   4096 /* elements per array calculation */
+#define BENCH_NUM_VALS  64 /* distinct input values cycled through by microbenchmarks */
+
+extern char **environ;
+
+static volatile double benchSink; /* keeps results from being optimized away */
+
+static double nowSec(void){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec/1E9;
+}
+
+static void printBench(const char *name, const unsigned long n, const double sec, const double bytes){
+  printf("%s\t%lu\t%.3f\t%.6g\t%.6g\n",name,n,sec*1E9/(double)n,(double)n/sec,bytes/sec);
+  fflush(stdout);
+}
+
+/* xorshift64* */
+static uint64_t benchRand(uint64_t *s){
+  *s ^= *s >> 12;
+  *s ^= *s << 25;
+  *s ^= *s >> 27;
+  return *s * 2685821657736338717ULL;
+}
+
+static double benchUniform(uint64_t *s){
+  return (double)(benchRand(s) >> 11)*(1.0/9007199254740992.0);
+}
+
+/* times op (which performs 'per' operations per call) until BENCH_MIN_TIME has passed */
+#define TIME_LOOP(name, per, op) do{ \
+    unsigned long iter_, reps_ = 1024; \
+    double t0_, t1_; \
+    for(;;){ \
+      t0_ = nowSec(); \
+      for(iter_=0;iter_<reps_;iter_++){ op; } \
+      t1_ = nowSec(); \
+      if(t1_ - t0_ >= BENCH_MIN_TIME) break; \
+      reps_ *= 2; \
+    } \
+    printBench(name,reps_*(unsigned long)(per),t1_-t0_,0.); \
+  }while(0)
+
+static void benchMicro(void){
+
+  double Et[BENCH_NUM_VALS], lt[BENCH_NUM_VALS];
+  char name[64];
+  const char *kname;
+  double sum = 0.;
+  uint64_t seed = 1;
+  int EM, L, k, i;
+  bcalcTrans t;
+  bcalcRes r;
+  bcalcArrIn in;
+  bcalcArrOut out;
+  bcalcAxis axes[BCALC_NUM_AXES];
+  double *arrEt, *arrLt, *arrVal, *arrVal1;
+  char fmtBuf[32];
+
+  for(i=0;i<BENCH_NUM_VALS;i++){
+    Et[i] = 50. + 3000.*benchUniform(&seed);
+    lt[i] = pow(10.,-3. + 9.*benchUniform(&seed));
+  }
+
+  TIME_LOOP("dblfac",BENCH_NUM_VALS,for(i=0;i<BENCH_NUM_VALS;i++) sum += dblfac((unsigned int)(2*(i%(BCALC_MAXL+1))+1)));
+  for(EM=0;EM<2;EM++){
+    for(L=(EM==0)?0:1;L<=BCALC_MAXL;L++){
+      snprintf(name,sizeof(name),"ltsp_%c%i",EM ? 'M' : 'E',L);
+      TIME_LOOP(name,BENCH_NUM_VALS,for(i=0;i<BENCH_NUM_VALS;i++) sum += ltsp(EM,L,152,Et[i]));
+    }
+  }
+  for(EM=0;EM<2;EM++){
+    for(L=1;L<=BCALC_MAXL;L++){
+      snprintf(name,sizeof(name),"calcB_%c%i",EM ? 'M' : 'E',L);
+      TIME_LOOP(name,BENCH_NUM_VALS,for(i=0;i<BENCH_NUM_VALS;i++) sum += calcB(0,EM,L,Et[i]/1000.,lt[i]*1E-12,2.,0.,0,152));
+      snprintf(name,sizeof(name),"calcLt_%c%i",EM ? 'M' : 'E',L);
+      TIME_LOOP(name,BENCH_NUM_VALS,for(i=0;i<BENCH_NUM_VALS;i++) sum += calcLt(0,EM,L,Et[i],lt[i],2.,0.,0,152,1.));
+    }
+  }
+
+  bcalcInitTrans(&t);
+  bcalcParseMultipole("E2",&t);
+  t.calcMode = 0;
+  t.ji = 2.;
+  t.jf = 0.;
+  t.delta = 0.5;
+  t.useDelta = 1;
+  t.branching = 0.5;
+  t.nucA = 152;
+  t.barn = 2;
+  TIME_LOOP("bcalcCompute_E2_mixed",BENCH_NUM_VALS,for(i=0;i<BENCH_NUM_VALS;i++){ t.Et = Et[i]; t.lt = lt[i]; bcalcCompute(&t,&r); sum += r.b; });
+  t.precision = BCALC_PREC_FAST;
+  TIME_LOOP("bcalcCompute_E2_mixed_fast",BENCH_NUM_VALS,for(i=0;i<BENCH_NUM_VALS;i++){ t.Et = Et[i]; t.lt = lt[i]; bcalcCompute(&t,&r); sum += r.b; });
+  t.precision = BCALC_PREC_DEFAULT;
+
+  arrEt = malloc(BENCH_ARR_LEN*sizeof(double));
+  arrLt = malloc(BENCH_ARR_LEN*sizeof(double));
+  arrVal = malloc(BENCH_ARR_LEN*sizeof(double));
+  arrVal1 = malloc(BENCH_ARR_LEN*sizeof(double));
+  if((arrEt == NULL)||(arrLt == NULL)||(arrVal == NULL)||(arrVal1 == NULL)){
+    printf("ERROR: Cannot allocate memory.\n");
+    exit(-1);
+  }
+  for(i=0;i<BENCH_ARR_LEN;i++){
+    arrEt[i] = Et[i%BENCH_NUM_VALS];
+    arrLt[i] = lt[i%BENCH_NUM_VALS];
+  }
+  in.t = t;
+  in.n = BENCH_ARR_LEN;
+  in.Et = arrEt;
+  in.val = arrLt;
+  in.branching = NULL;
+  in.icc = NULL;
+  in.delta = NULL;
+  out.val = arrVal;
+  out.val1 = arrVal1;
+  for(k=BCALC_KERNEL_SCALAR;k<BCALC_NUM_KERNELS;k++){
+    if(!bcalcKernelAvail(k))
+      continue;
+    kname = bcalcKernelName(k);
+    snprintf(name,sizeof(name),"bcalcComputeArr_E2_mixed_%s",kname);
+    TIME_LOOP(name,BENCH_ARR_LEN,bcalcComputeArrKernel(&in,&out,k); sum += arrVal[0]);
+    in.t.precision = BCALC_PREC_FAST;
+    snprintf(name,sizeof(name),"bcalcComputeArr_E2_mixed_%s_fast",kname);
+    TIME_LOOP(name,BENCH_ARR_LEN,bcalcComputeArrKernel(&in,&out,k); sum += arrVal[0]);
+    in.t.precision = BCALC_PREC_DEFAULT;
+  }
+  /* 64 energies x 8 lifetimes x 8 mixing ratios = BENCH_ARR_LEN grid points */
+  memset(axes,0,sizeof(axes));
+  axes[BCALC_AXIS_ENERGY].start = 50.;
+  axes[BCALC_AXIS_ENERGY].step = 47.;
+  axes[BCALC_AXIS_ENERGY].n = 64;
+  axes[BCALC_AXIS_VAL].start = 1.;
+  axes[BCALC_AXIS_VAL].step = 10.;
+  axes[BCALC_AXIS_VAL].n = 8;
+  axes[BCALC_AXIS_DELTA].start = -80.;
+  axes[BCALC_AXIS_DELTA].step = 20.;
+  axes[BCALC_AXIS_DELTA].n = 8;
+  axes[BCALC_AXIS_DELTA].atan = 1;
+  TIME_LOOP("bcalcSweep_E2_mixed",BENCH_ARR_LEN,bcalcSweep(&t,axes,0,64,&out); sum += arrVal[0]);
+  free(arrEt);
+  free(arrLt);
+  free(arrVal);
+  free(arrVal1);
+
+  /* number formatting, the B values from above */
+  TIME_LOOP("fmtExp_4",BENCH_NUM_VALS,for(i=0;i<BENCH_NUM_VALS;i++) sum += (double)fmtExp(fmtBuf,Et[i]*lt[i],4));
+  TIME_LOOP("snprintf_E4",BENCH_NUM_VALS,for(i=0;i<BENCH_NUM_VALS;i++) sum += snprintf(fmtBuf,sizeof(fmtBuf),"%0.4E",Et[i]*lt[i]));
+  TIME_LOOP("fmtNum",BENCH_NUM_VALS,for(i=0;i<BENCH_NUM_VALS;i++) sum += (double)fmtNum(fmtBuf,Et[i]*lt[i]));
+  TIME_LOOP("snprintf_17g",BENCH_NUM_VALS,for(i=0;i<BENCH_NUM_VALS;i++) sum += snprintf(fmtBuf,sizeof(fmtBuf),"%.17g",Et[i]*lt[i]));
+
+  TIME_LOOP("bcalcParseNuclide",4,{ int A_; int Z_; bcalcParseNuclide("152Sm",5,&A_,&Z_); sum += A_; bcalcParseNuclide("60Ni",4,&A_,&Z_); sum += A_; bcalcParseNuclide("Pb208",5,&A_,&Z_); sum += A_; bcalcParseNuclide("u-238",5,&A_,&Z_); sum += A_; });
+  TIME_LOOP("bcalcNucRadius",4,sum += bcalcNucRadius(152,62) + bcalcNucRadius(60,28) + bcalcNucRadius(208,82) + bcalcNucRadius(100,50));
+  TIME_LOOP("parseDouble",4,{ double v_; parseDouble("1332.5",6,&v_); sum += v_; parseDouble("0.9",3,&v_); sum += v_; parseDouble("2.2E-3",6,&v_); sum += v_; parseDouble("60",2,&v_); sum += v_; });
+
+  benchSink = sum;
+}
+
+static void benchMonteCarlo(void){
+  bcalcTrans t;
+  bcalcUnc u;
+  bcalcMCRes r;
+  const unsigned long n = 1000000;
+  double t0, t1;
+  bcalcInitTrans(&t);
+  bcalcParseMultipole("M1",&t);
+  t.calcMode = 0;
+  t.Et = 500.;
+  t.lt = 1.;
+  t.delta = 0.3;
+  t.useDelta = 1;
+  t.branching = 0.5;
+  memset(&u,0,sizeof(u));
+  u.val[0] = 0.1;
+  u.val[1] = 0.05;
+  u.delta[0] = u.delta[1] = 0.2;
+  u.branching[0] = u.branching[1] = 0.1;
+  t0 = nowSec();
+  bcalcMonteCarlo(&t,&u,n,1,1,&r);
+  t1 = nowSec();
+  printBench("bcalcMonteCarlo_M1_mixed_1thread",n,t1-t0,0.);
+}
+
+/* runs a command with stdout (and stdin) redirected, returns the wall time (s) */
+static double runCmd(char *const argv[], const char *inFile){
+  posix_spawn_file_actions_t fa;
+  pid_t pid;
+  int status;
+  double t0, t1;
+  posix_spawn_file_actions_init(&fa);
+  posix_spawn_file_actions_addopen(&fa,STDOUT_FILENO,"/dev/null",O_WRONLY,0);
+  posix_spawn_file_actions_addopen(&fa,STDIN_FILENO,(inFile != NULL) ? inFile : "/dev/null",O_RDONLY,0);
+  t0 = nowSec();
+  if(posix_spawn(&pid,argv[0],&fa,NULL,argv,environ) != 0){
+    printf("ERROR: Cannot run %s.\n",argv[0]);
+    exit(-1);
+  }
+  waitpid(pid,&status,0);
+  t1 = nowSec();
+  posix_spawn_file_actions_destroy(&fa);
+  return t1 - t0;
+}
+
+/* writes a synthetic batch input file with n rows, returns its size in bytes */
+static double writeDataset(const char *fileName, const unsigned long n){
+  static const char *mstr[] = {"E1","M1","E2","M2","E3"};
+  FILE *f;
+  uint64_t seed = 12345;
+  unsigned long i;
+  long size;
+  if((f = fopen(fileName,"w")) == NULL){
+    printf("ERROR: Cannot write %s.\n",fileName);
+    exit(-1);
+  }
+  for(i=0;i<n;i++){
+    fprintf(f,"%.3f %s %.4g",50. + 3000.*benchUniform(&seed),mstr[benchRand(&seed)%5],pow(10.,-3. + 6.*benchUniform(&seed)));
+    switch(benchRand(&seed)%4){
+      case 0:
+        fprintf(f,"\n");
+        break;
+      case 1:
+        fprintf(f," %.3f\n",0.05 + 0.95*benchUniform(&seed));
+        break;
+      case 2:
+        fprintf(f," %.3f %.3f\n",0.05 + 0.95*benchUniform(&seed),2.*benchUniform(&seed) - 1.);
+        break;
+      default:
+        fprintf(f," - %.3f %.4f\n",2.*benchUniform(&seed) - 1.,0.1*benchUniform(&seed));
+        break;
+    }
+  }
+  size = ftell(f);
+  fclose(f);
+  return (double)size;
+}
+
+static void benchProcess(char *bcalc, const unsigned long n){
+  char *argv[] = {NULL,"-e","1332","-m","E2","-lt","0.9","--quiet",NULL};
+  double sec = 0.;
+  unsigned long i;
+  argv[0] = bcalc;
+  for(i=0;i<n;i++)
+    sec += runCmd(argv,NULL);
+  printBench("process_single",n,sec,0.);
+}
+
+static void benchBatch(char *bcalc, const unsigned long maxRows, char *threads){
+  char fileName[] = "bench_tmpdatafile.txt";
+  char binFileName[] = "bench_tmpdatafile.bcol";
+  char *argvFile[] = {NULL,"--batch",NULL,"--threads",NULL,NULL};
+  char *argvPipe[] = {NULL,"--batch","--threads",NULL,NULL};
+  char *argvBinOut[] = {NULL,"--batch",NULL,"--binout",NULL,"--threads",NULL,NULL};
+  char *argvBinIn[] = {NULL,"--batch",NULL,"--binout","/dev/null","--threads",NULL,NULL};
+  char *argvCsv[] = {NULL,"--batch",NULL,"--format","csv","--threads",NULL,NULL};
+  char name[64];
+  unsigned long n;
+  double bytes, sec;
+  argvFile[0] = argvPipe[0] = argvBinOut[0] = argvBinIn[0] = argvCsv[0] = bcalc;
+  argvFile[2] = argvBinOut[2] = argvCsv[2] = fileName;
+  argvBinOut[4] = argvBinIn[2] = binFileName;
+  argvFile[4] = argvPipe[3] = argvBinOut[6] = argvBinIn[6] = argvCsv[6] = threads;
+  for(n=1000;n<=maxRows;n*=10){
+    bytes = writeDataset(fileName,n);
+    sec = runCmd(argvFile,NULL);
+    snprintf(name,sizeof(name),"batch_file_%lu",n);
+    printBench(name,n,sec,bytes);
+    sec = runCmd(argvPipe,fileName);
+    snprintf(name,sizeof(name),"batch_stdin_%lu",n);
+    printBench(name,n,sec,bytes);
+    sec = runCmd(argvCsv,NULL);
+    snprintf(name,sizeof(name),"batch_csv_%lu",n);
+    printBench(name,n,sec,bytes);
+    /* binary columnar output, then the same file as input */
+    sec = runCmd(argvBinOut,NULL);
+    snprintf(name,sizeof(name),"batch_binout_%lu",n);
+    printBench(name,n,sec,bytes);
+    sec = runCmd(argvBinIn,NULL);
+    snprintf(name,sizeof(name),"batch_binin_%lu",n);
+    printBench(name,n,sec,0.);
+    if(n > ULONG_MAX/10)
+      break;
+  }
+  remove(fileName);
+  remove(binFileName);
+}
+
+static void printUsage(void){
+  printf("\nbcalc benchmarks\n");
+  printf("usage: bcalc-bench [--micro] [--e2e] [--bcalc PATH] [--max-rows N] [--threads N]\n\n");
+  printf("    --micro    --  Only run the microbenchmarks.\n");
+  printf("    --e2e      --  Only run the end-to-end benchmarks.\n");
+  printf("    --bcalc    --  bcalc executable used by the end-to-end\n");
+  printf("                   benchmarks (default ./bcalc).\n");
+  printf("    --max-rows --  Largest batch dataset, datasets from 1000 rows\n");
+  printf("                   up to this size (in steps of 10x) are used\n");
+  printf("                   (default 1000000).\n");
+  printf("    --threads  --  Threads used by bcalc in batch mode (default:\n");
+  printf("                   the number of processors).\n");
+}
+
+int main(int argc, char *argv[]){
+
+  char defBcalc[] = "./bcalc";
+  char *bcalc = defBcalc;
+  char threads[16];
+  unsigned long maxRows = 1000000;
+  int micro = 1, e2e = 1;
+  int i;
+
+  snprintf(threads,sizeof(threads),"%li",(sysconf(_SC_NPROCESSORS_ONLN) > 0) ? sysconf(_SC_NPROCESSORS_ONLN) : 1L);
+  for(i=1;i<argc;i++){
+    if(strcmp(argv[i],"--micro")==0){
+      e2e = 0;
+    }else if(strcmp(argv[i],"--e2e")==0){
+      micro = 0;
+    }else if((strcmp(argv[i],"--bcalc")==0)&&(i<argc-1)){
+      bcalc = argv[++i];
+    }else if((strcmp(argv[i],"--max-rows")==0)&&(i<argc-1)){
+      maxRows = strtoul(argv[++i],NULL,10);
+    }else if((strcmp(argv[i],"--threads")==0)&&(i<argc-1)){
+      snprintf(threads,sizeof(threads),"%s",argv[++i]);
+    }else{
+      printUsage();
+      exit(-1);
+    }
+  }
+
+  printf("benchmark\tn\tns_per_op\tops_per_s\tbytes_per_s\n");
+  if(micro){
+    benchMicro();
+    benchMonteCarlo();
+  }
+  if(e2e){
+    benchProcess(bcalc,200);
+    benchBatch(bcalc,maxRows,threads);
+  }
+  return 0;
+}
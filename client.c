@@ -0,0 +1,272 @@
+/* bcalc-client: client and load generator for the bcalc server mode (bcalc --serve SOCK)
+Without options, requests are read from stdin (one per line) and the answers are printed.
+With --load N, N copies of a request are sent over one or more connections, and the throughput
+and latency distribution are reported. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define CLIENT_BUF_SIZE 65536
+#define CLIENT_DEF_REQ  "-e 1332 -m E2 -lt 0.9"
+
+typedef struct
+{
+  const char *path;
+  const char *req; /* request line, including the newline */
+  size_t reqLen;
+  unsigned long n; /* number of requests to send */
+  int depth; /* maximum number of requests in flight */
+  double *lat; /* latency of each request (us) */
+  int err;
+}loadArg;
+
+static void printUsage(void){
+  printf("\nClient for the bcalc server mode (bcalc --serve SOCK)\n");
+  printf("usage: bcalc-client SOCK [--load N] [--conns C] [--depth D] [--req 'REQUEST']\n\n");
+  printf("  Without --load, requests are read from stdin (one per line, with the\n");
+  printf("  same parameters as the bcalc command line) and the answers are printed.\n\n");
+  printf("    --load     --  Send N requests and report the throughput and latency.\n");
+  printf("    --conns    --  Number of connections used by --load (default 1).\n");
+  printf("    --depth    --  Number of requests in flight per connection\n");
+  printf("                   (default 1, ie. each request waits for the answer\n");
+  printf("                   to the previous one).\n");
+  printf("    --req      --  The request sent by --load\n");
+  printf("                   (default '%s').\n",CLIENT_DEF_REQ);
+}
+
+static double nowUs(void){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return (double)ts.tv_sec*1E6 + (double)ts.tv_nsec/1E3;
+}
+
+static int connectSock(const char *path){
+  struct sockaddr_un addr;
+  int fd;
+  if(strlen(path) >= sizeof(addr.sun_path))
+    return -1;
+  memset(&addr,0,sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path,path);
+  if((fd = socket(AF_UNIX,SOCK_STREAM,0)) < 0)
+    return -1;
+  if(connect(fd,(struct sockaddr *)&addr,sizeof(addr)) != 0){
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+static int writeAll(const int fd, const char *data, size_t len){
+  ssize_t n;
+  while(len > 0){
+    n = write(fd,data,len);
+    if(n < 0){
+      if(errno == EINTR)
+        continue;
+      return -1;
+    }
+    data += n;
+    len -= (size_t)n;
+  }
+  return 0;
+}
+
+/* sends requests from stdin one at a time, printing the answers */
+static int runInteractive(const char *path){
+  char line[CLIENT_BUF_SIZE], buf[CLIENT_BUF_SIZE];
+  size_t len;
+  ssize_t n;
+  int fd, got;
+  if((fd = connectSock(path)) < 0){
+    printf("ERROR: Cannot connect to %s.\n",path);
+    return -1;
+  }
+  while(fgets(line,sizeof(line),stdin) != NULL){
+    len = strlen(line);
+    if((len == 0)||(line[len-1] != '\n')){
+      if(len == sizeof(line)-1){
+        printf("ERROR: Request too long.\n");
+        break;
+      }
+      line[len++] = '\n';
+    }
+    if(strspn(line," \t\r\n") == len)
+      continue; /* blank lines get no answer */
+    if(writeAll(fd,line,len) != 0)
+      break;
+    /* print the answer line */
+    got = 0;
+    while(!got){
+      n = read(fd,buf,sizeof(buf));
+      if(n <= 0){
+        printf("ERROR: Connection closed by the server.\n");
+        close(fd);
+        return -1;
+      }
+      fwrite(buf,1,(size_t)n,stdout);
+      got = (buf[n-1] == '\n');
+    }
+    fflush(stdout);
+  }
+  close(fd);
+  return 0;
+}
+
+static void *loadWorker(void *arg){
+  loadArg *a = (loadArg *)arg;
+  char buf[CLIENT_BUF_SIZE];
+  double *sent;
+  unsigned long numSent = 0, numRecv = 0;
+  ssize_t n, i;
+  int fd;
+  if(((fd = connectSock(a->path)) < 0)||((sent = malloc((size_t)a->depth*sizeof(double))) == NULL)){
+    a->err = 1;
+    return NULL;
+  }
+  while(numRecv < a->n){
+    while((numSent < a->n)&&(numSent - numRecv < (unsigned long)a->depth)){
+      sent[numSent % (unsigned long)a->depth] = nowUs();
+      if(writeAll(fd,a->req,a->reqLen) != 0){
+        a->err = 1;
+        break;
+      }
+      numSent++;
+    }
+    if(a->err)
+      break;
+    n = read(fd,buf,sizeof(buf));
+    if(n <= 0){
+      if((n < 0)&&(errno == EINTR))
+        continue;
+      a->err = 1;
+      break;
+    }
+    for(i=0;i<n;i++){
+      if(buf[i] == '\n'){
+        a->lat[numRecv] = nowUs() - sent[numRecv % (unsigned long)a->depth];
+        numRecv++;
+      }
+    }
+  }
+  free(sent);
+  close(fd);
+  return NULL;
+}
+
+static int cmpDouble(const void *a, const void *b){
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+/* sends n requests over numConns connections, reports throughput and latency */
+static int runLoad(const char *path, const char *req, const unsigned long n, const int numConns, const int depth){
+  pthread_t *threads;
+  loadArg *args;
+  double *lat;
+  char *line;
+  double t0, t1;
+  unsigned long per, first;
+  int i, err = 0;
+
+  line = malloc(strlen(req)+2);
+  threads = calloc((size_t)numConns,sizeof(pthread_t));
+  args = calloc((size_t)numConns,sizeof(loadArg));
+  lat = calloc(n,sizeof(double));
+  if((line == NULL)||(threads == NULL)||(args == NULL)||(lat == NULL)){
+    printf("ERROR: Cannot allocate memory.\n");
+    return -1;
+  }
+  snprintf(line,strlen(req)+2,"%s\n",req);
+
+  per = n/(unsigned long)numConns;
+  first = 0;
+  for(i=0;i<numConns;i++){
+    args[i].path = path;
+    args[i].req = line;
+    args[i].reqLen = strlen(line);
+    args[i].n = (i == numConns-1) ? n - first : per;
+    args[i].depth = depth;
+    args[i].lat = lat + first;
+    first += args[i].n;
+  }
+  t0 = nowUs();
+  for(i=0;i<numConns;i++){
+    if(pthread_create(&threads[i],NULL,loadWorker,&args[i]) != 0){
+      printf("ERROR: Cannot create thread.\n");
+      return -1;
+    }
+  }
+  for(i=0;i<numConns;i++){
+    pthread_join(threads[i],NULL);
+    err |= args[i].err;
+  }
+  t1 = nowUs();
+  if(err){
+    printf("ERROR: Cannot connect to or lost connection to %s.\n",path);
+    return -1;
+  }
+
+  qsort(lat,n,sizeof(double),cmpDouble);
+  printf("requests: %lu\n",n);
+  printf("connections: %i\n",numConns);
+  printf("depth: %i\n",depth);
+  printf("time_s: %.6f\n",(t1-t0)/1E6);
+  printf("requests_per_s: %.0f\n",(double)n/((t1-t0)/1E6));
+  printf("latency_p50_us: %.2f\n",lat[(size_t)(0.50*(double)(n-1))]);
+  printf("latency_p90_us: %.2f\n",lat[(size_t)(0.90*(double)(n-1))]);
+  printf("latency_p99_us: %.2f\n",lat[(size_t)(0.99*(double)(n-1))]);
+  printf("latency_p999_us: %.2f\n",lat[(size_t)(0.999*(double)(n-1))]);
+  printf("latency_max_us: %.2f\n",lat[n-1]);
+
+  free(lat);
+  free(args);
+  free(threads);
+  free(line);
+  return 0;
+}
+
+int main(int argc, char *argv[]){
+
+  const char *req = CLIENT_DEF_REQ;
+  unsigned long n = 0;
+  int numConns = 1, depth = 1;
+  int i;
+
+  if((argc < 2)||(strcmp(argv[1],"--help")==0)){
+    printUsage();
+    exit(-1);
+  }
+  for(i=2;i<(argc-1);i++){
+    if(strcmp(argv[i],"--load")==0){
+      n = strtoul(argv[i+1],NULL,10);
+    }else if(strcmp(argv[i],"--conns")==0){
+      numConns = atoi(argv[i+1]);
+    }else if(strcmp(argv[i],"--depth")==0){
+      depth = atoi(argv[i+1]);
+    }else if(strcmp(argv[i],"--req")==0){
+      req = argv[i+1];
+    }
+  }
+  if((numConns <= 0)||(depth <= 0)){
+    printf("ERROR: The number of connections and depth must be positive integers.\n");
+    exit(-1);
+  }
+
+  if(n > 0){
+    if(n < (unsigned long)numConns)
+      numConns = (int)n;
+    return runLoad(argv[1],req,n,numConns,depth);
+  }
+  return runInteractive(argv[1]);
+}
@@ -0,0 +1,529 @@
+/* ENSDF mode: reads evaluated nuclear structure data files (ENSDF 80 column format), builds an index
+of nuclides -> levels -> gammas from the adopted levels and gammas datasets, and calculates reduced
+transition probabilities for every gamma ray depopulating a level with a known lifetime
+The file is mapped into memory and split at dataset boundaries into parts which are parsed (and
+calculated) in parallel, the parts are then joined in file order. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "bcalc.h"
+
+#define ENSDF_YEAR_S  31556926.0 /* seconds per year (365.2422 days) */
+
+/* a part of the file, parsed by one thread */
+typedef struct
+{
+  const char *data;
+  size_t len;
+  const bcalcTrans *tdef;
+  ensdfIndex idx;
+  strBuf out;
+  unsigned long numCalc;
+  unsigned long numSkip[ENSDF_NUM_SKIP];
+  int started; /* 1 if parsed by a separate thread */
+  int err;
+}ensdfPart;
+
+/* makes room in an index array for element n, doubling its capacity as needed, returns 0 on success */
+int ensdfGrowArr(void **arr, size_t *cap, const size_t n, const size_t size){
+  void *na;
+  size_t ncap;
+  if(n < *cap)
+    return 0;
+  ncap = (*cap > 0) ? *cap*2 : 256;
+  if((na = realloc(*arr,ncap*size)) == NULL)
+    return -1;
+  *arr = na;
+  *cap = ncap;
+  return 0;
+}
+
+/* copies columns [col,col+width) (1-based, as in the ENSDF manual) of a line, without surrounding spaces */
+static void getField(const char *line, const size_t len, const size_t col, const size_t width, char *buf){
+  size_t s = col - 1;
+  size_t e = s + width;
+  if(e > len)
+    e = len;
+  while((s < e)&&(line[s] == ' '))
+    s++;
+  while((e > s)&&(line[e-1] == ' '))
+    e--;
+  if(s >= e){
+    buf[0] = '\0';
+    return;
+  }
+  memcpy(buf,line + s,e - s);
+  buf[e - s] = '\0';
+}
+
+/* parses a numeric field, returns 0 if it is empty or not a number */
+static int getNum(const char *line, const size_t len, const size_t col, const size_t width, double *val){
+  char buf[32];
+  getField(line,len,col,width,buf);
+  return (buf[0] != '\0')&&parseDouble(buf,strlen(buf),val);
+}
+
+/* gets A and Z from a NUCID (columns 1-5, eg. '152SM'), returns 0 if it is not a nuclide */
+static int parseNucid(const char *line, const size_t len, int *A, int *Z){
+  char buf[8], sym[3];
+  getField(line,len,1,3,buf);
+  *A = atoi(buf);
+  getField(line,len,4,2,sym);
+  if((*A <= 0)||(sym[0] == '\0'))
+    return 0;
+  *Z = bcalcElementZ(sym,strlen(sym));
+  return (*Z > 0);
+}
+
+/* gets the mean lifetime (ps) from the half-life field of a level record (columns 40-55)
+returns 0 if there is no usable value (empty, stable, a limit, etc.) */
+static int parseHalfLife(const char *line, const size_t len, double *lt){
+  char buf[16], dt[8];
+  char *unit;
+  double val, fac;
+  getField(line,len,50,6,dt);
+  if((strncmp(dt,"LT",2) == 0)||(strncmp(dt,"GT",2) == 0)||(strncmp(dt,"LE",2) == 0)||(strncmp(dt,"GE",2) == 0)||(dt[0] == '?'))
+    return 0;
+  getField(line,len,40,10,buf);
+  if((unit = strchr(buf,' ')) == NULL)
+    return 0;
+  *unit++ = '\0';
+  while(*unit == ' ')
+    unit++;
+  if(!parseDouble(buf,strlen(buf),&val)||(val <= 0.))
+    return 0;
+  /* widths */
+  if(strcmp(unit,"EV") == 0){
+    *lt = HBAR_MEVS/(val*1E-6)*1E12;
+    return 1;
+  }else if(strcmp(unit,"KEV") == 0){
+    *lt = HBAR_MEVS/(val*1E-3)*1E12;
+    return 1;
+  }else if(strcmp(unit,"MEV") == 0){
+    *lt = HBAR_MEVS/val*1E12;
+    return 1;
+  }
+  /* half-lives, in ps */
+  if(strcmp(unit,"AS") == 0)
+    fac = 1E-6;
+  else if(strcmp(unit,"FS") == 0)
+    fac = 1E-3;
+  else if(strcmp(unit,"PS") == 0)
+    fac = 1.;
+  else if(strcmp(unit,"NS") == 0)
+    fac = 1E3;
+  else if(strcmp(unit,"US") == 0)
+    fac = 1E6;
+  else if(strcmp(unit,"MS") == 0)
+    fac = 1E9;
+  else if(strcmp(unit,"S") == 0)
+    fac = 1E12;
+  else if(strcmp(unit,"M") == 0)
+    fac = 60.*1E12;
+  else if(strcmp(unit,"H") == 0)
+    fac = 3600.*1E12;
+  else if(strcmp(unit,"D") == 0)
+    fac = 86400.*1E12;
+  else if(strcmp(unit,"Y") == 0)
+    fac = ENSDF_YEAR_S*1E12;
+  else
+    return 0;
+  *lt = val*fac/LN2;
+  return 1;
+}
+
+/* parses a multipolarity field (eg. 'E2', 'M1+E2', '[E1]', '(M1+E2)') into the lowest multipole,
+returns 1 for a pure multipole, 2 for a mixture with the L+1 multipole, and 0 otherwise
+(unknown, non-specific like 'D' or 'Q', alternatives like 'M1,E2', or E0 components) */
+int ensdfParseMult(const char *field, char *mstr){
+  char buf[16];
+  size_t n = 0;
+  const char *p;
+  bcalcTrans t1, t2;
+  char *plus;
+  for(p=field;(*p!='\0')&&(n<sizeof(buf)-1);p++){
+    if((*p != '[')&&(*p != ']')&&(*p != '(')&&(*p != ')'))
+      buf[n++] = *p;
+  }
+  buf[n] = '\0';
+  if((n == 0)||(strlen(buf) > 6))
+    return 0;
+  if((plus = strchr(buf,'+')) != NULL)
+    *plus++ = '\0';
+  if((strlen(buf) < 2)||(strlen(buf) > 3)||(bcalcParseMultipole(buf,&t1) != BCALC_OK)||(t1.L < 1))
+    return 0;
+  strcpy(mstr,buf);
+  if(plus == NULL)
+    return 1;
+  if((strlen(plus) < 2)||(strlen(plus) > 3)||(bcalcParseMultipole(plus,&t2) != BCALC_OK))
+    return 0;
+  if((t2.EM == t1.EM)||(t2.L != t1.L+1))
+    return 0;
+  return 2;
+}
+
+/* fills in the transition parameters for a gamma ray, returns a skip reason or -1 if it can be calculated */
+int ensdfTrans(const ensdfIndex *idx, const ensdfNuclide *nuc, const ensdfLevel *lev, const ensdfGamma *g, const bcalcTrans *tdef, bcalcTrans *t){
+  const ensdfGamma *gl = idx->gam + lev->firstGamma;
+  double sum = 0.;
+  char mstr[8];
+  size_t i;
+  int mix;
+
+  if(!(lev->lt > 0.))
+    return ENSDF_SKIP_LT;
+  *t = *tdef;
+  if((mix = ensdfParseMult(g->mult,mstr)) == 0)
+    return ENSDF_SKIP_MULT;
+  if((mix == 2)&&(!g->hasMR))
+    return ENSDF_SKIP_DELTA;
+  /* branching from the total (gamma + conversion electron) intensities of all gammas from the level */
+  for(i=0;i<lev->numGammas;i++){
+    if(!(gl[i].Itot > 0.)){
+      if(lev->numGammas > 1)
+        return ENSDF_SKIP_BR;
+    }else{
+      sum += gl[i].Itot;
+    }
+  }
+  bcalcParseMultipole(mstr,t);
+  t->Et = g->E;
+  t->lt = lev->lt;
+  t->calcMode = 0;
+  t->branching = (lev->numGammas > 1) ? g->Itot/sum : 1.;
+  t->brrel = 0;
+  t->icc = g->CC;
+  t->iccAuto = (g->hasCC) ? 0 : tdef->iccAuto; /* use the table if there is no CC */
+  t->useDelta = (mix == 2);
+  t->delta = (mix == 2) ? g->MR : 0.;
+  t->bup = 0;
+  t->calcB2 = 0;
+  t->nucA = nuc->A;
+  t->nucZ = nuc->Z;
+  return -1;
+}
+
+/* calculates and formats the results for all gammas of a nuclide */
+static void ensdfCalcNuclide(ensdfPart *pt, const ensdfNuclide *nuc){
+  const ensdfIndex *idx = &pt->idx;
+  const ensdfLevel *lev;
+  const ensdfGamma *g;
+  bcalcTrans t;
+  bcalcRes r, rwu;
+  char ustr[32], mstr1[16];
+  size_t i, j;
+  int skip, err;
+  for(i=0;i<nuc->numLevels;i++){
+    lev = idx->lev + nuc->firstLevel + i;
+    for(j=0;j<lev->numGammas;j++){
+      g = idx->gam + lev->firstGamma + j;
+      if((skip = ensdfTrans(idx,nuc,lev,g,pt->tdef,&t)) >= 0){
+        pt->numSkip[skip]++;
+        continue;
+      }
+      t.barn = (pt->tdef->barn == 1) ? 1 : 0;
+      err = bcalcCompute(&t,&r);
+      if(err == BCALC_OK){
+        t.barn = 2;
+        err = bcalcCompute(&t,&rwu);
+      }
+      if(err != BCALC_OK){
+        pt->numSkip[ENSDF_SKIP_CALC]++;
+        continue;
+      }
+      pt->numCalc++;
+      getBUnit(ustr,sizeof(ustr),t.EM,t.L,(pt->tdef->barn == 1) ? 1 : 0);
+      sbPrintf(&pt->out,"%s\t%s\t%s\t%s\tB(%s) = %0.4E %s = %0.4E W.u.",nuc->nucid,lev->Es,g->Es,g->mult,t.mstr,r.b,ustr,rwu.b);
+      if(t.useDelta){
+        getMixedMstr(mstr1,sizeof(mstr1),&t);
+        getBUnit(ustr,sizeof(ustr),!t.EM,t.L+1,(pt->tdef->barn == 1) ? 1 : 0);
+        sbPrintf(&pt->out,"\tB(%s) = %0.4E %s = %0.4E W.u.",mstr1,r.b1,ustr,rwu.b1);
+      }
+      sbPrintf(&pt->out,"\n");
+    }
+  }
+}
+
+/* parses the adopted levels and gammas datasets in a part of the file into its index */
+static void *ensdfParsePart(void *arg){
+  ensdfPart *pt = (ensdfPart *)arg;
+  ensdfIndex *idx = &pt->idx;
+  const char *p = pt->data;
+  const char *end = pt->data + pt->len;
+  const char *nl;
+  char buf[32];
+  size_t len, n;
+  ensdfNuclide *nuc = NULL; /* nuclide of the current dataset, NULL when skipping a dataset */
+  ensdfLevel *lev = NULL;
+  ensdfGamma *g;
+  int newDataset = 1;
+  int A, Z;
+
+  while(p < end){
+    nl = memchr(p,'\n',(size_t)(end - p));
+    if(nl == NULL)
+      nl = end;
+    len = (size_t)(nl - p);
+    if((len > 0)&&(p[len-1] == '\r'))
+      len--;
+    for(n=0;(n<len)&&(p[n]==' ');n++);
+    if(n == len){
+      /* blank (end) record */
+      newDataset = 1;
+      nuc = NULL;
+      lev = NULL;
+    }else if(newDataset){
+      /* identification record */
+      newDataset = 0;
+      getField(p,len,10,30,buf);
+      if((strncmp(buf,"ADOPTED LEVELS",14) == 0)&&parseNucid(p,len,&A,&Z)){
+        if(ensdfGrowArr((void **)&idx->nuc,&idx->nucCap,idx->numNuc,sizeof(ensdfNuclide)) != 0)
+          goto nomem;
+        nuc = idx->nuc + idx->numNuc++;
+        memset(nuc,0,sizeof(ensdfNuclide));
+        getField(p,len,1,5,nuc->nucid);
+        nuc->A = A;
+        nuc->Z = Z;
+        nuc->firstLevel = idx->numLev;
+      }
+    }else if((nuc != NULL)&&(len >= 8)&&(p[5] == ' ')&&(p[6] == ' ')){
+      /* primary (not continuation or comment) record in an adopted dataset */
+      if(p[7] == 'L'){
+        if(ensdfGrowArr((void **)&idx->lev,&idx->levCap,idx->numLev,sizeof(ensdfLevel)) != 0)
+          goto nomem;
+        lev = idx->lev + idx->numLev++;
+        memset(lev,0,sizeof(ensdfLevel));
+        getField(p,len,10,10,lev->Es);
+        if(!getNum(p,len,10,10,&lev->E))
+          lev->E = -1.;
+        getField(p,len,22,18,lev->J);
+        if(!parseHalfLife(p,len,&lev->lt))
+          lev->lt = -1.;
+        lev->firstGamma = idx->numGam;
+        nuc->numLevels++;
+      }else if((p[7] == 'G')&&(lev != NULL)){
+        if(ensdfGrowArr((void **)&idx->gam,&idx->gamCap,idx->numGam,sizeof(ensdfGamma)) != 0)
+          goto nomem;
+        g = idx->gam + idx->numGam++;
+        memset(g,0,sizeof(ensdfGamma));
+        getField(p,len,10,10,g->Es);
+        if(!getNum(p,len,10,10,&g->E))
+          g->E = -1.;
+        getField(p,len,32,10,g->mult);
+        g->hasMR = getNum(p,len,42,8,&g->MR);
+        g->hasCC = getNum(p,len,56,7,&g->CC);
+        if(!g->hasCC)
+          g->CC = 0.;
+        /* total intensity, from TI or from RI and the conversion coefficient */
+        if(getNum(p,len,65,10,&g->Itot)){
+          /* TI */
+        }else if(getNum(p,len,22,8,&g->Itot)){
+          g->Itot *= 1. + g->CC; /* without CC, conversion is assumed to be negligible for the branching */
+        }else{
+          g->Itot = -1.;
+        }
+        lev->numGammas++;
+      }
+    }
+    p = nl + 1;
+  }
+
+  /* calculate (the index is complete for each nuclide in this part) */
+  for(n=0;n<idx->numNuc;n++)
+    ensdfCalcNuclide(pt,idx->nuc + n);
+  return NULL;
+
+ nomem:
+  pt->err = 1;
+  return NULL;
+}
+
+/* returns the nuclide with mass number A and proton number Z in the index, or NULL */
+const ensdfNuclide *ensdfFind(const ensdfIndex *idx, const int A, const int Z){
+  size_t i;
+  for(i=0;i<idx->numNuc;i++){
+    if((idx->nuc[i].A == A)&&(idx->nuc[i].Z == Z))
+      return idx->nuc + i;
+  }
+  return NULL;
+}
+
+void ensdfFree(ensdfIndex *idx){
+  free(idx->nuc);
+  free(idx->lev);
+  free(idx->gam);
+  memset(idx,0,sizeof(ensdfIndex));
+}
+
+/* appends the index of a part to idx, shifting its level and gamma positions */
+static int ensdfJoin(ensdfIndex *idx, const ensdfIndex *part){
+  size_t i;
+  void *p;
+  if(part->numNuc > 0){
+    if((p = realloc(idx->nuc,(idx->numNuc + part->numNuc)*sizeof(ensdfNuclide))) == NULL)
+      return -1;
+    idx->nuc = p;
+    for(i=0;i<part->numNuc;i++){
+      idx->nuc[idx->numNuc + i] = part->nuc[i];
+      idx->nuc[idx->numNuc + i].firstLevel += idx->numLev;
+    }
+  }
+  if(part->numLev > 0){
+    if((p = realloc(idx->lev,(idx->numLev + part->numLev)*sizeof(ensdfLevel))) == NULL)
+      return -1;
+    idx->lev = p;
+    for(i=0;i<part->numLev;i++){
+      idx->lev[idx->numLev + i] = part->lev[i];
+      idx->lev[idx->numLev + i].firstGamma += idx->numGam;
+    }
+  }
+  if(part->numGam > 0){
+    if((p = realloc(idx->gam,(idx->numGam + part->numGam)*sizeof(ensdfGamma))) == NULL)
+      return -1;
+    idx->gam = p;
+    memcpy(idx->gam + idx->numGam,part->gam,part->numGam*sizeof(ensdfGamma));
+  }
+  idx->numNuc += part->numNuc;
+  idx->numLev += part->numLev;
+  idx->numGam += part->numGam;
+  idx->nucCap = idx->numNuc;
+  idx->levCap = idx->numLev;
+  idx->gamCap = idx->numGam;
+  return 0;
+}
+
+/* finds the start of the first dataset at or after pos (the line after a blank line) */
+static size_t nextDataset(const char *data, const size_t len, size_t pos){
+  const char *nl;
+  size_t s, n;
+  if(pos == 0)
+    return 0;
+  /* start of the next line */
+  while((pos < len)&&(data[pos-1] != '\n'))
+    pos++;
+  while(pos < len){
+    nl = memchr(data + pos,'\n',len - pos);
+    s = (nl == NULL) ? len : (size_t)(nl - data);
+    for(n=pos;(n<s)&&((data[n]==' ')||(data[n]=='\r'));n++);
+    pos = (nl == NULL) ? len : s + 1;
+    if(n == s)
+      return pos; /* blank line */
+  }
+  return len;
+}
+
+/* loads the adopted levels and gammas datasets from an ENSDF file into idx, and (if out is not NULL)
+writes the calculated reduced transition probabilities of all gammas to out in file order
+returns 0 on success */
+int ensdfLoad(const char *fileName, int numThreads, const bcalcTrans *tdef, ensdfIndex *idx, FILE *out, unsigned long *numCalc, unsigned long *numSkip){
+
+  ensdfPart *parts;
+  pthread_t *threads;
+  struct stat st;
+  void *map;
+  size_t size, pos, next;
+  int fd, i, j, err = 0;
+
+  memset(idx,0,sizeof(ensdfIndex));
+  *numCalc = 0;
+  for(j=0;j<ENSDF_NUM_SKIP;j++)
+    numSkip[j] = 0;
+  if((fd = open(fileName,O_RDONLY)) < 0){
+    printf("ERROR: Cannot open the ENSDF file %s!\n",fileName);
+    return -1;
+  }
+  if((fstat(fd,&st) != 0)||(!S_ISREG(st.st_mode))){
+    printf("ERROR: %s is not a regular file.\n",fileName);
+    close(fd);
+    return -1;
+  }
+  size = (size_t)st.st_size;
+  if(size == 0){
+    close(fd);
+    return 0;
+  }
+  if((map = mmap(NULL,size,PROT_READ,MAP_PRIVATE,fd,0)) == MAP_FAILED){
+    printf("ERROR: Cannot map the ENSDF file %s.\n",fileName);
+    close(fd);
+    return -1;
+  }
+  posix_madvise(map,size,POSIX_MADV_SEQUENTIAL);
+
+  if(numThreads <= 0)
+    numThreads = getNumCPUs();
+  parts = calloc((size_t)numThreads,sizeof(ensdfPart));
+  threads = calloc((size_t)numThreads,sizeof(pthread_t));
+  if((parts == NULL)||(threads == NULL)){
+    printf("ERROR: Cannot allocate memory for the ENSDF index.\n");
+    exit(-1);
+  }
+  /* split into parts at dataset boundaries */
+  pos = 0;
+  for(i=0;i<numThreads;i++){
+    next = (i == numThreads-1) ? size : nextDataset((const char *)map,size,size/(size_t)numThreads*(size_t)(i+1));
+    if(next < pos)
+      next = pos;
+    parts[i].data = (const char *)map + pos;
+    parts[i].len = next - pos;
+    parts[i].tdef = tdef;
+    sbInit(&parts[i].out);
+    pos = next;
+  }
+  for(i=1;i<numThreads;i++){
+    if(pthread_create(&threads[i],NULL,ensdfParsePart,&parts[i]) == 0)
+      parts[i].started = 1;
+    else
+      ensdfParsePart(&parts[i]);
+  }
+  ensdfParsePart(&parts[0]);
+
+  for(i=0;i<numThreads;i++){
+    if(parts[i].started)
+      pthread_join(threads[i],NULL);
+    if(parts[i].err != 0)
+      err = 1;
+    if((!err)&&(ensdfJoin(idx,&parts[i].idx) != 0))
+      err = 1;
+    if((!err)&&(out != NULL))
+      sbFlush(&parts[i].out,out);
+    *numCalc += parts[i].numCalc;
+    for(j=0;j<ENSDF_NUM_SKIP;j++)
+      numSkip[j] += parts[i].numSkip[j];
+    sbFree(&parts[i].out);
+    ensdfFree(&parts[i].idx);
+  }
+  free(parts);
+  free(threads);
+  munmap(map,size);
+  close(fd);
+  if(err){
+    ensdfFree(idx);
+    printf("ERROR: Cannot allocate memory for the ENSDF index.\n");
+    return -1;
+  }
+  return 0;
+}
+
+/* calculates reduced transition probabilities for all gammas in an ENSDF file */
+int runEnsdf(const char *fileName, const bcalcTrans *tdef, const int numThreads){
+  ensdfIndex idx;
+  unsigned long numCalc, numSkip[ENSDF_NUM_SKIP];
+  if(ensdfLoad(fileName,numThreads,tdef,&idx,stdout,&numCalc,numSkip) != 0)
+    exit(-1);
+  fflush(stdout);
+  fprintf(stderr,"%lu nuclides, %lu levels, %lu gammas read.\n",(unsigned long)idx.numNuc,(unsigned long)idx.numLev,(unsigned long)idx.numGam);
+  fprintf(stderr,"Reduced transition probabilities calculated for %lu gammas, not calculated for:\n",numCalc);
+  fprintf(stderr,"  %lu gammas from levels without a known lifetime\n",numSkip[ENSDF_SKIP_LT]);
+  fprintf(stderr,"  %lu gammas without a specific multipolarity\n",numSkip[ENSDF_SKIP_MULT]);
+  fprintf(stderr,"  %lu mixed gammas without a mixing ratio\n",numSkip[ENSDF_SKIP_DELTA]);
+  fprintf(stderr,"  %lu gammas from levels with incomplete intensities\n",numSkip[ENSDF_SKIP_BR]);
+  if(numSkip[ENSDF_SKIP_CALC] > 0)
+    fprintf(stderr,"  %lu gammas with invalid values\n",numSkip[ENSDF_SKIP_CALC]);
+  ensdfFree(&idx);
+  return 0;
+}
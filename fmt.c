@@ -0,0 +1,409 @@
+/* output formatting: fast conversion of doubles to text, and structured (CSV, TSV, JSON) records
+fmtExp() gives exactly the same text as printf's %.<prec>E, without going through stdio: the
+value is scaled by an exact power of ten in extended precision and rounded to an integer holding
+the significant digits.  The scaled value carries a relative error of a few units in the last
+place, which only matters if it is within that distance of a rounding tie; those (rare) values,
+and anything outside of the supported range, are handed to snprintf. */
+
+#include <float.h>
+#include "bcalc.h"
+
+#if LDBL_MANT_DIG >= 64
+/* 64 bit significand (x87 extended precision or better), powers of ten up to 10^27 are exact */
+typedef long double fmtFloat;
+#define FMT_MAX_PREC  16 /* digits after the decimal point (17 significant digits) */
+#define FMT_MAX_POW   27
+#define FMT_EPS       LDBL_EPSILON
+#else
+typedef double fmtFloat;
+#define FMT_MAX_PREC  14
+#define FMT_MAX_POW   22
+#define FMT_EPS       DBL_EPSILON
+#endif
+
+static const fmtFloat pow10f[28] = {1e0L,1e1L,1e2L,1e3L,1e4L,1e5L,1e6L,1e7L,1e8L,1e9L,1e10L,
+  1e11L,1e12L,1e13L,1e14L,1e15L,1e16L,1e17L,1e18L,1e19L,1e20L,1e21L,1e22L,1e23L,1e24L,1e25L,
+  1e26L,1e27L};
+
+/* multiplies a by 10^k, |k| <= 2*FMT_MAX_POW (at most 2 roundings) */
+static fmtFloat scale10(const fmtFloat a, const int k){
+  if(k >= 0){
+    if(k <= FMT_MAX_POW)
+      return a*pow10f[k];
+    return a*pow10f[FMT_MAX_POW]*pow10f[k - FMT_MAX_POW];
+  }
+  if(-k <= FMT_MAX_POW)
+    return a/pow10f[-k];
+  return a/pow10f[FMT_MAX_POW]/pow10f[-k - FMT_MAX_POW];
+}
+
+/* scales a > 0 to m in [10^prec,10^(prec+1)), setting e10 to its decimal exponent
+returns 0 if a is out of the supported range */
+static int scaleDigits(const double a, const int prec, fmtFloat *m, int *e10){
+  int e, e2, k, i;
+  frexp(a,&e2);
+  e = (int)floor((e2 - 1)*0.30102999566398120); /* exact, or one less */
+  for(i=0;i<3;i++){
+    k = prec - e;
+    if((k > 2*FMT_MAX_POW)||(k < -2*FMT_MAX_POW))
+      return 0;
+    *m = scale10((fmtFloat)a,k);
+    if(*m < pow10f[prec])
+      e--;
+    else if(*m >= pow10f[prec+1])
+      e++;
+    else
+      break;
+  }
+  *e10 = e;
+  return (i < 3);
+}
+
+/* finds the prec+1 significant digits (as an integer) and decimal exponent of a > 0
+returns 0 if this cannot be done reliably (the caller falls back to snprintf) */
+static int expDigits(const double a, const int prec, uint64_t *dig, int *e10){
+  fmtFloat m, f;
+  uint64_t r;
+  if(!scaleDigits(a,prec,&m,e10))
+    return 0;
+  r = (uint64_t)m;
+  f = m - (fmtFloat)r;
+  if(fabsl(f - 0.5L) <= m*8*FMT_EPS)
+    return 0; /* too close to a tie */
+  *dig = r + ((f > 0.5L) ? 1 : 0);
+  if(*dig == (uint64_t)pow10f[prec+1]){
+    *dig /= 10;
+    (*e10)++;
+  }
+  return 1;
+}
+
+/* writes numDig significant digits dig and exponent e as d.dddE+xx, returns the length written */
+static size_t putExp(char *buf, const int neg, uint64_t dig, const int numDig, int e){
+  size_t len = 0;
+  int i;
+  if(neg)
+    buf[len++] = '-';
+  /* digits after the decimal point, from the last one */
+  for(i=numDig;i>=2;i--){
+    buf[len+(size_t)i] = (char)('0' + (int)(dig % 10));
+    dig /= 10;
+  }
+  buf[len] = (char)('0' + (int)dig);
+  if(numDig > 1){
+    buf[len+1] = '.';
+    len += (size_t)numDig + 1;
+  }else{
+    len++;
+  }
+  buf[len++] = 'E';
+  buf[len++] = (e < 0) ? '-' : '+';
+  if(e < 0)
+    e = -e;
+  if(e >= 100)
+    buf[len++] = (char)('0' + e/100);
+  buf[len++] = (char)('0' + (e/10)%10);
+  buf[len++] = (char)('0' + e%10);
+  buf[len] = '\0';
+  return len;
+}
+
+/* writes v as printf's %.<prec>E would (buf must hold at least 32 characters)
+returns the length written */
+size_t fmtExp(char *buf, const double v, const int prec){
+  uint64_t dig;
+  int e, n;
+  if((!isfinite(v))||(v == 0.)||(prec < 0)||(prec > FMT_MAX_PREC)||(fabs(v) < DBL_MIN)||(!expDigits(fabs(v),prec,&dig,&e))){
+    n = snprintf(buf,32,"%.*E",prec,v);
+    return (n > 0) ? (size_t)n : 0;
+  }
+  return putExp(buf,(v < 0.),dig,prec+1,e);
+}
+
+/* finds the fewest (up to 17) significant digits which read back as a > 0, using the scaled
+value m of a (17 digits) and half the distance to the neighbouring doubles
+returns the number of digits, or 0 if too close to call (the caller checks by parsing instead) */
+static int shortDigits(const double a, uint64_t *dig, int *e10){
+  static const uint64_t div[3] = {100, 10, 1};
+  fmtFloat m, halfHi, halfLo, half, diff;
+  fmtFloat tol;
+  double f;
+  uint64_t u, c;
+  int e2, i;
+  if((FMT_MAX_PREC < 16)||(!scaleDigits(a,16,&m,e10)))
+    return 0;
+  /* half the gaps to the neighbouring doubles (the lower one is smaller at a power of 2), scaled like m */
+  f = frexp(a,&e2);
+  halfHi = m/((fmtFloat)f*18014398509481984.0L);
+  halfLo = (f == 0.5) ? 0.5L*halfHi : halfHi;
+  tol = m*4*FMT_EPS; /* at most 2 roundings in m */
+  u = (uint64_t)m;
+  for(i=0;i<3;i++){
+    /* 15, 16 then 17 digits */
+    c = (u + div[i]/2)/div[i];
+    diff = (fmtFloat)(c*div[i]) - m;
+    half = (diff < 0.) ? halfLo : halfHi;
+    diff = fabsl(diff);
+    if(i == 2){
+      diff = fabsl(m - (fmtFloat)u - 0.5L);
+      if(diff <= tol)
+        return 0;
+      c = (m - (fmtFloat)u > 0.5L) ? u + 1 : u;
+    }else if(diff + tol < half){
+      /* reads back as a */
+    }else if(diff - tol > half){
+      continue;
+    }else{
+      return 0;
+    }
+    if(c == (uint64_t)pow10f[15+i]){
+      c /= 10;
+      (*e10)++;
+    }
+    *dig = c;
+    return 15+i;
+  }
+  return 0;
+}
+
+/* writes v with as few significant digits as possible (at most 17) such that it reads back as the
+same value, in exponential notation without trailing zeros (eg. 1.332E+03)
+returns the length written (buf must hold at least 32 characters) */
+size_t fmtNum(char *buf, const double v){
+  size_t len, m, e;
+  uint64_t dig;
+  double back;
+  int numDig, e10;
+  if(v == 0.){
+    return putExp(buf,signbit(v),0,1,0);
+  }
+  if(isfinite(v)&&(fabs(v) >= DBL_MIN)&&((numDig = shortDigits(fabs(v),&dig,&e10)) > 0)){
+    while((numDig > 1)&&(dig % 10 == 0)){
+      dig /= 10;
+      numDig--;
+    }
+    return putExp(buf,(v < 0.),dig,numDig,e10);
+  }
+  if(!isfinite(v)){
+    return fmtExp(buf,v,16);
+  }
+  for(numDig=15;numDig<=17;numDig++){
+    len = fmtExp(buf,v,numDig-1);
+    if(parseDouble(buf,len,&back)&&(back == v))
+      break;
+  }
+  /* remove trailing zeros of the mantissa */
+  for(e=0;(e<len)&&(buf[e] != 'E');e++);
+  for(m=e;(m>0)&&(buf[m-1] == '0');m--);
+  if((m>0)&&(buf[m-1] == '.'))
+    m--;
+  memmove(buf+m,buf+e,len-e+1);
+  return len - (e - m);
+}
+
+/* appends v formatted as %.<prec>E */
+void sbPutExp(strBuf *sb, const double v, const int prec){
+  sbReserve(sb,32);
+  sb->len += fmtExp(sb->data + sb->len,v,prec);
+}
+
+/* appends v formatted by fmtNum */
+void sbPutNum(strBuf *sb, const double v){
+  sbReserve(sb,32);
+  sb->len += fmtNum(sb->data + sb->len,v);
+}
+
+/* appends a quoted JSON string, with escaping */
+void sbJsonStr(strBuf *sb, const char *str, const size_t len){
+  char esc[8];
+  size_t i;
+  sbPutc(sb,'"');
+  for(i=0;i<len;i++){
+    if((str[i] == '"')||(str[i] == '\\')){
+      sbPutc(sb,'\\');
+      sbPutc(sb,str[i]);
+    }else if((unsigned char)str[i] < 0x20){
+      snprintf(esc,sizeof(esc),"\\u%04x",(unsigned int)(unsigned char)str[i]);
+      sbPuts(sb,esc);
+    }else{
+      sbPutc(sb,str[i]);
+    }
+  }
+  sbPutc(sb,'"');
+}
+
+/* computes the results of a calculation in every unit system (NaN for values not calculated)
+the B value in the units of the calculation is the one calculated, the others are calculated
+from the partial lifetime (W.u. need A), r is NULL if the calculation failed */
+void getOutVals(outVals *o, const bcalcTrans *t, const bcalcRes *r){
+  double ji, jf, Et;
+  int unit;
+  if(r == NULL){
+    o->lt = o->lt1 = o->beta2 = NAN;
+    for(unit=0;unit<3;unit++)
+      o->b[unit] = o->b1[unit] = NAN;
+    return;
+  }
+  o->lt = r->lt;
+  o->lt1 = ((t->calcMode == 0)&&(t->useDelta)) ? r->lt1 : NAN;
+  o->beta2 = (t->calcB2) ? r->beta2 : NAN;
+  /* spins as used by the calculation */
+  ji = r->warn ? 2. : t->ji;
+  jf = r->warn ? 0. : t->jf;
+  Et = t->Et/1000.0;
+  for(unit=0;unit<3;unit++){
+    o->b[unit] = NAN;
+    o->b1[unit] = NAN;
+    if((unit == 2)&&(t->nucA <= 0))
+      continue;
+    if(unit == t->barn)
+      o->b[unit] = (t->calcMode == 1) ? t->b : r->b;
+    else
+      o->b[unit] = calcBPrec(t->bup,t->EM,t->L,Et,r->lt*1.0E-12,ji,jf,unit,t->nucA,t->precision);
+    if((t->calcMode == 0)&&(t->useDelta)){
+      if(unit == t->barn)
+        o->b1[unit] = r->b1;
+      else
+        o->b1[unit] = calcBPrec(t->bup,!t->EM,t->L+1,Et,r->lt1*1.0E-12,ji,jf,unit,t->nucA,t->precision);
+    }
+  }
+}
+
+/* names of the record fields, in order */
+static const char *recFields[] = {"line","E","multipole","lifetime_in","B_in","branching","delta","icc","ji","jf","A","Z",
+  "lifetime","lifetime1","B_fm","B_barn","B_wu","B1_fm","B1_barn","B1_wu","beta2","err","error"};
+#define REC_NUM_FIELDS ((int)(sizeof(recFields)/sizeof(recFields[0])))
+
+/* parses an output format name (text, csv, tsv or json), returns -1 if unknown */
+int parseOutFormat(const char *str){
+  if(strcmp(str,"text")==0){
+    return OUT_TEXT;
+  }else if(strcmp(str,"csv")==0){
+    return OUT_CSV;
+  }else if(strcmp(str,"tsv")==0){
+    return OUT_TSV;
+  }else if(strcmp(str,"json")==0){
+    return OUT_JSON;
+  }
+  return -1;
+}
+
+/* appends the header line of a CSV or TSV file (nothing for other formats) */
+void formatRecordHeader(strBuf *sb, const int fmt){
+  int i;
+  if((fmt != OUT_CSV)&&(fmt != OUT_TSV))
+    return;
+  for(i=0;i<REC_NUM_FIELDS;i++){
+    if(i > 0)
+      sbPutc(sb,(fmt == OUT_CSV) ? ',' : '\t');
+    sbPuts(sb,recFields[i]);
+  }
+  sbPutc(sb,'\n');
+}
+
+/* starts a record field */
+static void recField(strBuf *sb, const int fmt, const int i){
+  size_t n;
+  char *p;
+  if(fmt == OUT_JSON){
+    n = strlen(recFields[i]);
+    sbReserve(sb,n+4);
+    p = sb->data + sb->len;
+    *p++ = (i == 0) ? '{' : ',';
+    *p++ = '"';
+    memcpy(p,recFields[i],n);
+    p += n;
+    *p++ = '"';
+    *p++ = ':';
+    *p = '\0';
+    sb->len += n+4;
+  }else if(i > 0){
+    sbPutc(sb,(fmt == OUT_CSV) ? ',' : '\t');
+  }
+}
+
+static void recNum(strBuf *sb, const int fmt, const int i, const double v){
+  recField(sb,fmt,i);
+  if(isfinite(v))
+    sbPutNum(sb,v);
+  else if(fmt == OUT_JSON)
+    sbPuts(sb,"null");
+}
+
+static void recInt(strBuf *sb, const int fmt, const int i, const long v, const int valid){
+  char num[24];
+  unsigned long u = (v < 0) ? 0UL - (unsigned long)v : (unsigned long)v;
+  size_t n = sizeof(num);
+  recField(sb,fmt,i);
+  if(valid){
+    do{
+      num[--n] = (char)('0' + (int)(u % 10));
+      u /= 10;
+    }while(u > 0);
+    if(v < 0)
+      num[--n] = '-';
+    sbPutn(sb,num+n,sizeof(num)-n);
+  }else if(fmt == OUT_JSON){
+    sbPuts(sb,"null");
+  }
+}
+
+static void recStr(strBuf *sb, const int fmt, const int i, const char *str){
+  size_t j;
+  recField(sb,fmt,i);
+  if(fmt == OUT_JSON){
+    if(str != NULL)
+      sbJsonStr(sb,str,strlen(str));
+    else
+      sbPuts(sb,"null");
+  }else if(str != NULL){
+    if((fmt == OUT_CSV)&&(strpbrk(str,",\"\r\n") != NULL)){
+      /* quoted, with quotes doubled */
+      sbPutc(sb,'"');
+      for(j=0;str[j]!='\0';j++){
+        if(str[j] == '"')
+          sbPutc(sb,'"');
+        sbPutc(sb,str[j]);
+      }
+      sbPutc(sb,'"');
+    }else{
+      for(j=0;str[j]!='\0';j++)
+        sbPutc(sb,((str[j] == '\t')||(str[j] == '\r')||(str[j] == '\n')) ? ' ' : str[j]);
+    }
+  }
+}
+
+/* appends one record (line) with the inputs and results of a calculation
+err is a BCALC_ERR code, or BCOL_ERR_PARSE if the input could not be parsed (t and r are then not used)
+msg is the error message (NULL if none) */
+void formatRecord(strBuf *sb, const int fmt, const unsigned long lineNum, const bcalcTrans *t, const bcalcRes *r, const int err, const char *msg){
+  outVals o;
+  int i, ok = (err == BCALC_OK);
+  int in = (err != BCOL_ERR_PARSE);
+
+  recInt(sb,fmt,0,(long)lineNum,1);
+  recNum(sb,fmt,1,in ? t->Et : NAN);
+  recStr(sb,fmt,2,(in && (t->L >= 0)) ? t->mstr : NULL);
+  recNum(sb,fmt,3,(in && (t->calcMode == 0)) ? t->lt : NAN);
+  recNum(sb,fmt,4,(in && (t->calcMode == 1)) ? t->b : NAN);
+  recNum(sb,fmt,5,in ? t->branching : NAN);
+  recNum(sb,fmt,6,(in && t->useDelta) ? t->delta : NAN);
+  recNum(sb,fmt,7,ok ? r->icc : (in ? t->icc : NAN));
+  recNum(sb,fmt,8,(in && (t->ji >= 0.)) ? (r->warn ? 2. : t->ji) : NAN);
+  recNum(sb,fmt,9,(in && (t->jf >= 0.)) ? (r->warn ? 0. : t->jf) : NAN);
+  recInt(sb,fmt,10,in ? t->nucA : 0,in && (t->nucA > 0));
+  recInt(sb,fmt,11,in ? t->nucZ : 0,in && (t->nucZ > 0));
+  getOutVals(&o,t,ok ? r : NULL);
+  recNum(sb,fmt,12,o.lt);
+  recNum(sb,fmt,13,o.lt1);
+  for(i=0;i<3;i++)
+    recNum(sb,fmt,14+i,o.b[i]);
+  for(i=0;i<3;i++)
+    recNum(sb,fmt,17+i,o.b1[i]);
+  recNum(sb,fmt,20,o.beta2);
+  recInt(sb,fmt,21,err,1);
+  recStr(sb,fmt,22,msg);
+  if(fmt == OUT_JSON)
+    sbPutc(sb,'}');
+  sbPutc(sb,'\n');
+}
@@ -0,0 +1,261 @@
+/* follow mode: watches a batch input file which is being appended to (eg. by a fitting program),
+and calculates each new line as soon as it is complete, appending the results to the output
+The file is watched with inotify, so nothing is done while it is idle.  If it is truncated
+(or replaced, eg. by log rotation) it is read again from the start, and if the output is a
+regular file it is restarted too, so that it always holds the results for the current input. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+#include "bcalc.h"
+
+#define FOLLOW_READ_SIZE 65536
+#define FOLLOW_EVENT_BUF 4096 /* inotify events read at once (bytes) */
+#define FOLLOW_FILE_EVENTS (IN_MODIFY|IN_ATTRIB|IN_MOVE_SELF|IN_DELETE_SELF)
+#define FOLLOW_DIR_EVENTS  (IN_CREATE|IN_MOVED_TO)
+
+typedef struct
+{
+  const char *path; /* followed file */
+  const char *name; /* name of the file in its directory */
+  const bcalcTrans *tdef; /* defaults for all lines */
+  int inMode; /* BATCH_LT, BATCH_B or BATCH_CMD */
+  int fmt; /* output format */
+  int fd; /* the open file, -1 if it does not exist (yet) */
+  dev_t dev;
+  ino_t ino;
+  off_t pos; /* offset of the next byte to read */
+  char *buf; /* unprocessed input (the start of a line not yet complete) */
+  size_t have, cap;
+  unsigned long lineNum;
+  int inFd; /* inotify instance */
+  int fileWd, dirWd; /* watches on the file and on its directory */
+  int gone; /* 1 if the open file is no longer at the followed path */
+  int outReg; /* 1 if the output is a regular file (which is restarted with the input) */
+  strBuf out;
+}followState;
+
+/* starts the output (again), with the header line of CSV and TSV output */
+static void followStartOut(followState *f, const int restart){
+  fflush(stdout);
+  if(restart && f->outReg){
+    if((ftruncate(STDOUT_FILENO,0) != 0)||(fseek(stdout,0,SEEK_SET) != 0)){
+      fprintf(stderr,"WARNING: Cannot restart the output.\n");
+    }
+  }
+  formatRecordHeader(&f->out,f->fmt);
+  sbFlush(&f->out,stdout);
+  fflush(stdout);
+}
+
+/* opens the followed file (if it exists), returns 0 on success */
+static int followOpen(followState *f){
+  struct stat st;
+  if((f->fd = open(f->path,O_RDONLY)) < 0)
+    return -1;
+  if(fstat(f->fd,&st) != 0){
+    close(f->fd);
+    f->fd = -1;
+    return -1;
+  }
+  f->dev = st.st_dev;
+  f->ino = st.st_ino;
+  f->pos = 0;
+  f->have = 0;
+  f->lineNum = 0;
+  f->gone = 0;
+  if((f->fileWd = inotify_add_watch(f->inFd,f->path,FOLLOW_FILE_EVENTS)) < 0){
+    printf("ERROR: Cannot watch %s (%s).\n",f->path,strerror(errno));
+    exit(-1);
+  }
+  return 0;
+}
+
+static void followClose(followState *f){
+  if(f->fd < 0)
+    return;
+  inotify_rm_watch(f->inFd,f->fileWd);
+  close(f->fd);
+  f->fd = -1;
+  f->fileWd = -1;
+}
+
+/* calculates all complete lines in buf, and keeps any partial line at the end for later */
+static void followLines(followState *f){
+  const char *p = f->buf;
+  const char *end = f->buf + f->have;
+  const char *nl;
+  while((nl = memchr(p,'\n',(size_t)(end - p))) != NULL){
+    f->lineNum++;
+    processLine(p,(size_t)(nl - p),f->lineNum,f->tdef,f->inMode,f->fmt,&f->out,NULL,NULL,NULL,NULL);
+    p = nl + 1;
+  }
+  f->have = (size_t)(end - p);
+  memmove(f->buf,p,f->have);
+  sbFlush(&f->out,stdout);
+  fflush(stdout);
+}
+
+/* reads everything appended to the file since it was last read, starting again from the
+beginning if the file was truncated */
+static void followRead(followState *f){
+  struct stat st;
+  char *nbuf;
+  ssize_t n;
+  if(f->fd < 0)
+    return;
+  if((fstat(f->fd,&st) == 0)&&(st.st_size < f->pos)){
+    fprintf(stderr,"%s was truncated, reading it from the start.\n",f->path);
+    f->pos = 0;
+    f->have = 0;
+    f->lineNum = 0;
+    followStartOut(f,1);
+  }
+  while(1){
+    if(f->cap - f->have < FOLLOW_READ_SIZE){
+      if((nbuf = realloc(f->buf,f->cap*2)) == NULL){
+        printf("ERROR: Cannot allocate memory for input.\n");
+        exit(-1);
+      }
+      f->buf = nbuf;
+      f->cap *= 2;
+    }
+    n = pread(f->fd,f->buf + f->have,f->cap - f->have,f->pos);
+    if(n < 0){
+      if(errno == EINTR)
+        continue;
+      fprintf(stderr,"WARNING: Cannot read %s (%s).\n",f->path,strerror(errno));
+      break;
+    }
+    if(n == 0)
+      break;
+    f->pos += n;
+    f->have += (size_t)n;
+    followLines(f);
+  }
+}
+
+/* switches to a new file at the followed path (after the old one was renamed or deleted)
+until a new file is created, the old one is still read (as a writer may not have switched yet) */
+static void followReopen(followState *f){
+  struct stat st;
+  if(stat(f->path,&st) != 0){
+    followRead(f);
+    if(!f->gone)
+      fprintf(stderr,"%s was moved or removed, waiting for a new file.\n",f->path);
+    f->gone = 1;
+    return;
+  }
+  if((f->fd >= 0)&&(st.st_dev == f->dev)&&(st.st_ino == f->ino))
+    return; /* still the same file */
+  if(f->fd >= 0){
+    followRead(f); /* anything written to the old file before it was replaced */
+    followClose(f);
+  }
+  if(followOpen(f) == 0){
+    fprintf(stderr,"%s was replaced, reading the new file from the start.\n",f->path);
+    followStartOut(f,1);
+    followRead(f);
+  }
+}
+
+/* follows a growing file of batch input (in the format given by inMode, see runBatch), printing the
+results of each line in the output format fmt as soon as it is complete, until interrupted */
+int runFollow(const char *fileName, const bcalcTrans *tdef, const int inMode, const int fmt){
+
+  followState f;
+  char dir[4096];
+  union
+  {
+    struct inotify_event e;
+    char buf[FOLLOW_EVENT_BUF];
+  }ev; /* aligned for the events */
+  const struct inotify_event *e;
+  const char *slash;
+  struct stat st;
+  struct pollfd pfd;
+  ssize_t n, i;
+  int changed, moved;
+
+  memset(&f,0,sizeof(followState));
+  f.path = fileName;
+  f.tdef = tdef;
+  f.inMode = inMode;
+  f.fmt = fmt;
+  f.fd = -1;
+  f.fileWd = -1;
+  f.cap = 2*FOLLOW_READ_SIZE;
+  if((f.buf = malloc(f.cap)) == NULL){
+    printf("ERROR: Cannot allocate memory for input.\n");
+    exit(-1);
+  }
+  sbInit(&f.out);
+  f.outReg = (fstat(STDOUT_FILENO,&st) == 0)&&S_ISREG(st.st_mode);
+
+  /* the directory is watched for the file being created again after it is renamed or deleted */
+  if((slash = strrchr(fileName,'/')) != NULL){
+    snprintf(dir,sizeof(dir),"%.*s",(slash == fileName) ? 1 : (int)(slash - fileName),fileName);
+    f.name = slash + 1;
+  }else{
+    snprintf(dir,sizeof(dir),".");
+    f.name = fileName;
+  }
+  if((f.inFd = inotify_init1(IN_CLOEXEC)) < 0){
+    printf("ERROR: Cannot watch %s (%s).\n",fileName,strerror(errno));
+    exit(-1);
+  }
+  if((f.dirWd = inotify_add_watch(f.inFd,dir,FOLLOW_DIR_EVENTS)) < 0){
+    printf("ERROR: Cannot watch the directory %s (%s).\n",dir,strerror(errno));
+    exit(-1);
+  }
+
+  followStartOut(&f,0);
+  if(followOpen(&f) == 0){
+    followRead(&f);
+  }else{
+    fprintf(stderr,"Waiting for %s to be created.\n",fileName);
+  }
+
+  pfd.fd = f.inFd;
+  pfd.events = POLLIN;
+  while(1){
+    if(poll(&pfd,1,-1) < 0){
+      if(errno == EINTR)
+        continue;
+      break;
+    }
+    if((n = read(f.inFd,ev.buf,sizeof(ev.buf))) <= 0){
+      if((n < 0)&&((errno == EINTR)||(errno == EAGAIN)))
+        continue;
+      break;
+    }
+    changed = 0;
+    moved = 0;
+    for(i=0;i<n;i+=(ssize_t)(sizeof(struct inotify_event) + e->len)){
+      e = (const struct inotify_event *)(const void *)(ev.buf + i);
+      if((e->wd == f.fileWd)&&(f.fd >= 0)){
+        if(e->mask & IN_MODIFY)
+          changed = 1;
+        if(e->mask & (IN_ATTRIB|IN_MOVE_SELF|IN_DELETE_SELF))
+          moved = 1; /* IN_ATTRIB for the link count, when the file is deleted */
+      }else if((e->wd == f.dirWd)&&(e->len > 0)&&(strcmp(e->name,f.name) == 0)){
+        moved = 1;
+      }
+    }
+    if(changed)
+      followRead(&f);
+    if(moved)
+      followReopen(&f);
+  }
+
+  followClose(&f);
+  close(f.inFd);
+  sbFree(&f.out);
+  free(f.buf);
+  return 0;
+}
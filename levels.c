@@ -0,0 +1,482 @@
+/* level scheme mode: reads a level scheme (levels with lifetimes, each followed by the gammas
+depopulating it, with relative intensities, mixing ratios and conversion coefficients), and
+calculates the partial lifetimes and reduced transition probabilities of every multipole component
+of every gamma in one pass
+The scheme is held in the same index as ENSDF data (nuclides -> levels -> gammas), and the
+branching of each gamma is found from the total (gamma + conversion electron) intensities of all
+gammas from its level, as in ENSDF mode.  The final level of each gamma is found by energy, which
+gives the spins of both levels when they are known. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "bcalc.h"
+
+#define LEVELS_E_TOL     1.0 /* maximum difference (keV) between a final level energy and Ei - Eg */
+#define LEVELS_MAX_TOK   8 /* maximum number of fields in a line */
+#define LEVELS_SKIP_SPIN ENSDF_NUM_SKIP /* --up without known spins (in addition to the ENSDF reasons) */
+
+/* graph information for each gamma, parallel to the gammas of the index */
+typedef struct
+{
+  unsigned long lineNum; /* input line */
+  long final; /* final level (index in the index), -1 if not found */
+}levelsGamma;
+
+/* a level and its energy, for finding final levels */
+typedef struct
+{
+  double E;
+  size_t lev;
+}levelsSorted;
+
+typedef struct
+{
+  ensdfIndex idx;
+  levelsGamma *lg;
+  size_t lgCap;
+  double *spin; /* spin of each level, -1 if unknown */
+  size_t spinCap;
+}levelsScheme;
+
+/* parses a spin and parity (eg. '2+', '3/2-', '(4+)') into a spin, returns 0 if it is unknown or not specific */
+static int parseSpin(const char *J, double *j){
+  char buf[20];
+  size_t n = 0;
+  const char *p;
+  char *end;
+  long num, den = 1;
+  for(p=J;(*p!='\0')&&(n<sizeof(buf)-1);p++){
+    if((*p != '(')&&(*p != ')')&&(*p != '+')&&(*p != '-'))
+      buf[n++] = *p;
+  }
+  buf[n] = '\0';
+  if((n == 0)||(!isdigit((unsigned char)buf[0])))
+    return 0;
+  num = strtol(buf,&end,10);
+  if(*end == '/'){
+    den = strtol(end+1,&end,10);
+    if(den != 2)
+      return 0;
+  }
+  if(*end != '\0')
+    return 0;
+  *j = (double)num/(double)den;
+  return 1;
+}
+
+/* splits a line into whitespace separated fields (up to a '#' comment), returns the number of fields */
+static int splitLine(const char *line, const size_t len, const char **tok, size_t *tokLen){
+  const char *end = line + len;
+  const char *p = line;
+  int n = 0;
+  while(p < end){
+    while((p < end)&&((*p == ' ')||(*p == '\t')||(*p == '\r')))
+      p++;
+    if((p == end)||(*p == '#'))
+      break;
+    if(n == LEVELS_MAX_TOK)
+      return -1;
+    tok[n] = p;
+    while((p < end)&&(*p != ' ')&&(*p != '\t')&&(*p != '\r'))
+      p++;
+    tokLen[n] = (size_t)(p - tok[n]);
+    n++;
+  }
+  return n;
+}
+
+/* parses an optional numeric field ('-' or absent for none), returns 0 if it is invalid */
+static int getOptNum(const char **tok, const size_t *tokLen, const int numTok, const int i, int *has, double *val){
+  *has = 0;
+  if((i >= numTok)||((tokLen[i] == 1)&&(tok[i][0] == '-')))
+    return 1;
+  *has = 1;
+  return parseDouble(tok[i],tokLen[i],val);
+}
+
+/* copies a field into a fixed size string, returns 0 if it does not fit */
+static int getStr(const char *tok, const size_t tokLen, char *str, const size_t size){
+  if(tokLen >= size)
+    return 0;
+  memcpy(str,tok,tokLen);
+  str[tokLen] = '\0';
+  return 1;
+}
+
+/* parses the level scheme in data into s, reporting invalid lines to errOut
+returns the number of invalid lines, or -1 if out of memory */
+static long levelsParse(const char *data, const size_t len, const bcalcTrans *tdef, levelsScheme *s, FILE *errOut){
+  ensdfIndex *idx = &s->idx;
+  const char *p = data;
+  const char *end = data + len;
+  const char *nl;
+  const char *tok[LEVELS_MAX_TOK];
+  size_t tokLen[LEVELS_MAX_TOK];
+  ensdfNuclide *nuc = NULL;
+  ensdfLevel *lev = NULL;
+  ensdfGamma *g;
+  bcalcTrans t;
+  char mstr[8];
+  const char *sym;
+  unsigned long lineNum = 0;
+  long numBad = 0;
+  int numTok, A, Z, ok, has;
+  double I;
+
+  for(;p < end;p = nl + 1){
+    nl = memchr(p,'\n',(size_t)(end - p));
+    if(nl == NULL)
+      nl = end;
+    lineNum++;
+    if((numTok = splitLine(p,(size_t)(nl - p),tok,tokLen)) == 0)
+      continue;
+    ok = 0;
+    has = 0;
+    if(numTok < 0){
+      /* too many fields */
+    }else if((numTok == 2)&&(tokLen[0] == 3)&&(strncmp(tok[0],"nuc",3) == 0)){
+      /* nuclide */
+      lev = NULL;
+      if(bcalcParseNuclide(tok[1],tokLen[1],&A,&Z) == BCALC_OK){
+        ok = 1;
+        if(ensdfGrowArr((void **)&idx->nuc,&idx->nucCap,idx->numNuc,sizeof(ensdfNuclide)) != 0)
+          return -1;
+        nuc = idx->nuc + idx->numNuc++;
+        memset(nuc,0,sizeof(ensdfNuclide));
+        sym = bcalcElementSym(Z);
+        if(snprintf(nuc->nucid,sizeof(nuc->nucid),"%i%.2s",A,sym) >= (int)sizeof(nuc->nucid))
+          strcpy(nuc->nucid,"-"); /* A > 999 */
+        nuc->A = A;
+        nuc->Z = Z;
+        nuc->firstLevel = idx->numLev;
+      }
+    }else if((numTok >= 3)&&(numTok <= 4)&&(tokLen[0] == 5)&&(strncmp(tok[0],"level",5) == 0)){
+      /* level: energy lifetime [spin] */
+      if(nuc == NULL){
+        /* levels before any nuclide record belong to the nuclide from the command line (if any) */
+        if(ensdfGrowArr((void **)&idx->nuc,&idx->nucCap,idx->numNuc,sizeof(ensdfNuclide)) != 0)
+          return -1;
+        nuc = idx->nuc + idx->numNuc++;
+        memset(nuc,0,sizeof(ensdfNuclide));
+        nuc->A = tdef->nucA;
+        nuc->Z = tdef->nucZ;
+        sym = bcalcElementSym(tdef->nucZ);
+        if((tdef->nucA <= 0)||(sym == NULL)||(snprintf(nuc->nucid,sizeof(nuc->nucid),"%i%.2s",tdef->nucA,sym) >= (int)sizeof(nuc->nucid)))
+          strcpy(nuc->nucid,"-");
+        nuc->firstLevel = idx->numLev;
+      }
+      if((ensdfGrowArr((void **)&idx->lev,&idx->levCap,idx->numLev,sizeof(ensdfLevel)) != 0)||(ensdfGrowArr((void **)&s->spin,&s->spinCap,idx->numLev,sizeof(double)) != 0))
+        return -1;
+      lev = idx->lev + idx->numLev;
+      memset(lev,0,sizeof(ensdfLevel));
+      ok = getStr(tok[1],tokLen[1],lev->Es,sizeof(lev->Es))&&parseDouble(tok[1],tokLen[1],&lev->E)&&(lev->E >= 0.);
+      ok = ok&&getOptNum(tok,tokLen,numTok,2,&has,&lev->lt)&&((!has)||(lev->lt > 0.));
+      if(!has)
+        lev->lt = -1.;
+      s->spin[idx->numLev] = -1.;
+      if(numTok == 4){
+        ok = ok&&getStr(tok[3],tokLen[3],lev->J,sizeof(lev->J));
+        if(ok&&(!parseSpin(lev->J,&s->spin[idx->numLev])))
+          s->spin[idx->numLev] = -1.;
+      }
+      if(ok){
+        lev->firstGamma = idx->numGam;
+        idx->numLev++;
+        nuc->numLevels++;
+      }else{
+        lev = NULL;
+      }
+    }else if((numTok >= 4)&&(tokLen[0] == 5)&&(strncmp(tok[0],"gamma",5) == 0)&&(lev != NULL)){
+      /* gamma: energy multipolarity intensity [mixing ratio] [conversion coefficient] */
+      if((ensdfGrowArr((void **)&idx->gam,&idx->gamCap,idx->numGam,sizeof(ensdfGamma)) != 0)||(ensdfGrowArr((void **)&s->lg,&s->lgCap,idx->numGam,sizeof(levelsGamma)) != 0))
+        return -1;
+      g = idx->gam + idx->numGam;
+      memset(g,0,sizeof(ensdfGamma));
+      ok = (numTok <= 6)&&getStr(tok[1],tokLen[1],g->Es,sizeof(g->Es))&&parseDouble(tok[1],tokLen[1],&g->E)&&(g->E > 0.);
+      ok = ok&&getStr(tok[2],tokLen[2],g->mult,sizeof(g->mult)); /* gammas with other multipolarities (eg. E0) still count in the branching */
+      ok = ok&&getOptNum(tok,tokLen,numTok,3,&has,&I)&&((!has)||(I >= 0.));
+      g->Itot = has ? I : -1.; /* the conversion electron intensity is added once the coefficient is known */
+      ok = ok&&getOptNum(tok,tokLen,numTok,4,&g->hasMR,&g->MR);
+      ok = ok&&getOptNum(tok,tokLen,numTok,5,&g->hasCC,&g->CC)&&((!g->hasCC)||(g->CC >= 0.));
+      if(ok&&g->hasMR&&(ensdfParseMult(g->mult,mstr) == 1)){
+        /* a mixing ratio with a single multipole, mixed with the L+1 multipole (as with -d) */
+        bcalcParseMultipole(mstr,&t);
+        ok = (snprintf(g->mult,sizeof(g->mult),"%s+%c%i",mstr,(t.EM == 0) ? 'M' : 'E',t.L+1) < (int)sizeof(g->mult));
+      }
+      if(ok){
+        s->lg[idx->numGam].lineNum = lineNum;
+        s->lg[idx->numGam].final = -1;
+        idx->numGam++;
+        lev->numGammas++;
+      }
+    }
+    if(!ok){
+      if((numTok > 0)&&(tokLen[0] == 5)&&(strncmp(tok[0],"gamma",5) == 0)&&(lev == NULL))
+        fprintf(errOut,"ERROR: line %lu: gamma without a (valid) level before it.\n",lineNum);
+      else
+        fprintf(errOut,"ERROR: line %lu: invalid record.\n",lineNum);
+      numBad++;
+    }
+  }
+  return numBad;
+}
+
+static int cmpLevelE(const void *a, const void *b){
+  const levelsSorted *la = (const levelsSorted *)a;
+  const levelsSorted *lb = (const levelsSorted *)b;
+  return (la->E > lb->E) - (la->E < lb->E);
+}
+
+/* finds the final level of every gamma of a nuclide, by energy (the closest level to Ei - Eg, within LEVELS_E_TOL)
+sorted is space for the levels of the nuclide */
+static void levelsLink(levelsScheme *s, const ensdfNuclide *nuc, levelsSorted *sorted){
+  const ensdfIndex *idx = &s->idx;
+  const ensdfLevel *lev;
+  size_t i, j, lo, hi, mid, best;
+  double Ef;
+  for(i=0;i<nuc->numLevels;i++){
+    sorted[i].E = idx->lev[nuc->firstLevel + i].E;
+    sorted[i].lev = nuc->firstLevel + i;
+  }
+  qsort(sorted,nuc->numLevels,sizeof(levelsSorted),cmpLevelE);
+  for(i=0;i<nuc->numLevels;i++){
+    lev = idx->lev + nuc->firstLevel + i;
+    for(j=0;j<lev->numGammas;j++){
+      Ef = lev->E - idx->gam[lev->firstGamma + j].E;
+      /* first level with E >= Ef, then the closer of it and the one below */
+      lo = 0;
+      hi = nuc->numLevels;
+      while(lo < hi){
+        mid = (lo + hi)/2;
+        if(sorted[mid].E < Ef)
+          lo = mid + 1;
+        else
+          hi = mid;
+      }
+      best = lo;
+      if((lo == nuc->numLevels)||((lo > 0)&&(Ef - sorted[lo-1].E < sorted[lo].E - Ef)))
+        best = lo - 1;
+      if((best < nuc->numLevels)&&(fabs(sorted[best].E - Ef) <= LEVELS_E_TOL)&&(sorted[best].lev != nuc->firstLevel + i))
+        s->lg[lev->firstGamma + j].final = (long)sorted[best].lev;
+    }
+  }
+}
+
+/* adds the conversion electron intensity to the total intensity of each gamma of a level, taking
+the conversion coefficient from the table (if any) for gammas without one */
+static void levelsTotalIntensity(levelsScheme *s, const ensdfNuclide *nuc, const ensdfLevel *lev, const bcalcTrans *tdef){
+  ensdfGamma *g;
+  bcalcTrans t;
+  char mstr[8];
+  double cc;
+  size_t j;
+  int mix;
+  for(j=0;j<lev->numGammas;j++){
+    g = s->idx.gam + lev->firstGamma + j;
+    if((!g->hasCC)&&(tdef->iccTab != NULL)&&(tdef->iccAuto)&&(nuc->Z > 0)&&((mix = ensdfParseMult(g->mult,mstr)) > 0)){
+      t = *tdef;
+      bcalcParseMultipole(mstr,&t);
+      t.Et = g->E;
+      t.nucZ = nuc->Z;
+      t.useDelta = (mix == 2)&&g->hasMR;
+      t.delta = g->MR;
+      if(bcalcIccTrans(tdef->iccTab,&t,&cc) == BCALC_OK){
+        g->CC = cc;
+        g->hasCC = 1;
+      }
+    }
+    if(g->Itot > 0.)
+      g->Itot *= 1. + g->CC;
+  }
+}
+
+/* writes the results for a gamma as text (rwu, the results in W.u., may be NULL if A is unknown) */
+static void levelsPutText(strBuf *sb, const ensdfNuclide *nuc, const ensdfLevel *lev, const ensdfLevel *fin, const ensdfGamma *g, const bcalcTrans *t, const bcalcRes *r, const bcalcRes *rwu, const int barn){
+  char ustr[32], mstr1[16];
+  sbPuts(sb,nuc->nucid);
+  sbPutc(sb,'\t');
+  sbPuts(sb,lev->Es);
+  sbPutc(sb,'\t');
+  sbPuts(sb,(fin != NULL) ? fin->Es : "?");
+  sbPutc(sb,'\t');
+  sbPuts(sb,g->Es);
+  sbPutc(sb,'\t');
+  sbPuts(sb,g->mult);
+  sbPuts(sb,"\tbr = ");
+  sbPutExp(sb,t->branching,4);
+  getBUnit(ustr,sizeof(ustr),t->EM,t->L,barn);
+  sbPrintf(sb,"\tlt(%s) = ",t->mstr);
+  sbPutExp(sb,r->lt,4);
+  sbPrintf(sb," ps\tB(%s) = ",t->mstr);
+  sbPutExp(sb,r->b,4);
+  sbPrintf(sb," %s",ustr);
+  if(rwu != NULL){
+    sbPuts(sb," = ");
+    sbPutExp(sb,rwu->b,4);
+    sbPuts(sb," W.u.");
+  }
+  if(t->useDelta){
+    getMixedMstr(mstr1,sizeof(mstr1),t);
+    getBUnit(ustr,sizeof(ustr),!t->EM,t->L+1,barn);
+    sbPrintf(sb,"\tlt(%s) = ",mstr1);
+    sbPutExp(sb,r->lt1,4);
+    sbPrintf(sb," ps\tB(%s) = ",mstr1);
+    sbPutExp(sb,r->b1,4);
+    sbPrintf(sb," %s",ustr);
+    if(rwu != NULL){
+      sbPuts(sb," = ");
+      sbPutExp(sb,rwu->b1,4);
+      sbPuts(sb," W.u.");
+    }
+  }
+  sbPutc(sb,'\n');
+}
+
+/* calculates all gammas of a nuclide, returns the number calculated and adds to the skip counts */
+static unsigned long levelsCalcNuclide(levelsScheme *s, const ensdfNuclide *nuc, const bcalcTrans *tdef, const int fmt, strBuf *sb, unsigned long *numSkip){
+  const ensdfIndex *idx = &s->idx;
+  const ensdfLevel *lev, *fin;
+  const ensdfGamma *g;
+  const levelsGamma *lg;
+  bcalcTrans t;
+  bcalcRes r, rwu;
+  char estr[256];
+  unsigned long numCalc = 0;
+  size_t i, j;
+  int skip, err;
+  int barn = (tdef->barn == 1) ? 1 : 0;
+
+  for(i=0;i<nuc->numLevels;i++){
+    lev = idx->lev + nuc->firstLevel + i;
+    if(lev->numGammas == 0)
+      continue;
+    levelsTotalIntensity(s,nuc,lev,tdef);
+    for(j=0;j<lev->numGammas;j++){
+      g = idx->gam + lev->firstGamma + j;
+      lg = s->lg + lev->firstGamma + j;
+      fin = (lg->final >= 0) ? idx->lev + lg->final : NULL;
+      if((skip = ensdfTrans(idx,nuc,lev,g,tdef,&t)) >= 0){
+        numSkip[skip]++;
+        continue;
+      }
+      /* spins from the levels, if known */
+      if(s->spin[nuc->firstLevel + i] >= 0.)
+        t.ji = s->spin[nuc->firstLevel + i];
+      if((fin != NULL)&&(s->spin[lg->final] >= 0.))
+        t.jf = s->spin[lg->final];
+      t.bup = tdef->bup;
+      if((t.bup)&&((t.ji < 0.)||(t.jf < 0.))){
+        numSkip[LEVELS_SKIP_SPIN]++;
+        continue;
+      }
+      t.barn = barn;
+      err = bcalcCompute(&t,&r);
+      if(fmt != OUT_TEXT){
+        if(err != BCALC_OK)
+          getErrStr(estr,sizeof(estr),err,&t);
+        formatRecord(sb,fmt,lg->lineNum,&t,&r,err,(err != BCALC_OK) ? estr : NULL);
+      }else if((err == BCALC_OK)&&(t.nucA > 0)){
+        t.barn = 2;
+        err = bcalcCompute(&t,&rwu);
+        t.barn = barn;
+        if(err == BCALC_OK)
+          levelsPutText(sb,nuc,lev,fin,g,&t,&r,&rwu,barn);
+      }else if(err == BCALC_OK){
+        levelsPutText(sb,nuc,lev,fin,g,&t,&r,NULL,barn);
+      }
+      if(err != BCALC_OK){
+        numSkip[ENSDF_SKIP_CALC]++;
+        continue;
+      }
+      numCalc++;
+    }
+  }
+  return numCalc;
+}
+
+/* calculates partial lifetimes and reduced transition probabilities for every gamma in a level scheme file */
+int runLevels(const char *fileName, const bcalcTrans *tdef, const int fmt){
+
+  levelsScheme s;
+  levelsSorted *sorted = NULL;
+  size_t sortedCap = 0;
+  unsigned long numCalc = 0, numSkip[ENSDF_NUM_SKIP+1], numUnlinked = 0;
+  struct stat st;
+  void *map = NULL;
+  size_t size, i;
+  long numBad;
+  int fd;
+  strBuf out;
+
+  memset(&s,0,sizeof(levelsScheme));
+  memset(numSkip,0,sizeof(numSkip));
+  if((fd = open(fileName,O_RDONLY)) < 0){
+    printf("ERROR: Cannot open the level scheme file %s!\n",fileName);
+    exit(-1);
+  }
+  if((fstat(fd,&st) != 0)||(!S_ISREG(st.st_mode))){
+    printf("ERROR: %s is not a regular file.\n",fileName);
+    exit(-1);
+  }
+  size = (size_t)st.st_size;
+  if((size > 0)&&((map = mmap(NULL,size,PROT_READ,MAP_PRIVATE,fd,0)) == MAP_FAILED)){
+    printf("ERROR: Cannot map the level scheme file %s.\n",fileName);
+    exit(-1);
+  }
+  close(fd);
+
+  numBad = (size > 0) ? levelsParse((const char *)map,size,tdef,&s,(fmt == OUT_TEXT) ? stdout : stderr) : 0;
+  if(size > 0)
+    munmap(map,size);
+  if(numBad < 0){
+    printf("ERROR: Cannot allocate memory for the level scheme.\n");
+    exit(-1);
+  }
+
+  sbInit(&out);
+  formatRecordHeader(&out,fmt);
+  for(i=0;i<s.idx.numNuc;i++){
+    if(s.idx.nuc[i].numLevels > sortedCap){
+      sortedCap = s.idx.nuc[i].numLevels;
+      free(sorted);
+      if((sorted = malloc(sortedCap*sizeof(levelsSorted))) == NULL){
+        printf("ERROR: Cannot allocate memory for the level scheme.\n");
+        exit(-1);
+      }
+    }
+    levelsLink(&s,s.idx.nuc + i,sorted);
+    numCalc += levelsCalcNuclide(&s,s.idx.nuc + i,tdef,fmt,&out,numSkip);
+  }
+  sbFlush(&out,stdout);
+  sbFree(&out);
+  fflush(stdout);
+  for(i=0;i<s.idx.numGam;i++){
+    if(s.lg[i].final < 0)
+      numUnlinked++;
+  }
+
+  fprintf(stderr,"%lu nuclides, %lu levels, %lu gammas read (%lu gammas without a final level).\n",(unsigned long)s.idx.numNuc,(unsigned long)s.idx.numLev,(unsigned long)s.idx.numGam,numUnlinked);
+  if(numBad > 0)
+    fprintf(stderr,"%li invalid lines.\n",numBad);
+  fprintf(stderr,"Partial lifetimes and reduced transition probabilities calculated for %lu gammas, not calculated for:\n",numCalc);
+  fprintf(stderr,"  %lu gammas from levels without a lifetime\n",numSkip[ENSDF_SKIP_LT]);
+  fprintf(stderr,"  %lu gammas from levels with incomplete intensities\n",numSkip[ENSDF_SKIP_BR]);
+  if(numSkip[ENSDF_SKIP_MULT] > 0)
+    fprintf(stderr,"  %lu gammas without a specific multipolarity\n",numSkip[ENSDF_SKIP_MULT]);
+  if(numSkip[ENSDF_SKIP_DELTA] > 0)
+    fprintf(stderr,"  %lu mixed gammas without a mixing ratio\n",numSkip[ENSDF_SKIP_DELTA]);
+  if(numSkip[LEVELS_SKIP_SPIN] > 0)
+    fprintf(stderr,"  %lu gammas without known level spins (needed for --up)\n",numSkip[LEVELS_SKIP_SPIN]);
+  if(numSkip[ENSDF_SKIP_CALC] > 0)
+    fprintf(stderr,"  %lu gammas with invalid values\n",numSkip[ENSDF_SKIP_CALC]);
+
+  free(sorted);
+  free(s.lg);
+  free(s.spin);
+  ensdfFree(&s.idx);
+  return (numBad > 0) ? -1 : 0;
+}
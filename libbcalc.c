@@ -0,0 +1,1356 @@
+#include "libbcalc.h"
+#include "libbcalc_tables.h"
+
+double dblfac(unsigned int n){ 
+  double val = 1.0;
+  int i;
+  for (i=(int)n; i>=0; i=i-2){
+    if (i==0 || i==1)
+      return val;
+    else
+      val *= i;
+  }
+  return val;
+}
+
+/* raises x to an integer power
+the exponents used for multipoles up to L = BCALC_MAXL+1 (2L+1, 2L, 2L-2) use fixed multiplication chains */
+static inline double ipow(const double x, const int n){
+  double x2, x3, x4, x6, x8, x12, x16, x24, val;
+  int m;
+  switch(n){
+    case 0:
+      return 1.0;
+    case 1:
+      return x;
+    case 2:
+      return x*x;
+    case 3:
+      return x*x*x;
+    case 4:
+      x2 = x*x;
+      return x2*x2;
+    case 5:
+      x2 = x*x;
+      return x2*x2*x;
+    case 6:
+      x3 = x*x*x;
+      return x3*x3;
+    case 7:
+      x3 = x*x*x;
+      return x3*x3*x;
+    case 8:
+      x2 = x*x;
+      x4 = x2*x2;
+      return x4*x4;
+    case 9:
+      x3 = x*x*x;
+      return x3*x3*x3;
+    case 10:
+      x2 = x*x;
+      x4 = x2*x2;
+      return x4*x4*x2;
+    case 11:
+      x2 = x*x;
+      x4 = x2*x2;
+      return x4*x4*x2*x;
+    case 12:
+      x3 = x*x*x;
+      x6 = x3*x3;
+      return x6*x6;
+    case 13:
+      x3 = x*x*x;
+      x6 = x3*x3;
+      return x6*x6*x;
+    case 14:
+      x2 = x*x;
+      x4 = x2*x2;
+      x8 = x4*x4;
+      return x8*x4*x2;
+    case 15:
+      x3 = x*x*x;
+      x6 = x3*x3;
+      return x6*x6*x3;
+    case 16:
+      x2 = x*x;
+      x4 = x2*x2;
+      x8 = x4*x4;
+      return x8*x8;
+    case 17:
+      x2 = x*x;
+      x4 = x2*x2;
+      x8 = x4*x4;
+      return x8*x8*x;
+    case 18:
+      x3 = x*x*x;
+      x6 = x3*x3;
+      return x6*x6*x6;
+    case 19:
+      x3 = x*x*x;
+      x6 = x3*x3;
+      return x6*x6*x6*x;
+    case 20:
+      x2 = x*x;
+      x4 = x2*x2;
+      x8 = x4*x4;
+      return x8*x8*x4;
+    case 21:
+      x3 = x*x*x;
+      x6 = x3*x3;
+      return x6*x6*x6*x3;
+    case 22:
+      x2 = x*x;
+      x4 = x2*x2;
+      x8 = x4*x4;
+      return x8*x8*x4*x2;
+    case 23:
+      x2 = x*x;
+      x4 = x2*x2;
+      x8 = x4*x4;
+      return x8*x8*x4*x2*x;
+    case 24:
+      x3 = x*x*x;
+      x6 = x3*x3;
+      x12 = x6*x6;
+      return x12*x12;
+    case 25:
+      x3 = x*x*x;
+      x6 = x3*x3;
+      x12 = x6*x6;
+      return x12*x12*x;
+    case 26:
+      x3 = x*x*x;
+      x6 = x3*x3;
+      x12 = x6*x6;
+      return x12*x12*x*x;
+    case 27:
+      x3 = x*x*x;
+      x6 = x3*x3;
+      x12 = x6*x6;
+      x24 = x12*x12;
+      return x24*x3;
+    case 28:
+      x2 = x*x;
+      x4 = x2*x2;
+      x8 = x4*x4;
+      x16 = x8*x8;
+      return x16*x8*x4;
+    default:
+      /* generic exponentiation by squaring */
+      m = (n < 0) ? -n : n;
+      val = 1.0;
+      x2 = x;
+      while(m > 0){
+        if(m & 1)
+          val *= x2;
+        x2 *= x2;
+        m >>= 1;
+      }
+      return (n < 0) ? 1.0/val : val;
+  }
+}
+
+/* per-multipole constant factors (from libbcalc_tables.h), NAN outside of 0 <= L <= BCALC_MAXL+1 */
+static inline double getBFac(const int EM, const int L){
+  if((L < 0)||(L > BCALC_MAXL+1))
+    return NAN;
+  return bFac[EM!=0][L];
+}
+static inline double getLtspFac(const int EM, const int L){
+  if((L < 0)||(L > BCALC_MAXL+1))
+    return NAN;
+  return ltspFac[EM!=0][L];
+}
+static inline double getBarnFac(const int EM, const int L){
+  if((L < 0)||(L > BCALC_MAXL+1))
+    return NAN;
+  return barnFac[EM!=0][L];
+}
+
+/* raises x to an integer power in long double (BCALC_PREC_EXACT), by squaring */
+static long double ipowLd(const long double x, const int n){
+  long double val = 1.0L, base = x;
+  int m = (n < 0) ? -n : n;
+  while(m > 0){
+    if(m & 1)
+      val *= base;
+    base *= base;
+    m >>= 1;
+  }
+  return (n < 0) ? 1.0L/val : val;
+}
+
+#define FAST_RCBRT_MAGIC 0x553EF0FF289DD796ULL /* bits of a first guess of x^(-1/3) are this minus a third of those of x */
+
+/* x^(-1/3) for BCALC_PREC_FAST (x > 0 and normal), without division: a first guess from the
+exponent bits (relative error below 3.5E-2), two Newton steps y *= (4 - x*y^3)/3 (below 1.2E-5),
+and a second order step y *= 1 + r/3 + 2r^2/9 with r = 1 - x*y^3, truncated after 14|r|^3/81 = 8.1E-15 (|r| < 3.6E-5) */
+static inline double fastRcbrt(const double x){
+  uint64_t bits;
+  double y, r;
+  memcpy(&bits,&x,sizeof(bits));
+  bits = FAST_RCBRT_MAGIC - bits/3;
+  memcpy(&y,&bits,sizeof(y));
+  y = y*(4.0 - x*y*y*y)*(1.0/3.0);
+  y = y*(4.0 - x*y*y*y)*(1.0/3.0);
+  r = 1.0 - x*y*y*y;
+  return y + y*r*(1.0/3.0 + r*(2.0/9.0));
+}
+
+/* single particle lifetime (s) in long double, for BCALC_PREC_EXACT */
+static long double ltspLd(const int EM, const int L, const int nucA, const long double Et_keV){
+  return (long double)getLtspFac(EM,L)/(ipowLd(Et_keV,2*L + 1)*ipowLd(cbrtl((long double)nucA),(EM == 0) ? 2*L : 2*L - 2));
+}
+
+/* calculates single particle lifetimes (in s) */
+double ltsp(const int EM, const int L, const int nucA, const double Et_keV){
+
+  double a13 = cbrt((double)nucA);
+  if(EM == 0){
+    /* electric */
+    return getLtspFac(0,L)/(ipow(Et_keV,2*L + 1)*ipow(a13,2*L));
+  }else{
+    /* magnetic */
+    return getLtspFac(1,L)/(ipow(Et_keV,2*L + 1)*ipow(a13,2*L - 2));
+  }
+
+}
+
+/* calculates single particle lifetimes (in s) with the given precision tier (BCALC_PREC_...) */
+double ltspPrec(const int EM, const int L, const int nucA, const double Et_keV, const int prec){
+  switch(prec){
+    case BCALC_PREC_FAST:
+      return getLtspFac(EM,L)*ipow(fastRcbrt((double)nucA),(EM == 0) ? 2*L : 2*L - 2)/ipow(Et_keV,2*L + 1);
+    case BCALC_PREC_EXACT:
+      return (double)ltspLd(EM,L,nucA,Et_keV);
+    default:
+      return ltsp(EM,L,nucA,Et_keV);
+  }
+}
+
+/* squared radius (fm^2) of a uniformly charged sphere for the nucleus: from the measured RMS
+charge radius (R^2 = 5/3 <r^2>) if tabulated, otherwise R = 1.2*A^(1/3) */
+static double calcRadiusSq(const int nucA, const int nucZ, const int prec){
+  double rms = bcalcNucRadius(nucA,nucZ);
+  double a13;
+  if(rms > 0.)
+    return (5.0/3.0)*rms*rms;
+  if(prec == BCALC_PREC_FAST)
+    return 1.20*1.20*(double)nucA*fastRcbrt((double)nucA);
+  a13 = cbrt(1.0*nucA);
+  return 1.20*1.20*a13*a13;
+}
+
+/* beta_2 from a reduced transition probability in e^2 fm^4 (or W.u. if barn = 2), in long double
+(BCALC_PREC_EXACT) */
+static double calcBeta2Ld(const double Et, const long double b_in, const int nucA, const int nucZ, const int barn){
+  long double b, lt, rsq, a13;
+  long double rms = bcalcNucRadius(nucA,nucZ);
+  if(barn == 2){
+    lt = ltspLd(0,2,nucA,Et*1000.0L)/b_in;
+    b = 1.0L/(getBFac(0,2)*ipowLd(Et/(long double)HBARC_MEVFM,5)*lt);
+  }else{
+    b = b_in;
+  }
+  if(rms > 0.){
+    rsq = (5.0L/3.0L)*rms*rms;
+  }else{
+    a13 = cbrtl((long double)nucA);
+    rsq = 1.44L*a13*a13;
+  }
+  return (double)(sqrtl(5.0L*b)*4.0L*PI/(2.0L*nucZ*ESQ_MEVFM*rsq));
+}
+
+/* calculates the value of the quadrupole deformation parameter, assuming an input reduced transtion probability and a 2->0 transition */
+double calcBeta2(const double Et, const double b_in, const int nucA, const int nucZ, const int barn){
+  return calcBeta2Prec(Et,b_in,nucA,nucZ,barn,BCALC_PREC_DEFAULT);
+}
+
+/* as calcBeta2, with the given precision tier */
+double calcBeta2Prec(const double Et, const double b_in, const int nucA, const int nucZ, const int barn, const int prec){
+  
+  double b=0.;
+
+  if(prec == BCALC_PREC_EXACT){
+    return calcBeta2Ld(Et,b_in,nucA,nucZ,barn);
+  }
+
+  if(barn == 2){
+    /* input using Weisskopf units, first calculate lifetime */
+    double lt = ltspPrec(0,2,nucA,Et*1000.,prec)/b_in;
+    /* calculate b from lifetime */
+    double fac = getBFac(0,2)*ipow(Et/HBARC_MEVFM,5);
+    b=1/(fac*lt); /* lifetime to reduced transition probability (E2: e^2 fm^4) */
+  }else{
+    b=b_in;
+  }
+
+  return sqrt(5*b)*4.0*PI/(2*nucZ*ESQ_MEVFM*calcRadiusSq(nucA,nucZ,prec));
+  
+}
+
+/* calculates the value of the quadrupole deformation parameter, assuming an input lifetime and a 2->0 transition */
+double calcBeta2Lt(const double Et, const double lt, const int nucA, const int nucZ){
+  return calcBeta2LtPrec(Et,lt,nucA,nucZ,BCALC_PREC_DEFAULT);
+}
+
+/* as calcBeta2Lt, with the given precision tier */
+double calcBeta2LtPrec(const double Et, const double lt, const int nucA, const int nucZ, const int prec){
+
+  if(prec == BCALC_PREC_EXACT){
+    return calcBeta2Ld(Et,1.0L/(getBFac(0,2)*ipowLd(Et/(long double)HBARC_MEVFM,5)*lt),nucA,nucZ,0);
+  }
+
+  double fac = getBFac(0,2)*ipow(Et/HBARC_MEVFM,5);
+  
+  double b=1/(fac*lt); /* lifetime to reduced transition probability (E2: e^2 fm^4) */
+  return calcBeta2Prec(Et,b,nucA,nucZ,0,prec);
+  
+}
+
+/* calculates the value of the reduced transtion probability (in the units specified by barn) from a lifetime in s */
+double calcB(const int bup, const int EM, const int L, const double Et, const double lt, const double ji, const double jf, const int barn, const int nucA){
+  return calcBPrec(bup,EM,L,Et,lt,ji,jf,barn,nucA,BCALC_PREC_DEFAULT);
+}
+
+/* as calcB, with the given precision tier */
+double calcBPrec(const int bup, const int EM, const int L, const double Et, const double lt, const double ji, const double jf, const int barn, const int nucA, const int prec){
+
+  if(prec == BCALC_PREC_EXACT){
+    long double bl;
+    if(barn == 2)
+      return (double)(ltspLd(EM,L,nucA,Et*1000.0L)/lt);
+    bl = 1.0L/(getBFac(EM,L)*ipowLd(Et/(long double)HBARC_MEVFM,2*L + 1)*lt);
+    if(bup)
+      bl = bl*(2.0L*ji + 1.0L)/(2.0L*jf + 1.0L);
+    if(barn == 1)
+      bl = bl/getBarnFac(EM,L);
+    return (double)bl;
+  }
+
+  if(barn == 2){
+    /* Weisskopf unit calculation */
+    double lt_sp = ltspPrec(EM,L,nucA,Et*1000.,prec);
+    return lt_sp/lt;
+  }
+
+  /* e^2 fm^(2L) for electric, uN^2 fm^(2L-2) for magnetic */
+  double fac = getBFac(EM,L)*ipow(Et/HBARC_MEVFM,2*L + 1);
+  /* lifetime to reduced transition probability */
+  double b=1/(fac*lt);
+  if(bup){
+    b = b*(2.0*ji + 1.0)/(2.0*jf + 1.0);
+  }
+  if(barn == 1){
+    b = b/getBarnFac(EM,L);
+  }
+  return b;
+}
+
+/* calculates the (partial) lifetime in ps from the value of the reduced transition probability */
+double calcLt(const int bup, const int EM, const int L, const double Et, double b, const double ji, const double jf, const int barn, const int nucA, const double branching){
+  return calcLtPrec(bup,EM,L,Et,b,ji,jf,barn,nucA,branching,BCALC_PREC_DEFAULT);
+}
+
+/* as calcLt, with the given precision tier */
+double calcLtPrec(const int bup, const int EM, const int L, const double Et, double b, const double ji, const double jf, const int barn, const int nucA, const double branching, const int prec){
+
+  if(prec == BCALC_PREC_EXACT){
+    long double bl = b;
+    if(bup)
+      bl = bl*(2.0L*jf + 1.0L)/(2.0L*ji + 1.0L);
+    if(barn == 2)
+      return (double)(ltspLd(EM,L,nucA,Et*1000.0L)*1.0E12L/bl);
+    if(barn)
+      bl = bl*getBarnFac(EM,L);
+    return (double)(1.0E12L/(getBFac(EM,L)*ipowLd(Et/(long double)HBARC_MEVFM,2*L + 1)*bl)/branching);
+  }
+
+  if(bup){
+    b = b*(2.0*jf + 1.0)/(2.0*ji + 1.0);
+  }
+
+  if(barn == 2){
+    /* Weisskopf unit calculation */
+    double lt_sp = ltspPrec(EM,L,nucA,Et*1000.,prec);
+    lt_sp = lt_sp / 1.0E-12; //convert from s to ps
+    return lt_sp/b;
+  }
+
+  //convert barn units to fm units
+  if(barn){
+    b = b*getBarnFac(EM,L);
+  }
+
+  /* reduced transition probability to lifetime */
+  double fac = getBFac(EM,L)*ipow(Et/HBARC_MEVFM,2*L + 1);
+  double lt = 1/(fac*b);
+  lt = lt / 1.0E-12; //convert lifetime to ps
+  lt = 1.0/((1.0/lt)*branching); //partial lifetime
+  return lt;
+}
+
+/* sets transition parameters to their default (unspecified) values */
+void bcalcInitTrans(bcalcTrans *t){
+  memset(t,0,sizeof(bcalcTrans));
+  t->Et = -1.;
+  t->L = -1;
+  t->EM = -1;
+  t->calcMode = -1;
+  t->ji = -1.;
+  t->jf = -1.;
+  t->branching = 1.;
+  t->nucA = -1;
+  t->nucZ = -1;
+}
+
+/* parses a multipole string (eg. E1, M1, E2, etc.) */
+int bcalcParseMultipole(const char *str, bcalcTrans *t){
+  memset(t->mstr,0,sizeof(t->mstr));
+  strncpy(t->mstr,str,sizeof(t->mstr)-1);
+  if(t->mstr[0] == 'E'){
+    t->EM=0;
+  }else if(t->mstr[0] == 'M'){
+    t->EM=1;
+  }else{
+    return BCALC_ERR_MULTIPOLE;
+  }
+  if((isdigit(t->mstr[2])!=0)&&(isdigit(t->mstr[1])!=0)){
+    t->L=t->mstr[2] - '0';
+    t->L+=(t->mstr[1] - '0')*10;
+  }else if(isdigit(t->mstr[1])!=0){
+    t->L=t->mstr[1] - '0';
+  }else{
+    return BCALC_ERR_MULTIPOLE;
+  }
+  return BCALC_OK;
+}
+
+/* parses a precision tier name (fast, default or exact, len characters, not NUL terminated)
+returns an error code */
+int bcalcParsePrecision(const char *str, const size_t len, int *prec){
+  int i;
+  for(i=0;i<BCALC_NUM_PREC;i++){
+    if((strlen(bcalcPrecisionName(i)) == len)&&(strncmp(bcalcPrecisionName(i),str,len) == 0)){
+      *prec = i;
+      return BCALC_OK;
+    }
+  }
+  return BCALC_ERR_PRECISION;
+}
+
+/* returns the name of a precision tier */
+const char *bcalcPrecisionName(const int prec){
+  switch(prec){
+    case BCALC_PREC_DEFAULT:
+      return "default";
+    case BCALC_PREC_FAST:
+      return "fast";
+    case BCALC_PREC_EXACT:
+      return "exact";
+    default:
+      return "unknown";
+  }
+}
+
+/* checks transition parameters for validity, returns an error code
+warn is set if the spins of a B up calculation had to be assumed */
+int bcalcValidate(bcalcTrans *t, int *warn){
+  *warn = 0;
+  if((t->Et == 0.)||((t->Et < 0.)&&(t->Et != -1.))){
+    return BCALC_ERR_ENERGY;
+  }
+  if(t->icc < 0.){
+    return BCALC_ERR_ICC;
+  }
+  if((t->ji < 0.)&&(t->ji != -1.)){
+    return BCALC_ERR_JI;
+  }
+  if((t->jf < 0.)&&(t->jf != -1.)){
+    return BCALC_ERR_JF;
+  }
+  if(t->Et < 0.){
+    return BCALC_ERR_NOENERGY;
+  }
+  if(t->calcMode < 0){
+    return BCALC_ERR_NOVALUE;
+  }
+  if((t->EM==1) && (t->L ==0)){
+    return BCALC_ERR_M0;
+  }
+  if(t->L<0){
+    return BCALC_ERR_NOMULTIPOLE;
+  }
+  if(t->L > BCALC_MAXL){
+    return BCALC_ERR_LMAX;
+  }
+  if ((fmod(t->ji,0.5)!=0.) || (fmod(t->jf,0.5)!=0.) || (fmod(t->jf-t->ji,1)!=0.)){
+    return BCALC_ERR_SPINS;
+  }
+  if((t->bup == 1)&&((t->ji == -1)||(t->jf == -1))){
+    *warn = 1;
+    t->ji=2.;
+    t->jf=0.;
+  }
+  if((t->branching <= 0.)||(t->branching > 1.)){
+    return BCALC_ERR_BRANCHING;
+  }
+  if(t->barn>2){
+    return BCALC_ERR_UNITS;
+  }
+  if((t->precision < 0)||(t->precision >= BCALC_NUM_PREC)){
+    return BCALC_ERR_PRECISION;
+  }
+  if(t->barn==2){
+    if(t->nucA == -1){
+      return BCALC_ERR_WUNOA;
+    }else if(t->nucA <= 0){
+      return BCALC_ERR_A;
+    }
+  }
+  if(t->calcB2){
+    if((t->EM!=0)||(t->L!=2)||(t->ji!=2)||(t->jf!=0)){
+      return BCALC_ERR_BETA2TRANS;
+    }
+    if((t->nucZ == -1)||(t->nucA == -1)){
+      return BCALC_ERR_BETA2NOAZ;
+    }else if((t->nucZ <= 0)||(t->nucA <= 0)){
+      return BCALC_ERR_AZ;
+    }
+  }
+  if(t->nucA < t->nucZ){
+    return BCALC_ERR_ALTZ;
+  }
+  if((t->iccAuto)&&(t->iccTab != NULL)&&(t->nucZ > 0)&&(t->calcMode == 0)){
+    if(bcalcIccTrans(t->iccTab,t,&t->icc) != BCALC_OK){
+      return BCALC_ERR_ICCRANGE;
+    }
+  }
+  return BCALC_OK;
+}
+
+/* computes all requested quantities for a validated transition */
+static void computeValid(const bcalcTrans *t, bcalcRes *r){
+
+  double Et = t->Et/1000.0; //convert energy to MeV
+  double lt = t->lt;
+  double lt1 = 0.;
+
+  /* branching fraction calculation */
+  r->branching = t->branching;
+  r->icc = t->icc;
+  if(t->brrel == 1)
+    r->branching = r->branching/(r->branching + 1.0);
+
+  if(t->calcMode == 0){
+    lt = 1.0/((1.0/lt)*r->branching); //partial lifetime
+    lt = lt*(1.0 + t->icc);
+    /* mixing ratio calculation */
+    if(t->useDelta){
+      lt1 = lt * (1.0 + t->delta*t->delta) / (t->delta*t->delta);
+      lt = lt * (1.0 + t->delta*t->delta);
+    }
+    r->lt = lt;
+    r->lt1 = lt1;
+    lt=lt*1.0E-12; //convert lifetime to s
+    lt1=lt1*1.0E-12; //convert lifetime to s
+    r->b = calcBPrec(t->bup,t->EM,t->L,Et,lt,t->ji,t->jf,t->barn,t->nucA,t->precision);
+    if(t->useDelta){
+      r->b1 = calcBPrec(t->bup,!t->EM,t->L+1,Et,lt1,t->ji,t->jf,t->barn,t->nucA,t->precision);
+    }
+    if(t->calcB2){
+      r->beta2 = calcBeta2LtPrec(Et,lt,t->nucA,t->nucZ,t->precision);
+    }
+  }else if(t->calcMode == 1){
+    r->lt = calcLtPrec(t->bup,t->EM,t->L,Et,t->b,t->ji,t->jf,t->barn,t->nucA,r->branching,t->precision);
+    if(t->calcB2){
+      r->beta2 = calcBeta2Prec(Et,t->b,t->nucA,t->nucZ,t->barn,t->precision);
+    }
+  }
+}
+
+/* validates the transition parameters and computes all requested quantities
+returns an error code (also stored in the result), the input is not modified */
+int bcalcCompute(const bcalcTrans *t, bcalcRes *r){
+  bcalcTrans tv = *t;
+  memset(r,0,sizeof(bcalcRes));
+  r->err = bcalcValidate(&tv,&r->warn);
+  if(r->err == BCALC_OK){
+    computeValid(&tv,r);
+  }
+  return r->err;
+}
+
+/* computes all requested quantities for a transition already validated by bcalcValidate
+(bcalcCompute does both, this allows the two steps to be timed separately, eg. for bcalc --stats) */
+void bcalcComputeValid(const bcalcTrans *t, bcalcRes *r){
+  computeValid(t,r);
+}
+
+/* power of A in the inverse of a Weisskopf estimate: A^(2L/3) (electric) or A^((2L-2)/3) (magnetic), see ltsp */
+static inline double wuPowA(const int EM, const int L){
+  return (EM == 0) ? (2.0*L)/3.0 : (2.0*L - 2.0)/3.0;
+}
+
+/* sets a result and its derivatives from the derivatives of its logarithm, dln[j] = d ln(v) / d input j
+(0 if v does not depend on input j) */
+static void jacRow(bcalcJac *jac, const int row, const double v, const double *dln){
+  int j;
+  jac->val[row] = v;
+  for(j=0;j<BCALC_JAC_NUM_IN;j++)
+    jac->d[row][j] = (dln[j] != 0.) ? v*dln[j] : 0.;
+}
+
+/* computes the results of a validated transition and their partial derivatives
+each result of calcB, calcLt and calcBeta2 is a product of powers of the inputs (and of
+1+icc, 1+delta^2, etc.), so its derivatives are the result times those of its logarithm */
+static void jacValid(const bcalcTrans *t, bcalcJac *jac){
+
+  bcalcRes r;
+  double dlt[BCALC_JAC_NUM_IN]; /* d ln(partial lifetime of the L multipole) / d input (calcMode=0) */
+  double dln[BCALC_JAC_NUM_IN];
+  double d2 = t->delta*t->delta;
+  double dbr, dji, djf, dRsqA = 0.;
+  int j;
+
+  computeValid(t,&r);
+
+  /* d ln(branching fraction) / d input, including the conversion from relative intensity */
+  dbr = (t->brrel == 1) ? 1.0/(t->branching*(t->branching + 1.0)) : 1.0/t->branching;
+  /* d ln((2ji+1)/(2jf+1)) / d ji, d jf, for B up */
+  dji = t->bup ? 2.0/(2.0*t->ji + 1.0) : 0.;
+  djf = t->bup ? -2.0/(2.0*t->jf + 1.0) : 0.;
+  /* d ln(R^2) / dA, a measured radius does not depend on A */
+  if(t->calcB2 && (bcalcNucRadius(t->nucA,t->nucZ) <= 0.))
+    dRsqA = 2.0/(3.0*t->nucA);
+
+  if(t->calcMode == 0){
+    /* partial lifetime = lt/br*(1+icc)*(1+delta^2) */
+    memset(dlt,0,sizeof(dlt));
+    dlt[BCALC_JAC_VAL] = 1.0/t->lt;
+    dlt[BCALC_JAC_BR] = -dbr;
+    dlt[BCALC_JAC_ICC] = 1.0/(1.0 + t->icc);
+    if(t->useDelta)
+      dlt[BCALC_JAC_DELTA] = 2.0*t->delta/(1.0 + d2);
+
+    /* B = ltsp/lt in W.u., with ltsp ~ E^-(2L+1) A^-(2L/3 or (2L-2)/3) */
+    for(j=0;j<BCALC_JAC_NUM_IN;j++)
+      dln[j] = -dlt[j];
+    dln[BCALC_JAC_E] = -(2.0*t->L + 1.0)/t->Et;
+    if(t->nucA > 0){
+      dln[BCALC_JAC_A] = -wuPowA(t->EM,t->L)/t->nucA;
+      jacRow(jac,BCALC_JAC_BWU,(t->barn == 2) ? r.b : calcBPrec(0,t->EM,t->L,t->Et/1000.0,r.lt*1.0E-12,t->ji,t->jf,2,t->nucA,t->precision),dln);
+    }
+    /* otherwise B = 1/(fac*lt)*(2ji+1)/(2jf+1) with fac ~ E^(2L+1) */
+    if(t->barn != 2){
+      dln[BCALC_JAC_A] = 0.;
+      dln[BCALC_JAC_JI] = dji;
+      dln[BCALC_JAC_JF] = djf;
+    }
+    jacRow(jac,BCALC_JAC_B,r.b,dln);
+
+    /* the L+1 multipole, with partial lifetime lt/br*(1+icc)*(1+delta^2)/delta^2 */
+    if(t->useDelta){
+      dln[BCALC_JAC_E] = -(2.0*t->L + 3.0)/t->Et;
+      dln[BCALC_JAC_DELTA] = 2.0/(t->delta*(1.0 + d2));
+      if(t->barn == 2)
+        dln[BCALC_JAC_A] = -wuPowA(!t->EM,t->L+1)/t->nucA;
+      jacRow(jac,BCALC_JAC_B1,r.b1,dln);
+      if(t->delta == 0.)
+        jac->d[BCALC_JAC_B1][BCALC_JAC_DELTA] = 0.; /* B1 ~ delta^2 */
+    }
+
+    /* beta_2 ~ sqrt(B(E2))/R^2, with B(E2) in e^2 fm^4 from the partial lifetime */
+    if(t->calcB2){
+      for(j=0;j<BCALC_JAC_NUM_IN;j++)
+        dln[j] = -0.5*dlt[j];
+      dln[BCALC_JAC_E] = -2.5/t->Et;
+      dln[BCALC_JAC_A] = -dRsqA;
+      jacRow(jac,BCALC_JAC_BETA2,r.beta2,dln);
+    }
+  }else if(t->calcMode == 1){
+    /* lifetime = 1/(fac*B*br) with B converted to B down, or ltsp/B in W.u. (without the branching) */
+    memset(dln,0,sizeof(dln));
+    dln[BCALC_JAC_E] = -(2.0*t->L + 1.0)/t->Et;
+    dln[BCALC_JAC_VAL] = -1.0/t->b;
+    dln[BCALC_JAC_JI] = dji;
+    dln[BCALC_JAC_JF] = djf;
+    if(t->barn == 2)
+      dln[BCALC_JAC_A] = -wuPowA(t->EM,t->L)/t->nucA;
+    else
+      dln[BCALC_JAC_BR] = -dbr;
+    jacRow(jac,BCALC_JAC_LT,r.lt,dln);
+
+    /* beta_2 ~ sqrt(B(E2))/R^2, with B(E2) in W.u. converted to e^2 fm^4 by a factor ~ A^(4/3) */
+    if(t->calcB2){
+      memset(dln,0,sizeof(dln));
+      dln[BCALC_JAC_VAL] = 0.5/t->b;
+      dln[BCALC_JAC_A] = ((t->barn == 2) ? 2.0/(3.0*t->nucA) : 0.) - dRsqA;
+      jacRow(jac,BCALC_JAC_BETA2,r.beta2,dln);
+    }
+  }
+}
+
+/* sets all results and derivatives to NAN (not calculated) */
+static void jacInit(bcalcJac *jac){
+  int i, j;
+  for(i=0;i<BCALC_JAC_NUM_OUT;i++){
+    jac->val[i] = NAN;
+    for(j=0;j<BCALC_JAC_NUM_IN;j++)
+      jac->d[i][j] = NAN;
+  }
+  jac->err = BCALC_OK;
+  jac->warn = 0;
+}
+
+/* validates the transition parameters and computes the results with their (analytic) partial
+derivatives with respect to each input, as needed by least-squares fits
+a conversion coefficient looked up in a table is treated as an input (its energy dependence
+is not included in the derivatives with respect to the energy)
+returns an error code (also stored in jac), the input is not modified */
+int bcalcJacobian(const bcalcTrans *t, bcalcJac *jac){
+  bcalcTrans tv = *t;
+  jacInit(jac);
+  jac->err = bcalcValidate(&tv,&jac->warn);
+  if(jac->err == BCALC_OK){
+    jacValid(&tv,jac);
+  }
+  return jac->err;
+}
+
+/* returns a description of an error code */
+const char *bcalcErrStr(const int err){
+  switch(err){
+    case BCALC_OK:
+      return "No error.";
+    case BCALC_ERR_ENERGY:
+      return "Invalid transition energy.  Value must be a positive number.";
+    case BCALC_ERR_MULTIPOLE:
+      return "invalid multipole value.";
+    case BCALC_ERR_ICC:
+      return "Internal conversion coefficient must be a positive number.";
+    case BCALC_ERR_JI:
+      return "Invalid initial spin value provided.  The value must be a positive integer or half-integer.";
+    case BCALC_ERR_JF:
+      return "Invalid final spin value provided.  The value must be a positive integer or half-integer.";
+    case BCALC_ERR_NOENERGY:
+    case BCALC_ERR_NOMULTIPOLE:
+      return "Missing parameter.";
+    case BCALC_ERR_NOVALUE:
+      return "One of the following parameters is needed:";
+    case BCALC_ERR_M0:
+      return "Magnetic monopole transitions are not allowed.";
+    case BCALC_ERR_LMAX:
+      return "Maximum calculable L-value is 12.";
+    case BCALC_ERR_SPINS:
+      return "Initial and final spins must both be either integer or half-integer.";
+    case BCALC_ERR_BRANCHING:
+      return "invalid branching fraction (must be a positive number less than 1).";
+    case BCALC_ERR_UNITS:
+      return "only one of --barn and --wu can be used at once.";
+    case BCALC_ERR_WUNOA:
+      return "when using --wu, must also specify the -A parameter.";
+    case BCALC_ERR_A:
+      return "The mass number A cannot be less than 1.";
+    case BCALC_ERR_BETA2TRANS:
+      return "Can only calculate beta_2 for 2->0 (g.s.) E2 transitions.  The parameter values '-m E2 -ji 2 -jf 0' are required.";
+    case BCALC_ERR_BETA2NOAZ:
+      return "when calculating beta_2, must specify both the -A and -Z parameters.";
+    case BCALC_ERR_AZ:
+      return "The proton number Z or mass number A cannot be less than 1.";
+    case BCALC_ERR_ALTZ:
+      return "The mass number A cannot be less than the proton number Z.";
+    case BCALC_ERR_KERNEL:
+      return "The requested array kernel is not available on this system.";
+    case BCALC_ERR_ARRAY:
+      return "Missing input or output array.";
+    case BCALC_ERR_UNC:
+      return "Invalid uncertainty (use X or +X,-Y) or number of samples.";
+    case BCALC_ERR_MEMORY:
+      return "Out of memory.";
+    case BCALC_ERR_ICCTAB:
+      return "Cannot read the internal conversion coefficient table.";
+    case BCALC_ERR_ICCRANGE:
+      return "No tabulated internal conversion coefficient for this Z, multipole and energy (use -icc).";
+    case BCALC_ERR_SWEEP:
+      return "Invalid parameter range (use START:STOP:STEP, or atan:START:STOP:STEP in degrees for the mixing ratio).";
+    case BCALC_ERR_NUCLIDE:
+      return "Unknown nuclide (use eg. 152Sm or Sm152).";
+    case BCALC_ERR_PRECISION:
+      return "Unknown precision (use fast, default or exact).";
+    default:
+      return "Unknown error.";
+  }
+}
+
+/* constants shared by all elements of an array calculation */
+typedef struct
+{
+  double branching; /* branching fraction (if no per-transition values) */
+  int useDelta; /* 0=no mixing, 1=mixing */
+  double d2; /* squared mixing ratio (if no per-transition values) */
+  double fac, fac1; /* B factors for L, L+1 */
+  double sji, sjf; /* 2*ji+1, 2*jf+1 */
+  double barnFac, barnFac1; /* barn unit factors for L, L+1 */
+  double ltspFac, ltspFac1; /* single particle lifetime factors for L, L+1 */
+  double aPow, aPow1; /* mass number dependence of the single particle lifetime for L, L+1 */
+  double kB, kB1, kLt; /* all of the above folded together (BCALC_PREC_FAST, see arrFastFac) */
+}arrConsts;
+
+/* the BCALC_PREC_FAST kernel one element at a time, for the scalar kernel and the remaining elements */
+#define KERNEL_FAST_NAME arrKernelFastScalar
+#define KERNEL_POW  powScalar
+#define KERNEL_VT   double
+#define KERNEL_W    1
+#define KERNEL_ATTR
+#include "libbcalc_kernel.h"
+#undef KERNEL_FAST_NAME
+#undef KERNEL_POW
+#undef KERNEL_VT
+#undef KERNEL_W
+#undef KERNEL_ATTR
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define BCALC_X86_KERNELS
+
+typedef double v4d __attribute__((vector_size(32)));
+typedef double v8d __attribute__((vector_size(64)));
+
+#define KERNEL_NAME arrKernelAVX2
+#define KERNEL_FAST_NAME arrKernelFastAVX2
+#define KERNEL_POW  vpowAVX2
+#define KERNEL_VT   v4d
+#define KERNEL_W    4
+#define KERNEL_ATTR __attribute__((target("avx2")))
+#include "libbcalc_kernel.h"
+#undef KERNEL_NAME
+#undef KERNEL_FAST_NAME
+#undef KERNEL_POW
+#undef KERNEL_VT
+#undef KERNEL_W
+#undef KERNEL_ATTR
+
+#define KERNEL_NAME arrKernelAVX512
+#define KERNEL_FAST_NAME arrKernelFastAVX512
+#define KERNEL_POW  vpowAVX512
+#define KERNEL_VT   v8d
+#define KERNEL_W    8
+#define KERNEL_ATTR __attribute__((target("avx512f")))
+#include "libbcalc_kernel.h"
+#undef KERNEL_NAME
+#undef KERNEL_FAST_NAME
+#undef KERNEL_POW
+#undef KERNEL_VT
+#undef KERNEL_W
+#undef KERNEL_ATTR
+
+#endif
+
+/* constant factor of the B value of the multipole L (or L+1 if l1) in an array calculation with
+BCALC_PREC_FAST: B is this over lt*E^n (lt in ps, E in keV, n = 2L+1 or 2L+3), and the lifetime
+is this over B*E^n, with s the spin factor (the caller passes 1 for B values in W.u.) */
+static double arrFastFac(const bcalcTrans *tv, const arrConsts *c, const double s, const int l1){
+  if(tv->barn == 2)
+    return ((l1) ? c->ltspFac1/c->aPow1 : c->ltspFac/c->aPow)*1.0E12;
+  if(l1)
+    return s*1.0E12*ipow(1000.0*HBARC_MEVFM,2*tv->L + 3)/(c->fac1*((tv->barn == 1) ? c->barnFac1 : 1.0));
+  return s*1.0E12*ipow(1000.0*HBARC_MEVFM,2*tv->L + 1)/(c->fac*((tv->barn == 1) ? c->barnFac : 1.0));
+}
+
+/* runs the BCALC_PREC_FAST kernel one element at a time on elements i0 to n-1 */
+static void arrFastScalar(const bcalcArrIn *in, bcalcArrOut *out, const arrConsts *c, const size_t i0){
+  bcalcArrIn tin = *in;
+  bcalcArrOut tout = *out;
+  tin.n = in->n - i0;
+  tin.Et = in->Et + i0;
+  tin.val = in->val + i0;
+  tin.branching = (in->branching != NULL) ? in->branching + i0 : NULL;
+  tin.icc = (in->icc != NULL) ? in->icc + i0 : NULL;
+  tin.delta = (in->delta != NULL) ? in->delta + i0 : NULL;
+  tout.val = out->val + i0;
+  tout.val1 = (out->val1 != NULL) ? out->val1 + i0 : NULL;
+  arrKernelFastScalar(&tin,&tout,c);
+}
+
+/* processes elements i0 to n-1 of an array calculation, one at a time using the scalar calculation */
+static void arrScalar(const bcalcArrIn *in, bcalcArrOut *out, const bcalcTrans *tv, const size_t i0){
+  bcalcTrans t = *tv;
+  bcalcRes r;
+  size_t i;
+  t.calcB2 = 0;
+  for(i=i0;i<in->n;i++){
+    t.Et = in->Et[i];
+    if(t.calcMode == 0)
+      t.lt = in->val[i];
+    else
+      t.b = in->val[i];
+    if(in->branching != NULL)
+      t.branching = in->branching[i];
+    if(in->icc != NULL)
+      t.icc = in->icc[i];
+    if(in->delta != NULL){
+      t.delta = in->delta[i];
+      t.useDelta = 1;
+    }
+    computeValid(&t,&r);
+    if(t.calcMode == 0){
+      out->val[i] = r.b;
+      if(t.useDelta && (out->val1 != NULL))
+        out->val1[i] = r.b1;
+    }else{
+      out->val[i] = r.lt;
+    }
+  }
+}
+
+/* returns 1 if the given array kernel can be used on this system */
+int bcalcKernelAvail(const int kernel){
+  switch(kernel){
+    case BCALC_KERNEL_AUTO:
+    case BCALC_KERNEL_SCALAR:
+      return 1;
+#ifdef BCALC_X86_KERNELS
+    case BCALC_KERNEL_AVX2:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx2") ? 1 : 0;
+    case BCALC_KERNEL_AVX512:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx512f") ? 1 : 0;
+#endif
+    default:
+      return 0;
+  }
+}
+
+/* returns the name of an array kernel */
+const char *bcalcKernelName(const int kernel){
+  switch(kernel){
+    case BCALC_KERNEL_AUTO:
+      return "auto";
+    case BCALC_KERNEL_SCALAR:
+      return "scalar";
+    case BCALC_KERNEL_AVX2:
+      return "avx2";
+    case BCALC_KERNEL_AVX512:
+      return "avx512";
+    default:
+      return "unknown";
+  }
+}
+
+#define ARR_ICC_BLOCK 256 /* transitions per block with conversion coefficients from a table */
+
+/* calculates arrays of transitions with conversion coefficients from a table (iccAuto), looked up
+at the energy (and mixing ratio) of each transition, in blocks of ARR_ICC_BLOCK
+returns BCALC_ERR_ICCRANGE if a transition is outside of the table */
+static int arrIccAuto(const bcalcArrIn *in, bcalcArrOut *out, const int kernel){
+  double icc[ARR_ICC_BLOCK];
+  bcalcArrIn bin = *in;
+  bcalcArrOut bout;
+  bcalcTrans t = in->t;
+  size_t i0, i, n;
+  int err;
+  bin.t.iccAuto = 0;
+  bin.icc = icc;
+  for(i0=0;i0<in->n;i0+=n){
+    n = (in->n - i0 < ARR_ICC_BLOCK) ? in->n - i0 : ARR_ICC_BLOCK;
+    for(i=0;i<n;i++){
+      t.Et = in->Et[i0+i];
+      if(in->delta != NULL){
+        t.delta = in->delta[i0+i];
+        t.useDelta = 1;
+      }
+      if(bcalcIccTrans(t.iccTab,&t,&icc[i]) != BCALC_OK)
+        return BCALC_ERR_ICCRANGE;
+    }
+    bin.n = n;
+    bin.Et = in->Et + i0;
+    bin.val = in->val + i0;
+    bin.branching = (in->branching != NULL) ? in->branching + i0 : NULL;
+    bin.delta = (in->delta != NULL) ? in->delta + i0 : NULL;
+    bout.val = out->val + i0;
+    bout.val1 = (out->val1 != NULL) ? out->val1 + i0 : NULL;
+    if((err = bcalcComputeArrKernel(&bin,&bout,kernel)) != BCALC_OK)
+      return err;
+  }
+  return BCALC_OK;
+}
+
+/* calculates B values or lifetimes for arrays of transitions sharing the same multipole,
+using the given kernel (BCALC_KERNEL_AUTO picks the best available at runtime, and
+BCALC_PREC_EXACT always uses the scalar calculation)
+returns an error code, per-transition values are not validated (with iccAuto and no icc array,
+conversion coefficients from a table are looked up at the energy of each transition) */
+int bcalcComputeArrKernel(const bcalcArrIn *in, bcalcArrOut *out, const int kernel){
+
+  bcalcTrans tv = in->t;
+  bcalcArrIn vin;
+  arrConsts c;
+  size_t i0 = 0;
+  int warn, err, k, EM1, L;
+  double a13, s, g;
+
+  if((in->Et == NULL)||(in->val == NULL)||(out->val == NULL)){
+    return BCALC_ERR_ARRAY;
+  }
+  if(!bcalcKernelAvail(kernel)){
+    return BCALC_ERR_KERNEL;
+  }
+
+  /* validate the common parameters, with placeholders for the per-transition values (conversion
+  coefficients from a table depend on the energy, and are looked up for each transition) */
+  tv.iccAuto = 0;
+  tv.Et = 1.;
+  tv.lt = 1.;
+  tv.b = 1.;
+  if(in->branching != NULL)
+    tv.branching = 1.;
+  if(in->icc != NULL)
+    tv.icc = 0.;
+  if(in->delta != NULL){
+    tv.delta = 1.;
+    tv.useDelta = 1;
+  }
+  if((err = bcalcValidate(&tv,&warn)) != BCALC_OK){
+    return err;
+  }
+  if(tv.calcMode == 1){
+    tv.useDelta = 0;
+  }
+  if((tv.calcMode == 0)&&(in->t.iccAuto)&&(in->t.iccTab != NULL)&&(tv.nucZ > 0)&&(in->icc == NULL)){
+    return arrIccAuto(in,out,kernel);
+  }
+
+  k = kernel;
+  if(k == BCALC_KERNEL_AUTO){
+    if(bcalcKernelAvail(BCALC_KERNEL_AVX512))
+      k = BCALC_KERNEL_AVX512;
+    else if(bcalcKernelAvail(BCALC_KERNEL_AVX2))
+      k = BCALC_KERNEL_AVX2;
+    else
+      k = BCALC_KERNEL_SCALAR;
+  }
+  if(tv.precision == BCALC_PREC_EXACT){
+    k = BCALC_KERNEL_SCALAR; /* the reference is the scalar calculation in long double */
+  }
+
+  /* hoist everything that does not depend on the per-transition values */
+  L = tv.L;
+  EM1 = !tv.EM;
+  a13 = cbrt((double)tv.nucA);
+  c.branching = (tv.brrel == 1) ? in->t.branching/(in->t.branching + 1.0) : in->t.branching;
+  c.useDelta = tv.useDelta;
+  c.d2 = in->t.delta*in->t.delta;
+  c.fac = getBFac(tv.EM,L);
+  c.fac1 = getBFac(EM1,L+1);
+  c.sji = 2.0*tv.ji + 1.0;
+  c.sjf = 2.0*tv.jf + 1.0;
+  c.barnFac = getBarnFac(tv.EM,L);
+  c.barnFac1 = getBarnFac(EM1,L+1);
+  c.ltspFac = getLtspFac(tv.EM,L);
+  c.ltspFac1 = getLtspFac(EM1,L+1);
+  c.aPow = ipow(a13,(tv.EM == 0) ? 2*L : 2*L - 2);
+  c.aPow1 = ipow(a13,(EM1 == 0) ? 2*(L+1) : 2*(L+1) - 2);
+  if(tv.precision == BCALC_PREC_FAST){
+    s = (tv.bup) ? c.sji/c.sjf : 1.0;
+    if(tv.calcMode == 0){
+      g = ((in->branching != NULL) ? 1.0 : c.branching)/((in->icc != NULL) ? 1.0 : 1.0 + tv.icc);
+      if(c.useDelta && (in->delta == NULL))
+        g = g/(1.0 + c.d2);
+      c.kB = g*arrFastFac(&tv,&c,(tv.barn == 2) ? 1.0 : s,0);
+      c.kB1 = g*((in->delta != NULL) ? 1.0 : c.d2)*arrFastFac(&tv,&c,(tv.barn == 2) ? 1.0 : s,1);
+    }else{
+      c.kLt = s*arrFastFac(&tv,&c,1.0,0);
+      if((tv.barn != 2)&&(in->branching == NULL))
+        c.kLt = c.kLt/c.branching;
+    }
+  }
+
+  /* the kernels take the validated common parameters, as the scalar calculation of the remaining elements */
+  vin = *in;
+  vin.t = tv;
+  if(tv.precision == BCALC_PREC_FAST){
+    switch(k){
+#ifdef BCALC_X86_KERNELS
+      case BCALC_KERNEL_AVX2:
+        i0 = arrKernelFastAVX2(&vin,out,&c);
+        break;
+      case BCALC_KERNEL_AVX512:
+        i0 = arrKernelFastAVX512(&vin,out,&c);
+        break;
+#endif
+      default:
+        break;
+    }
+    if(i0 < in->n)
+      arrFastScalar(&vin,out,&c,i0);
+    return BCALC_OK;
+  }
+  switch(k){
+#ifdef BCALC_X86_KERNELS
+    case BCALC_KERNEL_AVX2:
+      i0 = arrKernelAVX2(&vin,out,&c);
+      break;
+    case BCALC_KERNEL_AVX512:
+      i0 = arrKernelAVX512(&vin,out,&c);
+      break;
+#endif
+    default:
+      break;
+  }
+  /* remaining elements */
+  arrScalar(in,out,&tv,i0);
+
+  return BCALC_OK;
+}
+
+/* calculates B values or lifetimes for arrays of transitions sharing the same multipole,
+using the best vectorized kernel available at runtime */
+int bcalcComputeArr(const bcalcArrIn *in, bcalcArrOut *out){
+  return bcalcComputeArrKernel(in,out,BCALC_KERNEL_AUTO);
+}
+
+/* calculates the results and their partial derivatives (as bcalcJacobian) for arrays of
+transitions sharing the same multipole (see bcalcComputeArr), into jac (n elements)
+each transition is validated, with its error code stored in its element of jac
+returns BCALC_ERR_ARRAY if a required array is missing, otherwise BCALC_OK */
+int bcalcJacobianArr(const bcalcArrIn *in, bcalcJac *jac){
+  bcalcTrans t = in->t;
+  size_t i;
+  if((in->Et == NULL)||(in->val == NULL)||(jac == NULL)){
+    return BCALC_ERR_ARRAY;
+  }
+  if(in->icc != NULL)
+    t.iccAuto = 0;
+  for(i=0;i<in->n;i++){
+    t.Et = in->Et[i];
+    if(t.calcMode == 0)
+      t.lt = in->val[i];
+    else
+      t.b = in->val[i];
+    if(in->branching != NULL)
+      t.branching = in->branching[i];
+    if(in->icc != NULL)
+      t.icc = in->icc[i];
+    if(in->delta != NULL){
+      t.delta = in->delta[i];
+      t.useDelta = 1;
+    }
+    bcalcJacobian(&t,&jac[i]);
+  }
+  return BCALC_OK;
+}
+
+#define DEG_RAD 0.017453292519943295769 /* pi/180 */
+
+/* returns the i-th value of a parameter grid axis */
+double bcalcAxisVal(const bcalcAxis *ax, const size_t i){
+  double v = ax->start + (double)i*ax->step;
+  if(ax->atan)
+    return tan(v*DEG_RAD);
+  return v;
+}
+
+/* sets the swept parameters of a transition to the given grid point */
+static void setGridPoint(bcalcTrans *t, const bcalcAxis *ax, const size_t ie, const size_t iv, const size_t id){
+  if(ax[BCALC_AXIS_ENERGY].n > 0)
+    t->Et = bcalcAxisVal(&ax[BCALC_AXIS_ENERGY],ie);
+  if(ax[BCALC_AXIS_VAL].n > 0){
+    if(t->calcMode == 1)
+      t->b = bcalcAxisVal(&ax[BCALC_AXIS_VAL],iv);
+    else
+      t->lt = bcalcAxisVal(&ax[BCALC_AXIS_VAL],iv);
+  }
+  if(ax[BCALC_AXIS_DELTA].n > 0){
+    t->delta = bcalcAxisVal(&ax[BCALC_AXIS_DELTA],id);
+    t->useDelta = 1;
+  }
+}
+
+/* calculates the grid points of bcalcSweep one at a time (for BCALC_PREC_EXACT), each validated
+on its own, returns an error code */
+static int sweepPoints(const bcalcTrans *t, const bcalcAxis *ax, const size_t e0, const size_t ne, const size_t nv, const size_t nd, bcalcArrOut *out){
+  bcalcTrans tp;
+  bcalcRes r;
+  size_t ie, iv, id, k = 0;
+  int warn, err;
+  for(ie=e0;ie<e0+ne;ie++){
+    for(iv=0;iv<nv;iv++){
+      for(id=0;id<nd;id++){
+        tp = *t;
+        setGridPoint(&tp,ax,ie,iv,id);
+        if((err = bcalcValidate(&tp,&warn)) != BCALC_OK){
+          return err;
+        }
+        computeValid(&tp,&r);
+        if(tp.calcMode == 0){
+          out->val[k] = r.b;
+          if(tp.useDelta && (out->val1 != NULL))
+            out->val1[k] = r.b1;
+        }else{
+          out->val[k] = r.lt;
+        }
+        k++;
+      }
+    }
+  }
+  return BCALC_OK;
+}
+
+/* calculates B values (calcMode=0) or lifetimes (calcMode=1) on a grid of energies x lifetimes
+(or B values) x mixing ratios, for the energy rows e0 to e0+ne-1
+parameters that are not swept (n=0) are taken from t, the result for grid point (ie,iv,id) is
+stored at index ((ie-e0)*nv + iv)*nd + id of out (nv, nd = number of values, or 1 if not swept)
+everything that does not depend on the grid point is hoisted out of the loops: the energy
+dependence (including tabulated conversion coefficients) is evaluated once per energy row, the
+mixing ratio dependence once per mixing ratio, leaving one multiplication per grid point
+(with BCALC_PREC_EXACT, each grid point is calculated on its own instead)
+returns an error code */
+int bcalcSweep(const bcalcTrans *t, const bcalcAxis *ax, const size_t e0, const size_t ne, bcalcArrOut *out){
+
+  bcalcTrans tv = *t;
+  const size_t nv = (ax[BCALC_AXIS_VAL].n > 0) ? ax[BCALC_AXIS_VAL].n : 1;
+  const size_t nd = (ax[BCALC_AXIS_DELTA].n > 0) ? ax[BCALC_AXIS_DELTA].n : 1;
+  size_t ie, iv, id, k;
+  int a, warn, err, L, EM1;
+  double *w = NULL; /* mixing ratio weights of the L and L+1 multipoles, 2 per mixing ratio */
+  double w0[2];
+  double br, spin, x, icc, k0, k1, eFac, eFac1, v, v1, d2;
+
+  if(out->val == NULL){
+    return BCALC_ERR_ARRAY;
+  }
+  if((ax[BCALC_AXIS_ENERGY].atan)||(ax[BCALC_AXIS_VAL].atan)){
+    return BCALC_ERR_SWEEP;
+  }
+  for(a=0;a<BCALC_NUM_AXES;a++){
+    if((ax[a].n > 1)&&((ax[a].step == 0.)||(!isfinite(ax[a].step)))){
+      return BCALC_ERR_SWEEP;
+    }
+  }
+  if(e0 + ne > ((ax[BCALC_AXIS_ENERGY].n > 0) ? ax[BCALC_AXIS_ENERGY].n : 1)){
+    return BCALC_ERR_SWEEP;
+  }
+
+  /* validate at both corners of the grid (all values in between are valid if these are) */
+  setGridPoint(&tv,ax,0,0,0);
+  if((err = bcalcValidate(&tv,&warn)) != BCALC_OK){
+    return err;
+  }
+  setGridPoint(&tv,ax,ax[BCALC_AXIS_ENERGY].n - (ax[BCALC_AXIS_ENERGY].n > 0),nv-1,nd-1);
+  if((err = bcalcValidate(&tv,&warn)) != BCALC_OK){
+    return err;
+  }
+  if((tv.calcMode == 1)&&(ax[BCALC_AXIS_DELTA].n > 0)){
+    return BCALC_ERR_SWEEP;
+  }
+  if(tv.calcMode == 1){
+    tv.useDelta = 0;
+  }
+  if(ne == 0){
+    return BCALC_OK;
+  }
+  if(tv.precision == BCALC_PREC_EXACT){
+    return sweepPoints(t,ax,e0,ne,nv,nd,out);
+  }
+
+  /* mixing ratio weights, the L multipole gets 1/(1+d^2) and the L+1 multipole d^2/(1+d^2)
+  of the transition rate */
+  if(tv.useDelta){
+    if((w = malloc(2*nd*sizeof(double))) == NULL){
+      return BCALC_ERR_MEMORY;
+    }
+    for(id=0;id<nd;id++){
+      d2 = (ax[BCALC_AXIS_DELTA].n > 0) ? bcalcAxisVal(&ax[BCALC_AXIS_DELTA],id) : tv.delta;
+      d2 = d2*d2;
+      w[2*id] = 1.0/(1.0 + d2);
+      w[2*id+1] = d2/(1.0 + d2);
+    }
+  }else{
+    w0[0] = 1.0;
+    w0[1] = 0.;
+    w = w0;
+  }
+
+  /* constant factors of the L and L+1 multipoles */
+  L = tv.L;
+  EM1 = !tv.EM;
+  br = (tv.brrel == 1) ? tv.branching/(tv.branching + 1.0) : tv.branching;
+  if(tv.calcMode == 0){
+    spin = (tv.bup) ? (2.0*tv.ji + 1.0)/(2.0*tv.jf + 1.0) : 1.0;
+    if(tv.barn == 2){
+      k0 = getLtspFac(tv.EM,L)/ipow(cbrt((double)tv.nucA),(tv.EM == 0) ? 2*L : 2*L - 2);
+      k1 = getLtspFac(EM1,L+1)/ipow(cbrt((double)tv.nucA),(EM1 == 0) ? 2*(L+1) : 2*(L+1) - 2);
+    }else{
+      k0 = spin/getBFac(tv.EM,L);
+      k1 = spin/getBFac(EM1,L+1);
+      if(tv.barn == 1){
+        k0 = k0/getBarnFac(tv.EM,L);
+        k1 = k1/getBarnFac(EM1,L+1);
+      }
+    }
+    k0 = k0*br*1.0E12;
+    k1 = k1*br*1.0E12;
+  }else{
+    spin = (tv.bup) ? (2.0*tv.jf + 1.0)/(2.0*tv.ji + 1.0) : 1.0;
+    if(tv.barn == 2){
+      /* no branching, as in calcLt() */
+      k0 = getLtspFac(tv.EM,L)/ipow(cbrt((double)tv.nucA),(tv.EM == 0) ? 2*L : 2*L - 2)*1.0E12/spin;
+    }else{
+      k0 = 1.0E12/(getBFac(tv.EM,L)*spin*br);
+      if(tv.barn == 1){
+        k0 = k0/getBarnFac(tv.EM,L);
+      }
+    }
+    k1 = 0.;
+  }
+
+  k = 0;
+  for(ie=e0;ie<e0+ne;ie++){
+    /* energy dependence */
+    setGridPoint(&tv,ax,ie,0,0);
+    x = (tv.barn == 2) ? tv.Et : tv.Et/1000.0/HBARC_MEVFM;
+    icc = tv.icc;
+    if((tv.calcMode == 0)&&(tv.iccAuto)&&(tv.iccTab != NULL)&&(tv.nucZ > 0)){
+      if(bcalcIccTrans(tv.iccTab,&tv,&icc) != BCALC_OK){
+        err = BCALC_ERR_ICCRANGE;
+        break;
+      }
+    }
+    if(tv.calcMode == 0){
+      eFac = k0/(ipow(x,2*L + 1)*(1.0 + icc));
+      eFac1 = k1/(ipow(x,2*L + 3)*(1.0 + icc));
+    }else{
+      eFac = k0/ipow(x,2*L + 1);
+      eFac1 = 0.;
+    }
+    for(iv=0;iv<nv;iv++){
+      /* lifetime or B value dependence */
+      if(ax[BCALC_AXIS_VAL].n > 0)
+        v = bcalcAxisVal(&ax[BCALC_AXIS_VAL],iv);
+      else
+        v = (tv.calcMode == 1) ? tv.b : tv.lt;
+      v1 = eFac1/v;
+      v = eFac/v;
+      /* mixing ratio dependence */
+      if(tv.useDelta){
+        for(id=0;id<nd;id++){
+          out->val[k+id] = v*w[2*id];
+        }
+        if(out->val1 != NULL){
+          for(id=0;id<nd;id++){
+            out->val1[k+id] = v1*w[2*id+1];
+          }
+        }
+      }else{
+        out->val[k] = v;
+      }
+      k += nd;
+    }
+  }
+
+  if(w != w0){
+    free(w);
+  }
+  return err;
+}
@@ -0,0 +1,308 @@
+#ifndef LIBBCALC_H
+#define LIBBCALC_H
+
+/* libbcalc: reduced transition probability calculations
+All functions are reentrant and thread-safe (no global state), and do not print anything. */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <ctype.h>
+#include <stdint.h>
+
+#define PI         3.14159265359
+#define LN2        0.693147180559945
+#define ESQ_MEVFM      1.44 /* MeV fm */
+#define UN_MEVFM3      0.015922 /* MeV fm^3 */
+#define UNSQ           1.5922E-38 /* keV cm^3 */
+#define BARN_FM        100.0 /* fm^2 */
+#define HBAR_MEVS      6.58212E-22 /* MeV s */
+#define HBARC_MEVFM    197.327 /* MeV fm */
+
+#define BCALC_MAXL     12 /* maximum calculable multipolarity */
+
+/* error codes */
+#define BCALC_OK                0
+#define BCALC_ERR_ENERGY        1  /* invalid transition energy */
+#define BCALC_ERR_MULTIPOLE     2  /* invalid multipole string */
+#define BCALC_ERR_ICC           3  /* negative conversion coefficient */
+#define BCALC_ERR_JI            4  /* invalid initial spin */
+#define BCALC_ERR_JF            5  /* invalid final spin */
+#define BCALC_ERR_NOENERGY      6  /* missing transition energy */
+#define BCALC_ERR_NOVALUE       7  /* missing lifetime, half-life or B value */
+#define BCALC_ERR_M0            8  /* magnetic monopole */
+#define BCALC_ERR_NOMULTIPOLE   9  /* missing multipole */
+#define BCALC_ERR_LMAX          10 /* L > 12 */
+#define BCALC_ERR_SPINS         11 /* mixed integer and half-integer spins */
+#define BCALC_ERR_BRANCHING     12 /* branching fraction outside (0,1] */
+#define BCALC_ERR_UNITS         13 /* both --barn and --wu */
+#define BCALC_ERR_WUNOA         14 /* --wu without -A */
+#define BCALC_ERR_A             15 /* A < 1 */
+#define BCALC_ERR_BETA2TRANS    16 /* beta_2 for something other than a 2->0 E2 transition */
+#define BCALC_ERR_BETA2NOAZ     17 /* beta_2 without -A and -Z */
+#define BCALC_ERR_AZ            18 /* A or Z < 1 */
+#define BCALC_ERR_ALTZ          19 /* A < Z */
+#define BCALC_ERR_KERNEL        20 /* requested array kernel not available */
+#define BCALC_ERR_ARRAY         21 /* missing array */
+#define BCALC_ERR_UNC           22 /* invalid uncertainty or number of samples */
+#define BCALC_ERR_MEMORY        23 /* out of memory */
+#define BCALC_ERR_ICCTAB        24 /* conversion coefficient table missing or invalid */
+#define BCALC_ERR_ICCRANGE      25 /* no tabulated conversion coefficient for the Z, multipole and energy */
+#define BCALC_ERR_SWEEP         26 /* invalid parameter grid */
+#define BCALC_ERR_NUCLIDE       27 /* unknown nuclide name */
+#define BCALC_ERR_PRECISION     28 /* unknown precision tier */
+#define BCALC_NUM_ERR           29 /* number of error codes */
+
+/* nuclide database (libbcalc_nuc.c, generated from nuclides.dat at build time) */
+#define BCALC_NUC_MAXZ          118 /* heaviest element */
+#define BCALC_NUC_MAXA          1023 /* largest accepted mass number (nuclide keys are Z << 10 | A) */
+
+/* array kernels */
+#define BCALC_KERNEL_AUTO       0 /* best available */
+#define BCALC_KERNEL_SCALAR     1
+#define BCALC_KERNEL_AVX2       2
+#define BCALC_KERNEL_AVX512     3
+#define BCALC_NUM_KERNELS       4
+
+/* maximum difference (in units in the last place) between the results of the vectorized
+array kernels and the scalar calculation.  The kernels repeat the scalar operations one for
+one, except for E^(2L+1) which is evaluated by binary exponentiation rather than a fixed
+multiplication chain.  Both have a relative error of at most (2L+2)u for L <= BCALC_MAXL+1
+(u = 2^-53), so the results differ by at most 2*(2*BCALC_MAXL+4) = 56 ulp, plus one ulp for
+each of the (at most 6) following operations that may round differently. */
+#define BCALC_ARR_MAXULP        64
+
+/* precision tiers (bcalcTrans.precision)
+BCALC_PREC_DEFAULT evaluates powers of the energy (and of A^(1/3)) by multiplication chains in
+double precision, with a relative error of at most BCALC_PREC_DEFAULT_MAXREL: for L <= BCALC_MAXL+1
+(u = 2^-53), 2Lu for each of the two powers, (2L+1)u for the conversion of the energy to keV,
+2Lu for the cube root raised to the power 2L, and a few u for the operations around them,
+(8L+8)u = 112u in all.
+BCALC_PREC_FAST replaces the cube root (the most expensive operation in a Weisskopf estimate, and
+in the nuclear radius 1.2*A^(1/3)) by A^(-1/3) from exponent bits and Newton steps, without
+division, with a relative error of at most 8.1E-15 plus a few u.  Raised to the power 2L <= 24,
+with the operations of the default tier, the relative error is at most 2.2E-13
+(rounded up in BCALC_PREC_FAST_MAXREL).
+Calculations without a cube root (B in fm or barn units) and sweeps (which fold their constant
+factors in every tier) are the same as in the default tier.  The array kernels (which take the
+cube root once per call) instead fold all constant factors into one in double precision (a few u),
+leaving a power of the energy ((2L+3)u) and one division for each element, well within the bound.
+BCALC_PREC_EXACT evaluates the same expressions in long double (64 bit mantissa on x86), as a
+reference for the other tiers.  The operations combining the branching fraction, conversion
+coefficient and mixing ratio into a partial lifetime (a few correctly rounded operations) are
+the same in all tiers. */
+#define BCALC_PREC_DEFAULT      0
+#define BCALC_PREC_FAST         1
+#define BCALC_PREC_EXACT        2
+#define BCALC_NUM_PREC          3
+#define BCALC_PREC_DEFAULT_MAXREL 1.3E-14 /* 112u */
+#define BCALC_PREC_FAST_MAXREL    2.5E-13
+
+/* internal conversion coefficient table (see bcalcIccOpen)
+The table file starts with a bcalcIccHeader, followed by a directory of bcalcIccSeries entries
+indexed by [Z][EM][L] (Z = 0..maxZ, EM = 0..1, L = 0..maxL), then 3*numPoints doubles.  For
+each series of n points starting at point 'first', x[n] = log(E/keV), y[n] = log(alpha) and
+the natural cubic spline second derivatives y2[n] are stored one after the other, starting at
+data[3*first].  All values are in the native byte order. */
+#define BCALC_ICC_MAGIC   "BCALCICC"
+#define BCALC_ICC_VERSION 1
+
+typedef struct
+{
+  char magic[8]; /* BCALC_ICC_MAGIC (not NUL terminated) */
+  uint32_t version; /* BCALC_ICC_VERSION */
+  uint32_t maxZ;
+  uint32_t maxL;
+  uint32_t numPoints;
+}bcalcIccHeader;
+
+typedef struct
+{
+  int32_t first; /* first point */
+  int32_t n; /* number of points, 0 if not tabulated */
+}bcalcIccSeries;
+
+typedef struct
+{
+  void *map; /* mapped table file */
+  size_t mapSize;
+  const bcalcIccHeader *hdr;
+  const bcalcIccSeries *dir;
+  const double *data;
+}bcalcIccTab;
+
+/* transition parameters, from the command line or a line of batch input */
+typedef struct
+{
+  double Et; /* transition energy (keV) */
+  int L; /* multipolarity */
+  int EM; /* 0=electric, 1=magnetic */
+  char mstr[4]; /* multipole string (eg. E2) */
+  double lt; /* lifetime (ps) */
+  double b; /* reduced transition probability */
+  int calcMode; /* 0=calulate B, 1=calculate lifetime */
+  int barn; /* 0=fm units, 1=barn units, 2=Weisskopf units */
+  int bup; /* 0=down, 1=up */
+  double ji; /* Initial spin */
+  double jf; /* Final spin*/
+  double delta; /* mixing ratio */
+  int useDelta; /* 0=no mixing, 1=mixing */
+  double branching; /* branching fraction */
+  int brrel; /* 0=use branching fraction, 1=use relative intensity */
+  double icc; /* internal conversion coefficient */
+  int calcB2; /* 0=no beta_2 calc, 1=calc beta_2 */
+  int nucA; /* mass number of the nucleus of interest */
+  int nucZ; /* proton number of the nucleus of interest */
+  const bcalcIccTab *iccTab; /* conversion coefficient table (NULL=none) */
+  int iccAuto; /* 1=look up icc in iccTab (if nucZ is known), 0=use icc */
+  int precision; /* BCALC_PREC_DEFAULT, BCALC_PREC_FAST or BCALC_PREC_EXACT */
+}bcalcTrans;
+
+/* calculated values for a transition */
+typedef struct
+{
+  double branching; /* branching fraction (after conversion from relative intensity) */
+  double lt; /* partial lifetime of the L multipole (ps), or calculated lifetime if calcMode=1 */
+  double lt1; /* partial lifetime of the L+1 multipole (ps) */
+  double b; /* reduced transition probability of the L multipole */
+  double b1; /* reduced transition probability of the L+1 multipole */
+  double beta2; /* quadrupole deformation parameter */
+  double icc; /* internal conversion coefficient used (looked up if iccAuto) */
+  int err; /* error code (BCALC_OK if the calculation succeeded) */
+  int warn; /* 1 if a 2->0 transition was assumed for a B up calculation with unknown spins */
+}bcalcRes;
+
+/* array (structure-of-arrays) calculation input
+the parameters in t apply to all transitions, the arrays hold per-transition values
+optional arrays may be NULL, in which case the corresponding value in t is used for all transitions */
+typedef struct
+{
+  bcalcTrans t; /* common parameters (multipole, calcMode, units, spins, A, brrel) */
+  size_t n; /* number of transitions */
+  const double *Et; /* transition energies (keV) */
+  const double *val; /* lifetimes (ps) if t.calcMode=0, reduced transition probabilities if t.calcMode=1 */
+  const double *branching; /* branching fractions, or relative intensities if t.brrel=1 (optional) */
+  const double *icc; /* internal conversion coefficients (optional, calcMode=0 only, otherwise from t.iccTab for each energy if t.iccAuto) */
+  const double *delta; /* mixing ratios (optional, calcMode=0 only) */
+}bcalcArrIn;
+
+/* array calculation output, arrays of length n */
+typedef struct
+{
+  double *val; /* B of the L multipole (calcMode=0) or (partial) lifetime in ps (calcMode=1) */
+  double *val1; /* B of the L+1 multipole, if there is mixing (optional) */
+}bcalcArrOut;
+
+/* partial derivatives of the results of a transition (see bcalcJacobian): inputs (columns) */
+#define BCALC_JAC_E             0 /* transition energy (keV) */
+#define BCALC_JAC_VAL           1 /* lifetime (ps, calcMode=0) or reduced transition probability (calcMode=1) */
+#define BCALC_JAC_BR            2 /* branching fraction, or relative intensity if brrel=1 */
+#define BCALC_JAC_DELTA         3 /* mixing ratio */
+#define BCALC_JAC_ICC           4 /* internal conversion coefficient */
+#define BCALC_JAC_JI            5 /* initial spin */
+#define BCALC_JAC_JF            6 /* final spin */
+#define BCALC_JAC_A             7 /* mass number (treated as continuous) */
+#define BCALC_JAC_NUM_IN        8
+/* results (rows) */
+#define BCALC_JAC_B             0 /* B of the L multipole, in the units given by barn (calcMode=0) */
+#define BCALC_JAC_B1            1 /* B of the L+1 multipole, if there is mixing (calcMode=0) */
+#define BCALC_JAC_BWU           2 /* B of the L multipole in W.u., if A is known (calcMode=0) */
+#define BCALC_JAC_LT            3 /* (partial) lifetime in ps (calcMode=1) */
+#define BCALC_JAC_BETA2         4 /* quadrupole deformation parameter, if calcB2=1 */
+#define BCALC_JAC_NUM_OUT       5
+
+/* results of a transition with their partial derivatives with respect to each input
+derivatives of results that do not depend on an input are 0, results not calculated are NAN
+(with all of their derivatives) */
+typedef struct
+{
+  double val[BCALC_JAC_NUM_OUT]; /* results, by BCALC_JAC_B, ... */
+  double d[BCALC_JAC_NUM_OUT][BCALC_JAC_NUM_IN]; /* d val[i] / d input j */
+  int err; /* error code (BCALC_OK if the calculation succeeded) */
+  int warn; /* as in bcalcRes */
+}bcalcJac;
+
+/* parameter grid axes (see bcalcSweep) */
+#define BCALC_AXIS_ENERGY       0 /* transition energy (keV) */
+#define BCALC_AXIS_VAL          1 /* lifetime (ps, calcMode=0) or reduced transition probability (calcMode=1) */
+#define BCALC_AXIS_DELTA        2 /* mixing ratio (calcMode=0 only) */
+#define BCALC_NUM_AXES          3
+
+/* parameter grid axis with n values start + i*step, or tan(start + i*step) with start and step
+in degrees if atan is set (mixing ratio only, to scan delta over (-inf, inf)) */
+typedef struct
+{
+  double start, step;
+  size_t n; /* number of values, 0 if the parameter is not swept (the value in bcalcTrans is used) */
+  int atan;
+}bcalcAxis;
+
+/* Monte Carlo input uncertainties, as {upper, lower} (1 sigma), 0 for exact values
+the val uncertainty is in the same units as the lifetime (ps, calcMode=0) or B value (calcMode=1) */
+typedef struct
+{
+  double Et[2]; /* transition energy (keV) */
+  double val[2]; /* lifetime (ps) or reduced transition probability */
+  double branching[2]; /* branching fraction or relative intensity */
+  double icc[2]; /* internal conversion coefficient */
+  double delta[2]; /* mixing ratio */
+}bcalcUnc;
+
+/* summary of a Monte Carlo result distribution, 0 if not calculated */
+typedef struct
+{
+  double median;
+  double lo68, hi68; /* central 68.27% (1 sigma) interval */
+  double lo95, hi95; /* central 95.45% (2 sigma) interval */
+}bcalcDist;
+
+/* Monte Carlo results */
+typedef struct
+{
+  bcalcDist b, b1; /* B of the L and L+1 multipoles (calcMode=0) */
+  bcalcDist lt; /* (partial) lifetime in ps (calcMode=1) */
+  bcalcDist beta2;
+  unsigned long numSamples;
+  unsigned long numBad; /* samples with no finite result, excluded from the distributions */
+  int err;
+}bcalcMCRes;
+
+/* function prototypes */
+double dblfac(unsigned int);
+double ltsp(const int,const int,const int,const double);
+double calcBeta2(const double,const double,const int,const int,const int);
+double calcBeta2Lt(const double,const double,const int,const int);
+double calcB(const int,const int,const int,const double,const double,const double,const double,const int,const int);
+double calcLt(const int,const int,const int,const double,double,const double,const double,const int,const int,const double);
+double ltspPrec(const int,const int,const int,const double,const int);
+double calcBeta2Prec(const double,const double,const int,const int,const int,const int);
+double calcBeta2LtPrec(const double,const double,const int,const int,const int);
+double calcBPrec(const int,const int,const int,const double,const double,const double,const double,const int,const int,const int);
+double calcLtPrec(const int,const int,const int,const double,double,const double,const double,const int,const int,const double,const int);
+int bcalcParsePrecision(const char *,const size_t,int *);
+const char *bcalcPrecisionName(const int);
+void bcalcInitTrans(bcalcTrans *);
+int bcalcParseMultipole(const char *,bcalcTrans *);
+int bcalcValidate(bcalcTrans *,int *);
+int bcalcCompute(const bcalcTrans *,bcalcRes *);
+void bcalcComputeValid(const bcalcTrans *,bcalcRes *);
+const char *bcalcErrStr(const int);
+int bcalcKernelAvail(const int);
+const char *bcalcKernelName(const int);
+int bcalcComputeArrKernel(const bcalcArrIn *,bcalcArrOut *,const int);
+int bcalcComputeArr(const bcalcArrIn *,bcalcArrOut *);
+int bcalcJacobian(const bcalcTrans *,bcalcJac *);
+int bcalcJacobianArr(const bcalcArrIn *,bcalcJac *);
+double bcalcAxisVal(const bcalcAxis *,const size_t);
+int bcalcSweep(const bcalcTrans *,const bcalcAxis *,const size_t,const size_t,bcalcArrOut *);
+int bcalcIccOpen(const char *,bcalcIccTab *);
+void bcalcIccClose(bcalcIccTab *);
+int bcalcIccLookup(const bcalcIccTab *,const int,const int,const int,const double,double *);
+int bcalcIccTrans(const bcalcIccTab *,const bcalcTrans *,double *);
+int bcalcMonteCarlo(const bcalcTrans *,const bcalcUnc *,const unsigned long,const uint64_t,int,bcalcMCRes *);
+int bcalcElementZ(const char *,const size_t);
+const char *bcalcElementSym(const int);
+double bcalcNucRadius(const int,const int);
+int bcalcParseNuclide(const char *,const size_t,int *,int *);
+
+#endif
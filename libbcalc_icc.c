@@ -0,0 +1,114 @@
+/* internal conversion coefficient tables
+Tables are generated from tabulated values by mkicc, and mapped into memory.  Coefficients are
+interpolated in log(alpha) vs. log(E) using natural cubic splines, whose second derivatives are
+precomputed by mkicc.  The series for a given Z and multipole is found directly from the directory,
+and the interval containing the energy by bisection. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "libbcalc.h"
+
+/* maps a table file into memory, returns an error code */
+int bcalcIccOpen(const char *path, bcalcIccTab *tab){
+  struct stat st;
+  size_t dirSize, dataOff;
+  void *map;
+  int fd;
+
+  memset(tab,0,sizeof(bcalcIccTab));
+  if((fd = open(path,O_RDONLY)) < 0)
+    return BCALC_ERR_ICCTAB;
+  if((fstat(fd,&st) != 0)||((size_t)st.st_size < sizeof(bcalcIccHeader))){
+    close(fd);
+    return BCALC_ERR_ICCTAB;
+  }
+  map = mmap(NULL,(size_t)st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+  close(fd);
+  if(map == MAP_FAILED)
+    return BCALC_ERR_ICCTAB;
+  tab->map = map;
+  tab->mapSize = (size_t)st.st_size;
+  tab->hdr = (const bcalcIccHeader *)map;
+
+  /* check the header and sizes */
+  if((memcmp(tab->hdr->magic,BCALC_ICC_MAGIC,8) != 0)||(tab->hdr->version != BCALC_ICC_VERSION)||(tab->hdr->maxZ > 200)||(tab->hdr->maxL > 64)){
+    bcalcIccClose(tab);
+    return BCALC_ERR_ICCTAB;
+  }
+  dirSize = (size_t)(tab->hdr->maxZ + 1)*2*(tab->hdr->maxL + 1)*sizeof(bcalcIccSeries);
+  dataOff = sizeof(bcalcIccHeader) + dirSize;
+  dataOff = (dataOff + 7) & ~(size_t)7; /* align the data */
+  if(tab->mapSize != dataOff + 3*(size_t)tab->hdr->numPoints*sizeof(double)){
+    bcalcIccClose(tab);
+    return BCALC_ERR_ICCTAB;
+  }
+  tab->dir = (const bcalcIccSeries *)((const char *)map + sizeof(bcalcIccHeader));
+  tab->data = (const double *)((const char *)map + dataOff);
+  return BCALC_OK;
+}
+
+void bcalcIccClose(bcalcIccTab *tab){
+  if(tab->map != NULL)
+    munmap(tab->map,tab->mapSize);
+  memset(tab,0,sizeof(bcalcIccTab));
+}
+
+/* looks up the conversion coefficient for proton number Z, multipole (EM, L) and energy Et (keV)
+returns BCALC_ERR_ICCRANGE if there is no series or the energy is outside of it */
+int bcalcIccLookup(const bcalcIccTab *tab, const int Z, const int EM, const int L, const double Et, double *alpha){
+  const bcalcIccSeries *s;
+  const double *x, *y, *y2;
+  double lx, h, a, b;
+  int32_t lo, hi, mid;
+
+  if((tab == NULL)||(tab->hdr == NULL)||(Z < 0)||((uint32_t)Z > tab->hdr->maxZ)||(EM < 0)||(EM > 1)||(L < 0)||((uint32_t)L > tab->hdr->maxL)||!(Et > 0.))
+    return BCALC_ERR_ICCRANGE;
+  s = tab->dir + ((size_t)Z*2 + (size_t)EM)*(tab->hdr->maxL + 1) + (size_t)L;
+  if(s->n < 2)
+    return BCALC_ERR_ICCRANGE;
+  x = tab->data + 3*(size_t)s->first;
+  y = x + s->n;
+  y2 = y + s->n;
+  lx = log(Et);
+  if((lx < x[0])||(lx > x[s->n-1]))
+    return BCALC_ERR_ICCRANGE;
+
+  /* find the interval x[lo] <= lx <= x[hi] */
+  lo = 0;
+  hi = s->n - 1;
+  while(hi - lo > 1){
+    mid = (lo + hi)/2;
+    if(x[mid] > lx)
+      hi = mid;
+    else
+      lo = mid;
+  }
+
+  /* cubic spline */
+  h = x[hi] - x[lo];
+  a = (x[hi] - lx)/h;
+  b = (lx - x[lo])/h;
+  *alpha = exp(a*y[lo] + b*y[hi] + ((a*a*a - a)*y2[lo] + (b*b*b - b)*y2[hi])*(h*h)/6.0);
+  return BCALC_OK;
+}
+
+/* looks up the conversion coefficient for a transition, combining the L and L+1 multipoles
+according to the mixing ratio if there is mixing: alpha = (alpha_L + delta^2 alpha_L+1)/(1 + delta^2) */
+int bcalcIccTrans(const bcalcIccTab *tab, const bcalcTrans *t, double *alpha){
+  double a, a1, d2;
+  int err;
+  if((err = bcalcIccLookup(tab,t->nucZ,t->EM,t->L,t->Et,&a)) != BCALC_OK)
+    return err;
+  if(t->useDelta){
+    if((err = bcalcIccLookup(tab,t->nucZ,!t->EM,t->L+1,t->Et,&a1)) != BCALC_OK)
+      return err;
+    d2 = t->delta*t->delta;
+    a = (a + d2*a1)/(1.0 + d2);
+  }
+  *alpha = a;
+  return BCALC_OK;
+}
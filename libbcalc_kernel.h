@@ -0,0 +1,214 @@
+/* vectorized array kernels, included by libbcalc.c once for each vector width
+the including file defines:
+  KERNEL_NAME      -- name of the kernel function (optional)
+  KERNEL_FAST_NAME -- name of the BCALC_PREC_FAST kernel function
+  KERNEL_POW       -- name of the integer power helper function
+  KERNEL_VT        -- GCC vector type holding KERNEL_W doubles (or double, with KERNEL_W = 1)
+  KERNEL_W         -- number of doubles per vector
+  KERNEL_ATTR      -- function attributes (instruction set target)
+the operations of KERNEL_NAME mirror computeValid(), calcB() and calcLt() one for one, except that
+powers of the energy are evaluated by binary exponentiation rather than by the fixed multiplication
+chains of ipow() */
+
+/* raises each element to a positive integer power */
+KERNEL_ATTR static inline KERNEL_VT KERNEL_POW(const KERNEL_VT x, int n){
+  KERNEL_VT val = x;
+  KERNEL_VT base = x;
+  n--;
+  while(n > 0){
+    if(n & 1)
+      val *= base;
+    base *= base;
+    n >>= 1;
+  }
+  return val;
+}
+
+#ifdef KERNEL_NAME
+/* processes the first n - n%KERNEL_W elements, returns the number of elements processed */
+KERNEL_ATTR static size_t KERNEL_NAME(const bcalcArrIn *in, bcalcArrOut *out, const arrConsts *c){
+
+  const bcalcTrans *t = &in->t;
+  const size_t nv = in->n - (in->n % KERNEL_W);
+  const int L = t->L;
+  KERNEL_VT e, x, v, br, icc, d, d2, lt, lt1, b, b1, p, lt_sp;
+  size_t i;
+
+  for(i=0;i<nv;i+=KERNEL_W){
+    memcpy(&e,in->Et+i,sizeof(e));
+    memcpy(&v,in->val+i,sizeof(v));
+    e = e/1000.0; //convert energy to MeV
+    x = e/HBARC_MEVFM;
+
+    if(t->calcMode == 0){
+      /* partial lifetime */
+      if(in->branching != NULL){
+        memcpy(&br,in->branching+i,sizeof(br));
+        if(t->brrel == 1)
+          br = br/(br + 1.0);
+        lt = 1.0/((1.0/v)*br);
+      }else{
+        lt = 1.0/((1.0/v)*c->branching);
+      }
+      if(in->icc != NULL){
+        memcpy(&icc,in->icc+i,sizeof(icc));
+        lt = lt*(1.0 + icc);
+      }else{
+        lt = lt*(1.0 + t->icc);
+      }
+      /* mixing ratio */
+      if(c->useDelta){
+        if(in->delta != NULL){
+          memcpy(&d,in->delta+i,sizeof(d));
+          d2 = d*d;
+          lt1 = lt * (1.0 + d2) / d2;
+          lt = lt * (1.0 + d2);
+        }else{
+          lt1 = lt * (1.0 + c->d2) / c->d2;
+          lt = lt * (1.0 + c->d2);
+        }
+        lt1 = lt1*1.0E-12;
+
+        /* B(L+1) */
+        if(out->val1 != NULL){
+          if(t->barn == 2){
+            lt_sp = c->ltspFac1/(KERNEL_POW(e*1000.,2*L + 3)*c->aPow1);
+            b1 = lt_sp/lt1;
+          }else{
+            p = c->fac1*KERNEL_POW(x,2*L + 3);
+            b1 = 1/(p*lt1);
+            if(t->bup){
+              b1 = b1*c->sji;
+              b1 = b1/c->sjf;
+            }
+            if(t->barn == 1)
+              b1 = b1/c->barnFac1;
+          }
+          memcpy(out->val1+i,&b1,sizeof(b1));
+        }
+      }
+      lt = lt*1.0E-12;
+
+      /* B(L) */
+      if(t->barn == 2){
+        lt_sp = c->ltspFac/(KERNEL_POW(e*1000.,2*L + 1)*c->aPow);
+        b = lt_sp/lt;
+      }else{
+        p = c->fac*KERNEL_POW(x,2*L + 1);
+        b = 1/(p*lt);
+        if(t->bup){
+          b = b*c->sji;
+          b = b/c->sjf;
+        }
+        if(t->barn == 1)
+          b = b/c->barnFac;
+      }
+      memcpy(out->val+i,&b,sizeof(b));
+
+    }else{
+      /* lifetime from B */
+      b = v;
+      if(t->bup){
+        b = b*c->sjf;
+        b = b/c->sji;
+      }
+      if(t->barn == 2){
+        lt_sp = c->ltspFac/(KERNEL_POW(e*1000.,2*L + 1)*c->aPow);
+        lt_sp = lt_sp / 1.0E-12;
+        lt = lt_sp/b;
+      }else{
+        if(t->barn)
+          b = b*c->barnFac;
+        p = c->fac*KERNEL_POW(x,2*L + 1);
+        lt = 1/(p*b);
+        lt = lt / 1.0E-12;
+        if(in->branching != NULL){
+          memcpy(&br,in->branching+i,sizeof(br));
+          if(t->brrel == 1)
+            br = br/(br + 1.0);
+          lt = 1.0/((1.0/lt)*br);
+        }else{
+          lt = 1.0/((1.0/lt)*c->branching);
+        }
+      }
+      memcpy(out->val+i,&lt,sizeof(lt));
+    }
+  }
+
+  return nv;
+}
+#endif
+
+/* as KERNEL_NAME for BCALC_PREC_FAST: all constant factors (units, powers of hbar*c, spins,
+branching fraction, conversion coefficient and mixing ratio when not given per transition) are
+folded into arrConsts.kB, kB1 and kLt, so that each element takes one division instead of six */
+KERNEL_ATTR static size_t KERNEL_FAST_NAME(const bcalcArrIn *in, bcalcArrOut *out, const arrConsts *c){
+
+  const bcalcTrans *t = &in->t;
+  const size_t nv = in->n - (in->n % KERNEL_W);
+  const int L = t->L;
+  const int mixed = c->useDelta && (out->val1 != NULL);
+  KERNEL_VT e, v, br, icc, d, den, p, inv, b, b1, lt;
+  size_t i;
+
+  memset(&d,0,sizeof(d));
+
+  for(i=0;i<nv;i+=KERNEL_W){
+    memcpy(&e,in->Et+i,sizeof(e));
+    memcpy(&v,in->val+i,sizeof(v));
+    p = KERNEL_POW(e,2*L + 1);
+
+    if(t->calcMode == 0){
+      /* B = kB*br/(lt*(1 + icc)*(1 + d^2)*E^(2L+1)), B1 = kB1*br*d^2/(lt*(1 + icc)*(1 + d^2)*E^(2L+3)) */
+      den = v*p;
+      if(in->icc != NULL){
+        memcpy(&icc,in->icc+i,sizeof(icc));
+        den = den*(1.0 + icc);
+      }
+      if(c->useDelta && (in->delta != NULL)){
+        memcpy(&d,in->delta+i,sizeof(d));
+        d = d*d;
+        den = den*(1.0 + d);
+      }
+      if(in->branching != NULL){
+        memcpy(&br,in->branching+i,sizeof(br));
+        if(t->brrel == 1)
+          den = den*(br + 1.0);
+      }
+      if(mixed){
+        inv = 1.0/(den*e*e);
+        b = c->kB*inv*e*e;
+        b1 = c->kB1*inv;
+        if(in->delta != NULL)
+          b1 = b1*d;
+      }else{
+        inv = 1.0/den;
+        b = c->kB*inv;
+      }
+      if(in->branching != NULL){
+        b = b*br;
+        if(mixed)
+          b1 = b1*br;
+      }
+      memcpy(out->val+i,&b,sizeof(b));
+      if(mixed)
+        memcpy(out->val1+i,&b1,sizeof(b1));
+
+    }else{
+      /* lifetime = kLt/(B*br*E^(2L+1)) (without the branching fraction in W.u.) */
+      den = v*p;
+      if((t->barn != 2)&&(in->branching != NULL)){
+        memcpy(&br,in->branching+i,sizeof(br));
+        den = den*br;
+        lt = c->kLt/den;
+        if(t->brrel == 1)
+          lt = lt*(br + 1.0);
+      }else{
+        lt = c->kLt/den;
+      }
+      memcpy(out->val+i,&lt,sizeof(lt));
+    }
+  }
+
+  return nv;
+}
@@ -0,0 +1,396 @@
+/* Monte Carlo uncertainty propagation
+Input values are drawn from (split) normal distributions using a counter-based random number
+generator (Philox4x32-10), so that each sample depends only on the seed and the sample index.
+Samples are processed in blocks by the array calculation, spread over a number of threads.
+The result distributions are summarized using integer histograms in log space (after a first
+pass which finds their range), which makes the results independent of the number of threads. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include "libbcalc.h"
+
+#define MC_BLOCK        4096 /* samples per block */
+#define MC_NUM_BINS     262144 /* histogram bins per quantity */
+#define MC_MAX_ATTEMPTS 64 /* draws of a parameter before giving up on a physical value */
+#define MC_NUM_QTY      3 /* quantities summarized: B (or lifetime), B of L+1, beta_2 */
+
+/* parameter identifiers used in the random number generator counter */
+#define MC_PAR_ET     0
+#define MC_PAR_VAL    1
+#define MC_PAR_BR     2
+#define MC_PAR_ICC    3
+#define MC_PAR_DELTA  4
+
+typedef struct
+{
+  const bcalcTrans *t; /* validated central values */
+  const bcalcUnc *u;
+  uint64_t seed;
+  unsigned long numSamples;
+  int numQty; /* number of quantities summarized */
+  int pass; /* 0=find range, 1=histogram */
+  double min[MC_NUM_QTY], max[MC_NUM_QTY]; /* range of each quantity (from pass 0) */
+  double logMin[MC_NUM_QTY], binScale[MC_NUM_QTY]; /* histogram binning (pass 1) */
+  pthread_mutex_t lock;
+  unsigned long nextBlock; /* next block of samples to process */
+}mcCtx;
+
+/* per-thread buffers and accumulators */
+typedef struct
+{
+  mcCtx *c;
+  double Et[MC_BLOCK], val[MC_BLOCK], br[MC_BLOCK], icc[MC_BLOCK], delta[MC_BLOCK];
+  double q[MC_NUM_QTY][MC_BLOCK]; /* calculated quantities */
+  double min[MC_NUM_QTY], max[MC_NUM_QTY];
+  unsigned long *hist[MC_NUM_QTY];
+  unsigned long numBad; /* samples with a non-finite or non-positive result */
+  int err; /* error code of the first block which could not be calculated */
+}mcThread;
+
+/* Philox4x32-10 block, ctr is replaced by the random output */
+static void philox(uint32_t ctr[4], const uint64_t seed){
+  uint32_t k0 = (uint32_t)seed;
+  uint32_t k1 = (uint32_t)(seed >> 32);
+  uint64_t p0, p1;
+  int r;
+  for(r=0;r<10;r++){
+    p0 = (uint64_t)0xD2511F53u*ctr[0];
+    p1 = (uint64_t)0xCD9E8D57u*ctr[2];
+    ctr[0] = (uint32_t)(p1 >> 32) ^ ctr[1] ^ k0;
+    ctr[1] = (uint32_t)p1;
+    ctr[2] = (uint32_t)(p0 >> 32) ^ ctr[3] ^ k1;
+    ctr[3] = (uint32_t)p0;
+    k0 += 0x9E3779B9u;
+    k1 += 0xBB67AE85u;
+  }
+}
+
+/* returns a standard normal deviate for the given sample, parameter and attempt */
+static double mcNormal(const uint64_t seed, const unsigned long sample, const uint32_t par, const uint32_t attempt){
+  uint32_t ctr[4];
+  double u1, u2;
+  ctr[0] = (uint32_t)sample;
+  ctr[1] = (uint32_t)((uint64_t)sample >> 32);
+  ctr[2] = par;
+  ctr[3] = attempt;
+  philox(ctr,seed);
+  /* two 53-bit uniform deviates, u1 in (0,1] */
+  u1 = (double)((((uint64_t)ctr[0] << 21) ^ (ctr[1] >> 11)) + 1)*(1.0/9007199254740992.0);
+  u2 = (double)(((uint64_t)ctr[2] << 21) ^ (ctr[3] >> 11))*(1.0/9007199254740992.0);
+  /* Box-Muller */
+  return sqrt(-2.0*log(u1))*cos(2.0*PI*u2);
+}
+
+/* draws a value from a split normal distribution with the given central value and (upper, lower) uncertainties,
+rejecting values outside of [min,max] (or (min,max] if openMin) */
+static double mcDraw(const mcCtx *c, const unsigned long sample, const uint32_t par, const double val, const double *unc, const double min, const int openMin, const double max){
+  double z, x;
+  uint32_t a;
+  if((unc[0] == 0.)&&(unc[1] == 0.))
+    return val;
+  for(a=0;a<MC_MAX_ATTEMPTS;a++){
+    z = mcNormal(c->seed,sample,par,a);
+    x = val + ((z > 0.) ? unc[0] : unc[1])*z;
+    if(((x > min)||((x == min)&&(!openMin)))&&(x <= max))
+      return x;
+  }
+  return val;
+}
+
+/* samples the inputs and calculates the quantities for one block of samples
+returns an error code */
+static int mcBlock(mcThread *th, const unsigned long first, const size_t n){
+  const mcCtx *c = th->c;
+  const bcalcTrans *t = c->t;
+  const bcalcUnc *u = c->u;
+  const double brMax = (t->brrel == 1) ? HUGE_VAL : 1.0;
+  bcalcArrIn in;
+  bcalcArrOut out;
+  size_t i;
+  int err;
+
+  in.t = *t;
+  in.t.calcB2 = 0;
+  in.t.iccAuto = 0; /* a conversion coefficient from a table was looked up for the central values */
+  in.n = n;
+  in.Et = th->Et;
+  in.val = th->val;
+  in.branching = NULL;
+  in.icc = NULL;
+  in.delta = NULL;
+  for(i=0;i<n;i++){
+    th->Et[i] = mcDraw(c,first+i,MC_PAR_ET,t->Et,u->Et,0.,1,HUGE_VAL);
+    th->val[i] = mcDraw(c,first+i,MC_PAR_VAL,(t->calcMode == 0) ? t->lt : t->b,u->val,0.,1,HUGE_VAL);
+  }
+  if((u->branching[0] > 0.)||(u->branching[1] > 0.)){
+    for(i=0;i<n;i++)
+      th->br[i] = mcDraw(c,first+i,MC_PAR_BR,t->branching,u->branching,0.,1,brMax);
+    in.branching = th->br;
+  }
+  if((t->calcMode == 0)&&((u->icc[0] > 0.)||(u->icc[1] > 0.))){
+    for(i=0;i<n;i++)
+      th->icc[i] = mcDraw(c,first+i,MC_PAR_ICC,t->icc,u->icc,0.,0,HUGE_VAL);
+    in.icc = th->icc;
+  }
+  if((t->calcMode == 0)&&(t->useDelta)&&((u->delta[0] > 0.)||(u->delta[1] > 0.))){
+    for(i=0;i<n;i++)
+      th->delta[i] = mcDraw(c,first+i,MC_PAR_DELTA,t->delta,u->delta,-HUGE_VAL,0,HUGE_VAL);
+    in.delta = th->delta;
+  }
+
+  out.val = th->q[0];
+  out.val1 = th->q[1];
+  if((err = bcalcComputeArr(&in,&out)) != BCALC_OK)
+    return err;
+
+  if(t->calcB2){
+    /* beta_2 from B(E2) in e^2 fm^4, or from the input B value */
+    if(t->calcMode == 0){
+      if((t->barn != 0)||(t->bup != 0)){
+        in.t.barn = 0;
+        in.t.bup = 0;
+        out.val = th->q[2];
+        out.val1 = NULL;
+        if((err = bcalcComputeArr(&in,&out)) != BCALC_OK)
+          return err;
+      }else{
+        memcpy(th->q[2],th->q[0],n*sizeof(double));
+      }
+      for(i=0;i<n;i++)
+        th->q[2][i] = calcBeta2Prec(th->Et[i]/1000.0,th->q[2][i],t->nucA,t->nucZ,0,t->precision);
+    }else{
+      for(i=0;i<n;i++)
+        th->q[2][i] = calcBeta2Prec(th->Et[i]/1000.0,th->val[i],t->nucA,t->nucZ,t->barn,t->precision);
+    }
+  }
+  return BCALC_OK;
+}
+
+/* accumulates the range (pass 0) or histogram (pass 1) of a block of samples */
+static void mcAccum(mcThread *th, const size_t n){
+  const mcCtx *c = th->c;
+  size_t i;
+  int j;
+  double x, b;
+  for(j=0;j<c->numQty;j++){
+    if((j == 1)&&(!c->t->useDelta || (c->t->calcMode != 0)))
+      continue;
+    if((j == 2)&&(!c->t->calcB2))
+      continue;
+    for(i=0;i<n;i++){
+      x = th->q[j][i];
+      if(!(x > 0.)||isinf(x)){
+        if(j == 0)
+          th->numBad++;
+        continue;
+      }
+      if(c->pass == 0){
+        if(x < th->min[j])
+          th->min[j] = x;
+        if(x > th->max[j])
+          th->max[j] = x;
+      }else{
+        b = (log(x) - c->logMin[j])*c->binScale[j];
+        if(b < 0.)
+          b = 0.;
+        if(b > MC_NUM_BINS-1)
+          b = MC_NUM_BINS-1;
+        th->hist[j][(size_t)b]++;
+      }
+    }
+  }
+}
+
+static void *mcWorker(void *arg){
+  mcThread *th = (mcThread *)arg;
+  mcCtx *c = th->c;
+  unsigned long block, first;
+  size_t n;
+  for(;;){
+    pthread_mutex_lock(&c->lock);
+    block = c->nextBlock++;
+    pthread_mutex_unlock(&c->lock);
+    first = block*MC_BLOCK;
+    if(first >= c->numSamples)
+      break;
+    n = (c->numSamples - first < MC_BLOCK) ? (size_t)(c->numSamples - first) : MC_BLOCK;
+    if((th->err = mcBlock(th,first,n)) != BCALC_OK)
+      break;
+    mcAccum(th,n);
+  }
+  return NULL;
+}
+
+/* runs one pass over all samples using numThreads threads */
+static int mcPass(mcCtx *c, mcThread *th, const int numThreads){
+  pthread_t *threads;
+  int i;
+  c->nextBlock = 0;
+  if(numThreads == 1){
+    mcWorker(&th[0]);
+    return BCALC_OK;
+  }
+  if((threads = malloc((size_t)numThreads*sizeof(pthread_t))) == NULL)
+    return BCALC_ERR_MEMORY;
+  for(i=0;i<numThreads;i++){
+    if(pthread_create(&threads[i],NULL,mcWorker,&th[i]) != 0){
+      /* run the rest of the pass with the threads already started */
+      break;
+    }
+  }
+  if(i == 0)
+    mcWorker(&th[0]);
+  while(i > 0)
+    pthread_join(threads[--i],NULL);
+  free(threads);
+  return BCALC_OK;
+}
+
+/* returns the error code of the first thread which could not calculate a block, or BCALC_OK */
+static int mcPassErr(const mcThread *th, const int numThreads){
+  int i;
+  for(i=0;i<numThreads;i++){
+    if(th[i].err != BCALC_OK)
+      return th[i].err;
+  }
+  return BCALC_OK;
+}
+
+/* finds a quantile of a histogrammed distribution, interpolating (in log space) within a bin */
+static double mcQuantile(const unsigned long *hist, const unsigned long total, const double logMin, const double binScale, const double q){
+  double target = q*(double)total;
+  double cum = 0.;
+  double frac;
+  size_t b;
+  for(b=0;b<MC_NUM_BINS;b++){
+    if((hist[b] > 0)&&(cum + (double)hist[b] >= target)){
+      frac = (target - cum)/(double)hist[b];
+      return exp(logMin + ((double)b + frac)/binScale);
+    }
+    cum += (double)hist[b];
+  }
+  return exp(logMin + (double)MC_NUM_BINS/binScale);
+}
+
+/* propagates the uncertainties u of the parameters in t to the calculated quantities
+using numSamples Monte Carlo samples (numThreads <= 0 uses 1 thread)
+the results only depend on the seed, not on the number of threads
+returns an error code (also stored in r) */
+int bcalcMonteCarlo(const bcalcTrans *t, const bcalcUnc *u, const unsigned long numSamples, const uint64_t seed, int numThreads, bcalcMCRes *r){
+
+  bcalcTrans tv = *t;
+  mcCtx c;
+  mcThread *th;
+  bcalcDist *dist[MC_NUM_QTY];
+  unsigned long total;
+  int i, j, k, warn;
+  double min, max;
+
+  memset(r,0,sizeof(bcalcMCRes));
+  if((r->err = bcalcValidate(&tv,&warn)) != BCALC_OK)
+    return r->err;
+  for(i=0;i<2;i++){
+    if((u->Et[i] < 0.)||(u->val[i] < 0.)||(u->branching[i] < 0.)||(u->icc[i] < 0.)||(u->delta[i] < 0.))
+      return (r->err = BCALC_ERR_UNC);
+  }
+  if(numSamples == 0)
+    return (r->err = BCALC_ERR_UNC);
+  if(numThreads <= 0)
+    numThreads = 1;
+  if((unsigned long)numThreads > numSamples/MC_BLOCK + 1)
+    numThreads = (int)(numSamples/MC_BLOCK + 1);
+
+  c.t = &tv;
+  c.u = u;
+  c.seed = seed;
+  c.numSamples = numSamples;
+  c.numQty = MC_NUM_QTY;
+  pthread_mutex_init(&c.lock,NULL);
+
+  if((th = calloc((size_t)numThreads,sizeof(mcThread))) == NULL){
+    pthread_mutex_destroy(&c.lock);
+    return (r->err = BCALC_ERR_MEMORY);
+  }
+  for(i=0;i<numThreads;i++){
+    th[i].c = &c;
+    for(j=0;j<MC_NUM_QTY;j++){
+      th[i].min[j] = HUGE_VAL;
+      th[i].max[j] = 0.;
+      if((th[i].hist[j] = calloc(MC_NUM_BINS,sizeof(unsigned long))) == NULL){
+        r->err = BCALC_ERR_MEMORY;
+      }
+    }
+  }
+
+  if(r->err == BCALC_OK){
+    /* pass 0: range of each quantity */
+    c.pass = 0;
+    mcPass(&c,th,numThreads);
+    r->err = mcPassErr(th,numThreads);
+  }
+  if(r->err == BCALC_OK){
+    for(j=0;j<MC_NUM_QTY;j++){
+      min = HUGE_VAL;
+      max = 0.;
+      for(i=0;i<numThreads;i++){
+        if(th[i].min[j] < min)
+          min = th[i].min[j];
+        if(th[i].max[j] > max)
+          max = th[i].max[j];
+      }
+      if(!(max > 0.)){
+        min = max = 1.;
+      }
+      c.min[j] = min;
+      c.max[j] = max;
+      c.logMin[j] = log(min);
+      c.binScale[j] = (max > min) ? (MC_NUM_BINS - 1)/(log(max) - c.logMin[j]) : 1.;
+    }
+
+    /* pass 1: histograms */
+    for(i=0;i<numThreads;i++)
+      th[i].numBad = 0;
+    c.pass = 1;
+    mcPass(&c,th,numThreads);
+    r->err = mcPassErr(th,numThreads);
+  }
+  if(r->err == BCALC_OK){
+    /* merge and summarize */
+    dist[0] = (tv.calcMode == 0) ? &r->b : &r->lt;
+    dist[1] = &r->b1;
+    dist[2] = &r->beta2;
+    r->numSamples = numSamples;
+    for(i=0;i<numThreads;i++)
+      r->numBad += th[i].numBad;
+    for(j=0;j<MC_NUM_QTY;j++){
+      total = 0;
+      for(i=1;i<numThreads;i++){
+        for(k=0;k<MC_NUM_BINS;k++)
+          th[0].hist[j][k] += th[i].hist[j][k];
+      }
+      for(k=0;k<MC_NUM_BINS;k++)
+        total += th[0].hist[j][k];
+      if(total == 0)
+        continue;
+      if(c.min[j] == c.max[j]){
+        /* no spread (no uncertainties which affect this quantity) */
+        dist[j]->median = dist[j]->lo68 = dist[j]->hi68 = dist[j]->lo95 = dist[j]->hi95 = c.min[j];
+        continue;
+      }
+      dist[j]->median = mcQuantile(th[0].hist[j],total,c.logMin[j],c.binScale[j],0.5);
+      dist[j]->lo68 = mcQuantile(th[0].hist[j],total,c.logMin[j],c.binScale[j],0.158655);
+      dist[j]->hi68 = mcQuantile(th[0].hist[j],total,c.logMin[j],c.binScale[j],0.841345);
+      dist[j]->lo95 = mcQuantile(th[0].hist[j],total,c.logMin[j],c.binScale[j],0.02275);
+      dist[j]->hi95 = mcQuantile(th[0].hist[j],total,c.logMin[j],c.binScale[j],0.97725);
+    }
+  }
+
+  for(i=0;i<numThreads;i++){
+    for(j=0;j<MC_NUM_QTY;j++)
+      free(th[i].hist[j]);
+  }
+  free(th);
+  pthread_mutex_destroy(&c.lock);
+  return r->err;
+}
@@ -0,0 +1,80 @@
+/* nuclide database
+Element symbols and nuclides (with measured RMS charge radii) are compiled in from nuclides.dat,
+as perfect hash tables generated by mknuc: a lookup hashes the key once and compares a single
+slot, so no parsing or file I/O is needed at runtime. */
+
+#include "libbcalc.h"
+#include "libbcalc_nuc.h"
+
+static uint32_t symKey(const char *sym, const size_t len){
+  uint32_t key = (uint32_t)toupper((unsigned char)sym[0]);
+  if(len == 2)
+    key |= (uint32_t)toupper((unsigned char)sym[1]) << 8;
+  return key;
+}
+
+/* returns Z for an element symbol of length len (case insensitive), or 0 if unknown */
+int bcalcElementZ(const char *sym, const size_t len){
+  uint32_t key, h;
+  if((len < 1)||(len > 2))
+    return 0;
+  key = symKey(sym,len);
+  h = (key*NUC_ELEM_MULT) >> (32 - NUC_ELEM_BITS);
+  if(nucElemKey[h] != key)
+    return 0;
+  return nucElemZ[h];
+}
+
+/* returns the element symbol for Z, or NULL if out of range */
+const char *bcalcElementSym(const int Z){
+  if((Z < 1)||(Z > BCALC_NUC_MAXZ))
+    return NULL;
+  return nucElemSym[Z];
+}
+
+/* returns the measured RMS charge radius (fm) of a nuclide, or 0 if not tabulated */
+double bcalcNucRadius(const int A, const int Z){
+  uint32_t key, h;
+  if((A < 1)||(A > BCALC_NUC_MAXA)||(Z < 1)||(Z > BCALC_NUC_MAXZ))
+    return 0.;
+  key = ((uint32_t)Z << 10) | (uint32_t)A;
+  h = (key*NUC_MULT) >> (32 - NUC_BITS);
+  if(nucKey[h] != key)
+    return 0.;
+  return nucRms[h];
+}
+
+/* parses a nuclide name of length len, eg. 152Sm, 152SM, Sm152 or Sm-152, into A and Z
+returns an error code */
+int bcalcParseNuclide(const char *str, const size_t len, int *A, int *Z){
+  size_t i = 0, symStart, symLen = 0;
+  int a = 0, numDigits = 0, z;
+
+  if((len > 0)&&(isdigit((unsigned char)str[0]))){
+    /* mass number first */
+    for(;(i<len)&&(isdigit((unsigned char)str[i]));i++,numDigits++)
+      a = (numDigits < 5) ? 10*a + (str[i] - '0') : BCALC_NUC_MAXA + 1;
+    if((i<len)&&(str[i] == '-'))
+      i++;
+    symStart = i;
+    for(;(i<len)&&(isalpha((unsigned char)str[i]));i++,symLen++);
+  }else{
+    /* element symbol first */
+    symStart = 0;
+    for(;(i<len)&&(isalpha((unsigned char)str[i]));i++,symLen++);
+    if((i<len)&&(str[i] == '-'))
+      i++;
+    for(;(i<len)&&(isdigit((unsigned char)str[i]));i++,numDigits++)
+      a = (numDigits < 5) ? 10*a + (str[i] - '0') : BCALC_NUC_MAXA + 1;
+  }
+  if((i != len)||(numDigits == 0)||(a < 1)||(a > BCALC_NUC_MAXA))
+    return BCALC_ERR_NUCLIDE;
+  z = bcalcElementZ(str + symStart,symLen);
+  if(z == 0)
+    return BCALC_ERR_NUCLIDE;
+  if(a < z)
+    return BCALC_ERR_ALTZ;
+  *A = a;
+  *Z = z;
+  return BCALC_OK;
+}
@@ -0,0 +1,155 @@
+/* mkicc: builds a binary internal conversion coefficient table for bcalc from tabulated values
+usage: mkicc INPUT OUTPUT
+Each line of the input has the columns: Z multipole energy(keV) alpha
+(eg. '62 E2 121.78 1.144', with alpha the total conversion coefficient summed over all shells).
+Blank lines and lines starting with '#' are ignored.  Points may be in any order, at least 2
+points are needed for each Z and multipole. */
+
+#include <stdio.h>
+#include "libbcalc.h"
+
+#define MKICC_MAXZ 120
+
+typedef struct
+{
+  int Z, EM, L;
+  double x, y; /* log(E), log(alpha) */
+}iccPoint;
+
+static int cmpPoint(const void *a, const void *b){
+  const iccPoint *p = (const iccPoint *)a;
+  const iccPoint *q = (const iccPoint *)b;
+  if(p->Z != q->Z)
+    return p->Z - q->Z;
+  if(p->EM != q->EM)
+    return p->EM - q->EM;
+  if(p->L != q->L)
+    return p->L - q->L;
+  return (p->x > q->x) - (p->x < q->x);
+}
+
+/* computes the second derivatives of the natural cubic spline through (x,y) */
+static void splineDeriv(const double *x, const double *y, const int n, double *y2, double *u){
+  double sig, p;
+  int i;
+  y2[0] = u[0] = 0.;
+  for(i=1;i<n-1;i++){
+    sig = (x[i] - x[i-1])/(x[i+1] - x[i-1]);
+    p = sig*y2[i-1] + 2.0;
+    y2[i] = (sig - 1.0)/p;
+    u[i] = (y[i+1] - y[i])/(x[i+1] - x[i]) - (y[i] - y[i-1])/(x[i] - x[i-1]);
+    u[i] = (6.0*u[i]/(x[i+1] - x[i-1]) - sig*u[i-1])/p;
+  }
+  y2[n-1] = 0.;
+  for(i=n-2;i>=0;i--)
+    y2[i] = y2[i]*y2[i+1] + u[i];
+}
+
+int main(int argc, char *argv[]){
+
+  FILE *in, *out;
+  char line[256], mstr[16];
+  iccPoint *pts = NULL, *np;
+  size_t numPts = 0, cap = 0, i, j, k, dirLen, dataOff;
+  bcalcIccHeader hdr;
+  bcalcIccSeries *dir;
+  double *data, *u;
+  double E, alpha;
+  unsigned long lineNum = 0;
+  bcalcTrans t;
+  int Z, n;
+  const char pad[8] = {0};
+
+  if(argc != 3){
+    printf("usage: mkicc INPUT OUTPUT\n");
+    printf("INPUT lines: Z multipole energy(keV) alpha\n");
+    return -1;
+  }
+  if((in = fopen(argv[1],"r")) == NULL){
+    printf("ERROR: Cannot open %s.\n",argv[1]);
+    return -1;
+  }
+  while(fgets(line,sizeof(line),in) != NULL){
+    lineNum++;
+    if((line[strspn(line," \t\r\n")] == '\0')||(line[strspn(line," \t")] == '#'))
+      continue;
+    if((sscanf(line,"%i %15s %lf %lf",&Z,mstr,&E,&alpha) != 4)||(Z < 0)||(Z > MKICC_MAXZ)||(bcalcParseMultipole(mstr,&t) != BCALC_OK)||(t.L > BCALC_MAXL+1)||!(E > 0.)||!(alpha > 0.)){
+      printf("ERROR: line %lu: expected 'Z multipole energy alpha' with positive values.\n",lineNum);
+      return -1;
+    }
+    if(numPts >= cap){
+      cap = (cap > 0) ? cap*2 : 1024;
+      if((np = realloc(pts,cap*sizeof(iccPoint))) == NULL){
+        printf("ERROR: Cannot allocate memory.\n");
+        return -1;
+      }
+      pts = np;
+    }
+    pts[numPts].Z = Z;
+    pts[numPts].EM = t.EM;
+    pts[numPts].L = t.L;
+    pts[numPts].x = log(E);
+    pts[numPts].y = log(alpha);
+    numPts++;
+  }
+  fclose(in);
+  qsort(pts,numPts,sizeof(iccPoint),cmpPoint);
+
+  memset(&hdr,0,sizeof(hdr));
+  memcpy(hdr.magic,BCALC_ICC_MAGIC,8);
+  hdr.version = BCALC_ICC_VERSION;
+  hdr.maxZ = MKICC_MAXZ;
+  hdr.maxL = BCALC_MAXL+1;
+  hdr.numPoints = (uint32_t)numPts;
+  dirLen = (size_t)(hdr.maxZ + 1)*2*(hdr.maxL + 1);
+  dir = calloc(dirLen,sizeof(bcalcIccSeries));
+  data = malloc((3*numPts + 1)*sizeof(double));
+  u = malloc((numPts + 1)*sizeof(double));
+  if((dir == NULL)||(data == NULL)||(u == NULL)){
+    printf("ERROR: Cannot allocate memory.\n");
+    return -1;
+  }
+
+  /* one series per Z and multipole */
+  for(i=0;i<numPts;i=j){
+    for(j=i+1;(j<numPts)&&(pts[j].Z == pts[i].Z)&&(pts[j].EM == pts[i].EM)&&(pts[j].L == pts[i].L);j++){
+      if(pts[j].x == pts[j-1].x){
+        printf("ERROR: Duplicate energy for Z = %i, %s%i.\n",pts[i].Z,pts[i].EM ? "M" : "E",pts[i].L);
+        return -1;
+      }
+    }
+    n = (int)(j - i);
+    if(n < 2){
+      printf("ERROR: At least 2 points are needed for Z = %i, %s%i.\n",pts[i].Z,pts[i].EM ? "M" : "E",pts[i].L);
+      return -1;
+    }
+    k = ((size_t)pts[i].Z*2 + (size_t)pts[i].EM)*(hdr.maxL + 1) + (size_t)pts[i].L;
+    dir[k].first = (int32_t)i;
+    dir[k].n = n;
+    for(k=0;k<(size_t)n;k++){
+      data[3*i + k] = pts[i+k].x;
+      data[3*i + (size_t)n + k] = pts[i+k].y;
+    }
+    splineDeriv(data + 3*i,data + 3*i + (size_t)n,n,data + 3*i + 2*(size_t)n,u);
+  }
+
+  if((out = fopen(argv[2],"wb")) == NULL){
+    printf("ERROR: Cannot write %s.\n",argv[2]);
+    return -1;
+  }
+  dataOff = sizeof(hdr) + dirLen*sizeof(bcalcIccSeries);
+  fwrite(&hdr,sizeof(hdr),1,out);
+  fwrite(dir,sizeof(bcalcIccSeries),dirLen,out);
+  fwrite(pad,1,((dataOff + 7) & ~(size_t)7) - dataOff,out);
+  fwrite(data,sizeof(double),3*numPts,out);
+  if(fclose(out) != 0){
+    printf("ERROR: Cannot write %s.\n",argv[2]);
+    return -1;
+  }
+  printf("Wrote %lu points to %s.\n",(unsigned long)numPts,argv[2]);
+  free(pts);
+  free(dir);
+  free(data);
+  free(u);
+  return 0;
+}
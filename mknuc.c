@@ -0,0 +1,143 @@
+/* generates libbcalc_nuc.h from the nuclide list (nuclides.dat): perfect hash tables of element
+symbols and of nuclides (with their charge radii), used by libbcalc_nuc.c
+each table has a multiplicative hash, h = (key*mult) >> (32 - bits), with the multiplier searched
+for here so that no two keys collide (lookups are then a single probe) */
+
+#include <stdio.h>
+#include "libbcalc.h"
+
+#define MKNUC_MAX_KEYS 4096
+#define MKNUC_MAX_BITS 16
+
+uint32_t elemKey(const char *);
+int findMult(const uint32_t *, const int, int *, uint32_t *);
+
+/* key of an element symbol (as in libbcalc_nuc.c) */
+uint32_t elemKey(const char *sym){
+  return (uint32_t)toupper((unsigned char)sym[0]) | ((sym[1] != '\0') ? (uint32_t)toupper((unsigned char)sym[1]) << 8 : 0U);
+}
+
+/* finds the smallest table size (2^bits, at least twice the number of keys) and a multiplier
+for which no keys collide, returns 0 on success */
+int findMult(const uint32_t *key, const int n, int *bits, uint32_t *mult){
+  static unsigned char used[1 << MKNUC_MAX_BITS];
+  uint64_t s = 1;
+  uint32_t m, h;
+  int b, i, tries;
+  for(b=1;(1 << b)<2*n;b++);
+  for(;b<=MKNUC_MAX_BITS;b++){
+    for(tries=0;tries<100000;tries++){
+      s = s*6364136223846793005ULL + 1442695040888963407ULL;
+      m = (uint32_t)(s >> 32) | 1U;
+      memset(used,0,(size_t)1 << b);
+      for(i=0;i<n;i++){
+        h = (key[i]*m) >> (32 - b);
+        if(used[h])
+          break;
+        used[h] = 1;
+      }
+      if(i == n){
+        *bits = b;
+        *mult = m;
+        return 0;
+      }
+    }
+  }
+  return -1;
+}
+
+int main(int argc, char *argv[]){
+
+  static uint32_t elKey[MKNUC_MAX_KEYS], nucKey[MKNUC_MAX_KEYS];
+  static uint32_t elTab[1 << MKNUC_MAX_BITS], nucTab[1 << MKNUC_MAX_BITS];
+  static int elTabZ[1 << MKNUC_MAX_BITS];
+  static double nucTabR[1 << MKNUC_MAX_BITS];
+  static int elZ[MKNUC_MAX_KEYS];
+  static double nucR[MKNUC_MAX_KEYS];
+  static char sym[BCALC_NUC_MAXZ+1][4];
+  char line[256], kind[8], s[8];
+  int numEl = 0, numNuc = 0, lineNum = 0;
+  int elBits, nucBits, i, A, Z;
+  uint32_t elMult, nucMult, k;
+  double r;
+  FILE *f;
+
+  if(argc < 2){
+    printf("usage: mknuc nuclides.dat > libbcalc_nuc.h\n");
+    return -1;
+  }
+  if((f = fopen(argv[1],"r")) == NULL){
+    fprintf(stderr,"ERROR: Cannot open %s.\n",argv[1]);
+    return -1;
+  }
+  while(fgets(line,sizeof(line),f) != NULL){
+    lineNum++;
+    if((line[0] == '#')||(sscanf(line,"%7s",kind) != 1))
+      continue;
+    if((strcmp(kind,"el") == 0)&&(sscanf(line,"%*s %i %7s",&Z,s) == 2)&&(Z > 0)&&(Z <= BCALC_NUC_MAXZ)&&(strlen(s) <= 2)&&(sym[Z][0] == '\0')&&(numEl < MKNUC_MAX_KEYS)){
+      strcpy(sym[Z],s);
+      elKey[numEl] = elemKey(s);
+      elZ[numEl++] = Z;
+    }else if((strcmp(kind,"nuc") == 0)&&(sscanf(line,"%*s %i %7s %lf",&A,s,&r) == 3)&&(A > 0)&&(A <= BCALC_NUC_MAXA)&&(r > 0.)&&(numNuc < MKNUC_MAX_KEYS)){
+      k = elemKey(s);
+      for(i=0;(i<numEl)&&(elKey[i] != k);i++);
+      if(i == numEl){
+        fprintf(stderr,"ERROR: %s line %i: unknown element %s.\n",argv[1],lineNum,s);
+        return -1;
+      }
+      nucKey[numNuc] = ((uint32_t)elZ[i] << 10) | (uint32_t)A;
+      nucR[numNuc++] = r;
+    }else{
+      fprintf(stderr,"ERROR: %s line %i: invalid or duplicate entry.\n",argv[1],lineNum);
+      return -1;
+    }
+  }
+  fclose(f);
+
+  if((findMult(elKey,numEl,&elBits,&elMult) != 0)||(findMult(nucKey,numNuc,&nucBits,&nucMult) != 0)){
+    fprintf(stderr,"ERROR: Cannot find a perfect hash (duplicate entries?).\n");
+    return -1;
+  }
+  for(i=0;i<numEl;i++){
+    k = (elKey[i]*elMult) >> (32 - elBits);
+    elTab[k] = elKey[i];
+    elTabZ[k] = elZ[i];
+  }
+  for(i=0;i<numNuc;i++){
+    k = (nucKey[i]*nucMult) >> (32 - nucBits);
+    nucTab[k] = nucKey[i];
+    nucTabR[k] = nucR[i];
+  }
+
+  printf("/* generated by mknuc from the nuclide list, do not edit */\n\n");
+  printf("/* element symbols, indexed by Z */\n");
+  printf("static const char nucElemSym[%i][3] = {\"\"",BCALC_NUC_MAXZ+1);
+  for(Z=1;Z<=BCALC_NUC_MAXZ;Z++)
+    printf(",%s\"%s\"",(Z % 16 == 0) ? "\n  " : "",sym[Z]);
+  printf("};\n\n");
+
+  printf("/* element symbol keys (0 = empty) and Z, %i symbols */\n",numEl);
+  printf("#define NUC_ELEM_BITS %i\n",elBits);
+  printf("#define NUC_ELEM_MULT 0x%08xU\n",elMult);
+  printf("static const uint16_t nucElemKey[%i] = {",1 << elBits);
+  for(i=0;i<(1 << elBits);i++)
+    printf("%s%s0x%x",(i > 0) ? "," : "",(i % 16 == 0) ? "\n  " : "",elTab[i]);
+  printf("};\n");
+  printf("static const uint8_t nucElemZ[%i] = {",1 << elBits);
+  for(i=0;i<(1 << elBits);i++)
+    printf("%s%s%i",(i > 0) ? "," : "",(i % 16 == 0) ? "\n  " : "",elTabZ[i]);
+  printf("};\n\n");
+
+  printf("/* nuclide keys (Z << 10 | A, 0 = empty) and RMS charge radii (fm), %i nuclides */\n",numNuc);
+  printf("#define NUC_BITS %i\n",nucBits);
+  printf("#define NUC_MULT 0x%08xU\n",nucMult);
+  printf("static const uint32_t nucKey[%i] = {",1 << nucBits);
+  for(i=0;i<(1 << nucBits);i++)
+    printf("%s%s0x%x",(i > 0) ? "," : "",(i % 12 == 0) ? "\n  " : "",nucTab[i]);
+  printf("};\n");
+  printf("static const double nucRms[%i] = {",1 << nucBits);
+  for(i=0;i<(1 << nucBits);i++)
+    printf("%s%s%.4f",(i > 0) ? "," : "",(i % 12 == 0) ? "\n  " : "",nucTabR[i]);
+  printf("};\n");
+  return 0;
+}
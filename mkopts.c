@@ -0,0 +1,60 @@
+/* generates opthash.h from the option table (opttab.h): a perfect hash of the option names,
+h = (optHash(name)*mult) >> (32 - bits), with the multiplier searched for here so that no two
+names collide (as for the nuclide tables made by mknuc) */
+
+#include "bcalc.h"
+#include "opttab.h"
+
+#define MKOPTS_MAX_BITS 12
+
+int main(void){
+
+  static unsigned char slot[1 << MKOPTS_MAX_BITS];
+  uint32_t key[OPT_TAB_LEN];
+  uint64_t s = 1;
+  uint32_t m = 0, h;
+  size_t i, j;
+  int b, tries, ok = 0;
+
+  for(i=0;i<OPT_TAB_LEN;i++){
+    for(j=0;j<i;j++){
+      if(strcmp(optTab[i].name,optTab[j].name) == 0){
+        fprintf(stderr,"ERROR: Duplicate option %s.\n",optTab[i].name);
+        return -1;
+      }
+    }
+    key[i] = optHash(optTab[i].name,strlen(optTab[i].name));
+  }
+
+  /* smallest table (at least twice the number of options) with a multiplier giving no collisions */
+  for(b=1;(1U << b)<2*OPT_TAB_LEN;b++);
+  for(;(b<=MKOPTS_MAX_BITS)&&(!ok);b++){
+    for(tries=0;(tries<100000)&&(!ok);tries++){
+      s = s*6364136223846793005ULL + 1442695040888963407ULL;
+      m = (uint32_t)(s >> 32) | 1U;
+      memset(slot,0,sizeof(slot));
+      for(i=0;i<OPT_TAB_LEN;i++){
+        h = (key[i]*m) >> (32 - b);
+        if(slot[h])
+          break;
+        slot[h] = (unsigned char)(i + 1);
+      }
+      ok = (i == OPT_TAB_LEN);
+    }
+  }
+  if(!ok){
+    fprintf(stderr,"ERROR: Cannot find a perfect hash of the option names.\n");
+    return -1;
+  }
+  b--;
+
+  printf("/* generated by mkopts from the option table, do not edit */\n\n");
+  printf("/* slots of the option hash table: index in optTab + 1 (0 = empty), %i options */\n",(int)OPT_TAB_LEN);
+  printf("#define OPT_HASH_BITS %i\n",b);
+  printf("#define OPT_HASH_MULT 0x%08xU\n",m);
+  printf("static const uint8_t optSlot[%i] = {",1 << b);
+  for(i=0;i<(1U << b);i++)
+    printf("%s%s%i",(i > 0) ? "," : "",(i % 16 == 0) ? "\n  " : "",slot[i]);
+  printf("};\n");
+  return 0;
+}
@@ -0,0 +1,90 @@
+/* generates libbcalc_tables.h, which holds the per-multipole constant factors used by libbcalc
+the factors are evaluated here (at build time) using the same expressions as the original per-call calculations */
+
+#include <stdio.h>
+#include "libbcalc.h"
+
+double dfac(int);
+void printVal(const double);
+void printTable(const char *, const char *, double (*)(const int, const int));
+double bFacVal(const int, const int);
+double ltspFacVal(const int, const int);
+double barnFacVal(const int, const int);
+
+double dfac(int n){
+  double val = 1.0;
+  for(;n>1;n-=2){
+    val *= n;
+  }
+  return val;
+}
+
+/* 8*pi*(L+1)/(L*hbar*((2L+1)!!)^2*ln2), times uN^2/e^2 for magnetic multipoles */
+double bFacVal(const int EM, const int L){
+  double fac = 8.0*PI*(L+1)/(L*HBAR_MEVS*pow(dfac(2*L + 1),2.0)*LN2);
+  if(EM==1){
+    fac = fac * UN_MEVFM3/ESQ_MEVFM;
+  }
+  return fac;
+}
+
+/* single particle lifetime (in s), without the energy and mass number dependence */
+double ltspFacVal(const int EM, const int L){
+  double hl_sp = 0.;
+  double hbar = 6.58212E-19; /* keV s */
+  double hbarc = 197.327E-10; /* keV cm */
+  double esq = 1.440E-10; /* kev cm */
+  double muNsq = 1.5922E-38; /* keV cm^3 */
+  double RFac = 1.2E-13; /* cm */
+  if(EM == 0){
+    hl_sp = log(2.0)*L*pow(dfac(2*L + 1),2.0)*hbar*pow(((3.0+L)/3.0),2.0)*pow(hbarc,2*L + 1)/(2.0*(L + 1.0)*esq*pow(RFac,2.0*L));
+  }else{
+    hl_sp = log(2.0)*L*pow(dfac(2*L + 1),2.0)*hbar*pow(((3.0+L)/3.0),2.0)*pow(hbarc,2*L + 1)/(80.0*(L + 1.0)*muNsq*pow(RFac,2.0*L - 2.0));
+  }
+  return hl_sp/LN2;
+}
+
+/* fm^2 per barn, raised to the power of the spatial dimension of B */
+double barnFacVal(const int EM, const int L){
+  if(EM==0){
+    return pow(BARN_FM,L);
+  }else{
+    return pow(BARN_FM,L-1);
+  }
+}
+
+void printVal(const double val){
+  if(isinf(val)){
+    printf("HUGE_VAL");
+  }else{
+    printf("%a",val);
+  }
+}
+
+void printTable(const char *name, const char *desc, double (*fn)(const int, const int)){
+  int EM, L;
+  printf("/* %s */\n",desc);
+  printf("static const double %s[2][BCALC_MAXL+2] = {\n",name);
+  for(EM=0;EM<2;EM++){
+    printf("  {");
+    for(L=0;L<=BCALC_MAXL+1;L++){
+      printVal(fn(EM,L));
+      if(L<=BCALC_MAXL)
+        printf(",");
+    }
+    printf("}");
+    if(EM==0)
+      printf(",");
+    printf("\n");
+  }
+  printf("};\n\n");
+}
+
+int main(void){
+  printf("/* per-multipole constant factors, indexed by [EM][L] */\n");
+  printf("/* generated by mktables, do not edit */\n\n");
+  printTable("bFac","8*pi*(L+1)/(L*hbar*((2L+1)!!)^2*ln2), times uN^2/e^2 for magnetic multipoles",bFacVal);
+  printTable("ltspFac","single particle lifetime (s) for E = 1 keV and A = 1",ltspFacVal);
+  printTable("barnFac","fm^(2L) per b^L (electric) or fm^(2L-2) per b^(L-1) (magnetic)",barnFacVal);
+  return 0;
+}
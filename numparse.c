@@ -0,0 +1,117 @@
+/* fast conversion of decimal numbers
+Most input values have few significant digits and small exponents, these are converted exactly
+using a single floating point multiplication or division of exactly representable values (Clinger's
+fast path), which gives the correctly rounded result.  Anything else is handed to strtod, so the
+result is always identical to strtod. */
+
+#include <stdint.h>
+#include "bcalc.h"
+
+#define NUM_MAX_DIGITS  19 /* significant digits which always fit in 64 bits */
+#define NUM_MAX_MANT    9007199254740992ULL /* 2^53, largest exactly representable mantissa */
+#define NUM_MAX_COPY    64 /* length of numbers copied to the stack for strtod */
+
+static const double pow10tab[23] = {1e0,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9,1e10,1e11,
+  1e12,1e13,1e14,1e15,1e16,1e17,1e18,1e19,1e20,1e21,1e22};
+
+/* converts the whole of str (len characters, not NUL terminated) using strtod
+returns 1 on success, 0 if str is not a valid number */
+static int parseDoubleSlow(const char *str, const size_t len, double *val){
+  char buf[NUM_MAX_COPY];
+  char *copy = buf;
+  char *vend;
+  int ok;
+  if(len >= NUM_MAX_COPY){
+    if((copy = malloc(len+1)) == NULL)
+      return 0;
+  }
+  memcpy(copy,str,len);
+  copy[len] = '\0';
+  *val = strtod(copy,&vend);
+  ok = (vend != copy)&&(*vend == '\0');
+  if(copy != buf)
+    free(copy);
+  return ok;
+}
+
+/* converts the whole of str (len characters, not NUL terminated) to a double
+returns 1 on success, 0 if str is not a valid number (in the sense of strtod) */
+int parseDouble(const char *str, const size_t len, double *val){
+  const char *p = str;
+  const char *end = str + len;
+  uint64_t mant = 0;
+  int numDig = 0, exp10 = 0, e = 0;
+  int neg = 0, expNeg = 0, any = 0;
+  unsigned int d;
+  double v;
+
+  if((p < end)&&((*p == '-')||(*p == '+'))){
+    neg = (*p == '-');
+    p++;
+  }
+  /* integer part */
+  for(;(p < end)&&((d=(unsigned int)(*p - '0')) < 10);p++){
+    any = 1;
+    if(numDig < NUM_MAX_DIGITS){
+      mant = mant*10 + d;
+      if(mant > 0)
+        numDig++;
+    }else if(d != 0){
+      return parseDoubleSlow(str,len,val); /* too many significant digits */
+    }else{
+      exp10++;
+    }
+  }
+  /* fraction */
+  if((p < end)&&(*p == '.')){
+    for(p++;(p < end)&&((d=(unsigned int)(*p - '0')) < 10);p++){
+      any = 1;
+      if(numDig < NUM_MAX_DIGITS){
+        mant = mant*10 + d;
+        exp10--;
+        if(mant > 0)
+          numDig++;
+      }else if(d != 0){
+        return parseDoubleSlow(str,len,val);
+      }
+    }
+  }
+  if(!any)
+    return parseDoubleSlow(str,len,val); /* eg. inf, nan */
+  /* exponent */
+  if((p < end)&&((*p == 'e')||(*p == 'E'))){
+    p++;
+    if((p < end)&&((*p == '-')||(*p == '+'))){
+      expNeg = (*p == '-');
+      p++;
+    }
+    if((p == end)||((unsigned int)(*p - '0') >= 10))
+      return parseDoubleSlow(str,len,val);
+    for(;(p < end)&&((d=(unsigned int)(*p - '0')) < 10);p++){
+      if(e < 100000)
+        e = e*10 + (int)d;
+    }
+    exp10 += expNeg ? -e : e;
+  }
+  if(p != end)
+    return parseDoubleSlow(str,len,val); /* trailing characters, eg. hexadecimal */
+
+  if(mant == 0){
+    v = 0.;
+  }else if(mant > NUM_MAX_MANT){
+    return parseDoubleSlow(str,len,val);
+  }else if(exp10 == 0){
+    v = (double)mant;
+  }else if((exp10 > 0)&&(exp10 <= 22)){
+    v = (double)mant*pow10tab[exp10];
+  }else if((exp10 < 0)&&(exp10 >= -22)){
+    v = (double)mant/pow10tab[-exp10];
+  }else if((exp10 > 22)&&(exp10 <= 22+15)&&(mant <= NUM_MAX_MANT/(uint64_t)pow10tab[exp10-22])){
+    /* few significant digits, move part of the exponent into the (exact) mantissa */
+    v = (double)(mant*(uint64_t)pow10tab[exp10-22])*1e22;
+  }else{
+    return parseDoubleSlow(str,len,val);
+  }
+  *val = neg ? -v : v;
+  return 1;
+}
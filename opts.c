@@ -0,0 +1,363 @@
+/* option parser: option names are looked up in a perfect hash of the option table (opttab.h,
+hashed at build time by mkopts), and options are parsed from any vector of tokens (which need not
+be NUL terminated), so that the same parser is used for the command line, for command lines read
+in batch mode (--commands) and for server requests
+errors are returned (with a message) rather than ending the program */
+
+#include "bcalc.h"
+#include "opttab.h"
+#include "opthash.h"
+
+#define OPT_MAX_VAL 64 /* longest multipole value */
+
+/* returns the option with the given name (len characters, not NUL terminated), or NULL if unknown */
+const optDef *findOpt(const char *name, const size_t len){
+  uint32_t h = (optHash(name,len)*OPT_HASH_MULT) >> (32 - OPT_HASH_BITS);
+  const optDef *od;
+  if(optSlot[h] == 0)
+    return NULL;
+  od = &optTab[optSlot[h] - 1];
+  if((strncmp(od->name,name,len) != 0)||(od->name[len] != '\0'))
+    return NULL;
+  return od;
+}
+
+/* sets a transition parameter or flag, val is the value (len characters, not NUL terminated,
+NULL for flags), ltFac is set to the units of lifetimes (in ps)
+returns an error code, or OPT_ERR_PARSE if the value is not a number */
+static int setTransOpt(const optDef *od, const char *val, const size_t len, bcalcTrans *t, double *ltFac){
+  char mstr[OPT_MAX_VAL];
+  double v;
+  switch(od->id){
+    case OPT_UP:
+      t->bup = 1;
+      return BCALC_OK;
+    case OPT_BETA2:
+      t->calcB2 = 1;
+      return BCALC_OK;
+    case OPT_BARN:
+      t->barn += 1;
+      return BCALC_OK;
+    case OPT_WU:
+      t->barn += 2;
+      return BCALC_OK;
+    case OPT_BRREL:
+      t->brrel = 1;
+      return BCALC_OK;
+    case OPT_M:
+      if(len >= OPT_MAX_VAL)
+        return BCALC_ERR_MULTIPOLE;
+      memcpy(mstr,val,len);
+      mstr[len] = '\0';
+      return bcalcParseMultipole(mstr,t);
+    case OPT_NUC:
+      return bcalcParseNuclide(val,len,&t->nucA,&t->nucZ);
+    case OPT_PRECISION:
+      return bcalcParsePrecision(val,len,&t->precision);
+    default:
+      break;
+  }
+  if(!parseDouble(val,len,&v))
+    return OPT_ERR_PARSE;
+  switch(od->id){
+    case OPT_E:
+      t->Et = v;
+      if(t->Et <= 0.)
+        return BCALC_ERR_ENERGY;
+      break;
+    case OPT_LT:
+      *ltFac = od->ltMul/od->ltDiv;
+      t->lt = v*od->ltMul/od->ltDiv;
+      t->calcMode = 0;
+      break;
+    case OPT_B:
+      t->b = v;
+      t->calcMode = 1;
+      break;
+    case OPT_D:
+      t->delta = v;
+      t->useDelta = 1;
+      break;
+    case OPT_BR:
+      t->branching = v;
+      break;
+    case OPT_ICC:
+      t->icc = v;
+      t->iccAuto = 0;
+      if(t->icc < 0.)
+        return BCALC_ERR_ICC;
+      break;
+    case OPT_A:
+      t->nucA = (int)v;
+      break;
+    case OPT_Z:
+      t->nucZ = (int)v;
+      break;
+    case OPT_JI:
+      t->ji = v;
+      if(t->ji < 0)
+        return BCALC_ERR_JI;
+      break;
+    case OPT_JF:
+      t->jf = v;
+      if(t->jf < 0)
+        return BCALC_ERR_JF;
+      break;
+    default:
+      break;
+  }
+  return BCALC_OK;
+}
+
+/* parses a vector of n tokens (tok[i] has tokLen[i] characters, not NUL terminated) containing
+transition parameters and flags (eg. -e 1332 -m E2 -lt 0.9 --wu -A 60) into t
+returns an error code, or OPT_ERR_PARSE with a message in estr, bad is set to the token at fault */
+int parseTransArgs(const char *const *tok, const size_t *tokLen, const int n, bcalcTrans *t, int *bad, char *estr, const size_t estrLen){
+  const optDef *od;
+  double ltFac;
+  int i, err;
+  for(i=0;i<n;i++){
+    *bad = i;
+    if((od = findOpt(tok[i],tokLen[i])) == NULL){
+      snprintf(estr,estrLen,"unknown parameter '%.*s'.",(int)tokLen[i],tok[i]);
+      return OPT_ERR_PARSE;
+    }
+    if(od->scope != OPT_SCOPE_TRANS){
+      snprintf(estr,estrLen,"%s can only be used on the command line.",od->name);
+      return OPT_ERR_PARSE;
+    }
+    if(od->val == OPT_VAL_NONE){
+      setTransOpt(od,NULL,0,t,&ltFac);
+      continue;
+    }
+    if(i == n-1){
+      snprintf(estr,estrLen,"missing value for %s.",od->name);
+      return OPT_ERR_PARSE;
+    }
+    i++;
+    *bad = i;
+    if((err = setTransOpt(od,tok[i],tokLen[i],t,&ltFac)) != BCALC_OK){
+      if(err == OPT_ERR_PARSE)
+        snprintf(estr,estrLen,"invalid value '%.*s' for %s.",(int)tokLen[i],tok[i],od->name);
+      return err;
+    }
+  }
+  return BCALC_OK;
+}
+
+/* sets the defaults for everything on the command line */
+void initCmdOpts(cmdOpts *o){
+  memset(o,0,sizeof(cmdOpts));
+  bcalcInitTrans(&o->t);
+  o->ltFac = 1.0;
+  o->numSamples = 1000000;
+  o->seed = 1;
+  o->verbose = 1;
+  o->fmt = OUT_TEXT;
+  o->batchIn = BATCH_LT;
+  o->iccFile = getenv("BCALC_ICC_TABLE");
+}
+
+/* describes the value needed by an option, for error messages */
+static const char *optValDesc(const int id){
+  switch(id){
+    case OPT_BINOUT:
+      return "the path of an output file (or - for stdout)";
+    case OPT_FORMAT:
+      return "an output format (text, csv, tsv or json)";
+    case OPT_ICCTAB:
+      return "the path of a table file";
+    case OPT_ENSDF:
+      return "the path of an ENSDF file";
+    case OPT_LEVELS:
+      return "the path of a level scheme file";
+    case OPT_SERVE:
+      return "the path of a socket";
+    case OPT_FOLLOW:
+      return "the path of a batch input file";
+    case OPT_SHM:
+      return "the name of a shared memory region";
+    case OPT_CACHE:
+      return "the path of a cache file";
+    case OPT_CACHESIZE:
+      return "a number of entries";
+    case OPT_PRECISION:
+      return "a precision (fast, default or exact)";
+    default:
+      return "a value";
+  }
+}
+
+/* returns 1 if an option taking an optional value takes the given token as its value */
+static int optValTaken(const optDef *od, const char *val){
+  if(od->id == OPT_STATS)
+    return (strcmp(val,"hw") == 0);
+  return (val[0] != '-');
+}
+
+/* parses the command line (argc arguments, without the program name) into o, which must have
+been initialized with initCmdOpts, stopping at --help or --selftest
+returns an error code, or OPT_ERR_PARSE with a message in estr */
+int parseCmdArgs(const int argc, const char *const *argv, cmdOpts *o, char *estr, const size_t estrLen){
+  const optDef *od;
+  const char *val;
+  int i, err;
+
+  for(i=0;i<argc;i++){
+    if((od = findOpt(argv[i],strlen(argv[i]))) == NULL){
+      snprintf(estr,estrLen,"Unknown parameter %s (see --help).",argv[i]);
+      return OPT_ERR_PARSE;
+    }
+    val = NULL;
+    if(od->val == OPT_VAL_REQ){
+      if(i == argc-1){
+        snprintf(estr,estrLen,"%s needs %s.",od->name,optValDesc(od->id));
+        return OPT_ERR_PARSE;
+      }
+      val = argv[++i];
+    }else if((od->val == OPT_VAL_OPT)&&(i < argc-1)&&optValTaken(od,argv[i+1])){
+      val = argv[++i];
+    }
+
+    if(od->scope == OPT_SCOPE_TRANS){
+      if((val != NULL)&&(od->axis >= 0)&&(strchr(val,':') != NULL)){
+        /* range of transition parameter values (the placeholder value sets the units) */
+        o->sweep = 1;
+        setTransOpt(od,"1",1,&o->t,&o->ltFac);
+        if(parseRange(val,((od->axis == BCALC_AXIS_VAL)&&(o->t.calcMode == 0)) ? o->ltFac : 1.0,&o->axes[od->axis]) != 0)
+          return BCALC_ERR_SWEEP;
+        continue;
+      }
+      if((err = setTransOpt(od,val,(val != NULL) ? strlen(val) : 0,&o->t,&o->ltFac)) != BCALC_OK){
+        if(err == OPT_ERR_PARSE)
+          snprintf(estr,estrLen,"Invalid value '%s' for %s.",val,od->name);
+        return err;
+      }
+      if(od->id == OPT_ICC)
+        o->iccSet = 1;
+      continue;
+    }
+
+    err = BCALC_OK;
+    switch(od->id){
+      case OPT_EERR:
+        o->useMC = 1;
+        if(parseUnc(val,o->unc.Et) != 0)
+          err = BCALC_ERR_UNC;
+        break;
+      case OPT_LTERR:
+        o->useMC = 1;
+        if(parseUnc(val,o->ltUnc) != 0)
+          err = BCALC_ERR_UNC;
+        break;
+      case OPT_BERR:
+        o->useMC = 1;
+        if(parseUnc(val,o->bUnc) != 0)
+          err = BCALC_ERR_UNC;
+        break;
+      case OPT_BRERR:
+        o->useMC = 1;
+        if(parseUnc(val,o->unc.branching) != 0)
+          err = BCALC_ERR_UNC;
+        break;
+      case OPT_DERR:
+        o->useMC = 1;
+        if(parseUnc(val,o->unc.delta) != 0)
+          err = BCALC_ERR_UNC;
+        break;
+      case OPT_ICCERR:
+        o->useMC = 1;
+        if(parseUnc(val,o->unc.icc) != 0)
+          err = BCALC_ERR_UNC;
+        break;
+      case OPT_SAMPLES:
+        o->numSamples = strtoul(val,NULL,10);
+        if(o->numSamples == 0)
+          err = BCALC_ERR_UNC;
+        break;
+      case OPT_SEED:
+        o->seed = (uint64_t)strtoull(val,NULL,0);
+        break;
+      case OPT_QUIET:
+        o->verbose = 0;
+        break;
+      case OPT_JACOBIAN:
+        o->jacobian = 1;
+        break;
+      case OPT_BATCH:
+        o->batch = 1;
+        o->batchFile = val;
+        break;
+      case OPT_COMMANDS:
+        o->batch = 1;
+        o->batchIn = BATCH_CMD;
+        o->batchFile = val;
+        break;
+      case OPT_BVAL:
+        if(o->batchIn != BATCH_CMD)
+          o->batchIn = BATCH_B;
+        break;
+      case OPT_BINOUT:
+        o->binOutFile = val;
+        break;
+      case OPT_FORMAT:
+        if((o->fmt = parseOutFormat(val)) < 0){
+          snprintf(estr,estrLen,"%s needs %s.",od->name,optValDesc(od->id));
+          return OPT_ERR_PARSE;
+        }
+        break;
+      case OPT_STATS:
+        o->stats = (val != NULL) ? 2 : 1;
+        break;
+      case OPT_THREADS:
+        o->numThreads = atoi(val);
+        if(o->numThreads <= 0){
+          snprintf(estr,estrLen,"The number of threads must be a positive integer.");
+          return OPT_ERR_PARSE;
+        }
+        break;
+      case OPT_ICCTAB:
+        o->iccFile = val;
+        break;
+      case OPT_ENSDF:
+        o->ensdfFile = val;
+        break;
+      case OPT_LEVELS:
+        o->levelsFile = val;
+        break;
+      case OPT_SERVE:
+        o->serveSock = val;
+        break;
+      case OPT_REPL:
+        o->repl = 1;
+        break;
+      case OPT_FOLLOW:
+        o->followFile = val;
+        break;
+      case OPT_SHM:
+        o->shmName = val;
+        break;
+      case OPT_CACHE:
+        o->cacheFile = val;
+        break;
+      case OPT_CACHESIZE:
+        o->cacheSize = strtoul(val,NULL,10);
+        if(o->cacheSize == 0){
+          snprintf(estr,estrLen,"The cache size must be a positive number of entries.");
+          return OPT_ERR_PARSE;
+        }
+        break;
+      case OPT_SELFTEST:
+        o->selfTest = 1;
+        return BCALC_OK;
+      case OPT_HELP:
+        o->help = 1;
+        return BCALC_OK;
+      default:
+        break;
+    }
+    if(err != BCALC_OK)
+      return err;
+  }
+  return BCALC_OK;
+}
@@ -0,0 +1,104 @@
+/* table of command line options, used by the option parser (opts.c) and by mkopts, which
+generates a perfect hash of the option names (opthash.h) so that each lookup is a single probe */
+
+#define L_PS  1.0 /* lifetime units, in ps */
+#define L_NS  1000.0
+#define L_US  1000000.0
+#define L_S   1000000000000.0
+#define L_H   3600000000000000.0
+
+static const optDef optTab[] = {
+  /* transition parameters and flags */
+  {"-E",       OPT_E,      OPT_VAL_REQ,  OPT_SCOPE_TRANS, BCALC_AXIS_ENERGY, 0., 0.},
+  {"-e",       OPT_E,      OPT_VAL_REQ,  OPT_SCOPE_TRANS, BCALC_AXIS_ENERGY, 0., 0.},
+  {"-M",       OPT_M,      OPT_VAL_REQ,  OPT_SCOPE_TRANS, -1, 0., 0.},
+  {"-m",       OPT_M,      OPT_VAL_REQ,  OPT_SCOPE_TRANS, -1, 0., 0.},
+  {"-Lt",      OPT_LT,     OPT_VAL_REQ,  OPT_SCOPE_TRANS, BCALC_AXIS_VAL, L_PS, 1.},
+  {"-lt",      OPT_LT,     OPT_VAL_REQ,  OPT_SCOPE_TRANS, BCALC_AXIS_VAL, L_PS, 1.},
+  {"-Ltps",    OPT_LT,     OPT_VAL_REQ,  OPT_SCOPE_TRANS, BCALC_AXIS_VAL, L_PS, 1.},
+  {"-ltps",    OPT_LT,     OPT_VAL_REQ,  OPT_SCOPE_TRANS, BCALC_AXIS_VAL, L_PS, 1.},
+  {"-Ltns",    OPT_LT,     OPT_VAL_REQ,  OPT_SCOPE_TRANS, BCALC_AXIS_VAL, L_NS, 1.},
+  {"-ltns",    OPT_LT,     OPT_VAL_REQ,  OPT_SCOPE_TRANS, BCALC_AXIS_VAL, L_NS, 1.},
+  {"-Ltus",    OPT_LT,     OPT_VAL_REQ,  OPT_SCOPE_TRANS, BCALC_AXIS_VAL, L_US, 1.},
+  {"-ltus",    OPT_LT,     OPT_VAL_REQ,  OPT_SCOPE_TRANS, BCALC_AXIS_VAL, L_US, 1.},
+  {"-Lts",     OPT_LT,     OPT_VAL_REQ,  OPT_SCOPE_TRANS, BCALC_AXIS_VAL, L_S, 1.},
+  {"-lts",     OPT_LT,     OPT_VAL_REQ,  OPT_SCOPE_TRANS, BCALC_AXIS_VAL, L_S, 1.},
+  {"-Lth",     OPT_LT,     OPT_VAL_REQ,  OPT_SCOPE_TRANS, BCALC_AXIS_VAL, L_H, 1.},
+  {"-lth",     OPT_LT,     OPT_VAL_REQ,  OPT_SCOPE_TRANS, BCALC_AXIS_VAL, L_H, 1.},
+  {"-Hl",      OPT_LT,     OPT_VAL_REQ,  OPT_SCOPE_TRANS, BCALC_AXIS_VAL, L_PS, LN2},
+  {"-hl",      OPT_LT,     OPT_VAL_REQ,  OPT_SCOPE_TRANS, BCALC_AXIS_VAL, L_PS, LN2},
+  {"-Hlps",    OPT_LT,     OPT_VAL_REQ,  OPT_SCOPE_TRANS, BCALC_AXIS_VAL, L_PS, LN2},
+  {"-hlps",    OPT_LT,     OPT_VAL_REQ,  OPT_SCOPE_TRANS, BCALC_AXIS_VAL, L_PS, LN2},
+  {"-Hlns",    OPT_LT,     OPT_VAL_REQ,  OPT_SCOPE_TRANS, BCALC_AXIS_VAL, L_NS, LN2},
+  {"-hlns",    OPT_LT,     OPT_VAL_REQ,  OPT_SCOPE_TRANS, BCALC_AXIS_VAL, L_NS, LN2},
+  {"-Hlus",    OPT_LT,     OPT_VAL_REQ,  OPT_SCOPE_TRANS, BCALC_AXIS_VAL, L_US, LN2},
+  {"-hlus",    OPT_LT,     OPT_VAL_REQ,  OPT_SCOPE_TRANS, BCALC_AXIS_VAL, L_US, LN2},
+  {"-Hls",     OPT_LT,     OPT_VAL_REQ,  OPT_SCOPE_TRANS, BCALC_AXIS_VAL, L_S, LN2},
+  {"-hls",     OPT_LT,     OPT_VAL_REQ,  OPT_SCOPE_TRANS, BCALC_AXIS_VAL, L_S, LN2},
+  {"-Hlh",     OPT_LT,     OPT_VAL_REQ,  OPT_SCOPE_TRANS, BCALC_AXIS_VAL, L_H, LN2},
+  {"-hlh",     OPT_LT,     OPT_VAL_REQ,  OPT_SCOPE_TRANS, BCALC_AXIS_VAL, L_H, LN2},
+  {"-B",       OPT_B,      OPT_VAL_REQ,  OPT_SCOPE_TRANS, BCALC_AXIS_VAL, 0., 0.},
+  {"-b",       OPT_B,      OPT_VAL_REQ,  OPT_SCOPE_TRANS, BCALC_AXIS_VAL, 0., 0.},
+  {"-d",       OPT_D,      OPT_VAL_REQ,  OPT_SCOPE_TRANS, BCALC_AXIS_DELTA, 0., 0.},
+  {"-br",      OPT_BR,     OPT_VAL_REQ,  OPT_SCOPE_TRANS, -1, 0., 0.},
+  {"-icc",     OPT_ICC,    OPT_VAL_REQ,  OPT_SCOPE_TRANS, -1, 0., 0.},
+  {"-A",       OPT_A,      OPT_VAL_REQ,  OPT_SCOPE_TRANS, -1, 0., 0.},
+  {"-Z",       OPT_Z,      OPT_VAL_REQ,  OPT_SCOPE_TRANS, -1, 0., 0.},
+  {"-nuc",     OPT_NUC,    OPT_VAL_REQ,  OPT_SCOPE_TRANS, -1, 0., 0.},
+  {"-ji",      OPT_JI,     OPT_VAL_REQ,  OPT_SCOPE_TRANS, -1, 0., 0.},
+  {"-jf",      OPT_JF,     OPT_VAL_REQ,  OPT_SCOPE_TRANS, -1, 0., 0.},
+  {"--up",     OPT_UP,     OPT_VAL_NONE, OPT_SCOPE_TRANS, -1, 0., 0.},
+  {"--beta2",  OPT_BETA2,  OPT_VAL_NONE, OPT_SCOPE_TRANS, -1, 0., 0.},
+  {"--barn",   OPT_BARN,   OPT_VAL_NONE, OPT_SCOPE_TRANS, -1, 0., 0.},
+  {"--wu",     OPT_WU,     OPT_VAL_NONE, OPT_SCOPE_TRANS, -1, 0., 0.},
+  {"--brrel",  OPT_BRREL,  OPT_VAL_NONE, OPT_SCOPE_TRANS, -1, 0., 0.},
+  {"--precision",OPT_PRECISION,OPT_VAL_REQ,OPT_SCOPE_TRANS,-1, 0., 0.},
+  /* uncertainties */
+  {"-eerr",    OPT_EERR,   OPT_VAL_REQ,  OPT_SCOPE_PROG, -1, 0., 0.},
+  {"-Eerr",    OPT_EERR,   OPT_VAL_REQ,  OPT_SCOPE_PROG, -1, 0., 0.},
+  {"-lterr",   OPT_LTERR,  OPT_VAL_REQ,  OPT_SCOPE_PROG, -1, 0., 0.},
+  {"-Lterr",   OPT_LTERR,  OPT_VAL_REQ,  OPT_SCOPE_PROG, -1, 0., 0.},
+  {"-hlerr",   OPT_LTERR,  OPT_VAL_REQ,  OPT_SCOPE_PROG, -1, 0., 0.},
+  {"-Hlerr",   OPT_LTERR,  OPT_VAL_REQ,  OPT_SCOPE_PROG, -1, 0., 0.},
+  {"-berr",    OPT_BERR,   OPT_VAL_REQ,  OPT_SCOPE_PROG, -1, 0., 0.},
+  {"-Berr",    OPT_BERR,   OPT_VAL_REQ,  OPT_SCOPE_PROG, -1, 0., 0.},
+  {"-brerr",   OPT_BRERR,  OPT_VAL_REQ,  OPT_SCOPE_PROG, -1, 0., 0.},
+  {"-derr",    OPT_DERR,   OPT_VAL_REQ,  OPT_SCOPE_PROG, -1, 0., 0.},
+  {"-iccerr",  OPT_ICCERR, OPT_VAL_REQ,  OPT_SCOPE_PROG, -1, 0., 0.},
+  {"--samples",OPT_SAMPLES,OPT_VAL_REQ,  OPT_SCOPE_PROG, -1, 0., 0.},
+  {"--seed",   OPT_SEED,   OPT_VAL_REQ,  OPT_SCOPE_PROG, -1, 0., 0.},
+  /* program options */
+  {"--quiet",  OPT_QUIET,  OPT_VAL_NONE, OPT_SCOPE_PROG, -1, 0., 0.},
+  {"--jacobian",OPT_JACOBIAN,OPT_VAL_NONE,OPT_SCOPE_PROG,-1, 0., 0.},
+  {"--batch",  OPT_BATCH,  OPT_VAL_OPT,  OPT_SCOPE_PROG, -1, 0., 0.},
+  {"--commands",OPT_COMMANDS,OPT_VAL_OPT,OPT_SCOPE_PROG, -1, 0., 0.},
+  {"--bval",   OPT_BVAL,   OPT_VAL_NONE, OPT_SCOPE_PROG, -1, 0., 0.},
+  {"--binout", OPT_BINOUT, OPT_VAL_REQ,  OPT_SCOPE_PROG, -1, 0., 0.},
+  {"--format", OPT_FORMAT, OPT_VAL_REQ,  OPT_SCOPE_PROG, -1, 0., 0.},
+  {"--stats",  OPT_STATS,  OPT_VAL_OPT,  OPT_SCOPE_PROG, -1, 0., 0.},
+  {"--threads",OPT_THREADS,OPT_VAL_REQ,  OPT_SCOPE_PROG, -1, 0., 0.},
+  {"--icctab", OPT_ICCTAB, OPT_VAL_REQ,  OPT_SCOPE_PROG, -1, 0., 0.},
+  {"--ensdf",  OPT_ENSDF,  OPT_VAL_REQ,  OPT_SCOPE_PROG, -1, 0., 0.},
+  {"--levels", OPT_LEVELS, OPT_VAL_REQ,  OPT_SCOPE_PROG, -1, 0., 0.},
+  {"--serve",  OPT_SERVE,  OPT_VAL_REQ,  OPT_SCOPE_PROG, -1, 0., 0.},
+  {"--repl",   OPT_REPL,   OPT_VAL_NONE, OPT_SCOPE_PROG, -1, 0., 0.},
+  {"--follow", OPT_FOLLOW, OPT_VAL_REQ,  OPT_SCOPE_PROG, -1, 0., 0.},
+  {"--shm",    OPT_SHM,    OPT_VAL_REQ,  OPT_SCOPE_PROG, -1, 0., 0.},
+  {"--cache",  OPT_CACHE,  OPT_VAL_REQ,  OPT_SCOPE_PROG, -1, 0., 0.},
+  {"--cache-size",OPT_CACHESIZE,OPT_VAL_REQ,OPT_SCOPE_PROG,-1, 0., 0.},
+  {"--selftest",OPT_SELFTEST,OPT_VAL_NONE,OPT_SCOPE_PROG,-1, 0., 0.},
+  {"--help",   OPT_HELP,   OPT_VAL_NONE, OPT_SCOPE_PROG, -1, 0., 0.},
+};
+
+#define OPT_TAB_LEN (sizeof(optTab)/sizeof(optDef))
+
+/* hash of an option name of length len (FNV-1a), mapped to a table slot with OPT_HASH_MULT */
+static inline uint32_t optHash(const char *name, const size_t len){
+  uint32_t h = 2166136261U;
+  size_t i;
+  for(i=0;i<len;i++){
+    h ^= (unsigned char)name[i];
+    h *= 16777619U;
+  }
+  return h;
+}
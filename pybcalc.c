@@ -0,0 +1,529 @@
+/* pybcalc: Python extension module for libbcalc (build with 'make python')
+Arrays are passed through the buffer protocol (eg. NumPy float64 arrays, array.array('d') or
+memoryviews) and read in place, without copying.  Results are written into new float64 buffers
+(memoryviews, which numpy.asarray() wraps without copying) or into arrays given with out=.
+Calculations run with the GIL released, and large arrays are split between threads. */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "libbcalc.h"
+
+#define PYBCALC_MIN_CHUNK  65536 /* minimum number of transitions per thread */
+#define PYBCALC_MAX_THREADS 256
+
+/* a float64 argument: a contiguous buffer, or a scalar */
+typedef struct
+{
+  Py_buffer view;
+  const double *p; /* NULL for a scalar (or an argument not given) */
+  Py_ssize_t n;
+  double val; /* scalar value */
+  int hasView;
+}pyArg;
+
+/* the part of an array calculation done by one thread */
+typedef struct
+{
+  const bcalcArrIn *in;
+  const bcalcArrOut *out;
+  size_t first, n;
+  int mode; /* 0=bcalcComputeArr, 1=beta_2, 2=single particle lifetimes */
+  int err;
+}pyChunk;
+
+static void releaseArg(pyArg *a){
+  if(a->hasView)
+    PyBuffer_Release(&a->view);
+  a->hasView = 0;
+}
+
+/* gets a float64 argument, from a buffer (any shape, C contiguous) or a number if scalarOk
+returns 0 on success, -1 with a Python exception set */
+static int getArg(PyObject *obj, const char *name, const int scalarOk, pyArg *a){
+  const char *f;
+  memset(a,0,sizeof(pyArg));
+  if(PyObject_CheckBuffer(obj)){
+    if(PyObject_GetBuffer(obj,&a->view,PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) != 0)
+      return -1;
+    a->hasView = 1;
+    f = (a->view.format != NULL) ? a->view.format : "B";
+    if((f[0] == '<')||(f[0] == '=')||(f[0] == '@'))
+      f++;
+    if((strcmp(f,"d") != 0)||(a->view.itemsize != (Py_ssize_t)sizeof(double))){
+      PyErr_Format(PyExc_TypeError,"%s must be a float64 array (format 'd'), not format '%s'",name,a->view.format);
+      releaseArg(a);
+      return -1;
+    }
+    a->p = (const double *)a->view.buf;
+    a->n = a->view.len/(Py_ssize_t)sizeof(double);
+    return 0;
+  }
+  if(scalarOk&&PyNumber_Check(obj)){
+    a->val = PyFloat_AsDouble(obj);
+    if((a->val == -1.)&&PyErr_Occurred())
+      return -1;
+    return 0;
+  }
+  PyErr_Format(PyExc_TypeError,"%s must be a float64 array (eg. numpy.float64 or array.array('d'))%s",name,scalarOk ? " or a number" : "");
+  return -1;
+}
+
+/* checks that an array argument has n values */
+static int checkLen(const pyArg *a, const char *name, const Py_ssize_t n){
+  if((a->p != NULL)&&(a->n != n)){
+    PyErr_Format(PyExc_ValueError,"%s has %zd values, expected %zd",name,a->n,n);
+    return -1;
+  }
+  return 0;
+}
+
+/* returns an output array for n values: out (checked) if given, otherwise a new float64 memoryview
+with the shape of the input view (if any), and sets *p to its data */
+static PyObject *getOut(PyObject *out, const Py_ssize_t n, const Py_buffer *shapeOf, double **p){
+  Py_buffer view;
+  PyObject *ba, *mv, *res, *shape;
+  const char *f;
+  Py_ssize_t i;
+  if((out != NULL)&&(out != Py_None)){
+    if(PyObject_GetBuffer(out,&view,PyBUF_C_CONTIGUOUS | PyBUF_FORMAT | PyBUF_WRITABLE) != 0)
+      return NULL;
+    f = (view.format != NULL) ? view.format : "B";
+    if((f[0] == '<')||(f[0] == '=')||(f[0] == '@'))
+      f++;
+    if((strcmp(f,"d") != 0)||(view.len != n*(Py_ssize_t)sizeof(double))){
+      PyBuffer_Release(&view);
+      PyErr_Format(PyExc_ValueError,"out must be a writable float64 array of %zd values",n);
+      return NULL;
+    }
+    *p = (double *)view.buf;
+    /* the data stays valid while the caller holds out */
+    PyBuffer_Release(&view);
+    Py_INCREF(out);
+    return out;
+  }
+  if((ba = PyByteArray_FromStringAndSize(NULL,n*(Py_ssize_t)sizeof(double))) == NULL)
+    return NULL;
+  *p = (double *)PyByteArray_AS_STRING(ba);
+  mv = PyMemoryView_FromObject(ba);
+  Py_DECREF(ba);
+  if(mv == NULL)
+    return NULL;
+  if((shapeOf != NULL)&&(shapeOf->ndim > 1)&&(shapeOf->shape != NULL)){
+    if((shape = PyTuple_New(shapeOf->ndim)) == NULL){
+      Py_DECREF(mv);
+      return NULL;
+    }
+    for(i=0;i<shapeOf->ndim;i++)
+      PyTuple_SET_ITEM(shape,i,PyLong_FromSsize_t(shapeOf->shape[i]));
+    res = PyObject_CallMethod(mv,"cast","sO","d",shape);
+    Py_DECREF(shape);
+  }else{
+    res = PyObject_CallMethod(mv,"cast","s","d");
+  }
+  Py_DECREF(mv);
+  return res;
+}
+
+/* parses a units string (fm, barn or wu) into bcalcTrans.barn */
+static int getUnits(const char *units, int *barn){
+  if((units == NULL)||(strcmp(units,"fm") == 0)){
+    *barn = 0;
+  }else if(strcmp(units,"barn") == 0){
+    *barn = 1;
+  }else if((strcmp(units,"wu") == 0)||(strcmp(units,"W.u.") == 0)){
+    *barn = 2;
+  }else{
+    PyErr_Format(PyExc_ValueError,"units must be 'fm', 'barn' or 'wu', not '%s'",units);
+    return -1;
+  }
+  return 0;
+}
+
+/* parses a precision string (fast, default or exact) into bcalcTrans.precision */
+static int getPrecision(const char *prec, bcalcTrans *t){
+  if(prec == NULL)
+    return 0;
+  if(bcalcParsePrecision(prec,strlen(prec),&t->precision) != BCALC_OK){
+    PyErr_Format(PyExc_ValueError,"precision must be 'fast', 'default' or 'exact', not '%s'",prec);
+    return -1;
+  }
+  return 0;
+}
+
+/* sets A and Z from a nuclide name, if given */
+static int getNuc(const char *nuc, bcalcTrans *t){
+  if(nuc == NULL)
+    return 0;
+  if(bcalcParseNuclide(nuc,strlen(nuc),&t->nucA,&t->nucZ) != BCALC_OK){
+    PyErr_Format(PyExc_ValueError,"unknown nuclide '%s'",nuc);
+    return -1;
+  }
+  return 0;
+}
+
+static void *runChunk(void *arg){
+  pyChunk *c = (pyChunk *)arg;
+  bcalcArrIn in = *c->in;
+  bcalcArrOut out;
+  size_t i;
+  double b;
+  in.n = c->n;
+  in.Et += c->first;
+  if(in.val != NULL)
+    in.val += c->first;
+  if(in.branching != NULL)
+    in.branching += c->first;
+  if(in.icc != NULL)
+    in.icc += c->first;
+  if(in.delta != NULL)
+    in.delta += c->first;
+  out.val = c->out->val + c->first;
+  out.val1 = (c->out->val1 != NULL) ? c->out->val1 + c->first : NULL;
+  if(c->mode == 0){
+    c->err = bcalcComputeArr(&in,&out);
+  }else if(c->mode == 1){
+    for(i=0;i<in.n;i++){
+      b = (in.t.barn == 1) ? in.val[i]*BARN_FM*BARN_FM : in.val[i]; /* e^2 b^2 to e^2 fm^4 */
+      out.val[i] = calcBeta2Prec(in.Et[i]/1000.,b,in.t.nucA,in.t.nucZ,(in.t.barn == 2) ? 2 : 0,in.t.precision);
+    }
+  }else{
+    for(i=0;i<in.n;i++)
+      out.val[i] = ltspPrec(in.t.EM,in.t.L,in.t.nucA,in.Et[i],in.t.precision)*1.0E12;
+  }
+  return NULL;
+}
+
+/* runs an array calculation on numThreads threads (0=number of processors, fewer for small arrays)
+with the GIL released, returns an error code */
+static int runArr(const bcalcArrIn *in, const bcalcArrOut *out, const int mode, int numThreads){
+  pyChunk c[PYBCALC_MAX_THREADS];
+  pthread_t th[PYBCALC_MAX_THREADS];
+  int started[PYBCALC_MAX_THREADS];
+  size_t per;
+  int i, err = BCALC_OK;
+
+  if(in->n == 0)
+    return BCALC_OK;
+  if(numThreads <= 0)
+    numThreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  if((size_t)numThreads > in->n/PYBCALC_MIN_CHUNK)
+    numThreads = (int)(in->n/PYBCALC_MIN_CHUNK);
+  if(numThreads > PYBCALC_MAX_THREADS)
+    numThreads = PYBCALC_MAX_THREADS;
+  if(numThreads < 1)
+    numThreads = 1;
+  per = (in->n + (size_t)numThreads - 1)/(size_t)numThreads;
+
+  Py_BEGIN_ALLOW_THREADS
+  for(i=0;i<numThreads;i++){
+    c[i].in = in;
+    c[i].out = out;
+    c[i].first = (size_t)i*per;
+    c[i].n = (c[i].first < in->n) ? ((in->n - c[i].first < per) ? in->n - c[i].first : per) : 0;
+    c[i].mode = mode;
+    c[i].err = BCALC_OK;
+    started[i] = (i > 0)&&(pthread_create(&th[i],NULL,runChunk,&c[i]) == 0);
+    if((i > 0)&&(!started[i]))
+      runChunk(&c[i]);
+  }
+  runChunk(&c[0]);
+  for(i=0;i<numThreads;i++){
+    if(started[i])
+      pthread_join(th[i],NULL);
+    if((c[i].err != BCALC_OK)&&(err == BCALC_OK))
+      err = c[i].err;
+  }
+  Py_END_ALLOW_THREADS
+
+  return err;
+}
+
+/* common parameters of the b() and lifetime() calculations */
+static int setTrans(bcalcTrans *t, const char *mult, const char *units, const char *nuc, const int A, const int Z, const int up, const double ji, const double jf, const int brrel){
+  bcalcInitTrans(t);
+  if(bcalcParseMultipole(mult,t) != BCALC_OK){
+    PyErr_Format(PyExc_ValueError,"%s",bcalcErrStr(BCALC_ERR_MULTIPOLE));
+    return -1;
+  }
+  if(getUnits(units,&t->barn) != 0)
+    return -1;
+  t->nucA = A;
+  t->nucZ = Z;
+  if(getNuc(nuc,t) != 0)
+    return -1;
+  t->bup = up;
+  t->ji = ji;
+  t->jf = jf;
+  t->brrel = brrel;
+  return 0;
+}
+
+PyDoc_STRVAR(b_doc,
+"b(E, lifetime, multipole, branching=1.0, icc=0.0, delta=None, A=-1, Z=-1, nuc=None,\n"
+"  units='fm', up=False, ji=-1, jf=-1, brrel=False, threads=0, out=None, out1=None,\n"
+"  precision='default')\n\n"
+"Reduced transition probabilities from transition energies E (keV) and level lifetimes (ps).\n"
+"branching, icc and delta may be arrays or numbers.  units is 'fm' (e^2 fm^2L, uN^2 fm^(2L-2)),\n"
+"'barn' or 'wu' (Weisskopf units, needs A).  Returns B, or (B, B1) of the L and L+1 multipoles\n"
+"if delta is given.  precision is 'fast', 'default' or 'exact'.");
+
+static PyObject *py_b(PyObject *self, PyObject *args, PyObject *kw){
+  static char *kwlist[] = {"E","lifetime","multipole","branching","icc","delta","A","Z","nuc","units","up","ji","jf","brrel","threads","out","out1","precision",NULL};
+  PyObject *oE, *oLt, *oBr = NULL, *oIcc = NULL, *oDelta = NULL, *oOut = NULL, *oOut1 = NULL;
+  PyObject *res = NULL, *res1 = NULL;
+  const char *mult, *units = NULL, *nuc = NULL, *prec = NULL;
+  int A = -1, Z = -1, up = 0, brrel = 0, threads = 0, err;
+  double ji = -1., jf = -1.;
+  pyArg E, lt, br, icc, delta;
+  bcalcArrIn in;
+  bcalcArrOut out;
+  double *p, *p1;
+  (void)self;
+
+  if(!PyArg_ParseTupleAndKeywords(args,kw,"OOs|OOOiizzpddpiOOz",kwlist,&oE,&oLt,&mult,&oBr,&oIcc,&oDelta,&A,&Z,&nuc,&units,&up,&ji,&jf,&brrel,&threads,&oOut,&oOut1,&prec))
+    return NULL;
+  memset(&br,0,sizeof(pyArg));
+  memset(&icc,0,sizeof(pyArg));
+  memset(&delta,0,sizeof(pyArg));
+  if(getArg(oE,"E",0,&E) != 0)
+    return NULL;
+  if(getArg(oLt,"lifetime",0,&lt) != 0)
+    goto done;
+  memset(&in,0,sizeof(bcalcArrIn));
+  if((setTrans(&in.t,mult,units,nuc,A,Z,up,ji,jf,brrel) != 0)||(getPrecision(prec,&in.t) != 0))
+    goto done;
+  in.t.calcMode = 0;
+  if((oBr != NULL)&&(oBr != Py_None)&&(getArg(oBr,"branching",1,&br) != 0))
+    goto done;
+  if((oIcc != NULL)&&(oIcc != Py_None)&&(getArg(oIcc,"icc",1,&icc) != 0))
+    goto done;
+  if((oDelta != NULL)&&(oDelta != Py_None)&&(getArg(oDelta,"delta",1,&delta) != 0))
+    goto done;
+  if((checkLen(&lt,"lifetime",E.n) != 0)||(checkLen(&br,"branching",E.n) != 0)||(checkLen(&icc,"icc",E.n) != 0)||(checkLen(&delta,"delta",E.n) != 0))
+    goto done;
+  in.n = (size_t)E.n;
+  in.Et = E.p;
+  in.val = lt.p;
+  in.branching = br.p;
+  if((oBr != NULL)&&(oBr != Py_None)&&(br.p == NULL))
+    in.t.branching = br.val;
+  in.icc = icc.p;
+  in.t.icc = (icc.p == NULL) ? icc.val : 0.;
+  in.delta = delta.p;
+  if((oDelta != NULL)&&(oDelta != Py_None)){
+    in.t.useDelta = 1;
+    in.t.delta = delta.val;
+  }
+  if((res = getOut(oOut,E.n,&E.view,&p)) == NULL)
+    goto done;
+  out.val = p;
+  out.val1 = NULL;
+  if(in.t.useDelta){
+    if((res1 = getOut(oOut1,E.n,&E.view,&p1)) == NULL){
+      Py_CLEAR(res);
+      goto done;
+    }
+    out.val1 = p1;
+  }
+  if((err = runArr(&in,&out,0,threads)) != BCALC_OK){
+    PyErr_SetString(PyExc_ValueError,bcalcErrStr(err));
+    Py_CLEAR(res);
+    Py_CLEAR(res1);
+  }
+
+ done:
+  releaseArg(&E);
+  releaseArg(&lt);
+  releaseArg(&br);
+  releaseArg(&icc);
+  releaseArg(&delta);
+  if((res != NULL)&&(res1 != NULL))
+    return Py_BuildValue("NN",res,res1);
+  return res;
+}
+
+PyDoc_STRVAR(lifetime_doc,
+"lifetime(E, B, multipole, branching=1.0, A=-1, Z=-1, nuc=None, units='fm', up=False,\n"
+"  ji=-1, jf=-1, brrel=False, threads=0, out=None, precision='default')\n\n"
+"Level lifetimes (ps) from transition energies E (keV) and reduced transition probabilities B\n"
+"(in the given units), for transitions with the given branching fractions (array or number).");
+
+static PyObject *py_lifetime(PyObject *self, PyObject *args, PyObject *kw){
+  static char *kwlist[] = {"E","B","multipole","branching","A","Z","nuc","units","up","ji","jf","brrel","threads","out","precision",NULL};
+  PyObject *oE, *oB, *oBr = NULL, *oOut = NULL;
+  PyObject *res = NULL;
+  const char *mult, *units = NULL, *nuc = NULL, *prec = NULL;
+  int A = -1, Z = -1, up = 0, brrel = 0, threads = 0, err;
+  double ji = -1., jf = -1.;
+  pyArg E, b, br;
+  bcalcArrIn in;
+  bcalcArrOut out;
+  double *p;
+  (void)self;
+
+  if(!PyArg_ParseTupleAndKeywords(args,kw,"OOs|OiizzpddpiOz",kwlist,&oE,&oB,&mult,&oBr,&A,&Z,&nuc,&units,&up,&ji,&jf,&brrel,&threads,&oOut,&prec))
+    return NULL;
+  memset(&b,0,sizeof(pyArg));
+  memset(&br,0,sizeof(pyArg));
+  if(getArg(oE,"E",0,&E) != 0)
+    return NULL;
+  if(getArg(oB,"B",0,&b) != 0)
+    goto done;
+  memset(&in,0,sizeof(bcalcArrIn));
+  if((setTrans(&in.t,mult,units,nuc,A,Z,up,ji,jf,brrel) != 0)||(getPrecision(prec,&in.t) != 0))
+    goto done;
+  in.t.calcMode = 1;
+  if((oBr != NULL)&&(oBr != Py_None)&&(getArg(oBr,"branching",1,&br) != 0))
+    goto done;
+  if((checkLen(&b,"B",E.n) != 0)||(checkLen(&br,"branching",E.n) != 0))
+    goto done;
+  in.n = (size_t)E.n;
+  in.Et = E.p;
+  in.val = b.p;
+  in.branching = br.p;
+  if((oBr != NULL)&&(oBr != Py_None)&&(br.p == NULL))
+    in.t.branching = br.val;
+  if((res = getOut(oOut,E.n,&E.view,&p)) == NULL)
+    goto done;
+  out.val = p;
+  out.val1 = NULL;
+  if((err = runArr(&in,&out,0,threads)) != BCALC_OK){
+    PyErr_SetString(PyExc_ValueError,bcalcErrStr(err));
+    Py_CLEAR(res);
+  }
+
+ done:
+  releaseArg(&E);
+  releaseArg(&b);
+  releaseArg(&br);
+  return res;
+}
+
+PyDoc_STRVAR(beta2_doc,
+"beta2(E, B, A=-1, Z=-1, nuc=None, units='fm', threads=0, out=None, precision='default')\n\n"
+"Quadrupole deformation parameters from the energies E (keV) and B(E2) values (in the given\n"
+"units) of 2+ -> 0+ transitions, using measured charge radii where tabulated.");
+
+static PyObject *py_beta2(PyObject *self, PyObject *args, PyObject *kw){
+  static char *kwlist[] = {"E","B","A","Z","nuc","units","threads","out","precision",NULL};
+  PyObject *oE, *oB, *oOut = NULL;
+  PyObject *res = NULL;
+  const char *units = NULL, *nuc = NULL, *prec = NULL;
+  int A = -1, Z = -1, threads = 0;
+  pyArg E, b;
+  bcalcArrIn in;
+  bcalcArrOut out;
+  double *p;
+  (void)self;
+
+  if(!PyArg_ParseTupleAndKeywords(args,kw,"OO|iizziOz",kwlist,&oE,&oB,&A,&Z,&nuc,&units,&threads,&oOut,&prec))
+    return NULL;
+  memset(&b,0,sizeof(pyArg));
+  if(getArg(oE,"E",0,&E) != 0)
+    return NULL;
+  if(getArg(oB,"B",0,&b) != 0)
+    goto done;
+  memset(&in,0,sizeof(bcalcArrIn));
+  if((setTrans(&in.t,"E2",units,nuc,A,Z,0,2.,0.,0) != 0)||(getPrecision(prec,&in.t) != 0))
+    goto done;
+  if((in.t.nucA < 1)||(in.t.nucZ < 1)||(in.t.nucA < in.t.nucZ)){
+    PyErr_SetString(PyExc_ValueError,bcalcErrStr(((in.t.nucA < 1)||(in.t.nucZ < 1)) ? BCALC_ERR_BETA2NOAZ : BCALC_ERR_ALTZ));
+    goto done;
+  }
+  if(checkLen(&b,"B",E.n) != 0)
+    goto done;
+  in.n = (size_t)E.n;
+  in.Et = E.p;
+  in.val = b.p;
+  if((res = getOut(oOut,E.n,&E.view,&p)) == NULL)
+    goto done;
+  out.val = p;
+  out.val1 = NULL;
+  runArr(&in,&out,1,threads);
+
+ done:
+  releaseArg(&E);
+  releaseArg(&b);
+  return res;
+}
+
+PyDoc_STRVAR(weisskopf_doc,
+"weisskopf(E, multipole, A=-1, nuc=None, threads=0, out=None, precision='default')\n\n"
+"Single particle (Weisskopf estimate) lifetimes (ps) for transition energies E (keV).");
+
+static PyObject *py_weisskopf(PyObject *self, PyObject *args, PyObject *kw){
+  static char *kwlist[] = {"E","multipole","A","nuc","threads","out","precision",NULL};
+  PyObject *oE, *oOut = NULL;
+  PyObject *res = NULL;
+  const char *mult, *nuc = NULL, *prec = NULL;
+  int A = -1, threads = 0;
+  pyArg E;
+  bcalcArrIn in;
+  bcalcArrOut out;
+  double *p;
+  (void)self;
+
+  if(!PyArg_ParseTupleAndKeywords(args,kw,"Os|iziOz",kwlist,&oE,&mult,&A,&nuc,&threads,&oOut,&prec))
+    return NULL;
+  if(getArg(oE,"E",0,&E) != 0)
+    return NULL;
+  memset(&in,0,sizeof(bcalcArrIn));
+  if((setTrans(&in.t,mult,NULL,nuc,A,-1,0,-1.,-1.,0) != 0)||(getPrecision(prec,&in.t) != 0))
+    goto done;
+  if((in.t.L < 1)||(in.t.L > BCALC_MAXL)||(in.t.nucA < 1)){
+    PyErr_SetString(PyExc_ValueError,bcalcErrStr((in.t.nucA < 1) ? BCALC_ERR_WUNOA : BCALC_ERR_LMAX));
+    goto done;
+  }
+  in.n = (size_t)E.n;
+  in.Et = E.p;
+  if((res = getOut(oOut,E.n,&E.view,&p)) == NULL)
+    goto done;
+  out.val = p;
+  out.val1 = NULL;
+  runArr(&in,&out,2,threads);
+
+ done:
+  releaseArg(&E);
+  return res;
+}
+
+PyDoc_STRVAR(nuclide_doc,
+"nuclide(name)\n\n"
+"Returns (A, Z) for a nuclide name (eg. '152Sm' or 'Sm152').");
+
+static PyObject *py_nuclide(PyObject *self, PyObject *args){
+  const char *name;
+  Py_ssize_t len;
+  int A, Z;
+  (void)self;
+  if(!PyArg_ParseTuple(args,"s#",&name,&len))
+    return NULL;
+  if(bcalcParseNuclide(name,(size_t)len,&A,&Z) != BCALC_OK){
+    PyErr_Format(PyExc_ValueError,"unknown nuclide '%s'",name);
+    return NULL;
+  }
+  return Py_BuildValue("ii",A,Z);
+}
+
+static PyMethodDef pybcalcMethods[] = {
+  {"b",(PyCFunction)(void (*)(void))py_b,METH_VARARGS | METH_KEYWORDS,b_doc},
+  {"lifetime",(PyCFunction)(void (*)(void))py_lifetime,METH_VARARGS | METH_KEYWORDS,lifetime_doc},
+  {"beta2",(PyCFunction)(void (*)(void))py_beta2,METH_VARARGS | METH_KEYWORDS,beta2_doc},
+  {"weisskopf",(PyCFunction)(void (*)(void))py_weisskopf,METH_VARARGS | METH_KEYWORDS,weisskopf_doc},
+  {"nuclide",py_nuclide,METH_VARARGS,nuclide_doc},
+  {NULL,NULL,0,NULL}
+};
+
+static struct PyModuleDef pybcalcModule = {
+  PyModuleDef_HEAD_INIT,"pybcalc",
+  "Reduced transition probability calculations (libbcalc) on float64 arrays, without copying.",
+  -1,pybcalcMethods,NULL,NULL,NULL,NULL
+};
+
+PyMODINIT_FUNC PyInit_pybcalc(void);
+
+PyMODINIT_FUNC PyInit_pybcalc(void){
+  return PyModule_Create(&pybcalcModule);
+}
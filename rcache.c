@@ -0,0 +1,297 @@
+/* persistent result cache (--cache): results of batch input lines are kept in a file mapped into
+memory, so that when the same input is processed again only new or changed lines are parsed and
+calculated
+A line is keyed by a 128 bit hash of its text (as hashing it is much faster than parsing it),
+seeded with a hash of everything else its results depend on: the defaults from the command line,
+the input mode, the conversion coefficient table and the build of bcalc.  The results are
+appended to a log of entries (each chunk of input taking blocks of RCACHE_BLOCK entries, so that
+entries are in input order), and an open addressing hash table maps keys to log positions.  As
+the next line looked up is usually the one after the last line found, the entry after the last
+one found is checked before the hash table, so that a repeated run reads the log sequentially.
+When the log is full it wraps around, replacing the oldest results.  Entries are written under a
+sequence lock and every hit is checked against the whole key in the entry, so that worker threads
+(and other runs using the same file) can read and write the cache without locks. */
+
+#define _DEFAULT_SOURCE /* flock */
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include "bcalc.h"
+
+#define RCACHE_C1 0x87C37B91114253D5ULL
+#define RCACHE_C2 0x4CF5AD432745937FULL
+
+static const char rcacheBuild[] = __DATE__ " " __TIME__;
+
+static uint64_t rcacheRotl(const uint64_t x, const int r){
+  return (x << r)|(x >> (64 - r));
+}
+
+/* final mix of a 64 bit hash */
+static uint64_t rcacheMix(uint64_t h){
+  h ^= h >> 33;
+  h *= 0xFF51AFD7ED558CCDULL;
+  h ^= h >> 33;
+  h *= 0xC4CEB9FE1A85EC53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+/* 128 bit hash of n bytes, 8 at a time, seeded with seed */
+static void rcacheHash(const char *p, const size_t n, const uint64_t *seed, uint64_t *key){
+  uint64_t h1 = seed[0] ^ (uint64_t)n;
+  uint64_t h2 = seed[1] ^ ((uint64_t)n*RCACHE_C1);
+  uint64_t w;
+  size_t i;
+  for(i=0;i<n;i+=8){
+    w = 0;
+    memcpy(&w,p+i,(n - i < 8) ? n - i : 8);
+    h1 = rcacheRotl(h1 ^ (w*RCACHE_C1),31)*RCACHE_C2;
+    h2 = rcacheRotl(h2 ^ (w*RCACHE_C2),33)*RCACHE_C1 + h1;
+  }
+  key[0] = rcacheMix(h1 ^ rcacheRotl(h2,17));
+  key[1] = rcacheMix(h2 + key[0]);
+  if(key[0] == 0)
+    key[0] = 1; /* 0 marks an empty entry */
+}
+
+static size_t rcacheSize(const uint64_t numEntries){
+  return sizeof(rcacheHeader) + (size_t)(2*numEntries)*sizeof(rcacheSlot) + (size_t)numEntries*sizeof(rcacheEntry);
+}
+
+/* returns 1 if the file (of size bytes) holds a cache made by this build with numEntries entries
+(or any number of entries, if numEntries is 0) */
+static int rcacheValid(const int fd, const size_t size, const uint64_t numEntries){
+  rcacheHeader h;
+  if((size < sizeof(rcacheHeader))||(pread(fd,&h,sizeof(rcacheHeader),0) != (ssize_t)sizeof(rcacheHeader)))
+    return 0;
+  if((memcmp(h.magic,RCACHE_MAGIC,8) != 0)||(h.version != RCACHE_VERSION)||(h.entrySize != sizeof(rcacheEntry))
+     ||(strncmp(h.build,rcacheBuild,sizeof(h.build)) != 0))
+    return 0;
+  if((h.numEntries < RCACHE_BLOCK)||((h.numEntries & (h.numEntries - 1)) != 0)||(h.numSlots != 2*h.numEntries)
+     ||(size != rcacheSize(h.numEntries)))
+    return 0;
+  return (numEntries == 0)||(h.numEntries == numEntries);
+}
+
+/* opens (or creates) the cache file at path for batch input in the format inMode (see runBatch)
+with the defaults in tdef, with size entries (rounded up to a power of 2, 0 = the size of an
+existing cache, or RCACHE_DEF_SIZE), starting a new cache if the file holds a cache of another
+size or made by another build of bcalc
+returns 0 on success, or -1 with an error message printed */
+int rcacheOpen(rcache *c, const char *path, const unsigned long size, const bcalcTrans *tdef, const int inMode){
+
+  char ctx[512];
+  struct stat st;
+  uint64_t numEntries = 0;
+  uint64_t zero[2] = {0, 0};
+  void *map;
+  int n;
+
+  memset(c,0,sizeof(rcache));
+  if(size > 0){
+    for(numEntries=RCACHE_BLOCK;numEntries<size;numEntries*=2);
+  }
+  if((c->fd = open(path,O_RDWR|O_CREAT,0644)) < 0){
+    printf("ERROR: Cannot open the result cache %s (%s).\n",path,strerror(errno));
+    return -1;
+  }
+  /* a shared lock is held while the cache is in use, the exclusive lock needed to start a new
+  cache is only taken if no other run is using it */
+  if((flock(c->fd,LOCK_SH) != 0)||(fstat(c->fd,&st) != 0)){
+    printf("ERROR: Cannot open the result cache %s (%s).\n",path,strerror(errno));
+    close(c->fd);
+    return -1;
+  }
+  if(!rcacheValid(c->fd,(size_t)st.st_size,numEntries)){
+    if(flock(c->fd,LOCK_EX|LOCK_NB) != 0){
+      printf("ERROR: The result cache %s is in use by another run, and cannot be replaced.\n",path);
+      close(c->fd);
+      return -1;
+    }
+    if((fstat(c->fd,&st) != 0)||!rcacheValid(c->fd,(size_t)st.st_size,numEntries)){
+      if(st.st_size > 0)
+        fprintf(stderr,"Starting a new result cache in %s (made by another build of bcalc, or of another size).\n",path);
+      if(numEntries == 0)
+        numEntries = RCACHE_DEF_SIZE;
+      /* truncated first, so that the new file is all zeros (empty slots and entries) */
+      if((ftruncate(c->fd,0) != 0)||(ftruncate(c->fd,(off_t)rcacheSize(numEntries)) != 0)){
+        printf("ERROR: Cannot create the result cache %s (%s).\n",path,strerror(errno));
+        close(c->fd);
+        return -1;
+      }
+      st.st_size = (off_t)rcacheSize(numEntries);
+    }else{
+      numEntries = 0; /* made by another run meanwhile */
+    }
+    flock(c->fd,LOCK_SH);
+  }
+
+  c->mapSize = (size_t)st.st_size;
+  map = mmap(NULL,c->mapSize,PROT_READ|PROT_WRITE,MAP_SHARED,c->fd,0);
+  if(map == MAP_FAILED){
+    printf("ERROR: Cannot map the result cache %s (%s).\n",path,strerror(errno));
+    close(c->fd);
+    return -1;
+  }
+  c->hdr = (rcacheHeader *)map;
+  if(numEntries > 0){
+    /* new cache (with the exclusive lock still held) */
+    c->hdr->version = RCACHE_VERSION;
+    c->hdr->entrySize = sizeof(rcacheEntry);
+    c->hdr->numEntries = numEntries;
+    c->hdr->numSlots = 2*numEntries;
+    snprintf(c->hdr->build,sizeof(c->hdr->build),"%s",rcacheBuild);
+    c->hdr->next = 1;
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(c->hdr->magic,RCACHE_MAGIC,8);
+  }
+  c->slot = (rcacheSlot *)(void *)((char *)map + sizeof(rcacheHeader));
+  c->ent = (rcacheEntry *)(void *)((char *)c->slot + (size_t)c->hdr->numSlots*sizeof(rcacheSlot));
+  c->slotMask = c->hdr->numSlots - 1;
+  c->entMask = c->hdr->numEntries - 1;
+  c->iccTab = tdef->iccTab;
+
+  /* everything besides the line that results depend on: the defaults (all values exactly, as hex
+  floats), how lines are read, and the conversion coefficient table */
+  n = snprintf(ctx,sizeof(ctx),"%s|%i|%a %i %i %.4s %a %a %i %i %i %a %a %a %i %a %i %a %i %i %i %i %i %i",rcacheBuild,inMode,
+               tdef->Et,tdef->L,tdef->EM,tdef->mstr,tdef->lt,tdef->b,tdef->calcMode,tdef->barn,tdef->bup,tdef->ji,tdef->jf,
+               tdef->delta,tdef->useDelta,tdef->branching,tdef->brrel,tdef->icc,tdef->calcB2,tdef->nucA,tdef->nucZ,
+               (tdef->iccTab != NULL),tdef->iccAuto,tdef->precision);
+  rcacheHash(ctx,(size_t)n,zero,c->seed);
+  if(tdef->iccTab != NULL)
+    rcacheHash((const char *)tdef->iccTab->map,tdef->iccTab->mapSize,c->seed,c->seed);
+  return 0;
+}
+
+/* adds the lookups of a chunk of input to the counts of the run */
+void rcacheAdd(rcache *c, const rcacheCtx *cc){
+  c->c.hits += cc->hits;
+  c->c.misses += cc->misses;
+  c->c.evictions += cc->evictions;
+}
+
+/* prints the hit and miss counts of the run to f, and closes the cache */
+void rcacheClose(rcache *c, FILE *f){
+  unsigned long n = c->c.hits + c->c.misses;
+  uint64_t used = __atomic_load_n(&c->hdr->next,__ATOMIC_RELAXED) - 1;
+  if(used > c->hdr->numEntries)
+    used = c->hdr->numEntries;
+  __atomic_add_fetch(&c->hdr->hits,c->c.hits,__ATOMIC_RELAXED);
+  __atomic_add_fetch(&c->hdr->misses,c->c.misses,__ATOMIC_RELAXED);
+  fprintf(f,"Result cache: %lu hits, %lu misses (%.1f%% hits), %lu evicted, %llu of %llu entries used.\n",
+          c->c.hits,c->c.misses,(n > 0) ? 100.*(double)c->c.hits/(double)n : 0.,c->c.evictions,
+          (unsigned long long)used,(unsigned long long)c->hdr->numEntries);
+  munmap(c->hdr,c->mapSize);
+  close(c->fd); /* also releases the lock */
+  c->hdr = NULL;
+}
+
+/* sets key to the hash of a line of batch input (not NUL terminated), without any whitespace at
+the end of the line
+returns 1 on success, or 0 for a blank or comment line */
+int rcacheKey(const rcache *c, const char *line, const size_t len, uint64_t *key){
+  const char *p = line;
+  size_t n = len;
+  while((p < line + n)&&isColSep(*p))
+    p++;
+  if((p == line + n)||(*p == '#'))
+    return 0;
+  while(isColSep(line[n-1]))
+    n--;
+  rcacheHash(line,n,c->seed,key);
+  return 1;
+}
+
+/* reads the entry at log position pos if it holds the given key, returns 1 if it does */
+static int rcacheRead(const rcache *c, const uint64_t pos, const uint64_t *key, bcalcTrans *t, bcalcRes *r, int *err){
+  const rcacheEntry *e = &c->ent[pos & c->entMask];
+  uint32_t s = __atomic_load_n(&e->seq,__ATOMIC_ACQUIRE);
+  if((s & 1)||(__atomic_load_n(&e->key[0],__ATOMIC_RELAXED) != key[0])||(__atomic_load_n(&e->key[1],__ATOMIC_RELAXED) != key[1]))
+    return 0;
+  *t = e->t;
+  *r = e->r;
+  *err = e->err;
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  if(__atomic_load_n(&e->seq,__ATOMIC_RELAXED) != s)
+    return 0; /* changed while it was read */
+  t->iccTab = c->iccTab;
+  return 1;
+}
+
+/* looks up the results for a key (first in the entry after the last one found in cc), setting t, r
+and err as they were calculated
+returns 1 if found, 0 if not */
+int rcacheGet(const rcache *c, const uint64_t *key, rcacheCtx *cc, bcalcTrans *t, bcalcRes *r, int *err){
+  const rcacheSlot *s;
+  uint64_t pos;
+  int i;
+  if((cc->last > 0)&&rcacheRead(c,cc->last + 1,key,t,r,err)){
+    cc->last++;
+    return 1;
+  }
+  for(i=0;i<RCACHE_PROBE;i++){
+    s = &c->slot[(key[0] + (uint64_t)i) & c->slotMask];
+    pos = __atomic_load_n(&s->pos,__ATOMIC_ACQUIRE);
+    if(pos == 0)
+      return 0; /* slots are filled in probe order and never emptied */
+    if((__atomic_load_n(&s->key,__ATOMIC_RELAXED) == key[0])&&rcacheRead(c,pos,key,t,r,err)){
+      cc->last = pos;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* appends the results for a key to the log (in the block of entries taken by cc), and enters it in
+the hash table, in the first slot searched which is empty, holds the same key or an entry which
+was overwritten, or else in place of the oldest entry
+results overwritten when the log wraps around are counted in cc */
+void rcachePut(const rcache *c, const uint64_t *key, rcacheCtx *cc, const bcalcTrans *t, const bcalcRes *r, const int err){
+  rcacheEntry *e;
+  rcacheSlot *s, *best = NULL;
+  uint64_t pos, spos, next, minPos = 0;
+  uint32_t seq;
+  int i;
+
+  if(cc->fill == cc->fillEnd){
+    cc->fill = __atomic_fetch_add(&c->hdr->next,RCACHE_BLOCK,__ATOMIC_RELAXED);
+    cc->fillEnd = cc->fill + RCACHE_BLOCK;
+  }
+  pos = cc->fill++;
+  e = &c->ent[pos & c->entMask];
+  seq = __atomic_load_n(&e->seq,__ATOMIC_RELAXED);
+  if((seq & 1)||!__atomic_compare_exchange_n(&e->seq,&seq,seq+1,0,__ATOMIC_ACQUIRE,__ATOMIC_RELAXED))
+    return; /* being written by another run which wrapped around the log */
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  if(__atomic_load_n(&e->key[0],__ATOMIC_RELAXED) != 0)
+    cc->evictions++; /* the log wrapped around */
+  __atomic_store_n(&e->key[0],key[0],__ATOMIC_RELAXED);
+  __atomic_store_n(&e->key[1],key[1],__ATOMIC_RELAXED);
+  e->err = err;
+  e->t = *t;
+  e->t.iccTab = NULL;
+  e->r = *r;
+  __atomic_store_n(&e->seq,seq+2,__ATOMIC_RELEASE);
+  cc->last = pos;
+
+  next = __atomic_load_n(&c->hdr->next,__ATOMIC_RELAXED);
+  for(i=0;i<RCACHE_PROBE;i++){
+    s = &c->slot[(key[0] + (uint64_t)i) & c->slotMask];
+    spos = __atomic_load_n(&s->pos,__ATOMIC_RELAXED);
+    if((spos == 0)||(spos + c->hdr->numEntries <= next)||(__atomic_load_n(&s->key,__ATOMIC_RELAXED) == key[0])){
+      best = s;
+      break;
+    }
+    if((best == NULL)||(spos < minPos)){
+      best = s;
+      minPos = spos;
+    }
+  }
+  __atomic_store_n(&best->key,key[0],__ATOMIC_RELAXED);
+  __atomic_store_n(&best->pos,pos,__ATOMIC_RELEASE);
+}
@@ -0,0 +1,626 @@
+/* interactive mode (--repl): holds the parameters of one transition, which are changed with
+commands such as 'set d 0.35' or 'set lt 2.1ns', and recalculates only the quantities that depend
+on what was changed
+The intermediate quantities (conversion coefficient, branching fraction, partial lifetimes, B
+values, beta_2, uncertainties) are the nodes of a small dependency graph: each node depends on some
+of the inputs and on nodes before it, so that a change of inputs marks the nodes to recalculate in
+one pass over the graph.  The nodes repeat the steps of the library calculation (bcalcCompute)
+exactly, so the results are identical. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <unistd.h>
+#include "bcalc.h"
+
+#define REPL_MAX_LINE 4096
+#define REPL_MAX_ARGS 64
+#define REPL_NAME_LEN 16 /* longest option name, with the leading dashes */
+
+/* inputs, as bits of a mask of changed inputs */
+#define REPL_IN_E     (1U << 0)  /* transition energy */
+#define REPL_IN_MULT  (1U << 1)  /* multipole */
+#define REPL_IN_LT    (1U << 2)  /* lifetime */
+#define REPL_IN_B     (1U << 3)  /* reduced transition probability */
+#define REPL_IN_MODE  (1U << 4)  /* calculation from a lifetime or from a B value */
+#define REPL_IN_UNITS (1U << 5)  /* --barn, --wu */
+#define REPL_IN_SPIN  (1U << 6)  /* spins, --up */
+#define REPL_IN_D     (1U << 7)  /* mixing ratio */
+#define REPL_IN_BR    (1U << 8)  /* branching fraction, --brrel */
+#define REPL_IN_ICC   (1U << 9)  /* conversion coefficient */
+#define REPL_IN_A     (1U << 10)
+#define REPL_IN_Z     (1U << 11)
+#define REPL_IN_BETA2 (1U << 12) /* --beta2 */
+#define REPL_IN_UNC   (1U << 13) /* uncertainties, number of samples and seed */
+#define REPL_IN_PREC  (1U << 14) /* --precision */
+#define REPL_IN_ALL   ((1U << 15) - 1)
+#define REPL_NODE(n)  (1U << (16 + (n))) /* a node, as a dependency of later nodes */
+
+/* nodes of the dependency graph, in dependency order */
+#define NODE_ICC       0 /* conversion coefficient (looked up in the table) */
+#define NODE_BR        1 /* branching fraction (from a relative intensity) */
+#define NODE_PLT       2 /* partial lifetimes of the L and L+1 multipoles */
+#define NODE_B         3 /* B of the L multipole */
+#define NODE_B1        4 /* B of the L+1 multipole */
+#define NODE_WU        5 /* B values in W.u., if other units are used */
+#define NODE_LT        6 /* (partial) lifetime from a B value */
+#define NODE_BETA2     7
+#define NODE_MC        8 /* uncertainties (Monte Carlo) */
+#define REPL_NUM_NODES 9
+
+typedef struct
+{
+  cmdOpts o; /* current parameters */
+  bcalcTrans tv; /* validated parameters (spins assumed for --up if unknown), without the table lookup */
+  bcalcRes r; /* current values: icc, branching, lt, lt1, b, b1, beta2, warn */
+  double bWu, b1Wu; /* B values in W.u. */
+  bcalcMCRes mc;
+  int has[REPL_NUM_NODES]; /* 1 if a node applies to the current parameters */
+  uint32_t dirty; /* nodes to recalculate (bit n for node n) */
+  int valid; /* 1 if the current parameters are valid */
+}replState;
+
+typedef struct
+{
+  uint32_t deps; /* inputs (REPL_IN_...) and nodes (REPL_NODE(n)) the node depends on */
+  int (*eval)(replState *); /* recalculates the node, returns an error code */
+}replNode;
+
+static int evalIcc(replState *s){
+  const bcalcTrans *t = &s->tv;
+  s->r.icc = t->icc;
+  s->has[NODE_ICC] = 0;
+  if((s->o.t.iccAuto)&&(t->iccTab != NULL)&&(t->nucZ > 0)&&(t->calcMode == 0)){
+    if(bcalcIccTrans(t->iccTab,t,&s->r.icc) != BCALC_OK)
+      return BCALC_ERR_ICCRANGE;
+    s->has[NODE_ICC] = 1;
+  }
+  return BCALC_OK;
+}
+
+static int evalBr(replState *s){
+  s->r.branching = s->tv.branching;
+  if(s->tv.brrel == 1)
+    s->r.branching = s->r.branching/(s->r.branching + 1.0);
+  s->has[NODE_BR] = s->tv.brrel;
+  return BCALC_OK;
+}
+
+static int evalPlt(replState *s){
+  const bcalcTrans *t = &s->tv;
+  double lt;
+  s->has[NODE_PLT] = (t->calcMode == 0);
+  if(t->calcMode != 0)
+    return BCALC_OK;
+  lt = 1.0/((1.0/t->lt)*s->r.branching); //partial lifetime
+  lt = lt*(1.0 + s->r.icc);
+  s->r.lt1 = 0.;
+  if(t->useDelta){
+    s->r.lt1 = lt * (1.0 + t->delta*t->delta) / (t->delta*t->delta);
+    lt = lt * (1.0 + t->delta*t->delta);
+  }
+  s->r.lt = lt;
+  return BCALC_OK;
+}
+
+static int evalB(replState *s){
+  const bcalcTrans *t = &s->tv;
+  s->has[NODE_B] = (t->calcMode == 0);
+  if(t->calcMode == 0)
+    s->r.b = calcBPrec(t->bup,t->EM,t->L,t->Et/1000.0,s->r.lt*1.0E-12,t->ji,t->jf,t->barn,t->nucA,t->precision);
+  return BCALC_OK;
+}
+
+static int evalB1(replState *s){
+  const bcalcTrans *t = &s->tv;
+  s->has[NODE_B1] = (t->calcMode == 0)&&(t->useDelta);
+  s->r.b1 = 0.;
+  if(s->has[NODE_B1])
+    s->r.b1 = calcBPrec(t->bup,!t->EM,t->L+1,t->Et/1000.0,s->r.lt1*1.0E-12,t->ji,t->jf,t->barn,t->nucA,t->precision);
+  return BCALC_OK;
+}
+
+static int evalWu(replState *s){
+  const bcalcTrans *t = &s->tv;
+  s->has[NODE_WU] = (t->calcMode == 0)&&(t->barn != 2)&&(t->nucA > 0);
+  if(!s->has[NODE_WU])
+    return BCALC_OK;
+  s->bWu = calcBPrec(t->bup,t->EM,t->L,t->Et/1000.0,s->r.lt*1.0E-12,t->ji,t->jf,2,t->nucA,t->precision);
+  if(t->useDelta)
+    s->b1Wu = calcBPrec(t->bup,!t->EM,t->L+1,t->Et/1000.0,s->r.lt1*1.0E-12,t->ji,t->jf,2,t->nucA,t->precision);
+  return BCALC_OK;
+}
+
+static int evalLt(replState *s){
+  const bcalcTrans *t = &s->tv;
+  s->has[NODE_LT] = (t->calcMode == 1);
+  if(t->calcMode == 1)
+    s->r.lt = calcLtPrec(t->bup,t->EM,t->L,t->Et/1000.0,t->b,t->ji,t->jf,t->barn,t->nucA,s->r.branching,t->precision);
+  return BCALC_OK;
+}
+
+static int evalBeta2(replState *s){
+  const bcalcTrans *t = &s->tv;
+  s->has[NODE_BETA2] = t->calcB2;
+  s->r.beta2 = 0.;
+  if(!t->calcB2)
+    return BCALC_OK;
+  if(t->calcMode == 0)
+    s->r.beta2 = calcBeta2LtPrec(t->Et/1000.0,s->r.lt*1.0E-12,t->nucA,t->nucZ,t->precision);
+  else
+    s->r.beta2 = calcBeta2Prec(t->Et/1000.0,t->b,t->nucA,t->nucZ,t->barn,t->precision);
+  return BCALC_OK;
+}
+
+static int evalMC(replState *s){
+  cmdOpts *o = &s->o;
+  s->has[NODE_MC] = o->useMC;
+  if(!o->useMC)
+    return BCALC_OK;
+  if(o->t.calcMode == 0){
+    o->unc.val[0] = o->ltUnc[0]*o->ltFac;
+    o->unc.val[1] = o->ltUnc[1]*o->ltFac;
+  }else{
+    o->unc.val[0] = o->bUnc[0];
+    o->unc.val[1] = o->bUnc[1];
+  }
+  return bcalcMonteCarlo(&o->t,&o->unc,o->numSamples,o->seed,o->numThreads,&s->mc);
+}
+
+static const replNode replNodes[REPL_NUM_NODES] = {
+  {REPL_IN_E|REPL_IN_MULT|REPL_IN_ICC|REPL_IN_Z|REPL_IN_MODE, evalIcc},
+  {REPL_IN_BR, evalBr},
+  {REPL_IN_LT|REPL_IN_D|REPL_IN_MODE|REPL_NODE(NODE_BR)|REPL_NODE(NODE_ICC), evalPlt},
+  {REPL_IN_E|REPL_IN_MULT|REPL_IN_SPIN|REPL_IN_UNITS|REPL_IN_A|REPL_IN_PREC|REPL_NODE(NODE_PLT), evalB},
+  {REPL_IN_E|REPL_IN_MULT|REPL_IN_SPIN|REPL_IN_UNITS|REPL_IN_A|REPL_IN_PREC|REPL_NODE(NODE_PLT), evalB1},
+  {REPL_IN_E|REPL_IN_MULT|REPL_IN_UNITS|REPL_IN_A|REPL_IN_PREC|REPL_NODE(NODE_PLT), evalWu},
+  {REPL_IN_E|REPL_IN_MULT|REPL_IN_B|REPL_IN_MODE|REPL_IN_SPIN|REPL_IN_UNITS|REPL_IN_A|REPL_IN_PREC|REPL_NODE(NODE_BR), evalLt},
+  {REPL_IN_E|REPL_IN_B|REPL_IN_MODE|REPL_IN_UNITS|REPL_IN_A|REPL_IN_Z|REPL_IN_BETA2|REPL_IN_PREC|REPL_NODE(NODE_PLT), evalBeta2},
+  {REPL_IN_ALL, evalMC},
+};
+
+/* returns the nodes (bit n for node n) depending, directly or not, on the given inputs */
+static uint32_t replAffected(const uint32_t changed){
+  uint32_t m = changed;
+  int i;
+  for(i=0;i<REPL_NUM_NODES;i++){
+    if(replNodes[i].deps & m)
+      m |= REPL_NODE(i);
+  }
+  return m >> 16;
+}
+
+/* returns the inputs which differ between two sets of parameters */
+static uint32_t replChanged(const cmdOpts *a, const cmdOpts *b){
+  const bcalcTrans *ta = &a->t, *tb = &b->t;
+  uint32_t c = 0;
+  if(ta->Et != tb->Et)
+    c |= REPL_IN_E;
+  if((ta->EM != tb->EM)||(ta->L != tb->L)||(strcmp(ta->mstr,tb->mstr) != 0))
+    c |= REPL_IN_MULT;
+  if(ta->lt != tb->lt)
+    c |= REPL_IN_LT;
+  if(ta->b != tb->b)
+    c |= REPL_IN_B;
+  if(ta->calcMode != tb->calcMode)
+    c |= REPL_IN_MODE;
+  if(ta->barn != tb->barn)
+    c |= REPL_IN_UNITS;
+  if((ta->bup != tb->bup)||(ta->ji != tb->ji)||(ta->jf != tb->jf))
+    c |= REPL_IN_SPIN;
+  if((ta->delta != tb->delta)||(ta->useDelta != tb->useDelta))
+    c |= REPL_IN_D;
+  if((ta->branching != tb->branching)||(ta->brrel != tb->brrel))
+    c |= REPL_IN_BR;
+  if((ta->icc != tb->icc)||(ta->iccAuto != tb->iccAuto))
+    c |= REPL_IN_ICC;
+  if(ta->nucA != tb->nucA)
+    c |= REPL_IN_A;
+  if(ta->nucZ != tb->nucZ)
+    c |= REPL_IN_Z;
+  if(ta->calcB2 != tb->calcB2)
+    c |= REPL_IN_BETA2;
+  if(ta->precision != tb->precision)
+    c |= REPL_IN_PREC;
+  if((a->useMC != b->useMC)||(a->ltFac != b->ltFac)||(memcmp(a->ltUnc,b->ltUnc,sizeof(a->ltUnc)) != 0)
+    ||(memcmp(a->bUnc,b->bUnc,sizeof(a->bUnc)) != 0)||(memcmp(&a->unc,&b->unc,sizeof(bcalcUnc)) != 0)
+    ||(a->numSamples != b->numSamples)||(a->seed != b->seed))
+    c |= REPL_IN_UNC;
+  return c;
+}
+
+/* formats a labelled B value */
+static void putB(strBuf *sb, const char *mstr, const int EM, const int L, const int barn, const double b){
+  char ustr[32];
+  getBUnit(ustr,sizeof(ustr),EM,L,barn);
+  sbPrintf(sb,"B(%s) = ",mstr);
+  sbPutExp(sb,b,4);
+  sbPutc(sb,' ');
+  sbPuts(sb,ustr);
+  sbPutc(sb,'\n');
+}
+
+/* formats the value(s) of a node (uncertainties in more detail if verbose) */
+static void printNode(strBuf *sb, const replState *s, const int n, const int verbose){
+  const bcalcTrans *t = &s->tv;
+  char mstr1[16], ustr[32], name[48];
+  getMixedMstr(mstr1,sizeof(mstr1),t);
+  switch(n){
+    case NODE_ICC:
+      sbPrintf(sb,"Internal conversion coefficient: %0.3f (from table)\n",s->r.icc);
+      break;
+    case NODE_BR:
+      putFraction(sb,"Branching fraction",s->r.branching);
+      break;
+    case NODE_PLT:
+      if(t->useDelta){
+        snprintf(name,sizeof(name),"Partial lifetime (%s)",t->mstr);
+        putLifetime(sb,name,s->r.lt);
+        snprintf(name,sizeof(name),"Partial lifetime (%s)",mstr1);
+        putLifetime(sb,name,s->r.lt1);
+      }else{
+        putLifetime(sb,"Partial lifetime",s->r.lt);
+      }
+      break;
+    case NODE_B:
+      putB(sb,t->mstr,t->EM,t->L,t->barn,s->r.b);
+      break;
+    case NODE_B1:
+      putB(sb,mstr1,!t->EM,t->L+1,t->barn,s->r.b1);
+      break;
+    case NODE_WU:
+      putB(sb,t->mstr,t->EM,t->L,2,s->bWu);
+      if(t->useDelta)
+        putB(sb,mstr1,!t->EM,t->L+1,2,s->b1Wu);
+      break;
+    case NODE_LT:
+      sbPuts(sb,"Lifetime = ");
+      sbPutExp(sb,s->r.lt,4);
+      sbPuts(sb,(s->r.branching != 1.) ? " ps (partial lifetime)\n" : " ps\n");
+      break;
+    case NODE_BETA2:
+      sbPuts(sb,"beta_2 = ");
+      sbPutExp(sb,s->r.beta2,4);
+      sbPutc(sb,'\n');
+      break;
+    case NODE_MC:
+      if(t->calcMode == 0){
+        getBUnit(ustr,sizeof(ustr),t->EM,t->L,t->barn);
+        snprintf(name,sizeof(name),"B(%s)",t->mstr);
+        printDist(sb,verbose,name,ustr,&s->mc.b);
+        if(t->useDelta){
+          getBUnit(ustr,sizeof(ustr),!t->EM,t->L+1,t->barn);
+          snprintf(name,sizeof(name),"B(%s)",mstr1);
+          printDist(sb,verbose,name,ustr,&s->mc.b1);
+        }
+      }else{
+        printDist(sb,verbose,"lifetime","ps",&s->mc.lt);
+      }
+      if(t->calcB2){
+        printDist(sb,verbose,"beta_2","",&s->mc.beta2);
+      }
+      if(s->mc.numBad > 0){
+        sbPrintf(sb,"WARNING: %lu of %lu samples gave no finite result and were excluded.\n",s->mc.numBad,s->o.numSamples);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+/* recalculates the nodes depending on the changed inputs (and any left over from earlier
+changes which could not be calculated), and formats the new values if sb is not NULL
+returns an error code */
+static int replUpdate(replState *s, const uint32_t changed, strBuf *sb){
+  int i, err;
+  s->dirty |= replAffected(changed);
+  s->tv = s->o.t;
+  s->tv.iccAuto = 0; /* the table lookup is done by its own node */
+  s->valid = 0;
+  if((err = bcalcValidate(&s->tv,&s->r.warn)) != BCALC_OK)
+    return err;
+  if((sb != NULL)&&(s->r.warn)&&(changed & REPL_IN_SPIN))
+    sbPrintf(sb,"WARNING: Initial and final spin unknown for B(%s) up, assuming a 2 -> 0 transition.\n",s->tv.mstr);
+  for(i=0;i<REPL_NUM_NODES;i++){
+    if(!(s->dirty & (1U << i)))
+      continue;
+    if((err = replNodes[i].eval(s)) != BCALC_OK)
+      return err;
+    s->dirty &= ~(1U << i);
+    if((sb != NULL)&&(s->has[i]))
+      printNode(sb,s,i,0);
+  }
+  s->valid = 1;
+  return BCALC_OK;
+}
+
+/* formats all values, as for a single calculation */
+static void replShow(strBuf *sb, const replState *s){
+  printResult(sb,&s->o.t,&s->r,1);
+  if(s->has[NODE_WU]){
+    sbPuts(sb,"\n");
+    printNode(sb,s,NODE_WU,0);
+  }
+  if(s->has[NODE_MC]){
+    sbPrintf(sb,"\nUNCERTAINTIES (%lu samples, seed %llu)\n--------------------------------------\n",s->o.numSamples,(unsigned long long)s->o.seed);
+    printNode(sb,s,NODE_MC,1);
+  }
+}
+
+static void replHelp(void){
+  printf("Commands:\n");
+  printf("  set NAME VALUE ...  --  set transition parameters or uncertainties, eg.\n");
+  printf("                          set d 0.35, set lt 2.1ns, set m M1 icc 0.02,\n");
+  printf("                          set lterr 0.1, or as on the command line:\n");
+  printf("                          set -hlus 1.5 -br 0.4\n");
+  printf("  set FLAG ...        --  set a flag (up, beta2, barn, wu, brrel)\n");
+  printf("  unset NAME ...      --  remove an optional parameter, uncertainty or flag\n");
+  printf("                          (eg. unset d, unset icc, unset wu)\n");
+  printf("  show                --  show all parameters and results\n");
+  printf("  help                --  show this list\n");
+  printf("  quit                --  end the session\n");
+}
+
+/* finds the option for a name given in a command, with or without the leading dashes
+(eg. d, lt, wu or -d, -lt, --wu) */
+static const optDef *replFindOpt(const char *name, char *oname){
+  const optDef *od;
+  if((name[0] == '-')||(strlen(name) > REPL_NAME_LEN-3)){
+    snprintf(oname,REPL_NAME_LEN,"%s",name);
+    return findOpt(name,strlen(name));
+  }
+  snprintf(oname,REPL_NAME_LEN,"-%s",name);
+  if((od = findOpt(oname,strlen(oname))) != NULL)
+    return od;
+  snprintf(oname,REPL_NAME_LEN,"--%s",name);
+  return findOpt(oname,strlen(oname));
+}
+
+/* returns 1 if an option can be changed during a session */
+static int replAllowed(const optDef *od){
+  return (od->scope == OPT_SCOPE_TRANS)||((od->id >= OPT_EERR)&&(od->id <= OPT_SEED));
+}
+
+/* 'set' command: translates the arguments into command line options (with lifetime units given
+as a suffix of the value, eg. lt 2.1ns -> -ltns 2.1) and parses them into o */
+static int replSet(char **arg, const int n, cmdOpts *o, char *estr, const size_t estrLen){
+  char oname[REPL_MAX_ARGS][REPL_NAME_LEN];
+  const char *argv[REPL_MAX_ARGS];
+  const optDef *od;
+  size_t len, k;
+  int i, argc = 0, err;
+
+  for(i=0;i<n;i++){
+    if((od = replFindOpt(arg[i],oname[argc])) == NULL){
+      snprintf(estr,estrLen,"unknown parameter '%s' (type help for the commands).",arg[i]);
+      return OPT_ERR_PARSE;
+    }
+    if(!replAllowed(od)){
+      snprintf(estr,estrLen,"%s cannot be changed in an interactive session.",od->name);
+      return OPT_ERR_PARSE;
+    }
+    argv[argc] = oname[argc];
+    argc++;
+    if(od->val == OPT_VAL_NONE)
+      continue;
+    if(i == n-1){
+      snprintf(estr,estrLen,"missing value for %s.",od->name);
+      return OPT_ERR_PARSE;
+    }
+    i++;
+    if((od->id == OPT_LT)&&(arg[i-1][0] != '-')){
+      /* units as a suffix of the value */
+      len = strlen(arg[i]);
+      for(k=len;(k>0)&&isalpha((unsigned char)arg[i][k-1]);k--);
+      if((k < len)&&(k > 0)){
+        if(strlen(oname[argc-1]) + (len-k) >= REPL_NAME_LEN){
+          snprintf(estr,estrLen,"unknown lifetime unit '%s'.",arg[i]+k);
+          return OPT_ERR_PARSE;
+        }
+        strcat(oname[argc-1],arg[i]+k);
+        if(findOpt(oname[argc-1],strlen(oname[argc-1])) == NULL){
+          snprintf(estr,estrLen,"unknown lifetime unit '%s' (use ps, ns, us, s or h).",arg[i]+k);
+          return OPT_ERR_PARSE;
+        }
+        arg[i][k] = '\0';
+      }
+    }
+    argv[argc++] = arg[i];
+  }
+  err = parseCmdArgs(argc,argv,o,estr,estrLen);
+  if((err == BCALC_OK)&&(o->sweep)){
+    snprintf(estr,estrLen,"ranges cannot be used in an interactive session.");
+    return OPT_ERR_PARSE;
+  }
+  return err;
+}
+
+/* 'unset' command: resets optional parameters, uncertainties and flags to their defaults */
+static int replUnset(char **arg, const int n, cmdOpts *o, char *estr, const size_t estrLen){
+  char oname[REPL_NAME_LEN];
+  bcalcTrans *t = &o->t;
+  const optDef *od;
+  int i;
+
+  for(i=0;i<n;i++){
+    if((od = replFindOpt(arg[i],oname)) == NULL){
+      snprintf(estr,estrLen,"unknown parameter '%s' (type help for the commands).",arg[i]);
+      return OPT_ERR_PARSE;
+    }
+    switch(od->id){
+      case OPT_D:
+        t->delta = 0.;
+        t->useDelta = 0;
+        break;
+      case OPT_BR:
+        t->branching = 1.;
+        break;
+      case OPT_ICC:
+        t->icc = 0.;
+        t->iccAuto = (t->iccTab != NULL);
+        o->iccSet = 0;
+        break;
+      case OPT_A:
+        t->nucA = -1;
+        break;
+      case OPT_Z:
+        t->nucZ = -1;
+        break;
+      case OPT_NUC:
+        t->nucA = -1;
+        t->nucZ = -1;
+        break;
+      case OPT_JI:
+        t->ji = -1.;
+        break;
+      case OPT_JF:
+        t->jf = -1.;
+        break;
+      case OPT_UP:
+        t->bup = 0;
+        break;
+      case OPT_BETA2:
+        t->calcB2 = 0;
+        break;
+      case OPT_BARN:
+        if(t->barn & 1)
+          t->barn -= 1;
+        break;
+      case OPT_WU:
+        if(t->barn >= 2)
+          t->barn -= 2;
+        break;
+      case OPT_BRREL:
+        t->brrel = 0;
+        break;
+      case OPT_PRECISION:
+        t->precision = BCALC_PREC_DEFAULT;
+        break;
+      case OPT_EERR:
+        memset(o->unc.Et,0,sizeof(o->unc.Et));
+        break;
+      case OPT_LTERR:
+        memset(o->ltUnc,0,sizeof(o->ltUnc));
+        break;
+      case OPT_BERR:
+        memset(o->bUnc,0,sizeof(o->bUnc));
+        break;
+      case OPT_BRERR:
+        memset(o->unc.branching,0,sizeof(o->unc.branching));
+        break;
+      case OPT_DERR:
+        memset(o->unc.delta,0,sizeof(o->unc.delta));
+        break;
+      case OPT_ICCERR:
+        memset(o->unc.icc,0,sizeof(o->unc.icc));
+        break;
+      default:
+        snprintf(estr,estrLen,"%s cannot be unset.",od->name);
+        return OPT_ERR_PARSE;
+    }
+  }
+  /* uncertainties are propagated while any are left */
+  o->useMC = (o->unc.Et[0] > 0.)||(o->unc.Et[1] > 0.)||(o->ltUnc[0] > 0.)||(o->ltUnc[1] > 0.)
+    ||(o->bUnc[0] > 0.)||(o->bUnc[1] > 0.)||(o->unc.branching[0] > 0.)||(o->unc.branching[1] > 0.)
+    ||(o->unc.delta[0] > 0.)||(o->unc.delta[1] > 0.)||(o->unc.icc[0] > 0.)||(o->unc.icc[1] > 0.);
+  return BCALC_OK;
+}
+
+/* splits a line into words (NUL terminated in place), returns the number of words or -1 if too many */
+static int replSplit(char *line, char **arg){
+  char *p = line;
+  int n = 0;
+  while(*p != '\0'){
+    while(isspace((unsigned char)*p))
+      p++;
+    if(*p == '\0')
+      break;
+    if(n >= REPL_MAX_ARGS)
+      return -1;
+    arg[n++] = p;
+    while((*p != '\0')&&(!isspace((unsigned char)*p)))
+      p++;
+    if(*p != '\0')
+      *p++ = '\0';
+  }
+  return n;
+}
+
+/* runs an interactive session, starting from the parameters on the command line */
+int runRepl(const cmdOpts *o){
+
+  replState s;
+  cmdOpts no;
+  strBuf out;
+  char line[REPL_MAX_LINE], estr[256];
+  char *arg[REPL_MAX_ARGS];
+  uint32_t changed;
+  int n, err;
+  int tty = isatty(STDIN_FILENO);
+
+  memset(&s,0,sizeof(replState));
+  s.o = *o;
+  if(s.o.numThreads == 0){
+    s.o.numThreads = getNumCPUs();
+  }
+  sbInit(&out);
+  if(o->verbose && tty){
+    printf("bcalc interactive session, type help for the commands.\n");
+  }
+  if(replUpdate(&s,REPL_IN_ALL,NULL) == BCALC_OK){
+    replShow(&out,&s);
+    sbFlush(&out,stdout);
+  }
+
+  while(1){
+    if(tty){
+      printf("> ");
+      fflush(stdout);
+    }
+    if(fgets(line,sizeof(line),stdin) == NULL)
+      break;
+    if((n = replSplit(line,arg)) < 0){
+      printf("ERROR: too many words in a command.\n");
+      continue;
+    }
+    if(n == 0)
+      continue;
+    err = BCALC_OK;
+    if((strcmp(arg[0],"quit") == 0)||(strcmp(arg[0],"exit") == 0)||(strcmp(arg[0],"q") == 0)){
+      break;
+    }else if(strcmp(arg[0],"help") == 0){
+      replHelp();
+      continue;
+    }else if(strcmp(arg[0],"show") == 0){
+      if((s.valid)||((err = replUpdate(&s,0,NULL)) == BCALC_OK)){
+        replShow(&out,&s);
+        sbFlush(&out,stdout);
+      }
+    }else if((strcmp(arg[0],"set") == 0)||(strcmp(arg[0],"unset") == 0)){
+      /* changes are made to a copy, and only kept if they are all accepted */
+      no = s.o;
+      if(arg[0][0] == 's')
+        err = replSet(arg+1,n-1,&no,estr,sizeof(estr));
+      else
+        err = replUnset(arg+1,n-1,&no,estr,sizeof(estr));
+      if(err == BCALC_OK){
+        changed = replChanged(&s.o,&no);
+        s.o = no;
+        err = replUpdate(&s,changed,&out);
+        sbFlush(&out,stdout);
+      }else if(err == OPT_ERR_PARSE){
+        printf("ERROR: %s\n",estr);
+        continue;
+      }
+    }else{
+      printf("ERROR: unknown command '%s' (type help for the commands).\n",arg[0]);
+      continue;
+    }
+    if(err != BCALC_OK){
+      printErr(err,&s.o.t);
+    }
+    fflush(stdout);
+  }
+  sbFree(&out);
+
+  return 0;
+}
@@ -0,0 +1,375 @@
+/* built-in self check of the library calculations */
+
+#include <stdint.h>
+#include "bcalc.h"
+
+static uint64_t stRngState = 0x2545F4914F6CDD1DULL;
+
+/* xorshift64* generator, returns a uniform deviate in [0,1) */
+static double stRand(void){
+  stRngState ^= stRngState >> 12;
+  stRngState ^= stRngState << 25;
+  stRngState ^= stRngState >> 27;
+  return (double)((stRngState*0x2545F4914F6CDD1DULL) >> 11)*(1.0/9007199254740992.0);
+}
+
+/* returns a log-uniform deviate in [min,max) */
+static double stRandLog(const double min, const double max){
+  return min*pow(max/min,stRand());
+}
+
+/* returns the distance between two doubles in units in the last place */
+double ulpDist(const double a, const double b){
+  int64_t ia, ib;
+  if(a == b)
+    return 0.;
+  if(isnan(a) || isnan(b))
+    return (isnan(a) && isnan(b)) ? 0. : HUGE_VAL;
+  memcpy(&ia,&a,sizeof(ia));
+  memcpy(&ib,&b,sizeof(ib));
+  /* map to a monotonic integer representation */
+  if(ia < 0)
+    ia = INT64_MIN - ia;
+  if(ib < 0)
+    ib = INT64_MIN - ib;
+  return (ia > ib) ? (double)((uint64_t)ia - (uint64_t)ib) : (double)((uint64_t)ib - (uint64_t)ia);
+}
+
+/* returns the relative difference of a value from a reference (0 if both are not finite) */
+static double relDiff(const double v, const double ref){
+  if(!isfinite(ref))
+    return (v == ref) ? 0. : HUGE_VAL;
+  if(v == ref)
+    return 0.;
+  if(!isfinite(v))
+    return HUGE_VAL;
+  return fabs(v - ref)/fabs(ref);
+}
+
+/* compares the array kernels against the scalar calculation over the supported
+domain of multipoles, units and input values, in the default and fast (BCALC_PREC_FAST) tiers
+returns 0 if all checks passed */
+int selfTestArr(void){
+
+  const size_t n = 1003; /* not a multiple of the vector width, so the scalar tail is also checked */
+  double *Et = malloc(n*sizeof(double));
+  double *val = malloc(n*sizeof(double));
+  double *br = malloc(n*sizeof(double));
+  double *icc = malloc(n*sizeof(double));
+  double *delta = malloc(n*sizeof(double));
+  double *ref = malloc(n*sizeof(double));
+  double *ref1 = malloc(n*sizeof(double));
+  double *res = malloc(n*sizeof(double));
+  double *res1 = malloc(n*sizeof(double));
+  double maxUlp[BCALC_NUM_KERNELS], maxRelFast[BCALC_NUM_KERNELS];
+  unsigned long numCmp[BCALC_NUM_KERNELS];
+  bcalcArrIn in;
+  bcalcArrOut out;
+  bcalcTrans t;
+  bcalcRes r;
+  int EM, L, calcMode, barn, mix, bup, k, err;
+  int fail = 0;
+  size_t i;
+  double d;
+
+  if((Et==NULL)||(val==NULL)||(br==NULL)||(icc==NULL)||(delta==NULL)||(ref==NULL)||(ref1==NULL)||(res==NULL)||(res1==NULL)){
+    printf("ERROR: Cannot allocate memory for the self check.\n");
+    exit(-1);
+  }
+  for(k=0;k<BCALC_NUM_KERNELS;k++){
+    maxUlp[k] = 0.;
+    maxRelFast[k] = 0.;
+    numCmp[k] = 0;
+  }
+
+  for(EM=0;EM<2;EM++){
+    for(L=EM;L<=BCALC_MAXL;L++){
+      for(calcMode=0;calcMode<2;calcMode++){
+        for(barn=0;barn<3;barn++){
+          for(mix=0;mix<2;mix++){
+            for(bup=0;bup<2;bup++){
+
+              if((calcMode==1)&&(mix==1))
+                continue;
+
+              bcalcInitTrans(&in.t);
+              in.t.EM = EM;
+              in.t.L = L;
+              snprintf(in.t.mstr,sizeof(in.t.mstr),"%c%i",EM ? 'M' : 'E',L);
+              in.t.calcMode = calcMode;
+              in.t.barn = barn;
+              in.t.bup = bup;
+              in.t.ji = 2.5;
+              in.t.jf = 0.5;
+              in.t.nucA = 1 + (int)(stRand()*299.);
+              in.n = n;
+              for(i=0;i<n;i++){
+                Et[i] = stRandLog(10.,10000.);
+                val[i] = (calcMode==0) ? stRandLog(1.0E-6,1.0E15) : stRandLog(1.0E-6,1.0E6);
+                br[i] = stRandLog(0.001,1.);
+                icc[i] = stRandLog(1.0E-4,10.);
+                d = stRandLog(0.001,1000.);
+                delta[i] = (stRand() < 0.5) ? -d : d;
+              }
+              in.Et = Et;
+              in.val = val;
+              in.branching = br;
+              in.icc = (calcMode==0) ? icc : NULL;
+              in.delta = mix ? delta : NULL;
+
+              /* reference: one transition at a time */
+              for(i=0;i<n;i++){
+                t = in.t;
+                t.Et = Et[i];
+                if(calcMode==0)
+                  t.lt = val[i];
+                else
+                  t.b = val[i];
+                t.branching = br[i];
+                if(in.icc != NULL)
+                  t.icc = icc[i];
+                if(mix){
+                  t.delta = delta[i];
+                  t.useDelta = 1;
+                }
+                if((err=bcalcCompute(&t,&r))!=BCALC_OK){
+                  printf("ERROR: self check transition rejected (%s)\n",bcalcErrStr(err));
+                  exit(-1);
+                }
+                ref[i] = (calcMode==0) ? r.b : r.lt;
+                ref1[i] = r.b1;
+              }
+
+              for(k=BCALC_KERNEL_SCALAR;k<BCALC_NUM_KERNELS;k++){
+                if(!bcalcKernelAvail(k))
+                  continue;
+                out.val = res;
+                out.val1 = mix ? res1 : NULL;
+                if((err=bcalcComputeArrKernel(&in,&out,k))!=BCALC_OK){
+                  printf("ERROR: %s array kernel failed (%s)\n",bcalcKernelName(k),bcalcErrStr(err));
+                  fail = 1;
+                  continue;
+                }
+                for(i=0;i<n;i++){
+                  d = ulpDist(ref[i],res[i]);
+                  if(mix && (ulpDist(ref1[i],res1[i]) > d))
+                    d = ulpDist(ref1[i],res1[i]);
+                  if(d > maxUlp[k])
+                    maxUlp[k] = d;
+                  numCmp[k]++;
+                }
+                in.t.precision = BCALC_PREC_FAST;
+                err = bcalcComputeArrKernel(&in,&out,k);
+                in.t.precision = BCALC_PREC_DEFAULT;
+                if(err != BCALC_OK){
+                  printf("ERROR: %s fast array kernel failed (%s)\n",bcalcKernelName(k),bcalcErrStr(err));
+                  fail = 1;
+                  continue;
+                }
+                for(i=0;i<n;i++){
+                  d = relDiff(res[i],ref[i]);
+                  if(mix && (relDiff(res1[i],ref1[i]) > d))
+                    d = relDiff(res1[i],ref1[i]);
+                  if(d > maxRelFast[k])
+                    maxRelFast[k] = d;
+                }
+              }
+
+            }
+          }
+        }
+      }
+    }
+  }
+
+  printf("Array kernels vs. scalar calculation (bound: %i ulp)\n",BCALC_ARR_MAXULP);
+  for(k=BCALC_KERNEL_SCALAR;k<BCALC_NUM_KERNELS;k++){
+    if(!bcalcKernelAvail(k)){
+      printf("  %-8s  not available\n",bcalcKernelName(k));
+      continue;
+    }
+    /* the scalar kernel must reproduce the scalar calculation exactly */
+    if((k == BCALC_KERNEL_SCALAR) ? (maxUlp[k] > 0.) : (maxUlp[k] > BCALC_ARR_MAXULP)){
+      fail = 1;
+    }
+    printf("  %-8s  %lu values, max difference %.0f ulp  %s\n",bcalcKernelName(k),numCmp[k],maxUlp[k],
+      ((k == BCALC_KERNEL_SCALAR) ? (maxUlp[k] > 0.) : (maxUlp[k] > BCALC_ARR_MAXULP)) ? "FAIL" : "ok");
+  }
+  printf("Fast array kernels vs. scalar calculation (bound: %.1E relative)\n",BCALC_PREC_FAST_MAXREL);
+  for(k=BCALC_KERNEL_SCALAR;k<BCALC_NUM_KERNELS;k++){
+    if(!bcalcKernelAvail(k)){
+      printf("  %-8s  not available\n",bcalcKernelName(k));
+      continue;
+    }
+    if(maxRelFast[k] > BCALC_PREC_FAST_MAXREL)
+      fail = 1;
+    printf("  %-8s  %lu values, max relative error %.2E  %s\n",bcalcKernelName(k),numCmp[k],maxRelFast[k],
+      (maxRelFast[k] > BCALC_PREC_FAST_MAXREL) ? "FAIL" : "ok");
+  }
+
+  free(Et);
+  free(val);
+  free(br);
+  free(icc);
+  free(delta);
+  free(ref);
+  free(ref1);
+  free(res);
+  free(res1);
+  return fail;
+}
+
+/* measures the error of each precision tier against BCALC_PREC_EXACT over the supported domain of
+multipoles, units, energies (1 keV to 100 MeV) and mass numbers, including beta_2 from calculated
+nuclear radii
+returns 0 if the errors are within their bounds */
+int selfTestPrec(void){
+
+  const int n = 1000; /* transitions per multipole and set of options */
+  const double bound[BCALC_NUM_PREC] = {BCALC_PREC_DEFAULT_MAXREL, BCALC_PREC_FAST_MAXREL, 0.};
+  double maxRel[BCALC_NUM_PREC], ref[4], d;
+  unsigned long numCmp[BCALC_NUM_PREC];
+  bcalcTrans t;
+  bcalcRes r;
+  int EM, L, calcMode, barn, mix, bup, p, i, j, err;
+  int fail = 0;
+
+  for(p=0;p<BCALC_NUM_PREC;p++){
+    maxRel[p] = 0.;
+    numCmp[p] = 0;
+  }
+
+  for(EM=0;EM<2;EM++){
+    for(L=EM;L<=BCALC_MAXL;L++){
+      for(calcMode=0;calcMode<2;calcMode++){
+        for(barn=0;barn<3;barn++){
+          for(mix=0;mix<2;mix++){
+            for(bup=0;bup<2;bup++){
+
+              if((calcMode==1)&&(mix==1))
+                continue;
+
+              for(i=0;i<n;i++){
+                bcalcInitTrans(&t);
+                t.EM = EM;
+                t.L = L;
+                snprintf(t.mstr,sizeof(t.mstr),"%c%i",EM ? 'M' : 'E',L);
+                t.calcMode = calcMode;
+                t.barn = barn;
+                t.bup = bup;
+                t.ji = 2.5;
+                t.jf = 0.5;
+                t.nucA = 1 + (int)(stRand()*299.);
+                t.Et = stRandLog(1.,100000.);
+                if(calcMode==0)
+                  t.lt = stRandLog(1.0E-6,1.0E15);
+                else
+                  t.b = stRandLog(1.0E-6,1.0E6);
+                t.branching = stRandLog(0.001,1.);
+                if(calcMode==0)
+                  t.icc = stRandLog(1.0E-4,10.);
+                if(mix){
+                  d = stRandLog(0.001,1000.);
+                  t.delta = (stRand() < 0.5) ? -d : d;
+                  t.useDelta = 1;
+                }
+                /* beta_2 of 2 -> 0 E2 transitions, with Z chosen so that most nuclides have no
+                tabulated radius */
+                if((EM==0)&&(L==2)&&(bup==0)&&(mix==0)){
+                  t.calcB2 = 1;
+                  t.ji = 2.;
+                  t.jf = 0.;
+                  t.nucZ = 1 + (int)(stRand()*(double)((t.nucA < BCALC_NUC_MAXZ) ? t.nucA : BCALC_NUC_MAXZ));
+                }
+
+                t.precision = BCALC_PREC_EXACT;
+                if((err=bcalcCompute(&t,&r))!=BCALC_OK){
+                  printf("ERROR: self check transition rejected (%s)\n",bcalcErrStr(err));
+                  exit(-1);
+                }
+                ref[0] = r.lt;
+                ref[1] = r.b;
+                ref[2] = r.b1;
+                ref[3] = r.beta2;
+                for(p=0;p<BCALC_NUM_PREC;p++){
+                  if(p == BCALC_PREC_EXACT)
+                    continue;
+                  t.precision = p;
+                  bcalcCompute(&t,&r);
+                  for(j=0;j<4;j++){
+                    d = relDiff((j==0) ? r.lt : (j==1) ? r.b : (j==2) ? r.b1 : r.beta2,ref[j]);
+                    if(d > maxRel[p])
+                      maxRel[p] = d;
+                  }
+                  numCmp[p]++;
+                }
+              }
+
+            }
+          }
+        }
+      }
+    }
+  }
+
+  printf("Precision tiers vs. exact (long double) calculation\n");
+  for(p=0;p<BCALC_NUM_PREC;p++){
+    if(p == BCALC_PREC_EXACT){
+      printf("  %-8s  reference\n",bcalcPrecisionName(p));
+      continue;
+    }
+    if(maxRel[p] > bound[p])
+      fail = 1;
+    printf("  %-8s  %lu transitions, max relative error %.2E (bound %.1E)  %s\n",bcalcPrecisionName(p),numCmp[p],maxRel[p],bound[p],
+      (maxRel[p] > bound[p]) ? "FAIL" : "ok");
+  }
+  return fail;
+}
+
+/* batch input lines with the expected text output, checking that invalid fields are reported
+rather than calculated with a default value */
+static const char *const stBatchCase[][2] = {
+  {"500 E2 1","B(E2) = 2.6069E+04 e^2 fm^4\n"},
+  {"500 E2 abc","ERROR: line 1, column 8: invalid value 'abc' in field 3.\n"},
+  {"500 E2 1 0.5 x","ERROR: line 1, column 14: invalid value 'x' in field 5.\n"},
+  {"500 X2 1","ERROR: line 1: invalid multipole value.\n"},
+  {"500 E2","ERROR: line 1: at least 3 columns (energy, multipole, lifetime) are needed.\n"},
+  {"# comment",""},
+};
+
+/* checks the parsing of batch input lines
+returns 0 if all lines give the expected output */
+int selfTestBatch(void){
+  const int numCase = (int)(sizeof(stBatchCase)/sizeof(stBatchCase[0]));
+  bcalcTrans tdef;
+  strBuf sb;
+  int i, numFail = 0;
+  bcalcInitTrans(&tdef);
+  sbInit(&sb);
+  for(i=0;i<numCase;i++){
+    sb.len = 0;
+    processLine(stBatchCase[i][0],strlen(stBatchCase[i][0]),1,&tdef,BATCH_LT,OUT_TEXT,&sb,NULL,NULL,NULL,NULL);
+    if((sb.len != strlen(stBatchCase[i][1]))||(memcmp(sb.data,stBatchCase[i][1],sb.len) != 0)){
+      printf("  '%s' gave '%.*s'\n",stBatchCase[i][0],(int)sb.len,sb.data);
+      numFail++;
+    }
+  }
+  sbFree(&sb);
+  printf("Batch input parsing\n");
+  printf("  %i lines, %i unexpected  %s\n",numCase,numFail,(numFail > 0) ? "FAIL" : "ok");
+  return (numFail > 0);
+}
+
+/* runs all self checks, returns 0 if all passed */
+int runSelfTest(void){
+  int fail = 0;
+  fail |= selfTestArr();
+  fail |= selfTestPrec();
+  fail |= selfTestBatch();
+  if(fail){
+    printf("Self check FAILED.\n");
+  }else{
+    printf("Self check passed.\n");
+  }
+  return fail;
+}
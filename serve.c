@@ -0,0 +1,302 @@
+/* server mode: answers calculation requests from clients connected to a Unix domain socket
+Each request is one line with the same parameters as the command line (eg. '-e 1332 -m E2 -lt 0.9'),
+each answer is one line containing the JSON record of the calculation (as written by --format json)
+with an "ok" member added.  Requests from a client are answered in order,
+and clients may send many requests without waiting for the answers.  All clients are handled by a
+single thread using epoll. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include "bcalc.h"
+
+#define SERVE_MAX_EVENTS  64
+#define SERVE_MAX_LINE    65536 /* maximum request length, longer requests close the connection */
+#define SERVE_MAX_ARGS    64 /* maximum number of words in a request */
+#define SERVE_READ_SIZE   65536
+#define SERVE_MAX_OUT     4194304 /* unsent answers (bytes) above which a client's requests are not read */
+
+typedef struct
+{
+  int fd;
+  char *in; /* unprocessed input */
+  size_t inLen, inCap;
+  strBuf out; /* answers not yet written */
+  size_t outPos; /* start of the unwritten part of out */
+  unsigned long lineNum; /* number of request lines received */
+  uint32_t events; /* epoll events waited for */
+  int closing; /* 1 once the client has closed its end, the connection is closed when out is written */
+}serveConn;
+
+static volatile sig_atomic_t serveQuit = 0;
+
+static void serveSignal(int sig){
+  (void)sig;
+  serveQuit = 1;
+}
+
+/* appends the answer to a request: the JSON record of the calculation (see formatRecord), with
+"ok" added at the end
+err is a BCALC_ERR code, or BCOL_ERR_PARSE for a malformed request (t and r are then not used) */
+static void serveAnswer(strBuf *sb, const unsigned long lineNum, const bcalcTrans *t, const bcalcRes *r, const int err, const char *msg){
+  formatRecord(sb,OUT_JSON,lineNum,t,r,err,msg);
+  sb->len -= 2; /* closing brace and newline of the record */
+  sbPuts(sb,(err == BCALC_OK) ? ",\"ok\":true}\n" : ",\"ok\":false}\n");
+}
+
+/* answers request line lineNum of a connection (not NUL terminated), appending the answer to sb */
+void serveRequest(const char *line, const size_t len, const unsigned long lineNum, const bcalcTrans *tdef, strBuf *sb){
+  const char *argv[SERVE_MAX_ARGS];
+  size_t argLen[SERVE_MAX_ARGS];
+  char estr[256];
+  const char *p = line;
+  const char *end = line + len;
+  bcalcTrans t;
+  bcalcRes r;
+  int argc = 0;
+  int bad, err;
+
+  /* split into words */
+  while(p < end){
+    while((p < end)&&((*p == ' ')||(*p == '\t')||(*p == '\r')))
+      p++;
+    if(p == end)
+      break;
+    if(argc >= SERVE_MAX_ARGS){
+      serveAnswer(sb,lineNum,tdef,NULL,BCOL_ERR_PARSE,"too many parameters");
+      return;
+    }
+    argv[argc] = p;
+    while((p < end)&&(*p != ' ')&&(*p != '\t')&&(*p != '\r'))
+      p++;
+    argLen[argc] = (size_t)(p - argv[argc]);
+    argc++;
+  }
+  if(argc == 0)
+    return;
+
+  t = *tdef;
+  err = parseTransArgs(argv,argLen,argc,&t,&bad,estr,sizeof(estr));
+  if(err == OPT_ERR_PARSE){
+    serveAnswer(sb,lineNum,tdef,NULL,BCOL_ERR_PARSE,estr);
+    return;
+  }
+  if(err == BCALC_OK){
+    err = bcalcCompute(&t,&r);
+  }
+  if(err != BCALC_OK){
+    getErrStr(estr,sizeof(estr),err,&t);
+    serveAnswer(sb,lineNum,&t,NULL,err,estr);
+    return;
+  }
+  serveAnswer(sb,lineNum,&t,&r,BCALC_OK,NULL);
+}
+
+static void closeConn(const int epfd, serveConn *c){
+  epoll_ctl(epfd,EPOLL_CTL_DEL,c->fd,NULL);
+  close(c->fd);
+  free(c->in);
+  sbFree(&c->out);
+  free(c);
+}
+
+/* writes as much of the pending output as possible, returns -1 on error or if the connection
+should be closed (the client has closed its end and all answers are written) */
+static int flushConn(const int epfd, serveConn *c){
+  struct epoll_event ev;
+  uint32_t events;
+  ssize_t n;
+  while(c->outPos < c->out.len){
+    n = write(c->fd,c->out.data + c->outPos,c->out.len - c->outPos);
+    if(n < 0){
+      if(errno == EINTR)
+        continue;
+      if((errno == EAGAIN)||(errno == EWOULDBLOCK))
+        break;
+      return -1;
+    }
+    c->outPos += (size_t)n;
+  }
+  if(c->outPos == c->out.len){
+    c->out.len = 0;
+    c->outPos = 0;
+  }
+  if(c->closing && (c->out.len == 0))
+    return -1;
+  /* only wait for the socket to become writable while there is output pending, and stop reading
+  requests once the client has closed its end or is not reading the answers */
+  events = 0;
+  if((!c->closing)&&(c->out.len - c->outPos <= SERVE_MAX_OUT))
+    events |= EPOLLIN;
+  if(c->out.len > 0)
+    events |= EPOLLOUT;
+  if(events != c->events){
+    c->events = events;
+    ev.events = events;
+    ev.data.ptr = c;
+    epoll_ctl(epfd,EPOLL_CTL_MOD,c->fd,&ev);
+  }
+  return 0;
+}
+
+/* reads and answers all available requests (until too many answers are unsent), returns -1 if
+the connection should be closed */
+static int readConn(const int epfd, serveConn *c, const bcalcTrans *tdef){
+  ssize_t n;
+  char *nl, *start, *nin;
+  size_t used;
+  while((!c->closing)&&(c->out.len - c->outPos <= SERVE_MAX_OUT)){
+    if(c->inCap - c->inLen < SERVE_READ_SIZE){
+      if(c->inCap >= SERVE_MAX_LINE + SERVE_READ_SIZE)
+        return -1; /* request too long */
+      if((nin = realloc(c->in,c->inCap + SERVE_READ_SIZE)) == NULL)
+        return -1;
+      c->in = nin;
+      c->inCap += SERVE_READ_SIZE;
+    }
+    n = read(c->fd,c->in + c->inLen,c->inCap - c->inLen);
+    if(n < 0){
+      if(errno == EINTR)
+        continue;
+      if((errno == EAGAIN)||(errno == EWOULDBLOCK))
+        break;
+      return -1;
+    }
+    if(n == 0){
+      /* client closed its end (eg. shutdown after the last request), answer a last request
+      without a newline and close once all answers are written */
+      if(c->inLen > 0)
+        serveRequest(c->in,c->inLen,++c->lineNum,tdef,&c->out);
+      c->inLen = 0;
+      c->closing = 1;
+      break;
+    }
+    c->inLen += (size_t)n;
+    /* answer all complete lines */
+    start = c->in;
+    while((nl = memchr(start,'\n',c->inLen - (size_t)(start - c->in))) != NULL){
+      serveRequest(start,(size_t)(nl - start),++c->lineNum,tdef,&c->out);
+      start = nl + 1;
+    }
+    used = (size_t)(start - c->in);
+    if(used > 0){
+      memmove(c->in,start,c->inLen - used);
+      c->inLen -= used;
+    }
+    if(c->inLen > SERVE_MAX_LINE)
+      return -1;
+  }
+  return flushConn(epfd,c);
+}
+
+/* creates the listening socket, replacing a stale socket file (but not a running server) */
+static int listenSock(const char *path){
+  struct sockaddr_un addr;
+  int fd;
+  if(strlen(path) >= sizeof(addr.sun_path)){
+    printf("ERROR: The socket path %s is too long.\n",path);
+    return -1;
+  }
+  memset(&addr,0,sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path,path);
+  if((fd = socket(AF_UNIX,SOCK_STREAM,0)) < 0){
+    printf("ERROR: Cannot create socket.\n");
+    return -1;
+  }
+  if(connect(fd,(struct sockaddr *)&addr,sizeof(addr)) == 0){
+    printf("ERROR: Another server is already listening on %s.\n",path);
+    close(fd);
+    return -1;
+  }
+  unlink(path);
+  if((bind(fd,(struct sockaddr *)&addr,sizeof(addr)) != 0)||(listen(fd,SOMAXCONN) != 0)){
+    printf("ERROR: Cannot listen on %s.\n",path);
+    close(fd);
+    return -1;
+  }
+  fcntl(fd,F_SETFL,fcntl(fd,F_GETFL) | O_NONBLOCK);
+  return fd;
+}
+
+/* answers requests on the Unix domain socket at path until interrupted (SIGINT or SIGTERM)
+parameters and flags in tdef are used as defaults for all requests */
+int runServer(const char *path, const bcalcTrans *tdef){
+
+  struct epoll_event ev, events[SERVE_MAX_EVENTS];
+  struct sigaction sa;
+  serveConn *c;
+  int lfd, epfd, cfd, n, i;
+
+  memset(&sa,0,sizeof(sa));
+  sa.sa_handler = serveSignal;
+  sigaction(SIGINT,&sa,NULL);
+  sigaction(SIGTERM,&sa,NULL);
+  sa.sa_handler = SIG_IGN;
+  sigaction(SIGPIPE,&sa,NULL);
+
+  if((lfd = listenSock(path)) < 0)
+    exit(-1);
+  if((epfd = epoll_create1(0)) < 0){
+    printf("ERROR: Cannot create epoll instance.\n");
+    exit(-1);
+  }
+  ev.events = EPOLLIN;
+  ev.data.ptr = NULL; /* the listening socket */
+  epoll_ctl(epfd,EPOLL_CTL_ADD,lfd,&ev);
+  fprintf(stderr,"Listening on %s.\n",path);
+
+  while(!serveQuit){
+    n = epoll_wait(epfd,events,SERVE_MAX_EVENTS,-1);
+    if(n < 0){
+      if(errno == EINTR)
+        continue;
+      printf("ERROR: epoll_wait failed.\n");
+      break;
+    }
+    for(i=0;i<n;i++){
+      if(events[i].data.ptr == NULL){
+        /* new connections */
+        while((cfd = accept(lfd,NULL,NULL)) >= 0){
+          fcntl(cfd,F_SETFL,fcntl(cfd,F_GETFL) | O_NONBLOCK);
+          if((c = calloc(1,sizeof(serveConn))) == NULL){
+            close(cfd);
+            continue;
+          }
+          c->fd = cfd;
+          sbInit(&c->out);
+          c->events = EPOLLIN;
+          ev.events = EPOLLIN;
+          ev.data.ptr = c;
+          if(epoll_ctl(epfd,EPOLL_CTL_ADD,cfd,&ev) != 0){
+            close(cfd);
+            free(c);
+          }
+        }
+        continue;
+      }
+      c = (serveConn *)events[i].data.ptr;
+      if(events[i].events & (EPOLLERR | EPOLLHUP | EPOLLIN)){
+        if(readConn(epfd,c,tdef) != 0){
+          closeConn(epfd,c);
+          continue;
+        }
+      }
+      if(events[i].events & EPOLLOUT){
+        if(flushConn(epfd,c) != 0)
+          closeConn(epfd,c);
+      }
+    }
+  }
+
+  close(epfd);
+  close(lfd);
+  unlink(path);
+  return 0;
+}
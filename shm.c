@@ -0,0 +1,154 @@
+/* shared memory mode: answers transition records from a request ring in a POSIX shared memory
+region (created by the program producing them, see shmring.h) with result records written to a
+response ring, in order.  Records are handled in batches of up to SHM_MAX_BATCH, with no system
+calls or allocation per record; the counters are published (and the other side woken if it is
+sleeping) once per batch. */
+
+#define _GNU_SOURCE
+
+#include <signal.h>
+#include <errno.h>
+#include "bcalc.h"
+#include "shmring.h"
+
+#define SHM_MAX_BATCH 64 /* records answered before publishing them */
+
+static volatile sig_atomic_t shmQuit = 0;
+
+static void shmSignal(int sig){
+  (void)sig;
+  shmQuit = 1;
+}
+
+/* sets a response record for a request which could not be calculated */
+static void shmErr(shmRes *s, const uint64_t id, const int err){
+  memset(s,0,sizeof(shmRes));
+  s->id = id;
+  s->err = err;
+}
+
+/* calculates a request record, with parameters not given taken from tdef */
+static void shmCalc(const shmReq *q, shmRes *s, const bcalcTrans *tdef){
+  bcalcTrans t = *tdef;
+  bcalcRes r;
+  t.Et = q->Et;
+  if(q->L >= 0){
+    if((q->EM != 0)&&(q->EM != 1)){
+      shmErr(s,q->id,BCALC_ERR_MULTIPOLE);
+      return;
+    }
+    if(q->L > BCALC_MAXL){
+      shmErr(s,q->id,BCALC_ERR_LMAX);
+      return;
+    }
+    t.EM = q->EM;
+    t.L = q->L;
+    snprintf(t.mstr,sizeof(t.mstr),"%c%i",t.EM ? 'M' : 'E',t.L);
+  }
+  if(q->flags & SHM_REQ_B){
+    t.b = q->val;
+    t.calcMode = 1;
+  }else{
+    t.lt = q->val;
+    t.calcMode = 0;
+  }
+  if(q->branching > 0.)
+    t.branching = q->branching;
+  if(q->flags & SHM_REQ_DELTA){
+    t.delta = q->delta;
+    t.useDelta = 1;
+  }
+  if(q->flags & SHM_REQ_ICC){
+    t.icc = q->icc;
+    t.iccAuto = 0;
+  }
+  if(q->ji >= 0.)
+    t.ji = q->ji;
+  if(q->jf >= 0.)
+    t.jf = q->jf;
+  if(q->A > 0)
+    t.nucA = q->A;
+  if(q->Z > 0)
+    t.nucZ = q->Z;
+  if(q->flags & (SHM_REQ_BARN|SHM_REQ_WU))
+    t.barn = ((q->flags & SHM_REQ_BARN) ? 1 : 0) + ((q->flags & SHM_REQ_WU) ? 2 : 0);
+  if(q->flags & SHM_REQ_UP)
+    t.bup = 1;
+  if(q->flags & SHM_REQ_BRREL)
+    t.brrel = 1;
+  if(q->flags & SHM_REQ_BETA2)
+    t.calcB2 = 1;
+
+  bcalcCompute(&t,&r);
+  s->id = q->id;
+  s->lt = r.lt;
+  s->lt1 = r.lt1;
+  s->b = r.b;
+  s->b1 = r.b1;
+  s->beta2 = r.beta2;
+  s->icc = r.icc;
+  s->err = r.err;
+  s->warn = r.warn;
+}
+
+/* answers requests in the shared memory region with the given name until it is stopped (shmStop)
+or interrupted (SIGINT or SIGTERM), parameters and flags in tdef are used as defaults */
+int runShm(const char *name, const bcalcTrans *tdef){
+
+  struct sigaction sa;
+  shmHeader *h;
+  const shmReq *req;
+  shmRes *res;
+  uint32_t mask, reqHead, reqTail, resHead, resTail, n, i;
+  unsigned long numRec = 0;
+
+  memset(&sa,0,sizeof(sa));
+  sa.sa_handler = shmSignal;
+  sigaction(SIGINT,&sa,NULL);
+  sigaction(SIGTERM,&sa,NULL);
+
+  errno = 0;
+  if((h = shmAttach(name)) == NULL){
+    printf("ERROR: Cannot attach to the shared memory region %s (%s).\n",name,(errno != 0) ? strerror(errno) : "not a bcalc region");
+    exit(-1);
+  }
+  req = shmReqs(h);
+  res = shmRess(h);
+  mask = h->numSlots - 1;
+  reqTail = __atomic_load_n(&h->req.tail,__ATOMIC_ACQUIRE);
+  resHead = __atomic_load_n(&h->res.head,__ATOMIC_ACQUIRE);
+  __atomic_store_n(&h->attached,1,__ATOMIC_SEQ_CST);
+  fprintf(stderr,"Attached to %s (%u slots per ring).\n",name,h->numSlots);
+
+  while((!shmQuit)&&(!__atomic_load_n(&h->quit,__ATOMIC_ACQUIRE))){
+    reqHead = __atomic_load_n(&h->req.head,__ATOMIC_ACQUIRE);
+    if(reqHead == reqTail){
+      shmWait(h,&h->req.head,&h->req.headWait,reqTail);
+      continue;
+    }
+    resTail = __atomic_load_n(&h->res.tail,__ATOMIC_ACQUIRE);
+    if(resHead - resTail == h->numSlots){
+      shmWait(h,&h->res.tail,&h->res.tailWait,resTail);
+      continue; /* no space for responses */
+    }
+    n = reqHead - reqTail;
+    if(n > h->numSlots - (resHead - resTail))
+      n = h->numSlots - (resHead - resTail);
+    if(n > SHM_MAX_BATCH)
+      n = SHM_MAX_BATCH;
+    for(i=0;i<n;i++)
+      shmCalc(&req[(reqTail + i) & mask],&res[(resHead + i) & mask],tdef);
+    reqTail += n;
+    resHead += n;
+    numRec += n;
+    shmPublish(&h->res.head,&h->res.headWait,resHead);
+    shmPublish(&h->req.tail,&h->req.tailWait,reqTail);
+  }
+
+  __atomic_store_n(&h->attached,0,__ATOMIC_SEQ_CST);
+  shmFutex(&h->res.head,FUTEX_WAKE,1); /* in case the producer is waiting for answers */
+  shmFutex(&h->req.tail,FUTEX_WAKE,1);
+  fprintf(stderr,"Detached from %s after %lu records.\n",name,numRec);
+  shmDetach(h);
+  return 0;
+}
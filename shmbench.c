@@ -0,0 +1,217 @@
+/* bcalc-shmbench: stand-in for a program using bcalc through shared memory rings (bcalc --shm)
+A region is created, bcalc is started attached to it, and N transition records are sent through
+the request ring while the answers are read from the response ring (by the same thread, with at
+most D records in flight), reporting the sustained throughput and the latency distribution. */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <spawn.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include "shmring.h"
+
+#define SHMBENCH_NUM_VALS 64 /* distinct transitions cycled through */
+
+extern char **environ;
+
+static void printUsage(void){
+  printf("\nStand-in producer and consumer for the bcalc shared memory mode (bcalc --shm)\n");
+  printf("usage: bcalc-shmbench [--n N] [--slots S] [--depth D] [--spin P] [--poll] [--bcalc PATH]\n\n");
+  printf("    --n        --  Number of records sent (default 1000000).\n");
+  printf("    --slots    --  Records per ring, a power of 2 (default 4096).\n");
+  printf("    --depth    --  Maximum number of records in flight (default: the\n");
+  printf("                   number of slots).  --depth 1 measures the latency\n");
+  printf("                   of single records.\n");
+  printf("    --spin     --  Polls of an empty or full ring before sleeping\n");
+  printf("                   (default %i).\n",SHM_SPIN);
+  printf("    --poll     --  Busy-poll, never sleep.\n");
+  printf("    --bcalc    --  The bcalc program to start (default ./bcalc).\n");
+}
+
+static double nowUs(void){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return (double)ts.tv_sec*1E6 + (double)ts.tv_nsec/1E3;
+}
+
+static int cmpDouble(const void *a, const void *b){
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+/* E2 transitions in 152Sm with a range of energies and lifetimes */
+static void makeReqs(shmReq *vals){
+  uint64_t s = 1;
+  int i;
+  memset(vals,0,SHMBENCH_NUM_VALS*sizeof(shmReq));
+  for(i=0;i<SHMBENCH_NUM_VALS;i++){
+    s = s*6364136223846793005ULL + 1442695040888963407ULL;
+    vals[i].Et = 50. + (double)(s >> 40)*(3000./16777216.);
+    vals[i].val = 0.1 + (double)((s >> 16) & 0xFFFFFF)*(1000./16777216.);
+    vals[i].EM = 0;
+    vals[i].L = 2;
+    vals[i].ji = -1.;
+    vals[i].jf = -1.;
+    vals[i].A = 152;
+    vals[i].Z = 62;
+  }
+}
+
+/* sends n records with at most depth in flight, reading the answers, reports throughput and latency */
+static int runLoad(shmHeader *h, const unsigned long n, const uint32_t depth){
+  shmReq vals[SHMBENCH_NUM_VALS];
+  shmReq *req = shmReqs(h);
+  const shmRes *res = shmRess(h);
+  double *sent, *lat;
+  double t0, t1;
+  unsigned long numSent = 0, numRecv = 0, numErr = 0;
+  uint32_t mask = h->numSlots - 1;
+  uint32_t reqHead, reqTail, resHead, resTail, k;
+
+  sent = malloc(n*sizeof(double));
+  lat = malloc(n*sizeof(double));
+  if((sent == NULL)||(lat == NULL)){
+    printf("ERROR: Cannot allocate memory.\n");
+    return -1;
+  }
+  makeReqs(vals);
+  reqHead = h->req.head;
+  reqTail = h->req.tail;
+  resTail = h->res.tail;
+
+  t0 = nowUs();
+  while(numRecv < n){
+    /* requests, while there is space in the ring and fewer than depth are in flight */
+    k = 0;
+    while((numSent < n)&&(numSent - numRecv < depth)){
+      if(reqHead - reqTail == h->numSlots){
+        reqTail = __atomic_load_n(&h->req.tail,__ATOMIC_ACQUIRE);
+        if(reqHead - reqTail == h->numSlots)
+          break;
+      }
+      req[reqHead & mask] = vals[numSent % SHMBENCH_NUM_VALS];
+      req[reqHead & mask].id = numSent;
+      sent[numSent] = nowUs();
+      reqHead++;
+      numSent++;
+      k++;
+    }
+    if(k > 0)
+      shmPublish(&h->req.head,&h->req.headWait,reqHead);
+    /* answers */
+    resHead = __atomic_load_n(&h->res.head,__ATOMIC_ACQUIRE);
+    if(resHead == resTail){
+      if(!__atomic_load_n(&h->attached,__ATOMIC_ACQUIRE)){
+        printf("ERROR: bcalc detached from the region.\n");
+        return -1;
+      }
+      if((numSent == n)||(numSent - numRecv == depth)||(reqHead - reqTail == h->numSlots))
+        shmWait(h,&h->res.head,&h->res.headWait,resTail); /* nothing else to do */
+      continue;
+    }
+    t1 = nowUs();
+    for(;resTail != resHead;resTail++){
+      const shmRes *s = &res[resTail & mask];
+      lat[numRecv] = t1 - sent[s->id];
+      numErr += (s->err != 0);
+      numRecv++;
+    }
+    shmPublish(&h->res.tail,&h->res.tailWait,resTail);
+  }
+  t1 = nowUs();
+
+  qsort(lat,n,sizeof(double),cmpDouble);
+  printf("records: %lu\n",n);
+  printf("slots: %u\n",h->numSlots);
+  printf("depth: %u\n",depth);
+  printf("errors: %lu\n",numErr);
+  printf("time_s: %.6f\n",(t1-t0)/1E6);
+  printf("records_per_s: %.0f\n",(double)n/((t1-t0)/1E6));
+  printf("latency_p50_us: %.2f\n",lat[(size_t)(0.50*(double)(n-1))]);
+  printf("latency_p90_us: %.2f\n",lat[(size_t)(0.90*(double)(n-1))]);
+  printf("latency_p99_us: %.2f\n",lat[(size_t)(0.99*(double)(n-1))]);
+  printf("latency_p999_us: %.2f\n",lat[(size_t)(0.999*(double)(n-1))]);
+  printf("latency_max_us: %.2f\n",lat[n-1]);
+
+  free(lat);
+  free(sent);
+  return 0;
+}
+
+int main(int argc, char *argv[]){
+
+  const char *bcalc = "./bcalc";
+  char name[64];
+  char *args[4];
+  unsigned long n = 1000000;
+  uint32_t numSlots = 4096, depth = 0, spin = SHM_SPIN, flags = 0;
+  shmHeader *h;
+  pid_t pid;
+  double t0;
+  int i, status, err;
+
+  for(i=1;i<argc;i++){
+    if(strcmp(argv[i],"--poll")==0){
+      flags |= SHM_FLAG_POLL;
+    }else if((strcmp(argv[i],"--n")==0)&&(i < argc-1)){
+      n = strtoul(argv[++i],NULL,10);
+    }else if((strcmp(argv[i],"--slots")==0)&&(i < argc-1)){
+      numSlots = (uint32_t)strtoul(argv[++i],NULL,10);
+    }else if((strcmp(argv[i],"--depth")==0)&&(i < argc-1)){
+      depth = (uint32_t)strtoul(argv[++i],NULL,10);
+    }else if((strcmp(argv[i],"--spin")==0)&&(i < argc-1)){
+      spin = (uint32_t)strtoul(argv[++i],NULL,10);
+    }else if((strcmp(argv[i],"--bcalc")==0)&&(i < argc-1)){
+      bcalc = argv[++i];
+    }else{
+      printUsage();
+      exit(-1);
+    }
+  }
+  if((n == 0)||(numSlots == 0)||((numSlots & (numSlots - 1)) != 0)){
+    printf("ERROR: The number of records must be positive, and the number of slots a power of 2.\n");
+    exit(-1);
+  }
+  if((depth == 0)||(depth > numSlots))
+    depth = numSlots;
+
+  snprintf(name,sizeof(name),"/bcalc-shmbench-%li",(long)getpid());
+  if((h = shmCreate(name,numSlots,flags,spin)) == NULL){
+    printf("ERROR: Cannot create the shared memory region %s (%s).\n",name,strerror(errno));
+    exit(-1);
+  }
+  args[0] = (char *)(uintptr_t)bcalc;
+  args[1] = (char *)(uintptr_t)"--shm";
+  args[2] = name;
+  args[3] = NULL;
+  if(posix_spawn(&pid,bcalc,NULL,NULL,args,environ) != 0){
+    printf("ERROR: Cannot start %s.\n",bcalc);
+    shm_unlink(name);
+    exit(-1);
+  }
+
+  /* wait for bcalc to attach */
+  t0 = nowUs();
+  while(!__atomic_load_n(&h->attached,__ATOMIC_ACQUIRE)){
+    if((nowUs() - t0 > 5E6)||(waitpid(pid,&status,WNOHANG) == pid)){
+      printf("ERROR: %s did not attach to the region.\n",bcalc);
+      shm_unlink(name);
+      exit(-1);
+    }
+    usleep(1000);
+  }
+
+  err = runLoad(h,n,depth);
+
+  shmStop(h);
+  waitpid(pid,&status,0);
+  shm_unlink(name);
+  shmDetach(h);
+  return err;
+}
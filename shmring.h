@@ -0,0 +1,227 @@
+#ifndef SHMRING_H
+#define SHMRING_H
+
+/* shared memory rings for bcalc --shm: a POSIX shared memory region holding a ring of request
+records and a ring of response records, each with a single producer and a single consumer and
+no locks.  The region is created (with shmCreate) by the program producing the requests, which
+also consumes the responses; bcalc attaches to it by name (shmAttach), answers every request in
+order and stops when shmStop is called.
+
+Layout: a shmHeader, then numSlots shmReq records, then numSlots shmRes records (all in the
+native byte order).  The head (records written) and tail (records read) of each ring count up
+freely modulo 2^32, and each is on its own cache line as it is written by one side only.  A side
+with nothing to do polls for a while and then sleeps on a futex; the other side only makes the
+wake up system call when its waitFlag is set, so there are no system calls per record while
+records keep coming.  With SHM_FLAG_POLL neither side ever sleeps.
+
+This header does not depend on the rest of bcalc, so that it can be included by producers. */
+
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#define SHM_MAGIC       "BCALCSHM"
+#define SHM_VERSION     1
+#define SHM_LINE        64 /* cache line size (bytes) */
+#define SHM_SPIN        20000 /* default number of polls of an empty or full ring before sleeping */
+
+/* region flags */
+#define SHM_FLAG_POLL   1 /* busy-poll, never sleep */
+
+/* request flags */
+#define SHM_REQ_B       1 /* val is a reduced transition probability (calculate the lifetime) */
+#define SHM_REQ_DELTA   2 /* delta is given */
+#define SHM_REQ_ICC     4 /* icc is given (otherwise from a conversion coefficient table, or 0) */
+#define SHM_REQ_UP      8 /* as --up */
+#define SHM_REQ_BARN    16 /* as --barn */
+#define SHM_REQ_WU      32 /* as --wu */
+#define SHM_REQ_BRREL   64 /* as --brrel */
+#define SHM_REQ_BETA2   128 /* as --beta2 */
+
+/* a transition to calculate (96 bytes), parameters given as 'default' are taken from the
+bcalc command line */
+typedef struct
+{
+  uint64_t id; /* copied to the response */
+  double Et; /* transition energy (keV) */
+  double val; /* lifetime (ps), or reduced transition probability with SHM_REQ_B */
+  double branching; /* branching fraction (or relative intensity), 0 = default */
+  double delta; /* mixing ratio, with SHM_REQ_DELTA */
+  double icc; /* internal conversion coefficient, with SHM_REQ_ICC */
+  double ji, jf; /* initial and final spins, < 0 = default */
+  int32_t EM; /* 0 = electric, 1 = magnetic */
+  int32_t L; /* multipolarity, < 0 = default */
+  int32_t A, Z; /* mass and proton numbers, 0 = default */
+  uint32_t flags; /* SHM_REQ_... */
+  uint32_t reserved;
+}shmReq;
+
+/* results of a transition (64 bytes), as in bcalcRes (0 for values not calculated) */
+typedef struct
+{
+  uint64_t id; /* of the request */
+  double lt; /* partial lifetime of the L multipole (ps), or the calculated lifetime */
+  double lt1; /* partial lifetime of the L+1 multipole (ps) */
+  double b, b1; /* reduced transition probabilities of the L and L+1 multipoles */
+  double beta2;
+  double icc; /* internal conversion coefficient used */
+  int32_t err; /* error code (BCALC_OK = 0, see libbcalc.h) */
+  int32_t warn; /* 1 if a 2->0 transition was assumed for B up */
+}shmRes;
+
+/* counters of a ring, head is written by the producer only and tail by the consumer only */
+typedef struct
+{
+  uint32_t head; /* records written */
+  uint32_t headWait; /* 1 while the consumer is sleeping on head */
+  char pad0[SHM_LINE - 8];
+  uint32_t tail; /* records read */
+  uint32_t tailWait; /* 1 while the producer is sleeping on tail */
+  char pad1[SHM_LINE - 8];
+}shmRing;
+
+typedef struct
+{
+  char magic[8]; /* SHM_MAGIC (not NUL terminated) */
+  uint32_t version; /* SHM_VERSION */
+  uint32_t numSlots; /* records per ring, a power of 2 */
+  uint32_t reqSize, resSize; /* sizeof(shmReq), sizeof(shmRes) */
+  uint32_t flags; /* SHM_FLAG_... */
+  uint32_t spin; /* polls before sleeping */
+  uint32_t attached; /* 1 while bcalc is answering requests */
+  uint32_t quit; /* set by shmStop */
+  char pad[SHM_LINE - 40];
+  shmRing req; /* requests, produced by the creator of the region */
+  shmRing res; /* responses, produced by bcalc */
+}shmHeader;
+
+/* size of a region with numSlots records per ring */
+static inline size_t shmSize(const uint32_t numSlots){
+  return sizeof(shmHeader) + (size_t)numSlots*(sizeof(shmReq) + sizeof(shmRes));
+}
+
+static inline shmReq *shmReqs(shmHeader *h){
+  return (shmReq *)(void *)((char *)h + sizeof(shmHeader));
+}
+
+static inline shmRes *shmRess(shmHeader *h){
+  return (shmRes *)(void *)((char *)h + sizeof(shmHeader) + (size_t)h->numSlots*sizeof(shmReq));
+}
+
+/* creates the region with the given name (eg. /daq-bcalc) and numSlots (a power of 2) records per
+ring, returns NULL on failure (with errno set), eg. if it already exists */
+static inline shmHeader *shmCreate(const char *name, const uint32_t numSlots, const uint32_t flags, const uint32_t spin){
+  shmHeader *h;
+  void *p;
+  int fd;
+  if((numSlots == 0)||((numSlots & (numSlots - 1)) != 0))
+    return NULL;
+  if((fd = shm_open(name,O_RDWR|O_CREAT|O_EXCL,0600)) < 0)
+    return NULL;
+  if(ftruncate(fd,(off_t)shmSize(numSlots)) != 0){
+    close(fd);
+    shm_unlink(name);
+    return NULL;
+  }
+  p = mmap(NULL,shmSize(numSlots),PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+  close(fd);
+  if(p == MAP_FAILED){
+    shm_unlink(name);
+    return NULL;
+  }
+  h = (shmHeader *)p;
+  memset(h,0,sizeof(shmHeader));
+  h->version = SHM_VERSION;
+  h->numSlots = numSlots;
+  h->reqSize = sizeof(shmReq);
+  h->resSize = sizeof(shmRes);
+  h->flags = flags;
+  h->spin = spin;
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  memcpy(h->magic,SHM_MAGIC,8); /* last, so that the region is complete when it is recognized */
+  return h;
+}
+
+/* attaches to an existing region, returns NULL if it does not exist or is not valid */
+static inline shmHeader *shmAttach(const char *name){
+  struct stat st;
+  shmHeader *h;
+  void *p;
+  int fd;
+  if((fd = shm_open(name,O_RDWR,0)) < 0)
+    return NULL;
+  if((fstat(fd,&st) != 0)||((size_t)st.st_size < sizeof(shmHeader))){
+    close(fd);
+    return NULL;
+  }
+  p = mmap(NULL,(size_t)st.st_size,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+  close(fd);
+  if(p == MAP_FAILED)
+    return NULL;
+  h = (shmHeader *)p;
+  if((memcmp(h->magic,SHM_MAGIC,8) != 0)||(h->version != SHM_VERSION)||(h->reqSize != sizeof(shmReq))||(h->resSize != sizeof(shmRes))
+     ||(h->numSlots == 0)||((h->numSlots & (h->numSlots - 1)) != 0)||((size_t)st.st_size < shmSize(h->numSlots))){
+    munmap(p,(size_t)st.st_size);
+    return NULL;
+  }
+  return h;
+}
+
+static inline void shmDetach(shmHeader *h){
+  munmap(h,shmSize(h->numSlots));
+}
+
+static inline long shmFutex(uint32_t *addr, const int op, const uint32_t val){
+  return syscall(SYS_futex,addr,op,val,NULL,NULL,0);
+}
+
+static inline void shmRelax(void){
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#endif
+}
+
+/* waits for the counter ctr (written by the other side) to change from old, polling and then
+sleeping on it (unless busy-polling), returns its value, which is still old if the wait was
+interrupted (by a signal or shmStop) or the polls ran out with SHM_FLAG_POLL */
+static inline uint32_t shmWait(shmHeader *h, uint32_t *ctr, uint32_t *waitFlag, const uint32_t old){
+  uint32_t i, v = old;
+  for(i=0;i<h->spin;i++){
+    if(((v = __atomic_load_n(ctr,__ATOMIC_ACQUIRE)) != old)||__atomic_load_n(&h->quit,__ATOMIC_RELAXED))
+      return v;
+    shmRelax();
+  }
+  if(h->flags & SHM_FLAG_POLL)
+    return __atomic_load_n(ctr,__ATOMIC_ACQUIRE);
+  /* the flag is set before checking the counter again, and the other side stores the counter
+  before checking the flag, so that one of the two always sees the other */
+  __atomic_store_n(waitFlag,1,__ATOMIC_SEQ_CST);
+  if((__atomic_load_n(ctr,__ATOMIC_SEQ_CST) == old)&&!__atomic_load_n(&h->quit,__ATOMIC_SEQ_CST))
+    shmFutex(ctr,FUTEX_WAIT,old);
+  __atomic_store_n(waitFlag,0,__ATOMIC_RELAXED);
+  return __atomic_load_n(ctr,__ATOMIC_ACQUIRE);
+}
+
+/* sets the counter ctr (written by this side) to v, after the records it covers have been
+written or read, waking the other side if it is sleeping on it */
+static inline void shmPublish(uint32_t *ctr, uint32_t *waitFlag, const uint32_t v){
+  __atomic_store_n(ctr,v,__ATOMIC_SEQ_CST);
+  if(__atomic_load_n(waitFlag,__ATOMIC_SEQ_CST))
+    shmFutex(ctr,FUTEX_WAKE,1);
+}
+
+/* tells bcalc (and anything waiting on the rings) to stop */
+static inline void shmStop(shmHeader *h){
+  __atomic_store_n(&h->quit,1,__ATOMIC_SEQ_CST);
+  shmFutex(&h->req.head,FUTEX_WAKE,1);
+  shmFutex(&h->req.tail,FUTEX_WAKE,1);
+  shmFutex(&h->res.head,FUTEX_WAKE,1);
+  shmFutex(&h->res.tail,FUTEX_WAKE,1);
+}
+
+#endif
@@ -0,0 +1,201 @@
+/* runtime statistics (--stats): time spent in each stage of batch processing, error counts,
+CPU time, peak memory use and (where perf_event_open is available) hardware counters
+timing is only done when statistics are requested, callers pass a NULL statCounts otherwise */
+
+#define _DEFAULT_SOURCE /* syscall */
+
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+#include "bcalc.h"
+
+static const char *statName[STAT_NUM] = {"startup", "input", "result cache", "parsing", "validation",
+  "calcB", "calcB, W.u. (ltsp)", "calcLt", "calcLt, W.u. (ltsp)", "beta_2", "formatting",
+  "output", "waiting for threads"};
+
+static const char *hwName[STAT_NUM_HW] = {"cycles", "instructions", "cache references", "cache misses"};
+
+/* returns a monotonic timestamp (ns) */
+uint64_t statsNow(void){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return (uint64_t)ts.tv_sec*1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* adds the time since *t to stage s, and sets *t to the current time */
+void statsLap(statCounts *st, const int s, uint64_t *t){
+  uint64_t now = statsNow();
+  st->ns[s] += now - *t;
+  st->calls[s]++;
+  *t = now;
+}
+
+/* counts a line which could not be processed, err is an error code or BCOL_ERR_PARSE */
+void statsErr(statCounts *st, const int err){
+  if((err > BCALC_OK)&&(err < BCALC_NUM_ERR))
+    st->numErr[err]++;
+  else
+    st->numParseErr++;
+}
+
+/* adds the counts of a chunk to the totals */
+void statsAdd(statCounts *tot, const statCounts *st){
+  int i;
+  for(i=0;i<STAT_NUM;i++){
+    tot->ns[i] += st->ns[i];
+    tot->calls[i] += st->calls[i];
+  }
+  tot->numParseErr += st->numParseErr;
+  tot->numCached += st->numCached;
+  for(i=0;i<BCALC_NUM_ERR;i++)
+    tot->numErr[i] += st->numErr[i];
+}
+
+/* same as bcalcCompute, but with validation, the B value or lifetime and beta_2 timed separately
+(the beta_2 calculation is repeated exactly as in the library, so results are identical)
+*tm is the start of the current stage, and is advanced */
+int statsCompute(const bcalcTrans *t, bcalcRes *r, statCounts *st, uint64_t *tm){
+  bcalcTrans tv = *t;
+  int calcB2;
+  memset(r,0,sizeof(bcalcRes));
+  r->err = bcalcValidate(&tv,&r->warn);
+  statsLap(st,STAT_VALIDATE,tm);
+  if(r->err != BCALC_OK)
+    return r->err;
+  calcB2 = tv.calcB2;
+  tv.calcB2 = 0;
+  bcalcComputeValid(&tv,r);
+  if(tv.calcMode == 0)
+    statsLap(st,(tv.barn == 2) ? STAT_CALCB_WU : STAT_CALCB,tm);
+  else
+    statsLap(st,(tv.barn == 2) ? STAT_CALCLT_WU : STAT_CALCLT,tm);
+  if(calcB2){
+    if(tv.calcMode == 0)
+      r->beta2 = calcBeta2LtPrec(tv.Et/1000.0,r->lt*1.0E-12,tv.nucA,tv.nucZ,tv.precision);
+    else if(tv.calcMode == 1)
+      r->beta2 = calcBeta2Prec(tv.Et/1000.0,tv.b,tv.nucA,tv.nucZ,tv.barn,tv.precision);
+    statsLap(st,STAT_BETA2,tm);
+  }
+  return r->err;
+}
+
+#ifdef __linux__
+/* opens a hardware counter for this process and the threads it creates later, returns -1 on failure */
+static int openCounter(const uint64_t config){
+  struct perf_event_attr pa;
+  memset(&pa,0,sizeof(pa));
+  pa.type = PERF_TYPE_HARDWARE;
+  pa.size = sizeof(pa);
+  pa.config = config;
+  pa.inherit = 1;
+  pa.exclude_kernel = 1;
+  pa.exclude_hv = 1;
+  pa.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED|PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return (int)syscall(__NR_perf_event_open,&pa,0,-1,-1,0UL);
+}
+#endif
+
+/* starts collecting statistics, start is the time the program started
+hw=1 also opens the hardware counters (before any threads are created, so that they are counted) */
+void statsStart(runStats *rs, const uint64_t start, const int hw){
+  int i;
+  memset(rs,0,sizeof(runStats));
+  rs->start = start;
+  for(i=0;i<STAT_NUM_HW;i++)
+    rs->perfFd[i] = -1;
+  if(!hw)
+    return;
+#ifdef __linux__
+  {
+    static const uint64_t config[STAT_NUM_HW] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_CACHE_REFERENCES, PERF_COUNT_HW_CACHE_MISSES};
+    for(i=0;i<STAT_NUM_HW;i++){
+      if((rs->perfFd[i] = openCounter(config[i])) < 0){
+        rs->perfErr = errno;
+        break;
+      }
+    }
+  }
+#else
+  rs->perfErr = ENOSYS;
+#endif
+  if(rs->perfErr != 0){
+    for(i=0;i<STAT_NUM_HW;i++){
+      if(rs->perfFd[i] >= 0)
+        close(rs->perfFd[i]);
+      rs->perfFd[i] = -1;
+    }
+  }
+}
+
+/* reads a hardware counter (scaled up if it was multiplexed), returns -1 on failure */
+static double readCounter(const int fd){
+  uint64_t v[3]; /* value, time enabled, time running */
+  if(read(fd,v,sizeof(v)) != (ssize_t)sizeof(v))
+    return -1.;
+  if((v[2] > 0)&&(v[2] < v[1]))
+    return (double)v[0]*(double)v[1]/(double)v[2];
+  return (double)v[0];
+}
+
+/* prints the statistics of a run which processed numLines lines (or rows, as named by unit: "line" or "row")
+and closes the hardware counters */
+void statsPrint(runStats *rs, const unsigned long numLines, const char *unit, FILE *f){
+  const statCounts *c = &rs->c;
+  double wall = (double)(statsNow() - rs->start)*1.0E-9;
+  double tot = 0., hw[STAT_NUM_HW];
+  unsigned long numErr = c->numParseErr;
+  struct rusage ru;
+  int i;
+
+  for(i=0;i<STAT_NUM;i++)
+    tot += (double)c->ns[i];
+  for(i=0;i<BCALC_NUM_ERR;i++)
+    numErr += c->numErr[i];
+  fprintf(f,"\nStatistics:\n");
+  fprintf(f,"  %lu %ss (%lu transitions, %lu not processed) in %.3f s, %.4g %ss/s\n",numLines,unit,c->calls[STAT_VALIDATE] + c->numCached,numErr,wall,(wall > 0.) ? (double)numLines/wall : 0.,unit);
+  if(c->numCached > 0)
+    fprintf(f,"  %lu transitions taken from the result cache\n",c->numCached);
+  if(getrusage(RUSAGE_SELF,&ru) == 0){
+    fprintf(f,"  CPU time: %.3f s user, %.3f s system\n",(double)ru.ru_utime.tv_sec + (double)ru.ru_utime.tv_usec*1.0E-6,(double)ru.ru_stime.tv_sec + (double)ru.ru_stime.tv_usec*1.0E-6);
+    fprintf(f,"  Peak RSS: %ld kB\n",ru.ru_maxrss);
+  }
+  fprintf(f,"  %-22s %12s %12s %10s %7s\n","Stage (all threads)","calls","time (s)","ns/call","share");
+  for(i=0;i<STAT_NUM;i++){
+    if(c->calls[i] == 0)
+      continue;
+    fprintf(f,"  %-22s %12lu %12.4f %10.1f %6.1f%%\n",statName[i],c->calls[i],(double)c->ns[i]*1.0E-9,(double)c->ns[i]/(double)c->calls[i],(tot > 0.) ? 100.*(double)c->ns[i]/tot : 0.);
+  }
+  if(numErr > 0){
+    fprintf(f,"  Not processed:\n");
+    if(c->numParseErr > 0)
+      fprintf(f,"  %12lu  Parse error.\n",c->numParseErr);
+    for(i=0;i<BCALC_NUM_ERR;i++){
+      if(c->numErr[i] > 0)
+        fprintf(f,"  %12lu  %s\n",c->numErr[i],bcalcErrStr(i));
+    }
+  }
+  if(rs->perfErr != 0){
+    fprintf(f,"  Hardware counters not available (perf_event_open: %s).\n",strerror(rs->perfErr));
+  }else if(rs->perfFd[0] >= 0){
+    fprintf(f,"  Hardware counters (user space, all threads):\n");
+    for(i=0;i<STAT_NUM_HW;i++){
+      hw[i] = readCounter(rs->perfFd[i]);
+      close(rs->perfFd[i]);
+      rs->perfFd[i] = -1;
+      if(hw[i] >= 0.)
+        fprintf(f,"  %-22s %14.0f\n",hwName[i],hw[i]);
+    }
+    if((hw[0] > 0.)&&(hw[1] >= 0.))
+      fprintf(f,"  %-22s %14.2f\n","instructions/cycle",hw[1]/hw[0]);
+    if((hw[2] > 0.)&&(hw[3] >= 0.))
+      fprintf(f,"  %-22s %13.1f%%\n","cache miss rate",100.*hw[3]/hw[2]);
+    if((numLines > 0)&&(hw[0] >= 0.))
+      fprintf(f,"  cycles/%-15s %14.1f\n",unit,hw[0]/(double)numLines);
+  }
+}
@@ -0,0 +1,82 @@
+/* growable string buffer, used to format output before writing it out */
+
+#include <stdarg.h>
+#include "bcalc.h"
+
+void sbInit(strBuf *sb){
+  sb->data = NULL;
+  sb->len = 0;
+  sb->cap = 0;
+}
+
+void sbFree(strBuf *sb){
+  free(sb->data);
+  sbInit(sb);
+}
+
+/* makes room for at least n more characters (plus a terminating NUL) */
+void sbReserve(strBuf *sb, const size_t n){
+  size_t cap = (sb->cap > 0) ? sb->cap : 256;
+  char *data;
+  if(sb->len + n + 1 <= sb->cap){
+    return;
+  }
+  while(cap < sb->len + n + 1){
+    cap *= 2;
+  }
+  if((data = realloc(sb->data,cap)) == NULL){
+    printf("ERROR: Cannot allocate memory for output.\n");
+    exit(-1);
+  }
+  sb->data = data;
+  sb->cap = cap;
+}
+
+/* appends formatted text */
+void sbPrintf(strBuf *sb, const char *fmt, ...){
+  va_list ap;
+  int n;
+  sbReserve(sb,64);
+  va_start(ap,fmt);
+  n = vsnprintf(sb->data + sb->len,sb->cap - sb->len,fmt,ap);
+  va_end(ap);
+  if(n < 0){
+    return;
+  }
+  if((size_t)n >= sb->cap - sb->len){
+    /* did not fit, grow and format again */
+    sbReserve(sb,(size_t)n);
+    va_start(ap,fmt);
+    vsnprintf(sb->data + sb->len,sb->cap - sb->len,fmt,ap);
+    va_end(ap);
+  }
+  sb->len += (size_t)n;
+}
+
+/* appends len characters of str */
+void sbPutn(strBuf *sb, const char *str, const size_t len){
+  sbReserve(sb,len);
+  memcpy(sb->data + sb->len,str,len);
+  sb->len += len;
+  sb->data[sb->len] = '\0';
+}
+
+/* appends a string */
+void sbPuts(strBuf *sb, const char *str){
+  sbPutn(sb,str,strlen(str));
+}
+
+/* appends a character */
+void sbPutc(strBuf *sb, const char c){
+  sbReserve(sb,1);
+  sb->data[sb->len++] = c;
+  sb->data[sb->len] = '\0';
+}
+
+/* writes out the buffer contents and empties it */
+void sbFlush(strBuf *sb, FILE *out){
+  if(sb->len > 0){
+    fwrite(sb->data,1,sb->len,out);
+  }
+  sb->len = 0;
+}
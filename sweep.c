@@ -0,0 +1,275 @@
+/* parameter sweeps: calculations on a grid of energies, lifetimes (or B values) and mixing
+ratios, given as ranges on the command line (eg. -e 50:3000:0.5 -d atan:-90:90:0.1) */
+
+#include "bcalc.h"
+
+#define SWEEP_CHUNK 65536 /* approximate number of grid points calculated and written at once */
+#define SWEEP_STR_LEN 24 /* formatted axis value, with a separator */
+
+/* parses a range given as START:STOP:STEP (or atan:START:STOP:STEP, with angles in degrees),
+with values multiplied by fac (except for angles)
+STOP is included if it falls on the grid, returns 0 on success */
+int parseRange(const char *str, const double fac, bcalcAxis *ax){
+  double v[3], n;
+  char *end;
+  int i;
+  memset(ax,0,sizeof(bcalcAxis));
+  if(strncmp(str,"atan:",5)==0){
+    ax->atan = 1;
+    str += 5;
+  }
+  for(i=0;i<3;i++){
+    v[i] = strtod(str,&end);
+    if((end == str)||(!isfinite(v[i]))||(*end != ((i<2) ? ':' : '\0')))
+      return -1;
+    str = end + 1;
+  }
+  if(v[2] == 0.){
+    return -1;
+  }
+  /* number of steps, allowing for rounding in STOP - START */
+  n = floor((v[1] - v[0])/v[2] + 1E-9);
+  if((n < 0.)||(n >= 1E12)){
+    return -1;
+  }
+  ax->n = (size_t)n + 1;
+  if(ax->atan){
+    ax->start = v[0];
+    ax->step = v[2];
+  }else{
+    ax->start = v[0]*fac;
+    ax->step = v[2]*fac;
+  }
+  return 0;
+}
+
+/* finds the corner of the grid where validation fails with err, for the error message */
+static const bcalcTrans *sweepErrTrans(const bcalcTrans *t, const bcalcAxis *ax, const int err, bcalcTrans *tv){
+  int c, a, warn;
+  for(c=0;c<2;c++){
+    *tv = *t;
+    for(a=0;a<BCALC_NUM_AXES;a++){
+      if(ax[a].n == 0)
+        continue;
+      if(a == BCALC_AXIS_ENERGY)
+        tv->Et = bcalcAxisVal(&ax[a],c ? ax[a].n-1 : 0);
+      else if((a == BCALC_AXIS_VAL)&&(tv->calcMode == 1))
+        tv->b = bcalcAxisVal(&ax[a],c ? ax[a].n-1 : 0);
+      else if(a == BCALC_AXIS_VAL)
+        tv->lt = bcalcAxisVal(&ax[a],c ? ax[a].n-1 : 0);
+      else
+        tv->delta = bcalcAxisVal(&ax[a],c ? ax[a].n-1 : 0);
+    }
+    if(bcalcValidate(tv,&warn) == err)
+      return tv;
+  }
+  return t;
+}
+
+/* appends one grid point (or the field names, if v is NULL) in a structured output format
+values which are not finite are left empty (null in JSON) */
+static void putSweepRec(strBuf *sb, const int fmt, const char **names, const double *v, const int n){
+  int i;
+  if(fmt == OUT_JSON)
+    sbPutc(sb,'{');
+  for(i=0;i<n;i++){
+    if(fmt == OUT_JSON){
+      sbPuts(sb,(i > 0) ? ",\"" : "\"");
+      sbPuts(sb,names[i]);
+      sbPuts(sb,"\":");
+    }else if(i > 0){
+      sbPutc(sb,(fmt == OUT_CSV) ? ',' : '\t');
+    }
+    if(v == NULL)
+      sbPuts(sb,names[i]);
+    else if(isfinite(v[i]))
+      sbPutNum(sb,v[i]);
+    else if(fmt == OUT_JSON)
+      sbPuts(sb,"null");
+  }
+  if(fmt == OUT_JSON)
+    sbPutc(sb,'}');
+  sbPutc(sb,'\n');
+}
+
+/* calculates and writes out the grid of values given by the axes, returns 0 on success
+fmt is OUT_TEXT (with a header if verbose) or a structured record format */
+int runSweep(const bcalcTrans *t, const bcalcAxis *ax, const int verbose, const int fmt){
+
+  const size_t ne = (ax[BCALC_AXIS_ENERGY].n > 0) ? ax[BCALC_AXIS_ENERGY].n : 1;
+  const size_t nv = (ax[BCALC_AXIS_VAL].n > 0) ? ax[BCALC_AXIS_VAL].n : 1;
+  const size_t nd = (ax[BCALC_AXIS_DELTA].n > 0) ? ax[BCALC_AXIS_DELTA].n : 1;
+  const int useDelta = t->useDelta || (ax[BCALC_AXIS_DELTA].n > 0);
+  size_t rowLen, chunk, ie, iv, id, k;
+  int i;
+  double *val, *val1;
+  char (*vstr)[SWEEP_STR_LEN] = NULL, (*dstr)[SWEEP_STR_LEN] = NULL; /* formatted axis values */
+  char estr[SWEEP_STR_LEN];
+  bcalcArrOut out;
+  bcalcTrans tv;
+  strBuf sb;
+  char ustr[32], mstr1[16];
+  static const char *bNames[3] = {"B_fm","B_barn","B_wu"}, *b1Names[3] = {"B1_fm","B1_barn","B1_wu"};
+  const char *names[BCALC_NUM_AXES+2]; /* record fields */
+  double rec[BCALC_NUM_AXES+2];
+  int nf = 0;
+  int err;
+
+  if(t->calcB2){
+    printf("ERROR: --beta2 cannot be used with parameter ranges.\n");
+    return -1;
+  }
+  if((t->bup == 1)&&((t->ji == -1)||(t->jf == -1))){
+    printf("WARNING: To calculate B(%s) up, the initial and final spin must be known.\nAssuming a 2 -> 0 transition.\n",t->mstr);
+  }
+
+  /* calculate and write out whole energy rows, about SWEEP_CHUNK values at a time */
+  if(nv > ((size_t)-1)/sizeof(double)/nd){
+    printErr(BCALC_ERR_MEMORY,t);
+    return -1;
+  }
+  rowLen = nv*nd;
+  chunk = (rowLen >= SWEEP_CHUNK) ? 1 : SWEEP_CHUNK/rowLen;
+  if(chunk > ne){
+    chunk = ne;
+  }
+  val = malloc(chunk*rowLen*sizeof(double));
+  val1 = malloc(chunk*rowLen*sizeof(double));
+  /* the lifetime and mixing ratio columns repeat for every energy, format them only once */
+  vstr = malloc(nv*SWEEP_STR_LEN);
+  dstr = malloc(nd*SWEEP_STR_LEN);
+  if((val == NULL)||(val1 == NULL)||(vstr == NULL)||(dstr == NULL)){
+    free(val);
+    free(val1);
+    free(vstr);
+    free(dstr);
+    printErr(BCALC_ERR_MEMORY,t);
+    return -1;
+  }
+  for(iv=0;iv<nv;iv++){
+    vstr[iv][0] = '\0';
+    if(ax[BCALC_AXIS_VAL].n > 0)
+      snprintf(vstr[iv],SWEEP_STR_LEN,"%.6g\t",bcalcAxisVal(&ax[BCALC_AXIS_VAL],iv));
+  }
+  for(id=0;id<nd;id++){
+    dstr[id][0] = '\0';
+    if(ax[BCALC_AXIS_DELTA].n > 0)
+      snprintf(dstr[id],SWEEP_STR_LEN,"%.6g\t",bcalcAxisVal(&ax[BCALC_AXIS_DELTA],id));
+  }
+  estr[0] = '\0';
+  out.val = val;
+  out.val1 = val1;
+
+  /* check the whole grid before writing anything */
+  if((err = bcalcSweep(t,ax,0,0,&out)) != BCALC_OK){
+    printErr(err,sweepErrTrans(t,ax,err,&tv));
+    free(val);
+    free(val1);
+    free(vstr);
+    free(dstr);
+    return -1;
+  }
+
+  sbInit(&sb);
+  if(fmt != OUT_TEXT){
+    if(ax[BCALC_AXIS_ENERGY].n > 0)
+      names[nf++] = "E";
+    if(ax[BCALC_AXIS_VAL].n > 0)
+      names[nf++] = (t->calcMode == 1) ? "B_in" : "lifetime_in";
+    if(ax[BCALC_AXIS_DELTA].n > 0)
+      names[nf++] = "delta";
+    if(t->calcMode == 1){
+      names[nf++] = "lifetime";
+    }else{
+      names[nf++] = bNames[t->barn];
+      if(useDelta)
+        names[nf++] = b1Names[t->barn];
+    }
+    if(fmt != OUT_JSON)
+      putSweepRec(&sb,fmt,names,NULL,nf);
+  }else if(verbose){
+    sbPrintf(&sb,"# ");
+    if(ax[BCALC_AXIS_ENERGY].n > 0)
+      sbPrintf(&sb,"E(keV)\t");
+    if(ax[BCALC_AXIS_VAL].n > 0){
+      if(t->calcMode == 1){
+        getBUnit(ustr,sizeof(ustr),t->EM,t->L,t->barn);
+        sbPrintf(&sb,"B(%s)(%s)\t",t->mstr,ustr);
+      }else{
+        sbPrintf(&sb,"lifetime(ps)\t");
+      }
+    }
+    if(ax[BCALC_AXIS_DELTA].n > 0)
+      sbPrintf(&sb,"delta\t");
+    if(t->calcMode == 1){
+      sbPrintf(&sb,"lifetime(ps)");
+      if((t->brrel == 1)||(t->branching != 1.))
+        sbPrintf(&sb," (partial lifetime)");
+    }else{
+      getBUnit(ustr,sizeof(ustr),t->EM,t->L,t->barn);
+      sbPrintf(&sb,"B(%s)(%s)",t->mstr,ustr);
+      if(useDelta){
+        getMixedMstr(mstr1,sizeof(mstr1),t);
+        getBUnit(ustr,sizeof(ustr),!t->EM,t->L+1,t->barn);
+        sbPrintf(&sb,"\tB(%s)(%s)",mstr1,ustr);
+      }
+    }
+    sbPrintf(&sb,"\n");
+  }
+
+  for(ie=0;ie<ne;ie+=chunk){
+    if(chunk > ne - ie){
+      chunk = ne - ie;
+    }
+    if((err = bcalcSweep(t,ax,ie,chunk,&out)) != BCALC_OK){
+      sbFlush(&sb,stdout);
+      printErr(err,t);
+      break;
+    }
+    k = 0;
+    if(fmt != OUT_TEXT){
+      for(iv=0;iv<chunk*nv;iv++){
+        for(id=0;id<nd;id++){
+          i = 0;
+          if(ax[BCALC_AXIS_ENERGY].n > 0)
+            rec[i++] = bcalcAxisVal(&ax[BCALC_AXIS_ENERGY],ie + iv/nv);
+          if(ax[BCALC_AXIS_VAL].n > 0)
+            rec[i++] = bcalcAxisVal(&ax[BCALC_AXIS_VAL],iv%nv);
+          if(ax[BCALC_AXIS_DELTA].n > 0)
+            rec[i++] = bcalcAxisVal(&ax[BCALC_AXIS_DELTA],id);
+          rec[i++] = val[k];
+          if(useDelta && (t->calcMode == 0))
+            rec[i] = val1[k];
+          putSweepRec(&sb,fmt,names,rec,nf);
+          k++;
+        }
+      }
+      sbFlush(&sb,stdout);
+      continue;
+    }
+    for(iv=0;iv<chunk*nv;iv++){
+      if((iv%nv == 0)&&(ax[BCALC_AXIS_ENERGY].n > 0))
+        snprintf(estr,sizeof(estr),"%.6g\t",bcalcAxisVal(&ax[BCALC_AXIS_ENERGY],ie + iv/nv));
+      for(id=0;id<nd;id++){
+        sbPuts(&sb,estr);
+        sbPuts(&sb,vstr[iv%nv]);
+        sbPuts(&sb,dstr[id]);
+        sbPutExp(&sb,val[k],4);
+        if(useDelta && (t->calcMode == 0)){
+          sbPutc(&sb,'\t');
+          sbPutExp(&sb,val1[k],4);
+        }
+        sbPutc(&sb,'\n');
+        k++;
+      }
+    }
+    sbFlush(&sb,stdout);
+  }
+
+  sbFree(&sb);
+  free(val);
+  free(val1);
+  free(vstr);
+  free(dstr);
+  return (err == BCALC_OK) ? 0 : -1;
+}